@@ -0,0 +1,125 @@
+use criterion::{
+    BatchSize, BenchmarkId, Criterion, Throughput, black_box, criterion_group, criterion_main,
+};
+use whirl::{
+    graphics::buffer::{BufferHandle, BufferUsage},
+    math::vec4::Vec4,
+};
+
+/// Item counts of the benchmarked buffers, from 1 KiB to 16 MiB of [`Vec4`] items
+const ITEM_COUNTS: [usize; 4] = [64, 4096, 65536, 1 << 20];
+
+const USAGE: BufferUsage = BufferUsage::Vertex { is_writable: true };
+
+/// Requests a device without a surface, returns [`None`] if no adapter is available
+/// (e.g. on a CI machine without a GPU or a software rasterizer)
+fn headless_device() -> Option<(wgpu::Device, wgpu::Queue)> {
+    let instance = wgpu::Instance::default();
+    let adapter = pollster::block_on(instance.request_adapter(&wgpu::RequestAdapterOptions {
+        power_preference: wgpu::PowerPreference::HighPerformance,
+        force_fallback_adapter: false,
+        compatible_surface: None,
+    }))
+    .ok()?;
+    pollster::block_on(adapter.request_device(&wgpu::DeviceDescriptor {
+        label: Some("Benchmark device"),
+        ..Default::default()
+    }))
+    .ok()
+}
+
+fn items(count: usize) -> Vec<Vec4> {
+    (0..count)
+        .map(|i| Vec4::new(i as f32, 0.0, 1.0, 1.0))
+        .collect()
+}
+
+fn bytes(count: usize) -> u64 {
+    (count * size_of::<Vec4>()) as u64
+}
+
+fn cpu_paths(c: &mut Criterion, device: &wgpu::Device, queue: &wgpu::Queue) {
+    let mut group = c.benchmark_group("buffer");
+    for count in ITEM_COUNTS {
+        let list = items(count);
+        group.throughput(Throughput::Bytes(bytes(count)));
+
+        let mut buffer = BufferHandle::create(device, &list, USAGE, Some("Benchmark buffer"));
+        group.bench_with_input(
+            BenchmarkId::new("skip_and_write_item_list", count),
+            &list,
+            |b, list| b.iter(|| buffer.skip_and_write_item_list(0, black_box(list))),
+        );
+
+        group.bench_with_input(
+            BenchmarkId::new("extend_with_item_list", count),
+            &list,
+            |b, list| {
+                b.iter_batched(
+                    || BufferHandle::create(device, &list[..1], USAGE, Some("Benchmark buffer")),
+                    |mut buffer| {
+                        buffer.extend_with_item_list(black_box(list));
+                        buffer
+                    },
+                    BatchSize::LargeInput,
+                )
+            },
+        );
+
+        // Growing from a single item measures the reallocation and the GPU-side copy
+        group.bench_with_input(
+            BenchmarkId::new("skip_and_flush_exact_growth", count),
+            &list,
+            |b, list| {
+                b.iter_batched(
+                    || BufferHandle::create(device, &list[..1], USAGE, Some("Benchmark buffer")),
+                    |mut buffer| {
+                        buffer.extend_with_item_list(list);
+                        buffer.skip_and_flush_exact(device, queue, 0, list.len() + 1);
+                        queue.submit([]);
+                        buffer
+                    },
+                    BatchSize::LargeInput,
+                )
+            },
+        );
+    }
+    group.finish();
+}
+
+fn flush_throughput(c: &mut Criterion, device: &wgpu::Device, queue: &wgpu::Queue) {
+    let mut group = c.benchmark_group("flush");
+    for count in ITEM_COUNTS {
+        let mut buffer =
+            BufferHandle::create(device, &items(count), USAGE, Some("Benchmark buffer"));
+        group.throughput(Throughput::Bytes(bytes(count)));
+        group.bench_function(BenchmarkId::new("flush", count), |b| {
+            b.iter(|| {
+                buffer.flush(device, queue);
+                // Submitting hands the staged data to the GPU and lets wgpu reclaim it
+                queue.submit([]);
+            })
+        });
+
+        group.bench_function(BenchmarkId::new("flush_dirty_single_item", count), |b| {
+            b.iter(|| {
+                buffer.skip_and_update_item(count / 2, Vec4::new(1.0, 2.0, 3.0, 4.0));
+                black_box(buffer.flush_dirty(device, queue));
+                queue.submit([]);
+            })
+        });
+    }
+    group.finish();
+}
+
+fn benches(c: &mut Criterion) {
+    let Some((device, queue)) = headless_device() else {
+        eprintln!("No GPU adapter is available, skipping the buffer benchmarks");
+        return;
+    };
+    cpu_paths(c, &device, &queue);
+    flush_throughput(c, &device, &queue);
+}
+
+criterion_group!(buffer_benches, benches);
+criterion_main!(buffer_benches);
@@ -0,0 +1,85 @@
+use criterion::{BenchmarkId, Criterion, Throughput, black_box, criterion_group, criterion_main};
+use whirl::math::{batch::Vec3Soa, mat4::Mat4, quat::Quat, vec3::Vec3, vec4::Vec4};
+
+const BATCH_SIZES: [usize; 3] = [64, 1024, 16384];
+
+fn sample_matrix() -> Mat4 {
+    Mat4::from_trs(
+        Vec3::new(1.0, -2.0, 3.0),
+        Quat::from_euler(0.3, 1.2, -0.7),
+        Vec3::new(2.0, 0.5, 1.5),
+    )
+}
+
+fn sample_points(count: usize) -> Vec<Vec3> {
+    (0..count)
+        .map(|i| Vec3::new(i as f32, (i % 17) as f32 * 0.5, 1.0 - i as f32 * 0.25))
+        .collect()
+}
+
+fn mat4(c: &mut Criterion) {
+    let m1 = sample_matrix();
+    let m2 = Mat4::look_at(Vec3::new(3.0, 4.0, 5.0), Vec3::ZERO, Vec3::UP);
+    let v = Vec4::new(1.0, 2.0, 3.0, 1.0);
+
+    let mut group = c.benchmark_group("mat4");
+    group.bench_function("multiply_mat", |b| {
+        b.iter(|| black_box(m1).multiply_mat(&black_box(m2)))
+    });
+    group.bench_function("multiply_vec", |b| {
+        b.iter(|| black_box(m1).multiply_vec(black_box(v)))
+    });
+    group.bench_function("inverse", |b| b.iter(|| black_box(m1).inverse()));
+    group.bench_function("inverse_affine", |b| {
+        b.iter(|| black_box(m1).inverse_affine())
+    });
+    group.finish();
+}
+
+fn quat(c: &mut Criterion) {
+    let q1 = Quat::from_euler(0.3, 1.2, -0.7);
+    let q2 = Quat::from_axis(Vec3::UP, 0.5);
+
+    let mut group = c.benchmark_group("quat");
+    group.bench_function("from_euler", |b| {
+        b.iter(|| Quat::from_euler(black_box(0.3), black_box(1.2), black_box(-0.7)))
+    });
+    group.bench_function("multiply", |b| {
+        b.iter(|| black_box(q1).multiply(&black_box(q2)))
+    });
+    group.finish();
+}
+
+fn vec3(c: &mut Criterion) {
+    let v1 = Vec3::new(1.0, 2.0, 3.0);
+    let v2 = Vec3::new(-3.0, 0.5, 2.0);
+
+    let mut group = c.benchmark_group("vec3");
+    group.bench_function("normalize", |b| b.iter(|| black_box(v1).normalize()));
+    group.bench_function("cross", |b| b.iter(|| black_box(v1).cross(black_box(v2))));
+    group.finish();
+}
+
+fn batched(c: &mut Criterion) {
+    let m = sample_matrix();
+
+    let mut group = c.benchmark_group("batched");
+    for count in BATCH_SIZES {
+        let points = sample_points(count);
+        let mut out = vec![Vec3::ZERO; count];
+        let mut soa = Vec3Soa::from_slice(&points);
+        group.throughput(Throughput::Elements(count as u64));
+        group.bench_with_input(
+            BenchmarkId::new("transform_points", count),
+            &points,
+            |b, points| b.iter(|| m.transform_points(black_box(points), &mut out)),
+        );
+        group.bench_function(BenchmarkId::new("soa_transform_points", count), |b| {
+            b.iter(|| soa.transform_points(black_box(&m)))
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(benches, mat4, quat, vec3, batched);
+criterion_main!(benches);
@@ -1,20 +1,56 @@
 //! The graphics module, containing all the essential GPU abstractions and functionality.
 //!
+/// Contains functionality related to GPU uniform arenas.
+pub mod arena;
+/// Contains functionality related to GPU texture atlases.
+pub mod atlas;
+/// Contains functionality related to GPU batched pipeline creation.
+pub mod batch;
 /// Contains functionality related to GPU buffers.
 pub mod buffer;
+/// Contains functionality related to GPU render bundles.
+pub mod bundle;
+/// Contains functionality related to GPU pipeline caching.
+pub mod cache;
 /// Contains functionality related to GPU colors.
 pub mod color;
+/// Contains functionality related to GPU command recording.
+pub mod command;
+/// Contains functionality related to GPU texture containers.
+pub mod container;
 /// Contains functionality related to GPU bind groups and layouts.
 pub mod group;
+/// Contains functionality related to GPU resource identities.
+pub mod id;
 /// Contains functionality related to GPU buffer layouts.
 pub mod layout;
+/// Contains functionality related to GPU texture loading.
+pub mod loader;
+/// Contains functionality related to GPU mipmap generation.
+pub mod mipmap;
+/// Contains functionality related to GPU occlusion culling.
+pub mod occlusion;
 /// Contains functionality related to GPU render passes.
 pub mod pass;
 /// Contains functionality related to GPU pipelines.
 pub mod pipeline;
+/// Contains functionality related to GPU resource pooling.
+pub mod pool;
+/// Contains functionality related to GPU profiling.
+pub mod profiler;
+/// Contains functionality related to GPU readback.
+pub mod readback;
+/// Contains functionality related to GPU hot reloading.
+pub mod reload;
 /// Contains functionality related to GPU samplers.
 pub mod sampler;
 /// Contains functionality related to GPU shaders.
 pub mod shader;
+/// Contains functionality related to GPU sprite batching.
+pub mod sprite;
+/// Contains functionality related to GPU resource tables.
+pub mod table;
 /// Contains functionality related to GPU textures.
 pub mod texture;
+/// Contains functionality related to GPU uploads.
+pub mod upload;
@@ -0,0 +1,196 @@
+use std::marker::PhantomData;
+
+use bytemuck::Pod;
+use wgpu::{Device, Queue};
+
+use crate::graphics::{
+    buffer::{BufferHandle, BufferUsage},
+    id::ResourceId,
+};
+
+/// The largest offset alignment a device can require, used for zero padding.
+const MAX_OFFSET_ALIGNMENT: usize = 256;
+
+/// Zeroed bytes used to pad items to the arena stride.
+const PADDING: [u8; MAX_OFFSET_ALIGNMENT] = [0; MAX_OFFSET_ALIGNMENT];
+
+/// A buffer of per-draw items that are addressed through dynamic offsets.
+///
+/// Instead of creating a small buffer and a bind group per object, every item is packed
+/// into a single [`BufferHandle`] at a stride that respects the device's offset alignment,
+/// and [`UniformArena::push()`] hands back the dynamic offset of the item.
+///
+/// The arena is bound once through a bind group with a
+/// [`crate::graphics::group::BufferConfig::DynamicUniform`] (or `DynamicStorage`) entry,
+/// created with [`crate::graphics::group::BindGroupBuilder::add_uniform_arena()`],
+/// and each draw selects its item with
+/// [`crate::graphics::pass::RenderPass::use_bind_group_with_offsets()`]:
+///
+/// ```rust
+/// arena.clear();
+/// let offsets: Vec<u32> = objects.iter().map(|object| arena.push(object.uniforms())).collect();
+/// arena.flush(&device, &queue);
+/// for offset in offsets {
+///     pass.use_bind_group_with_offsets(1, &object_group, &[offset]);
+///     pass.draw_indexed(index_count, 1);
+/// }
+/// ```
+///
+/// When the arena grows, its GPU buffer is recreated, so bind groups referencing it
+/// need to be rebuilt, compare [`UniformArena::id()`] to detect that.
+#[derive(Debug)]
+pub struct UniformArena<T: Pod> {
+    /// The byte buffer holding the padded items
+    buffer: BufferHandle<u8>,
+    /// The distance between two items in bytes
+    stride: usize,
+    /// The amount of items pushed since the last clear
+    item_count: usize,
+    _marker: PhantomData<T>,
+}
+
+impl<T: Pod> UniformArena<T> {
+    /// Creates a new [`UniformArena`] that can initially hold `item_capacity` items.
+    /// - `device` -> the raw [`wgpu::Device`] which is needed to create GPU resources
+    /// - `item_capacity` -> the initial amount of items, the arena grows if needed
+    /// - `usage` -> either [`BufferUsage::Uniform`] or [`BufferUsage::Storage`],
+    ///   which determines the offset alignment
+    /// - `label` -> the optional debugging label of the buffer
+    ///
+    /// # Panics:
+    /// - If `item_capacity` is equal to zero.
+    /// - If `usage` is not a writable uniform or storage usage.
+    /// - If `T` is a zero-sized type.
+    pub fn new(
+        device: &Device,
+        item_capacity: usize,
+        usage: BufferUsage,
+        label: Option<&str>,
+    ) -> Self {
+        assert!(
+            size_of::<T>() > 0,
+            "Cannot create an arena of zero-sized items!"
+        );
+        let limits = device.limits();
+        let alignment = match usage {
+            BufferUsage::Uniform { is_writable: true } => {
+                limits.min_uniform_buffer_offset_alignment
+            }
+            BufferUsage::Storage { is_writable: true } => {
+                limits.min_storage_buffer_offset_alignment
+            }
+            _ => panic!("An arena requires a writable uniform or storage usage!"),
+        };
+        let stride = align_to(size_of::<T>(), alignment as usize);
+        Self {
+            buffer: BufferHandle::allocate(device, item_capacity * stride, usage, label),
+            stride,
+            item_count: 0,
+            _marker: PhantomData,
+        }
+    }
+
+    /// Pushes an item into the arena and returns its dynamic offset.
+    ///
+    /// This function does not flush, call [`UniformArena::flush()`] before submitting draws.
+    pub fn push(&mut self, item: T) -> u32 {
+        let offset = self.item_count * self.stride;
+        let padding = self.stride - size_of::<T>();
+        self.buffer
+            .skip_and_write_item_list(offset, bytemuck::bytes_of(&item));
+        if padding > 0 {
+            self.buffer
+                .skip_and_write_item_list(offset + size_of::<T>(), &PADDING[..padding]);
+        }
+        self.item_count += 1;
+        offset as u32
+    }
+
+    /// Overwrites the item at `index`.
+    ///
+    /// # Panics:
+    /// - If `index` is out of bounds.
+    pub fn set(&mut self, index: usize, item: T) {
+        assert!(
+            index < self.item_count,
+            "Cannot set arena item {} out of {} items!",
+            index,
+            self.item_count
+        );
+        // The whole stride is marked, so the flushed range stays aligned like the pushed one
+        let offset = self.offset(index) as usize;
+        let padding = self.stride - size_of::<T>();
+        self.buffer
+            .skip_and_update_item_list(offset, bytemuck::bytes_of(&item));
+        if padding > 0 {
+            self.buffer
+                .skip_and_update_item_list(offset + size_of::<T>(), &PADDING[..padding]);
+        }
+    }
+
+    /// Removes all items from the arena, the GPU buffer keeps its capacity
+    /// and the next pushes overwrite the old items.
+    pub fn clear(&mut self) {
+        self.item_count = 0;
+    }
+
+    /// Uploads the items that changed since the last flush, growing the GPU buffer if needed.
+    ///
+    /// Returns the amount of bytes uploaded.
+    pub fn flush(&mut self, device: &Device, queue: &Queue) -> u64 {
+        self.buffer.flush_dirty(device, queue)
+    }
+
+    /// Returns the dynamic offset of the item at `index`
+    pub fn offset(&self, index: usize) -> u32 {
+        (index * self.stride) as u32
+    }
+
+    /// Returns the size of a single binding in bytes, which is the size of `T`
+    pub fn binding_size(&self) -> u64 {
+        size_of::<T>() as u64
+    }
+
+    /// Returns the distance between two items in bytes
+    pub fn stride(&self) -> usize {
+        self.stride
+    }
+
+    /// Returns the amount of items pushed since the last clear
+    pub fn len(&self) -> usize {
+        self.item_count
+    }
+
+    /// Returns `true` if no items were pushed since the last clear
+    pub fn is_empty(&self) -> bool {
+        self.item_count == 0
+    }
+
+    /// Returns the underlying byte buffer
+    pub fn buffer(&self) -> &BufferHandle<u8> {
+        &self.buffer
+    }
+
+    /// Returns the [`ResourceId`] of the GPU buffer, which changes when the arena grows
+    pub fn id(&self) -> ResourceId {
+        self.buffer.id()
+    }
+}
+
+/// Aligns `value` up to the next multiple of `alignment`.
+fn align_to(value: usize, alignment: usize) -> usize {
+    value.div_ceil(alignment) * alignment
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn stride_alignment() {
+        assert_eq!(align_to(64, 256), 256);
+        assert_eq!(align_to(256, 256), 256);
+        assert_eq!(align_to(257, 256), 512);
+        assert_eq!(align_to(12, 4), 12);
+    }
+}
@@ -0,0 +1,354 @@
+use crate::graphics::texture::{
+    MipPolicy, Texture, TextureDescriptor, TextureDimension, TextureError, TextureFormat,
+    TextureSource, TextureUsage,
+};
+
+/// Describes a texture atlas
+#[derive(Debug)]
+pub struct AtlasDescriptor<'a> {
+    /// The optional debugging label of the atlas texture
+    pub label: Option<&'a str>,
+    /// The width of every atlas layer (in pixels)
+    pub width: u32,
+    /// The height of every atlas layer (in pixels)
+    pub height: u32,
+    /// The amount of layers of the atlas, new layers are filled once the previous ones are full
+    pub layers: u32,
+    /// The uncompressed format of the atlas texture
+    pub format: TextureFormat,
+    /// The empty border kept around every sub-image (in pixels),
+    /// which stops linear filtering from bleeding neighbouring sub-images into each other
+    pub padding: u32,
+}
+
+/// Packs many small images into the layers of a single 2D array texture
+///
+/// Drawing sprites from an atlas only needs a single bind group for all of them,
+/// instead of one texture and bind group per sprite.
+///
+/// Sub-images are packed into shelves, rows as high as their first sub-image,
+/// and every insert is uploaded with a partial texture write.
+#[derive(Debug)]
+pub struct TextureAtlas {
+    /// The atlas texture
+    texture: Texture,
+    /// The packers of every layer
+    layers: Vec<ShelfPacker>,
+    /// The border kept around every sub-image
+    padding: u32,
+    /// The amount of sub-images in the atlas
+    len: usize,
+}
+
+/// Describes where a sub-image lives inside of a [`TextureAtlas`]
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct AtlasRegion {
+    /// The horizontal offset of the sub-image (in pixels)
+    pub x: u32,
+    /// The vertical offset of the sub-image (in pixels)
+    pub y: u32,
+    /// The atlas layer the sub-image is in
+    pub layer: u32,
+    /// The width of the sub-image (in pixels)
+    pub width: u32,
+    /// The height of the sub-image (in pixels)
+    pub height: u32,
+    /// The normalized texture coordinates of the sub-image
+    pub uv: UvRect,
+}
+
+/// Describes a rectangle of normalized texture coordinates
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct UvRect {
+    /// The top left texture coordinate
+    pub min: [f32; 2],
+    /// The bottom right texture coordinate
+    pub max: [f32; 2],
+}
+
+/// Packs rectangles into horizontal shelves of a fixed area
+#[derive(Debug)]
+struct ShelfPacker {
+    /// The width of the packed area
+    width: u32,
+    /// The height of the packed area
+    height: u32,
+    /// The shelves opened so far, from top to bottom
+    shelves: Vec<Shelf>,
+    /// The vertical offset where the next shelf opens
+    next_y: u32,
+}
+
+/// Describes a row of packed rectangles
+#[derive(Debug)]
+struct Shelf {
+    /// The vertical offset of the shelf
+    y: u32,
+    /// The height of the shelf
+    height: u32,
+    /// The width taken up by the rectangles of the shelf
+    used_width: u32,
+}
+
+impl TextureAtlas {
+    /// Attempts to create a new empty [`TextureAtlas`], returns a [`TextureError`] upon failure
+    /// - `device` -> the [`wgpu::Device`] needed to create the atlas texture
+    /// - `queue` -> the [`wgpu::Queue`] needed to create the atlas texture
+    /// - `descriptor` -> the [`AtlasDescriptor`] of the atlas
+    ///
+    /// # Panics:
+    /// - If the atlas has zero layers.
+    /// - If the atlas format is compressed.
+    pub fn new(
+        device: &wgpu::Device,
+        queue: &wgpu::Queue,
+        descriptor: AtlasDescriptor,
+    ) -> Result<Self, TextureError> {
+        assert!(
+            !descriptor.format.is_compressed(),
+            "Texture atlases can't have a compressed format!"
+        );
+        let texture = TextureDescriptor {
+            label: descriptor.label,
+            dimension: TextureDimension::D2Array {
+                layers: descriptor.layers,
+            },
+            usage: TextureUsage::Image {
+                is_writable: true,
+                is_readable: false,
+            },
+            source: TextureSource::Blank {
+                width: descriptor.width,
+                height: descriptor.height,
+                format: descriptor.format,
+            },
+            mipmaps: MipPolicy::None,
+        }
+        .build(device, queue)?;
+        Ok(Self {
+            texture,
+            layers: (0..descriptor.layers)
+                .map(|_| ShelfPacker::new(descriptor.width, descriptor.height))
+                .collect(),
+            padding: descriptor.padding,
+            len: 0,
+        })
+    }
+
+    /// Packs a sub-image into the atlas and uploads its pixels,
+    /// returns [`None`] if there's no room left for it
+    /// - `queue` -> the [`wgpu::Queue`] the upload is scheduled on
+    /// - `width` -> the width of the sub-image (in pixels)
+    /// - `height` -> the height of the sub-image (in pixels)
+    /// - `bytes` -> the tightly packed pixels of the sub-image, in the atlas format
+    ///
+    /// # Panics:
+    /// - If the amount of bytes doesn't match the sub-image size.
+    pub fn insert(
+        &mut self,
+        queue: &wgpu::Queue,
+        width: u32,
+        height: u32,
+        bytes: &[u8],
+    ) -> Option<AtlasRegion> {
+        let region = self.allocate(width, height)?;
+        self.texture.write_region(
+            queue,
+            (region.x, region.y, region.layer),
+            (width, height),
+            bytes,
+        );
+        Some(region)
+    }
+
+    /// Reserves room for a sub-image without uploading anything,
+    /// returns [`None`] if there's no room left for it
+    ///
+    /// This is useful when the sub-image gets rendered into the atlas instead.
+    pub fn allocate(&mut self, width: u32, height: u32) -> Option<AtlasRegion> {
+        let padded_width = width + self.padding * 2;
+        let padded_height = height + self.padding * 2;
+        let (layer, (x, y)) = self
+            .layers
+            .iter_mut()
+            .enumerate()
+            .find_map(|(layer, packer)| {
+                packer
+                    .allocate(padded_width, padded_height)
+                    .map(|position| (layer as u32, position))
+            })?;
+        self.len += 1;
+        let size = self.texture.size();
+        Some(AtlasRegion::new(
+            x + self.padding,
+            y + self.padding,
+            layer,
+            width,
+            height,
+            (size.width, size.height),
+        ))
+    }
+
+    /// Forgets every sub-image so the atlas can be packed again,
+    /// the old pixels stay in the texture until they're overwritten
+    pub fn clear(&mut self) {
+        self.layers.iter_mut().for_each(ShelfPacker::clear);
+        self.len = 0;
+    }
+
+    /// Returns a reference to the atlas [`Texture`]
+    pub fn texture(&self) -> &Texture {
+        &self.texture
+    }
+
+    /// Returns a reference to the 2D array view of the atlas texture
+    pub fn view(&self) -> &wgpu::TextureView {
+        self.texture.view()
+    }
+
+    /// Returns the amount of sub-images in the atlas
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    /// Returns `true` if the atlas has no sub-images
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+}
+
+impl AtlasRegion {
+    /// Creates a new [`AtlasRegion`] of an atlas of size `atlas_size`,
+    /// computing the texture coordinates of the sub-image
+    fn new(x: u32, y: u32, layer: u32, width: u32, height: u32, atlas_size: (u32, u32)) -> Self {
+        let (atlas_width, atlas_height) = (atlas_size.0 as f32, atlas_size.1 as f32);
+        Self {
+            x,
+            y,
+            layer,
+            width,
+            height,
+            uv: UvRect {
+                min: [x as f32 / atlas_width, y as f32 / atlas_height],
+                max: [
+                    (x + width) as f32 / atlas_width,
+                    (y + height) as f32 / atlas_height,
+                ],
+            },
+        }
+    }
+}
+
+impl ShelfPacker {
+    /// Creates a new empty [`ShelfPacker`] of `width` x `height`
+    fn new(width: u32, height: u32) -> Self {
+        Self {
+            width,
+            height,
+            shelves: Vec::new(),
+            next_y: 0,
+        }
+    }
+
+    /// Packs a rectangle, returning its top left corner or [`None`] if it doesn't fit
+    ///
+    /// The rectangle goes into the lowest shelf it fits in, to waste the least height,
+    /// a new shelf is only opened when no existing shelf has room for it.
+    fn allocate(&mut self, width: u32, height: u32) -> Option<(u32, u32)> {
+        if width == 0 || height == 0 || width > self.width {
+            return None;
+        }
+
+        let best_shelf = self
+            .shelves
+            .iter_mut()
+            .filter(|shelf| shelf.height >= height && self.width - shelf.used_width >= width)
+            .min_by_key(|shelf| shelf.height);
+        if let Some(shelf) = best_shelf {
+            let x = shelf.used_width;
+            shelf.used_width += width;
+            return Some((x, shelf.y));
+        }
+
+        if self.height - self.next_y < height {
+            return None;
+        }
+        let y = self.next_y;
+        self.shelves.push(Shelf {
+            y,
+            height,
+            used_width: width,
+        });
+        self.next_y += height;
+        Some((0, y))
+    }
+
+    /// Removes every shelf
+    fn clear(&mut self) {
+        self.shelves.clear();
+        self.next_y = 0;
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn overlaps(a: (u32, u32, u32, u32), b: (u32, u32, u32, u32)) -> bool {
+        a.0 < b.0 + b.2 && b.0 < a.0 + a.2 && a.1 < b.1 + b.3 && b.1 < a.1 + a.3
+    }
+
+    #[test]
+    fn shelves_fill_rows_first() {
+        let mut packer = ShelfPacker::new(64, 64);
+        assert_eq!(packer.allocate(32, 16), Some((0, 0)));
+        assert_eq!(packer.allocate(32, 8), Some((32, 0)));
+        assert_eq!(packer.allocate(16, 16), Some((0, 16)));
+        assert_eq!(packer.allocate(8, 8), Some((16, 16)));
+    }
+
+    #[test]
+    fn lowest_fitting_shelf_is_picked() {
+        let mut packer = ShelfPacker::new(64, 64);
+        assert_eq!(packer.allocate(16, 32), Some((0, 0)));
+        assert_eq!(packer.allocate(56, 8), Some((0, 32)));
+        assert_eq!(packer.allocate(8, 8), Some((56, 32)));
+        assert_eq!(packer.allocate(8, 8), Some((16, 0)));
+    }
+
+    #[test]
+    fn full_packer_rejects() {
+        let mut packer = ShelfPacker::new(32, 32);
+        assert_eq!(packer.allocate(33, 1), None);
+        assert_eq!(packer.allocate(0, 4), None);
+        assert_eq!(packer.allocate(32, 32), Some((0, 0)));
+        assert_eq!(packer.allocate(1, 1), None);
+        packer.clear();
+        assert_eq!(packer.allocate(1, 1), Some((0, 0)));
+    }
+
+    #[test]
+    fn packed_rects_never_overlap() {
+        let mut packer = ShelfPacker::new(128, 128);
+        let mut rects = Vec::new();
+        for i in 0..200u32 {
+            let (width, height) = (4 + i * 7 % 13, 4 + i * 5 % 11);
+            if let Some((x, y)) = packer.allocate(width, height) {
+                assert!(x + width <= 128 && y + height <= 128);
+                rects.push((x, y, width, height));
+            }
+        }
+        for (i, a) in rects.iter().enumerate() {
+            for b in &rects[i + 1..] {
+                assert!(!overlaps(*a, *b), "{a:?} overlaps {b:?}");
+            }
+        }
+    }
+
+    #[test]
+    fn region_uvs() {
+        let region = AtlasRegion::new(64, 32, 1, 64, 32, (256, 128));
+        assert_eq!(region.uv.min, [0.25, 0.25]);
+        assert_eq!(region.uv.max, [0.5, 0.5]);
+    }
+}
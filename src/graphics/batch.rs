@@ -0,0 +1,212 @@
+use std::{
+    collections::VecDeque,
+    fs, io,
+    path::Path,
+    sync::{Arc, Mutex, OnceLock},
+    thread,
+};
+
+use crate::graphics::{
+    pipeline::{ComputePipeline, ComputePipelineDescriptor, Pipeline, PipelineDescriptor},
+    shader::Shader,
+};
+
+/// Creates shaders and pipelines across a pool of worker threads.
+///
+/// Compiling pipelines is done by the driver on the calling thread, so building hundreds of them
+/// one after another keeps the main thread busy for a long time while the other cores sit idle.
+/// Since [`wgpu::Device`] is `Send + Sync`, the work can be spread across multiple threads instead.
+///
+/// There are two ways to use the batch:
+/// - [`PipelineBatch::build_all()`] and [`PipelineBatch::load_shaders()`] block until everything
+///   is created, but do the work in parallel.
+/// - [`PipelineBatch::spawn()`] returns right away with a [`PendingPipeline`] per job,
+///   which lets rendering start with a fallback pipeline while the rest compile.
+#[derive(Debug)]
+pub struct PipelineBatch;
+
+/// Describes a shader that should be loaded by [`PipelineBatch::load_shaders()`]
+#[derive(Debug, Clone, Copy)]
+pub struct ShaderRequest<'a> {
+    /// The path of the shader file to read
+    pub path: &'a Path,
+    /// The optional debugging label of the shader
+    pub label: Option<&'a str>,
+}
+
+/// A handle to a pipeline (or any other value) that is being created on a worker thread.
+///
+/// The handle is cheap to clone, all clones refer to the same pipeline.
+/// If the job creating the pipeline panics, the handle never becomes ready.
+#[derive(Debug)]
+pub struct PendingPipeline<T = Pipeline> {
+    /// The slot the worker thread stores the created pipeline in
+    slot: Arc<OnceLock<T>>,
+}
+
+/// A job for [`PipelineBatch::spawn()`] that creates a value using the [`wgpu::Device`]
+type Job<T> = Box<dyn FnOnce(&wgpu::Device) -> T + Send>;
+
+impl PipelineBatch {
+    /// Builds all pipelines in parallel, returning them in the same order as `descriptors`.
+    /// - `device` -> the raw [`wgpu::Device`] which is needed to build GPU resources
+    /// - `descriptors` -> the [`PipelineDescriptor`]s of the pipelines to build
+    pub fn build_all(device: &wgpu::Device, descriptors: Vec<PipelineDescriptor>) -> Vec<Pipeline> {
+        parallel_map(descriptors, |descriptor| descriptor.build(device))
+    }
+
+    /// Builds all compute pipelines in parallel, returning them in the same order as `descriptors`.
+    /// - `device` -> the raw [`wgpu::Device`] which is needed to build GPU resources
+    /// - `descriptors` -> the [`ComputePipelineDescriptor`]s of the pipelines to build
+    pub fn build_all_compute(
+        device: &wgpu::Device,
+        descriptors: Vec<ComputePipelineDescriptor>,
+    ) -> Vec<ComputePipeline> {
+        parallel_map(descriptors, |descriptor| descriptor.build(device))
+    }
+
+    /// Reads and creates all shaders in parallel, returning them in the same order as `requests`.
+    /// - `device` -> the raw [`wgpu::Device`] which is needed to create GPU resources
+    /// - `requests` -> the [`ShaderRequest`]s describing the shaders to load
+    ///
+    /// A shader that fails to load doesn't stop the others from loading.
+    pub fn load_shaders(
+        device: &wgpu::Device,
+        requests: &[ShaderRequest],
+    ) -> Vec<io::Result<Shader>> {
+        parallel_map(requests.to_vec(), |request| {
+            let source = fs::read_to_string(request.path)?;
+            Ok(Shader::from_wgsl(device, source, request.label))
+        })
+    }
+
+    /// Spawns `jobs` onto background worker threads and returns right away.
+    /// - `device` -> the raw [`wgpu::Device`] which is passed to every job
+    /// - `jobs` -> the closures creating the pipelines, usually owning `Arc`s of
+    ///   the shaders and layouts they need
+    ///
+    /// Returns a [`PendingPipeline`] per job, in the same order as `jobs`.
+    pub fn spawn<T, F>(device: &wgpu::Device, jobs: Vec<F>) -> Vec<PendingPipeline<T>>
+    where
+        T: Send + Sync + 'static,
+        F: FnOnce(&wgpu::Device) -> T + Send + 'static,
+    {
+        let pending: Vec<_> = (0..jobs.len()).map(|_| PendingPipeline::new()).collect();
+        let workers = worker_count(jobs.len());
+        let queue: VecDeque<(Job<T>, Arc<OnceLock<T>>)> = jobs
+            .into_iter()
+            .zip(&pending)
+            .map(|(job, pending)| (Box::new(job) as Job<T>, Arc::clone(&pending.slot)))
+            .collect();
+        let queue = Arc::new(Mutex::new(queue));
+
+        for _ in 0..workers {
+            let queue = Arc::clone(&queue);
+            let device = device.clone();
+            thread::spawn(move || {
+                loop {
+                    // The lock is only held while popping, so jobs run concurrently
+                    let next = queue.lock().expect("Poisoned job queue").pop_front();
+                    let Some((job, slot)) = next else {
+                        break;
+                    };
+                    let _ = slot.set(job(&device));
+                }
+            });
+        }
+        pending
+    }
+}
+
+impl<T> PendingPipeline<T> {
+    /// Creates a new [`PendingPipeline`] that isn't ready yet
+    fn new() -> Self {
+        Self {
+            slot: Arc::new(OnceLock::new()),
+        }
+    }
+
+    /// Returns the pipeline if it has finished building
+    pub fn get(&self) -> Option<&T> {
+        self.slot.get()
+    }
+
+    /// Returns the pipeline if it has finished building, `fallback` otherwise
+    pub fn get_or<'a>(&'a self, fallback: &'a T) -> &'a T {
+        self.slot.get().unwrap_or(fallback)
+    }
+
+    /// Returns `true` if the pipeline has finished building
+    pub fn is_ready(&self) -> bool {
+        self.slot.get().is_some()
+    }
+}
+
+impl<T> Clone for PendingPipeline<T> {
+    fn clone(&self) -> Self {
+        Self {
+            slot: Arc::clone(&self.slot),
+        }
+    }
+}
+
+/// Returns the amount of worker threads to use for `jobs` jobs
+fn worker_count(jobs: usize) -> usize {
+    let cores = thread::available_parallelism().map_or(1, |cores| cores.get());
+    cores.min(jobs)
+}
+
+/// Maps `items` with `f` across scoped worker threads, preserving the order of `items`
+fn parallel_map<I, O, F>(items: Vec<I>, f: F) -> Vec<O>
+where
+    I: Send,
+    O: Send,
+    F: Fn(I) -> O + Sync,
+{
+    let workers = worker_count(items.len());
+    if workers <= 1 {
+        return items.into_iter().map(f).collect();
+    }
+
+    // Split the items into contiguous chunks, one per worker
+    let chunk_size = items.len().div_ceil(workers);
+    let mut chunks = Vec::with_capacity(workers);
+    let mut items = items.into_iter();
+    loop {
+        let chunk: Vec<I> = items.by_ref().take(chunk_size).collect();
+        if chunk.is_empty() {
+            break;
+        }
+        chunks.push(chunk);
+    }
+
+    let f = &f;
+    thread::scope(|scope| {
+        let handles: Vec<_> = chunks
+            .into_iter()
+            .map(|chunk| scope.spawn(move || chunk.into_iter().map(f).collect::<Vec<O>>()))
+            .collect();
+        handles
+            .into_iter()
+            .flat_map(|handle| handle.join().expect("Pipeline worker thread panicked"))
+            .collect()
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn parallel_map_preserves_order() {
+        let items: Vec<u32> = (0..1000).collect();
+        let mapped = parallel_map(items, |item| item * 2);
+        assert_eq!(mapped, (0..1000).map(|item| item * 2).collect::<Vec<_>>());
+    }
+
+    #[test]
+    fn parallel_map_empty() {
+        let mapped = parallel_map(Vec::<u32>::new(), |item| item);
+        assert!(mapped.is_empty());
+    }
+}
@@ -1,11 +1,17 @@
-use std::fmt::Debug;
+use std::{borrow::Cow, fmt::Debug, ops::Range};
 
 use bytemuck::Pod;
 use wgpu::{
-    BufferDescriptor, Device, Queue,
+    BufferDescriptor, CommandEncoder, Device, Queue,
     util::{BufferInitDescriptor, DeviceExt},
 };
 
+use crate::graphics::{
+    id::ResourceId,
+    readback::{Readback, ReadbackPool},
+    upload::UploadBelt,
+};
+
 /// A handle to a buffer on the GPU.
 ///
 /// A buffer is used for any kind of data that needs to be provided to
@@ -17,6 +23,8 @@ use wgpu::{
 /// - [`BufferUsage::Vertex`]
 /// - [`BufferUsage::Uniform`]
 /// - [`BufferUsage::Storage`]
+/// - [`BufferUsage::ReadWriteStorage`]
+/// - [`BufferUsage::Indirect`]
 ///
 /// The buffer API is designed around the concepts of "items", where an item
 /// is an instance of the type the buffer has, for example:
@@ -104,12 +112,51 @@ use wgpu::{
 /// - [`BufferHandle::nuke_and_flush()`]
 ///
 /// All of that functionality is available if needed.
+///
+/// On top of that, every non-flushing method records the range of items it touched
+/// as a "dirty range", nearby dirty ranges are coalesced together based on the merge gap
+/// (see [`BufferHandle::set_merge_gap()`]), which allows the buffer to be flushed
+/// with only the items that actually changed:
+/// - [`BufferHandle::flush_dirty()`]
+///
+/// This is especially useful for large instance buffers that get sparsely updated every frame,
+/// since only the minimal set of ranges gets uploaded to the GPU.
+///
+/// The amount of bytes uploaded by the last flush can be queried with
+/// [`BufferHandle::last_flush_bytes()`].
+///
+/// Whenever the items outgrow the capacity of the buffer, the buffer grows based on its
+/// [`BufferGrowth`] policy (see [`BufferHandle::set_growth()`]), the old contents are copied
+/// over on the GPU so only the new items have to be uploaded, to avoid growing in the middle
+/// of a frame, the buffer can be pre-sized with [`BufferHandle::reserve()`].
+///
+/// Every flush method goes through [`wgpu::Queue::write_buffer()`] by default, which allocates
+/// staging memory for each call, if a lot of buffers are flushed every frame, the `*_with()`
+/// variants can be used instead, which write through a reusable [`UploadBelt`]:
+/// - [`BufferHandle::flush_with()`]
+/// - [`BufferHandle::skip_and_flush_exact_with()`]
+/// - [`BufferHandle::flush_dirty_with()`]
+///
+/// By default, a buffer keeps a CPU-side copy of its items (a mirror), which is what
+/// allows all of the non-flushing methods to exist, but this doubles the memory needed
+/// for large buffers, so the mirror can be opted out of with a [`BufferStorage`]:
+/// - [`BufferStorage::Mirrored`] keeps the CPU mirror (the default)
+/// - [`BufferStorage::WriteOnly`] writes straight through to the GPU with no mirror
+/// - [`BufferStorage::DiscardAfterCreate`] drops the contents after creation (immutable geometry)
+///
+/// See [`BufferHandle::allocate_with_storage()`] and [`BufferHandle::create_with_storage()`].
 #[derive(Debug)]
 pub struct BufferHandle<T: Pod> {
     item_list: Vec<T>,
+    item_count: usize,
     item_capacity: usize,
+    storage: BufferStorage,
     usage: BufferUsage,
     raw: wgpu::Buffer,
+    id: ResourceId,
+    dirty_ranges: DirtyRanges,
+    last_flush_bytes: u64,
+    growth: BufferGrowth,
 }
 
 impl<T: Pod> BufferHandle<T> {
@@ -123,19 +170,31 @@ impl<T: Pod> BufferHandle<T> {
         item_capacity: usize,
         usage: BufferUsage,
         label: Option<&str>,
+    ) -> Self {
+        Self::allocate_with_storage(device, item_capacity, usage, BufferStorage::Mirrored, label)
+    }
+
+    /// Allocates a new buffer that can hold initially hold `item_capacity` items,
+    /// with the specified [`BufferStorage`] mode.
+    ///
+    /// # Panics:
+    /// - If `item_capacity` is equal to zero.
+    /// - If `storage` is [`BufferStorage::DiscardAfterCreate`], since an allocated buffer has no contents.
+    pub fn allocate_with_storage(
+        device: &Device,
+        item_capacity: usize,
+        usage: BufferUsage,
+        storage: BufferStorage,
+        label: Option<&str>,
     ) -> Self {
         assert!(item_capacity > 0, "Item capacity cannot be zero!");
-        Self {
-            usage,
-            item_capacity,
-            raw: device.create_buffer(&wgpu::BufferDescriptor {
-                label,
-                size: item_capacity as u64 * size_of::<T>() as u64,
-                usage: usage.raw(),
-                mapped_at_creation: false,
-            }),
-            item_list: Vec::with_capacity(item_capacity),
-        }
+        let raw = device.create_buffer(&wgpu::BufferDescriptor {
+            label,
+            size: aligned_buffer_size(item_capacity as u64 * size_of::<T>() as u64),
+            usage: usage.raw(),
+            mapped_at_creation: false,
+        });
+        Self::from_raw(raw, item_capacity, usage, storage)
     }
 
     /// Creates a new buffer with the contents of `item_list`.
@@ -150,6 +209,21 @@ impl<T: Pod> BufferHandle<T> {
         item_list: &[T],
         usage: BufferUsage,
         label: Option<&str>,
+    ) -> Self {
+        Self::create_with_storage(device, item_list, usage, BufferStorage::Mirrored, label)
+    }
+
+    /// Creates a new buffer with the contents of `item_list`,
+    /// with the specified [`BufferStorage`] mode.
+    ///
+    /// # Panics:
+    /// - If `item_list` is an empty slice.
+    pub fn create_with_storage(
+        device: &Device,
+        item_list: &[T],
+        usage: BufferUsage,
+        storage: BufferStorage,
+        label: Option<&str>,
     ) -> Self {
         assert!(
             !item_list.is_empty(),
@@ -157,13 +231,23 @@ impl<T: Pod> BufferHandle<T> {
         );
         Self {
             usage,
+            item_count: item_list.len(),
             item_capacity: item_list.len(),
+            storage,
             raw: device.create_buffer_init(&BufferInitDescriptor {
                 label,
                 contents: bytemuck::cast_slice(item_list),
                 usage: usage.raw(),
             }),
-            item_list: Vec::from(item_list),
+            id: ResourceId::next(),
+            item_list: if storage.is_mirrored() {
+                Vec::from(item_list)
+            } else {
+                Vec::new()
+            },
+            dirty_ranges: DirtyRanges::new(DEFAULT_MERGE_GAP),
+            last_flush_bytes: 0,
+            growth: BufferGrowth::Double,
         }
     }
 
@@ -199,18 +283,25 @@ impl<T: Pod> BufferHandle<T> {
     /// Or simply use [`BufferHandle::skip_and_write_item_list_and_flush()`] for an immediate flush.
     ///
     /// # Panics:
+    /// - If the buffer has no CPU mirror.
     /// - If the `item_list` is empty.
     pub fn skip_and_write_item_list(&mut self, items_to_skip: usize, item_list: &[T]) {
+        self.assert_mirrored();
         assert!(
             !item_list.is_empty(),
             "Cannot write an empty slice to the buffer!"
         );
         let required_length = items_to_skip + item_list.len();
+        // The zeroed gap between the old end of the buffer and the written items
+        // has never been uploaded, so it's dirty as well
+        let dirty_start = items_to_skip.min(self.item_list.len());
         if self.item_list.len() < required_length {
             self.item_list.resize(required_length, T::zeroed());
         }
 
         self.item_list[items_to_skip..required_length].copy_from_slice(item_list);
+        self.item_count = self.item_list.len();
+        self.dirty_ranges.mark(dirty_start..required_length);
     }
 
     /// Skips `items_to_skip` items in the buffer and updates an existing item.
@@ -225,6 +316,7 @@ impl<T: Pod> BufferHandle<T> {
     /// Or simply use [`BufferHandle::skip_and_update_item_and_flush()`] for an immediate flush.
     ///
     /// # Panics:
+    /// - If the buffer has no CPU mirror.
     /// - If `items_to_skip` is equal to or exceeds the length of the buffer.
     pub fn skip_and_update_item(&mut self, items_to_skip: usize, item: T) {
         self.skip_and_update_item_list(items_to_skip, &[item]);
@@ -242,9 +334,11 @@ impl<T: Pod> BufferHandle<T> {
     /// Or simply use [`BufferHandle::skip_and_update_item_and_flush()`] for an immediate flush.
     ///
     /// # Panics:
+    /// - If the buffer has no CPU mirror.
     /// - If `items_to_skip` plus the length of the `item_list`
     ///   exceeds the length of the buffer.
     pub fn skip_and_update_item_list(&mut self, items_to_skip: usize, item_list: &[T]) {
+        self.assert_mirrored();
         assert!(
             !item_list.is_empty(),
             "Cannot update the buffer with an empty slice!"
@@ -256,6 +350,7 @@ impl<T: Pod> BufferHandle<T> {
         let start_index = items_to_skip;
         let end_index = items_to_skip + item_list.len();
         self.item_list[start_index..end_index].copy_from_slice(item_list);
+        self.dirty_ranges.mark(start_index..end_index);
     }
 
     /// Extends the buffer with a list of items.
@@ -302,12 +397,18 @@ impl<T: Pod> BufferHandle<T> {
     /// # Constraints:
     /// - `length` must be greater than zero.
     /// - `length` must be smaller than the item count of the buffer.
+    ///
+    /// # Panics:
+    /// - If the buffer has no CPU mirror.
     pub fn truncate(&mut self, length: usize) {
+        self.assert_mirrored();
         assert!(
             length > 0 && length < self.item_list.len(),
             "Cannot truncate buffer out of bounds!"
         );
         self.item_list.truncate(length);
+        self.item_count = length;
+        self.dirty_ranges.truncate(length);
     }
 
     /// Overwrites the buffer with the contents of `item_list`.
@@ -318,14 +419,19 @@ impl<T: Pod> BufferHandle<T> {
     /// or simply use [`BufferHandle::overwrite_and_flush()`] for an immediate flush.
     ///
     /// # Panics:
+    /// - If the buffer has no CPU mirror.
     /// - If `item_list` is empty.
     pub fn overwrite(&mut self, item_list: &[T]) {
+        self.assert_mirrored();
         assert!(
             !item_list.is_empty(),
             "Cannot overwrite the buffer with an empty slice!"
         );
         self.item_list.clear();
         self.item_list.extend_from_slice(item_list);
+        self.item_count = self.item_list.len();
+        self.dirty_ranges.clear();
+        self.dirty_ranges.mark(0..self.item_list.len());
     }
 
     /// Nukes the buffer, in other words, replaces the contents of the entire buffer
@@ -337,8 +443,13 @@ impl<T: Pod> BufferHandle<T> {
     /// or simply use [`BufferHandle::nuke_and_flush()`] instead.
     ///
     /// What this function actually does is subject to change.
+    ///
+    /// # Panics:
+    /// - If the buffer has no CPU mirror.
     pub fn nuke(&mut self) {
+        self.assert_mirrored();
         self.item_list.fill(T::zeroed());
+        self.dirty_ranges.mark(0..self.item_list.len());
     }
 
     /// Skips `items_to_skip` items and writes an item, then flushes immediately.
@@ -348,6 +459,8 @@ impl<T: Pod> BufferHandle<T> {
     ///
     /// # Panics:
     /// - If the buffer is not writable.
+    /// - If the buffer has no CPU mirror and the written bytes are unaligned, see
+    ///   [`BufferStorage::WriteOnly`].
     pub fn skip_and_write_item_and_flush(
         &mut self,
         device: &Device,
@@ -366,6 +479,8 @@ impl<T: Pod> BufferHandle<T> {
     /// # Panics:
     /// - If the buffer is not writable.
     /// - If the `item_list` is empty.
+    /// - If the buffer has no CPU mirror and the written bytes are unaligned, see
+    ///   [`BufferStorage::WriteOnly`].
     pub fn skip_and_write_item_list_and_flush(
         &mut self,
         device: &Device,
@@ -373,6 +488,11 @@ impl<T: Pod> BufferHandle<T> {
         items_to_skip: usize,
         item_list: &[T],
     ) {
+        if !self.is_mirrored() {
+            self.write_through(device, queue, items_to_skip, item_list);
+            return;
+        }
+
         self.skip_and_write_item_list(items_to_skip, item_list);
         self.skip_and_flush_exact(device, queue, items_to_skip, item_list.len());
     }
@@ -382,6 +502,8 @@ impl<T: Pod> BufferHandle<T> {
     /// # Panics:
     /// - If the buffer is not writable.
     /// - If `items_to_skip` is equal to or exceeds the length of the buffer.
+    /// - If the buffer has no CPU mirror and the written bytes are unaligned, see
+    ///   [`BufferStorage::WriteOnly`].
     pub fn skip_and_update_item_and_flush(
         &mut self,
         device: &Device,
@@ -398,6 +520,8 @@ impl<T: Pod> BufferHandle<T> {
     /// - If the buffer is not writable.
     /// - If `items_to_skip` plus the length of the `item_list`
     ///   is equal to or exceeds the length of the buffer.
+    /// - If the buffer has no CPU mirror and the written bytes are unaligned, see
+    ///   [`BufferStorage::WriteOnly`].
     pub fn skip_and_update_item_list_and_flush(
         &mut self,
         device: &Device,
@@ -405,6 +529,15 @@ impl<T: Pod> BufferHandle<T> {
         items_to_skip: usize,
         item_list: &[T],
     ) {
+        if !self.is_mirrored() {
+            assert!(
+                items_to_skip + item_list.len() <= self.item_count,
+                "Cannot update the buffer because it would overflow!"
+            );
+            self.write_through(device, queue, items_to_skip, item_list);
+            return;
+        }
+
         self.skip_and_update_item_list(items_to_skip, item_list);
         self.skip_and_flush_exact(device, queue, items_to_skip, item_list.len());
     }
@@ -413,6 +546,8 @@ impl<T: Pod> BufferHandle<T> {
     ///
     /// # Panics:
     /// - If the buffer is not writable.
+    /// - If the buffer has no CPU mirror and the written bytes are unaligned, see
+    ///   [`BufferStorage::WriteOnly`].
     pub fn extend_with_item_and_flush(&mut self, device: &Device, queue: &Queue, item: T) {
         self.extend_with_item_list_and_flush(device, queue, &[item]);
     }
@@ -422,13 +557,15 @@ impl<T: Pod> BufferHandle<T> {
     /// # Panics:
     /// - If the buffer is not writable.
     /// - If `item_list` is empty.
+    /// - If the buffer has no CPU mirror and the written bytes are unaligned, see
+    ///   [`BufferStorage::WriteOnly`].
     pub fn extend_with_item_list_and_flush(
         &mut self,
         device: &Device,
         queue: &Queue,
         item_list: &[T],
     ) {
-        self.skip_and_write_item_list_and_flush(device, queue, self.item_list.len(), item_list);
+        self.skip_and_write_item_list_and_flush(device, queue, self.item_count, item_list);
     }
 
     /// Truncates the buffer to a specified length, then flushes immediately.
@@ -440,6 +577,18 @@ impl<T: Pod> BufferHandle<T> {
     /// # Panics:
     /// - If the buffer is not writable.
     pub fn truncate_and_flush(&mut self, device: &Device, queue: &Queue, length: usize) {
+        if !self.is_mirrored() {
+            self.assert_write_through();
+            assert!(
+                length > 0 && length < self.item_count,
+                "Cannot truncate buffer out of bounds!"
+            );
+            // The items past the new length are simply left on the GPU
+            self.item_count = length;
+            self.last_flush_bytes = 0;
+            return;
+        }
+
         self.truncate(length);
         self.skip_and_flush(device, queue, length);
     }
@@ -450,6 +599,16 @@ impl<T: Pod> BufferHandle<T> {
     /// - If the buffer is not writable.
     /// - If `item_list` is empty.
     pub fn overwrite_and_flush(&mut self, device: &Device, queue: &Queue, item_list: &[T]) {
+        if !self.is_mirrored() {
+            assert!(
+                !item_list.is_empty(),
+                "Cannot overwrite the buffer with an empty slice!"
+            );
+            self.item_count = 0;
+            self.write_through(device, queue, 0, item_list);
+            return;
+        }
+
         self.overwrite(item_list);
         self.flush(device, queue);
     }
@@ -462,6 +621,21 @@ impl<T: Pod> BufferHandle<T> {
     /// # Panics:
     /// - If the buffer is not writable.
     pub fn nuke_and_flush(&mut self, device: &Device, queue: &Queue) {
+        if !self.is_mirrored() {
+            self.assert_write_through();
+            let mut encoder = device.create_command_encoder(&wgpu::CommandEncoderDescriptor {
+                label: Some("Buffer nuke"),
+            });
+            encoder.clear_buffer(
+                &self.raw,
+                0,
+                Some(aligned_buffer_size(self.item_count_to_bytes())),
+            );
+            queue.submit([encoder.finish()]);
+            self.last_flush_bytes = 0;
+            return;
+        }
+
         self.nuke();
         self.flush(device, queue);
     }
@@ -470,6 +644,9 @@ impl<T: Pod> BufferHandle<T> {
     ///
     /// This effectively copies the CPU buffer to the GPU buffer.
     ///
+    /// If the buffer has no CPU mirror, everything has already been written
+    /// to the GPU, so there's nothing to flush.
+    ///
     /// # Panics:
     /// - If the buffer is not writable.
     /// - If item capacity of the buffer is zero.
@@ -485,13 +662,18 @@ impl<T: Pod> BufferHandle<T> {
     /// - If the buffer is not writable.
     /// - If item capacity of the buffer is zero.
     pub fn skip_and_flush(&mut self, device: &Device, queue: &Queue, items_to_skip: usize) {
-        self.skip_and_flush_exact(device, queue, items_to_skip, self.item_list.len());
+        self.skip_and_flush_exact(device, queue, items_to_skip, self.item_count);
     }
 
     /// Skips and flushes an exact amount of items.
     ///
     /// This effectively copies a range of the CPU buffer to the GPU buffer.
     ///
+    /// If the buffer has to grow, the old contents are copied over on the GPU,
+    /// and only the items past the old capacity get uploaded.
+    ///
+    /// If the buffer has no CPU mirror, there's nothing to flush.
+    ///
     /// # Panics:
     /// - If the buffer is not writable.
     /// - If the range of items to flush is out of bounds.
@@ -504,31 +686,264 @@ impl<T: Pod> BufferHandle<T> {
     ) {
         assert!(self.is_writable(), "Buffer is not writable!");
         assert!(
-            items_to_skip + items_to_flush <= self.item_list.len(),
+            items_to_skip + items_to_flush <= self.item_count,
             "Cannot skip and flush exact because it would be out of bounds"
         );
-        let mut needs_resizing = false;
-        while self.item_list.len() > self.item_capacity {
-            self.item_capacity *= 2;
-            needs_resizing = true;
+        if !self.is_mirrored() {
+            self.last_flush_bytes = 0;
+            return;
         }
 
-        if needs_resizing {
-            self.recreate_buffer(device);
-            queue.write_buffer(&self.raw, 0, bytemuck::cast_slice(&self.item_list));
-        }
+        let mut uploaded_bytes = 0;
         let start_index = items_to_skip;
-        let end_index = items_to_skip + items_to_flush;
+        let mut end_index = items_to_skip + items_to_flush;
+        if let Some(old_capacity) = self.grow_to_fit(device, queue) {
+            // Everything past the old capacity has already been uploaded while growing
+            uploaded_bytes += Self::items_to_bytes(self.item_list.len() - old_capacity);
+            end_index = end_index.min(old_capacity).max(start_index);
+        }
+
         queue.write_buffer(
             &self.raw,
-            Self::items_to_bytes(items_to_skip),
+            Self::items_to_bytes(start_index),
             bytemuck::cast_slice(&self.item_list[start_index..end_index]),
         );
+        self.dirty_ranges.clear_range(start_index..end_index);
+        uploaded_bytes += Self::items_to_bytes(end_index - start_index);
+        self.last_flush_bytes = uploaded_bytes;
+    }
+
+    /// Flushes only the dirty ranges of the buffer and returns the amount of bytes uploaded.
+    ///
+    /// A dirty range is a range of items that has been modified by one of the
+    /// non-flushing methods since the last flush, nearby dirty ranges are coalesced
+    /// based on the merge gap, see [`BufferHandle::set_merge_gap()`].
+    ///
+    /// This effectively copies only the changed parts of the CPU buffer to the GPU buffer.
+    ///
+    /// If the buffer has no CPU mirror, nothing is ever dirty and nothing gets uploaded.
+    ///
+    /// # Panics:
+    /// - If the buffer is not writable.
+    pub fn flush_dirty(&mut self, device: &Device, queue: &Queue) -> u64 {
+        assert!(self.is_writable(), "Buffer is not writable!");
+        if !self.is_mirrored() {
+            self.last_flush_bytes = 0;
+            return 0;
+        }
+
+        let mut uploaded_bytes = 0;
+        if let Some(old_capacity) = self.grow_to_fit(device, queue) {
+            uploaded_bytes += Self::items_to_bytes(self.item_list.len() - old_capacity);
+        }
+
+        for range in self.dirty_ranges.take() {
+            let (offset, bytes) = self.aligned_bytes(range);
+            uploaded_bytes += bytes.len() as u64;
+            queue.write_buffer(&self.raw, offset, &bytes);
+        }
+        self.last_flush_bytes = uploaded_bytes;
+        uploaded_bytes
+    }
+
+    /// Flushes the entire buffer through an [`UploadBelt`].
+    ///
+    /// This effectively records a copy of the CPU buffer to the GPU buffer into `encoder`.
+    ///
+    /// # Panics:
+    /// - If the buffer is not writable.
+    pub fn flush_with(
+        &mut self,
+        device: &Device,
+        belt: &mut UploadBelt,
+        encoder: &mut CommandEncoder,
+    ) {
+        self.skip_and_flush_exact_with(device, belt, encoder, 0, self.item_count);
+    }
+
+    /// Skips and flushes an exact amount of items through an [`UploadBelt`].
+    ///
+    /// This effectively records a copy of a range of the CPU buffer to the GPU buffer into `encoder`.
+    ///
+    /// # Panics:
+    /// - If the buffer is not writable.
+    /// - If the range of items to flush is out of bounds.
+    pub fn skip_and_flush_exact_with(
+        &mut self,
+        device: &Device,
+        belt: &mut UploadBelt,
+        encoder: &mut CommandEncoder,
+        items_to_skip: usize,
+        items_to_flush: usize,
+    ) {
+        assert!(self.is_writable(), "Buffer is not writable!");
+        assert!(
+            items_to_skip + items_to_flush <= self.item_count,
+            "Cannot skip and flush exact because it would be out of bounds"
+        );
+        if !self.is_mirrored() {
+            self.last_flush_bytes = 0;
+            return;
+        }
+
+        let mut uploaded_bytes = 0;
+        let start_index = items_to_skip;
+        let mut end_index = items_to_skip + items_to_flush;
+        if let Some(old_capacity) = self.grow_to_fit_with(device, belt, encoder) {
+            // Everything past the old capacity has already been uploaded while growing
+            uploaded_bytes += Self::items_to_bytes(self.item_list.len() - old_capacity);
+            end_index = end_index.min(old_capacity).max(start_index);
+        }
+
+        let (offset, bytes) = self.aligned_bytes(start_index..end_index);
+        uploaded_bytes += bytes.len() as u64;
+        belt.write(device, encoder, &self.raw, offset, &bytes);
+        self.dirty_ranges.clear_range(start_index..end_index);
+        self.last_flush_bytes = uploaded_bytes;
+    }
+
+    /// Flushes only the dirty ranges of the buffer through an [`UploadBelt`]
+    /// and returns the amount of bytes uploaded.
+    ///
+    /// See [`BufferHandle::flush_dirty()`] for more information.
+    ///
+    /// # Panics:
+    /// - If the buffer is not writable.
+    pub fn flush_dirty_with(
+        &mut self,
+        device: &Device,
+        belt: &mut UploadBelt,
+        encoder: &mut CommandEncoder,
+    ) -> u64 {
+        assert!(self.is_writable(), "Buffer is not writable!");
+        if !self.is_mirrored() {
+            self.last_flush_bytes = 0;
+            return 0;
+        }
+
+        let mut uploaded_bytes = 0;
+        if let Some(old_capacity) = self.grow_to_fit_with(device, belt, encoder) {
+            uploaded_bytes += Self::items_to_bytes(self.item_list.len() - old_capacity);
+        }
+
+        for range in self.dirty_ranges.take() {
+            let (offset, bytes) = self.aligned_bytes(range);
+            uploaded_bytes += bytes.len() as u64;
+            belt.write(device, encoder, &self.raw, offset, &bytes);
+        }
+        self.last_flush_bytes = uploaded_bytes;
+        uploaded_bytes
+    }
+
+    /// Reserves capacity for at least `additional` more items on the GPU.
+    ///
+    /// This is useful for pre-sizing buffers at load time, so they don't have to grow
+    /// in the middle of a frame, the new capacity is picked by the [`BufferGrowth`] policy.
+    ///
+    /// If the buffer has to grow, the old contents are copied over on the GPU.
+    ///
+    /// # Panics:
+    /// - If the buffer is not writable.
+    /// - If the [`BufferGrowth`] policy cannot fit the required capacity.
+    pub fn reserve(&mut self, device: &Device, queue: &Queue, additional: usize) {
+        assert!(self.is_writable(), "Buffer is not writable!");
+        if self.is_mirrored() {
+            self.item_list.reserve(additional);
+        }
+        let required_capacity = self.item_count + additional;
+        if required_capacity <= self.item_capacity {
+            return;
+        }
+
+        let old_capacity = self.item_capacity;
+        self.item_capacity = self.growth.next_capacity(old_capacity, required_capacity);
+        let old_raw = self.recreate_buffer(device);
+        let mut encoder = device.create_command_encoder(&wgpu::CommandEncoderDescriptor {
+            label: Some("Buffer reserve"),
+        });
+        encoder.copy_buffer_to_buffer(&old_raw, 0, &self.raw, 0, old_raw.size());
+        queue.submit([encoder.finish()]);
+    }
+
+    /// Skips `items_to_skip` items and writes a list of items through an [`UploadBelt`].
+    ///
+    /// If the buffer has a CPU mirror, the items get written to the mirror first
+    /// and only the written range gets flushed, otherwise the items are written straight
+    /// from `item_list` into a staging chunk.
+    ///
+    /// # Panics:
+    /// - If the buffer is not writable.
+    /// - If the `item_list` is empty.
+    /// - If the buffer has no CPU mirror and the written bytes are unaligned, see
+    ///   [`BufferStorage::WriteOnly`].
+    pub fn skip_and_write_item_list_and_flush_with(
+        &mut self,
+        device: &Device,
+        belt: &mut UploadBelt,
+        encoder: &mut CommandEncoder,
+        items_to_skip: usize,
+        item_list: &[T],
+    ) {
+        if self.is_mirrored() {
+            self.skip_and_write_item_list(items_to_skip, item_list);
+            self.skip_and_flush_exact_with(device, belt, encoder, items_to_skip, item_list.len());
+            return;
+        }
+
+        self.assert_write_through();
+        assert!(
+            !item_list.is_empty(),
+            "Cannot write an empty slice to the buffer!"
+        );
+        let (offset, bytes) = self.write_through_bytes(items_to_skip, item_list);
+        self.grow_to_fit_with(device, belt, encoder);
+        belt.write(device, encoder, &self.raw, offset, &bytes);
+        self.last_flush_bytes = bytes.len() as u64;
+    }
+
+    /// Sets the [`BufferGrowth`] policy used whenever the buffer has to grow.
+    pub fn set_growth(&mut self, growth: BufferGrowth) {
+        self.growth = growth;
+    }
+
+    /// Returns the [`BufferGrowth`] policy used whenever the buffer has to grow.
+    pub fn growth(&self) -> BufferGrowth {
+        self.growth
+    }
+
+    /// Sets the merge gap (in items) used to coalesce nearby dirty ranges.
+    ///
+    /// Two dirty ranges that are at most `merge_gap` items apart get merged into one,
+    /// which trades uploading a few unchanged items for issuing fewer writes.
+    ///
+    /// A merge gap of zero only merges ranges that overlap or touch.
+    pub fn set_merge_gap(&mut self, merge_gap: usize) {
+        self.dirty_ranges.merge_gap = merge_gap;
+    }
+
+    /// Returns the merge gap (in items) used to coalesce nearby dirty ranges.
+    pub fn merge_gap(&self) -> usize {
+        self.dirty_ranges.merge_gap
+    }
+
+    /// Returns the dirty item ranges that are waiting to be flushed, sorted by their start.
+    pub fn dirty_ranges(&self) -> &[Range<usize>] {
+        &self.dirty_ranges.ranges
+    }
+
+    /// Returns whether the buffer has any changes that haven't been flushed yet.
+    pub fn is_dirty(&self) -> bool {
+        !self.dirty_ranges.ranges.is_empty()
+    }
+
+    /// Returns the amount of bytes uploaded to the GPU by the last flush.
+    pub fn last_flush_bytes(&self) -> u64 {
+        self.last_flush_bytes
     }
 
     /// Converts the item count to bytes.
     pub fn item_count_to_bytes(&self) -> u64 {
-        self.item_list.len() as u64 * size_of::<T>() as u64
+        self.item_count as u64 * size_of::<T>() as u64
     }
 
     /// Converts the item capacity to bytes.
@@ -548,6 +963,8 @@ impl<T: Pod> BufferHandle<T> {
             BufferUsage::Vertex { is_writable } => is_writable,
             BufferUsage::Uniform { is_writable } => is_writable,
             BufferUsage::Storage { is_writable } => is_writable,
+            BufferUsage::ReadWriteStorage { is_writable } => is_writable,
+            BufferUsage::Indirect { is_writable } => is_writable,
         }
     }
 
@@ -557,13 +974,71 @@ impl<T: Pod> BufferHandle<T> {
     }
 
     /// Returns a slice of the contents.
+    ///
+    /// # Panics:
+    /// - If the buffer has no CPU mirror.
     pub fn items(&self) -> &[T] {
+        self.assert_mirrored();
         &self.item_list
     }
 
+    /// Returns a mutable slice of a range of the contents and marks the range as dirty,
+    /// which allows filling the items in place, e.g. with a batched math kernel,
+    /// without building them in an intermediate list first.
+    ///
+    /// This function does not flush, use [`BufferHandle::flush_dirty()`] afterwards.
+    ///
+    /// # Panics:
+    /// - If the buffer has no CPU mirror.
+    /// - If the range exceeds the length of the buffer.
+    pub fn items_mut(&mut self, range: Range<usize>) -> &mut [T] {
+        self.assert_mirrored();
+        assert!(
+            range.start <= range.end && range.end <= self.item_list.len(),
+            "Cannot access the items because the range exceeds the buffer!"
+        );
+        self.dirty_ranges.mark(range.clone());
+        &mut self.item_list[range]
+    }
+
+    /// Reads a range of items back from the GPU without blocking,
+    /// including items written on the GPU, e.g. by a compute shader
+    /// - `device` -> the [`wgpu::Device`] which is needed to build GPU resources
+    /// - `encoder` -> the command encoder that records the copy into a readback buffer
+    /// - `pool` -> the [`ReadbackPool`] that completes the read
+    /// - `range` -> the range of items to read
+    ///
+    /// The read completes a few frames later, see [`ReadbackPool`].
+    ///
+    /// # Panics:
+    /// - If the buffer is not writable (only writable buffers can be copied from).
+    /// - If the range exceeds the capacity of the buffer.
+    /// - If the range ends in the last bytes of a buffer whose size isn't a multiple of 4 bytes
+    ///   (e.g. an odd amount of `u16` items), since they can't be copied.
+    pub fn read_async(
+        &self,
+        device: &Device,
+        encoder: &mut CommandEncoder,
+        pool: &mut ReadbackPool,
+        range: Range<usize>,
+    ) -> Readback<T> {
+        assert!(self.is_writable(), "Buffer is not writable!");
+        assert!(
+            range.start <= range.end && range.end <= self.item_capacity,
+            "Cannot read the items because the range exceeds the buffer!"
+        );
+        pool.read_buffer(
+            device,
+            encoder,
+            &self.raw,
+            Self::items_to_bytes(range.start),
+            Self::items_to_bytes(range.len()),
+        )
+    }
+
     /// Returns the item count.
     pub fn item_count(&self) -> usize {
-        self.item_list.len()
+        self.item_count
     }
 
     /// Returns the item capacity.
@@ -573,7 +1048,17 @@ impl<T: Pod> BufferHandle<T> {
 
     /// Returns whether empty.
     pub fn is_empty(&self) -> bool {
-        self.item_list.is_empty()
+        self.item_count == 0
+    }
+
+    /// Returns the [`BufferStorage`] mode.
+    pub fn storage(&self) -> BufferStorage {
+        self.storage
+    }
+
+    /// Returns whether the buffer keeps a CPU mirror of its items.
+    pub fn is_mirrored(&self) -> bool {
+        self.storage.is_mirrored()
     }
 
     /// Returns the raw [`wgpu::Buffer`].
@@ -586,14 +1071,410 @@ impl<T: Pod> BufferHandle<T> {
         self.raw.slice(..)
     }
 
-    /// Recreates the GPU buffer internally.
-    fn recreate_buffer(&mut self, device: &Device) {
-        self.raw = device.create_buffer(&BufferDescriptor {
+    /// Returns the unique [`ResourceId`] of the GPU buffer.
+    ///
+    /// The id changes whenever the GPU buffer is recreated (for example when it grows),
+    /// so it always identifies the [`wgpu::Buffer`] returned by [`BufferHandle::raw()`].
+    pub fn id(&self) -> ResourceId {
+        self.id
+    }
+
+    /// Grows the GPU buffer if the item count exceeds the item capacity.
+    ///
+    /// The old contents of the GPU buffer are copied into the new one on the GPU,
+    /// so only the items past the old capacity get uploaded, which also clears
+    /// them from the dirty ranges.
+    ///
+    /// Note that the copy is submitted right away, so it's ordered before any
+    /// command encoder that hasn't been submitted yet.
+    ///
+    /// Returns the old item capacity if the buffer had to grow.
+    fn grow_to_fit(&mut self, device: &Device, queue: &Queue) -> Option<usize> {
+        let (old_raw, old_capacity) = self.grow_capacity(device)?;
+        let mut encoder = device.create_command_encoder(&wgpu::CommandEncoderDescriptor {
+            label: Some("Buffer growth"),
+        });
+        encoder.copy_buffer_to_buffer(&old_raw, 0, &self.raw, 0, old_raw.size());
+        queue.submit([encoder.finish()]);
+        if !self.is_mirrored() {
+            return Some(old_capacity);
+        }
+
+        let (offset, bytes) = self.aligned_bytes(old_capacity..self.item_list.len());
+        queue.write_buffer(&self.raw, offset, &bytes);
+        self.dirty_ranges.clear_range(old_capacity..self.item_list.len());
+        Some(old_capacity)
+    }
+
+    /// Same as [`BufferHandle::grow_to_fit()`], except the copy is recorded into `encoder`
+    /// and the upload goes through an [`UploadBelt`].
+    fn grow_to_fit_with(
+        &mut self,
+        device: &Device,
+        belt: &mut UploadBelt,
+        encoder: &mut CommandEncoder,
+    ) -> Option<usize> {
+        let (old_raw, old_capacity) = self.grow_capacity(device)?;
+        encoder.copy_buffer_to_buffer(&old_raw, 0, &self.raw, 0, old_raw.size());
+        if !self.is_mirrored() {
+            return Some(old_capacity);
+        }
+
+        let (offset, bytes) = self.aligned_bytes(old_capacity..self.item_list.len());
+        belt.write(device, encoder, &self.raw, offset, &bytes);
+        self.dirty_ranges.clear_range(old_capacity..self.item_list.len());
+        Some(old_capacity)
+    }
+
+    /// Grows the item capacity based on the [`BufferGrowth`] policy until the items fit,
+    /// and recreates the GPU buffer.
+    ///
+    /// Returns the old GPU buffer and the old item capacity if the buffer had to grow.
+    fn grow_capacity(&mut self, device: &Device) -> Option<(wgpu::Buffer, usize)> {
+        let required_capacity = self.item_count;
+        if required_capacity <= self.item_capacity {
+            return None;
+        }
+
+        let old_capacity = self.item_capacity;
+        self.item_capacity = self.growth.next_capacity(old_capacity, required_capacity);
+        Some((self.recreate_buffer(device), old_capacity))
+    }
+
+    /// Writes a list of items straight to the GPU buffer, for buffers without a CPU mirror.
+    ///
+    /// If `items_to_skip` exceeds the item count of the buffer, the empty item slots
+    /// get filled with zeroed data, and the buffer grows if needed.
+    fn write_through(
+        &mut self,
+        device: &Device,
+        queue: &Queue,
+        items_to_skip: usize,
+        item_list: &[T],
+    ) {
+        self.assert_write_through();
+        assert!(
+            !item_list.is_empty(),
+            "Cannot write an empty slice to the buffer!"
+        );
+        let (offset, bytes) = self.write_through_bytes(items_to_skip, item_list);
+        self.grow_to_fit(device, queue);
+        queue.write_buffer(&self.raw, offset, &bytes);
+        self.last_flush_bytes = bytes.len() as u64;
+    }
+
+    /// Returns the byte offset and the bytes of a write-through write, the zeroed gap
+    /// up to `items_to_skip` followed by `item_list`, and grows the item count to fit them.
+    ///
+    /// # Panics:
+    /// - If the bytes cannot be aligned to [`wgpu::COPY_BUFFER_ALIGNMENT`].
+    fn write_through_bytes<'a>(
+        &mut self,
+        items_to_skip: usize,
+        item_list: &'a [T],
+    ) -> (u64, Cow<'a, [u8]>) {
+        let gap_start = self.item_count.min(items_to_skip);
+        let bytes = padded_write_through(
+            Self::items_to_bytes(gap_start) as usize,
+            Self::items_to_bytes(items_to_skip - gap_start) as usize,
+            bytemuck::cast_slice(item_list),
+            self.item_count_to_bytes() as usize,
+        );
+        self.item_count = self.item_count.max(items_to_skip + item_list.len());
+        (Self::items_to_bytes(gap_start), bytes)
+    }
+
+    /// Asserts that the buffer keeps a CPU mirror of its items.
+    fn assert_mirrored(&self) {
+        assert!(
+            self.is_mirrored(),
+            "Buffer has no CPU mirror, use the flushing methods instead!"
+        );
+    }
+
+    /// Asserts that the buffer can be written straight to the GPU.
+    fn assert_write_through(&self) {
+        assert!(self.is_writable(), "Buffer is not writable!");
+        assert!(
+            self.storage != BufferStorage::DiscardAfterCreate,
+            "Buffer contents were discarded after creation, it cannot be written to!"
+        );
+    }
+
+    /// Wraps an existing, empty GPU buffer that can hold `item_capacity` items,
+    /// e.g. one recycled by a [`crate::graphics::pool::ResourcePool`].
+    ///
+    /// # Panics:
+    /// - If `item_capacity` is equal to zero.
+    /// - If `storage` is [`BufferStorage::DiscardAfterCreate`], since an allocated buffer has no contents.
+    pub(crate) fn from_raw(
+        raw: wgpu::Buffer,
+        item_capacity: usize,
+        usage: BufferUsage,
+        storage: BufferStorage,
+    ) -> Self {
+        assert!(item_capacity > 0, "Item capacity cannot be zero!");
+        assert!(
+            storage != BufferStorage::DiscardAfterCreate,
+            "Cannot allocate a buffer that discards its contents after creation!"
+        );
+        Self {
+            usage,
+            item_count: 0,
+            item_capacity,
+            storage,
+            raw,
+            id: ResourceId::next(),
+            item_list: if storage.is_mirrored() {
+                Vec::with_capacity(item_capacity)
+            } else {
+                Vec::new()
+            },
+            dirty_ranges: DirtyRanges::new(DEFAULT_MERGE_GAP),
+            last_flush_bytes: 0,
+            growth: BufferGrowth::Double,
+        }
+    }
+
+    /// Drops the items of the buffer and returns the GPU buffer.
+    pub(crate) fn into_raw(self) -> wgpu::Buffer {
+        self.raw
+    }
+
+    /// Returns the byte offset and the bytes of a range of mirrored items, widened to
+    /// [`wgpu::COPY_BUFFER_ALIGNMENT`] so they can be written to the GPU buffer,
+    /// a widened end past the mirror is padded with zeroes (the GPU buffer size is aligned).
+    fn aligned_bytes(&self, range: Range<usize>) -> (u64, Cow<'_, [u8]>) {
+        let bytes: &[u8] = bytemuck::cast_slice(&self.item_list);
+        let size = size_of::<T>();
+        let aligned = align_byte_range(range.start * size..range.end * size);
+        let offset = aligned.start as u64;
+        if aligned.end <= bytes.len() {
+            return (offset, Cow::Borrowed(&bytes[aligned]));
+        }
+
+        let mut padded = bytes[aligned.start..].to_vec();
+        padded.resize(aligned.len(), 0);
+        (offset, Cow::Owned(padded))
+    }
+
+    /// Recreates the GPU buffer internally and returns the old one.
+    fn recreate_buffer(&mut self, device: &Device) -> wgpu::Buffer {
+        let raw = device.create_buffer(&BufferDescriptor {
             label: None,
-            size: self.item_capacity_to_bytes(),
+            size: aligned_buffer_size(self.item_capacity_to_bytes()),
             usage: self.usage.raw(),
             mapped_at_creation: false,
         });
+        self.id = ResourceId::next();
+        std::mem::replace(&mut self.raw, raw)
+    }
+}
+
+/// Widens a range of bytes to whole multiples of [`wgpu::COPY_BUFFER_ALIGNMENT`]
+fn align_byte_range(range: Range<usize>) -> Range<usize> {
+    let alignment = wgpu::COPY_BUFFER_ALIGNMENT as usize;
+    range.start / alignment * alignment..range.end.next_multiple_of(alignment)
+}
+
+/// Returns `gap` zeroed bytes followed by `bytes`, written at byte `start` of a buffer whose
+/// contents end at byte `end`, padded with zeroes up to [`wgpu::COPY_BUFFER_ALIGNMENT`]
+///
+/// Without a CPU mirror the neighbouring bytes are unknown, so only the end of the contents
+/// can be padded and the write can start nowhere but at an aligned offset.
+///
+/// # Panics:
+/// - If `start` is not a multiple of [`wgpu::COPY_BUFFER_ALIGNMENT`].
+/// - If the written bytes end off the alignment before `end`.
+fn padded_write_through(start: usize, gap: usize, bytes: &[u8], end: usize) -> Cow<'_, [u8]> {
+    let alignment = wgpu::COPY_BUFFER_ALIGNMENT as usize;
+    let write_end = start + gap + bytes.len();
+    assert!(
+        start % alignment == 0 && (write_end % alignment == 0 || write_end >= end),
+        "Cannot write bytes {}..{} to a buffer without a CPU mirror, they must start and end on a multiple of {}!",
+        start,
+        write_end,
+        alignment
+    );
+    if gap == 0 && bytes.len() % alignment == 0 {
+        return Cow::Borrowed(bytes);
+    }
+
+    let mut padded = vec![0; gap];
+    padded.extend_from_slice(bytes);
+    padded.resize(padded.len().next_multiple_of(alignment), 0);
+    Cow::Owned(padded)
+}
+
+/// Rounds a GPU buffer size up to [`wgpu::COPY_BUFFER_ALIGNMENT`], so every write and copy
+/// widened to the alignment stays inside the buffer
+fn aligned_buffer_size(size: u64) -> u64 {
+    size.next_multiple_of(wgpu::COPY_BUFFER_ALIGNMENT)
+}
+
+/// The default merge gap (in items) of a [`BufferHandle`], only touching ranges get merged.
+pub const DEFAULT_MERGE_GAP: usize = 0;
+
+/// Keeps track of the item ranges of a [`BufferHandle`] that need to be flushed.
+///
+/// The ranges are kept sorted and disjoint, any 2 ranges that are at most
+/// `merge_gap` items apart get coalesced into a single range.
+#[derive(Debug, Clone, Default)]
+struct DirtyRanges {
+    ranges: Vec<Range<usize>>,
+    merge_gap: usize,
+}
+
+impl DirtyRanges {
+    /// Creates an empty set of dirty ranges.
+    fn new(merge_gap: usize) -> Self {
+        Self {
+            ranges: Vec::new(),
+            merge_gap,
+        }
+    }
+
+    /// Marks a range of items as dirty, coalescing it with nearby ranges.
+    fn mark(&mut self, range: Range<usize>) {
+        if range.is_empty() {
+            return;
+        }
+
+        let gap = self.merge_gap;
+        // The first range that ends close enough to the new range
+        let first = self
+            .ranges
+            .partition_point(|dirty| dirty.end.saturating_add(gap) < range.start);
+        // One past the last range that starts close enough to the new range
+        let last = self
+            .ranges
+            .partition_point(|dirty| dirty.start <= range.end.saturating_add(gap));
+        if first == last {
+            self.ranges.insert(first, range);
+            return;
+        }
+
+        let start = range.start.min(self.ranges[first].start);
+        let end = range.end.max(self.ranges[last - 1].end);
+        self.ranges.splice(first..last, [start..end]);
+    }
+
+    /// Removes a range of items from the dirty ranges, splitting ranges if needed.
+    fn clear_range(&mut self, range: Range<usize>) {
+        if range.is_empty() || self.ranges.is_empty() {
+            return;
+        }
+
+        let mut remaining = Vec::with_capacity(self.ranges.len() + 1);
+        for dirty in self.ranges.drain(..) {
+            if dirty.end <= range.start || dirty.start >= range.end {
+                remaining.push(dirty);
+                continue;
+            }
+            if dirty.start < range.start {
+                remaining.push(dirty.start..range.start);
+            }
+            if dirty.end > range.end {
+                remaining.push(range.end..dirty.end);
+            }
+        }
+        self.ranges = remaining;
+    }
+
+    /// Discards every dirty range that lies beyond `length`.
+    fn truncate(&mut self, length: usize) {
+        self.ranges.retain(|dirty| dirty.start < length);
+        if let Some(last) = self.ranges.last_mut() {
+            last.end = last.end.min(length);
+        }
+    }
+
+    /// Clears all dirty ranges.
+    fn clear(&mut self) {
+        self.ranges.clear();
+    }
+
+    /// Takes all dirty ranges, leaving none behind.
+    fn take(&mut self) -> Vec<Range<usize>> {
+        std::mem::take(&mut self.ranges)
+    }
+}
+
+/// Specifies whether a [`BufferHandle`] keeps a CPU-side mirror of its items.
+///
+/// The item count and the item capacity are tracked in every mode.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum BufferStorage {
+    /// The buffer keeps a CPU mirror of its items,
+    /// which allows writing and updating items without flushing
+    Mirrored,
+    /// The buffer keeps no CPU mirror, only the flushing methods are available
+    /// and they write straight to the GPU (either through the queue or an [`UploadBelt`])
+    ///
+    /// Since there's no mirror to widen a write from, every write has to start at a multiple
+    /// of [`wgpu::COPY_BUFFER_ALIGNMENT`] bytes and end on one too, unless it ends at or past
+    /// the item count, where the bytes are padded with zeroes.
+    WriteOnly,
+    /// The buffer keeps no CPU mirror and its contents cannot change after creation,
+    /// which is useful for large immutable geometry
+    DiscardAfterCreate,
+}
+
+impl BufferStorage {
+    /// Returns whether the storage mode keeps a CPU mirror.
+    pub fn is_mirrored(self) -> bool {
+        matches!(self, BufferStorage::Mirrored)
+    }
+}
+
+/// Specifies how a [`BufferHandle`] picks its new item capacity whenever it has to grow.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum BufferGrowth {
+    /// Doubles the capacity until the items fit
+    Double,
+    /// Multiplies the capacity by 1.5 until the items fit
+    OneAndHalf,
+    /// Grows the capacity to exactly fit the items
+    Exact,
+    /// Doubles the capacity until the items fit, but never grows past `max_capacity`
+    Capped { max_capacity: usize },
+}
+
+impl BufferGrowth {
+    /// Returns the new capacity that fits at least `required_capacity` items.
+    /// - `capacity` -> the current capacity
+    /// - `required_capacity` -> the minimum capacity needed
+    ///
+    /// # Panics:
+    /// - If `required_capacity` exceeds the maximum capacity of [`BufferGrowth::Capped`].
+    pub fn next_capacity(self, capacity: usize, required_capacity: usize) -> usize {
+        let mut new_capacity = capacity.max(1);
+        match self {
+            BufferGrowth::Double => {
+                while new_capacity < required_capacity {
+                    new_capacity = new_capacity.saturating_mul(2);
+                }
+            }
+            BufferGrowth::OneAndHalf => {
+                while new_capacity < required_capacity {
+                    new_capacity = new_capacity.saturating_add((new_capacity / 2).max(1));
+                }
+            }
+            BufferGrowth::Exact => new_capacity = new_capacity.max(required_capacity),
+            BufferGrowth::Capped { max_capacity } => {
+                assert!(
+                    required_capacity <= max_capacity,
+                    "Cannot grow the buffer to {} items, the maximum capacity is {}!",
+                    required_capacity,
+                    max_capacity
+                );
+                while new_capacity < required_capacity {
+                    new_capacity = new_capacity.saturating_mul(2);
+                }
+                new_capacity = new_capacity.min(max_capacity);
+            }
+        }
+        new_capacity
     }
 }
 
@@ -610,40 +1491,65 @@ pub enum BufferUsage {
     Uniform { is_writable: bool },
     /// Specifies that the buffer will be used for large amounts of data in shaders
     Storage { is_writable: bool },
+    /// Specifies that the buffer will be used for large amounts of data that shaders
+    /// can both read and write (compute shaders), the buffer can also be used as
+    /// vertex/instance data in a render pipeline, which allows a compute pass to fill
+    /// a buffer that a render pass then draws from
+    ReadWriteStorage { is_writable: bool },
+    /// Specifies that the buffer will be used for indirect draw/dispatch arguments,
+    /// the buffer can also be bound as storage so a compute pass can write the arguments
+    Indirect { is_writable: bool },
 }
 
 impl BufferUsage {
     /// Maps the [`BufferUsage`] to the internal [`wgpu::BufferUsages`]
+    ///
+    /// Writable buffers can also be copied from, so they can grow on the GPU.
     pub fn raw(self) -> wgpu::BufferUsages {
+        let writable = wgpu::BufferUsages::COPY_DST | wgpu::BufferUsages::COPY_SRC;
         match self {
             Self::Index { is_writable } => {
                 if is_writable {
-                    wgpu::BufferUsages::INDEX | wgpu::BufferUsages::COPY_DST
+                    wgpu::BufferUsages::INDEX | writable
                 } else {
                     wgpu::BufferUsages::INDEX
                 }
             }
             Self::Vertex { is_writable } => {
                 if is_writable {
-                    wgpu::BufferUsages::VERTEX | wgpu::BufferUsages::COPY_DST
+                    wgpu::BufferUsages::VERTEX | writable
                 } else {
                     wgpu::BufferUsages::VERTEX
                 }
             }
             Self::Uniform { is_writable } => {
                 if is_writable {
-                    wgpu::BufferUsages::UNIFORM | wgpu::BufferUsages::COPY_DST
+                    wgpu::BufferUsages::UNIFORM | writable
                 } else {
                     wgpu::BufferUsages::UNIFORM
                 }
             }
             Self::Storage { is_writable } => {
                 if is_writable {
-                    wgpu::BufferUsages::STORAGE | wgpu::BufferUsages::COPY_DST
+                    wgpu::BufferUsages::STORAGE | writable
                 } else {
                     wgpu::BufferUsages::STORAGE
                 }
             }
+            Self::ReadWriteStorage { is_writable } => {
+                if is_writable {
+                    wgpu::BufferUsages::STORAGE | wgpu::BufferUsages::VERTEX | writable
+                } else {
+                    wgpu::BufferUsages::STORAGE | wgpu::BufferUsages::VERTEX
+                }
+            }
+            Self::Indirect { is_writable } => {
+                if is_writable {
+                    wgpu::BufferUsages::INDIRECT | wgpu::BufferUsages::STORAGE | writable
+                } else {
+                    wgpu::BufferUsages::INDIRECT | wgpu::BufferUsages::STORAGE
+                }
+            }
         }
     }
 }
@@ -655,6 +1561,8 @@ pub trait AnyBufferHandle: Debug {
     fn raw(&self) -> &wgpu::Buffer;
     /// Functionally the same as [`BufferHandle::as_slice()`].
     fn as_slice(&self) -> wgpu::BufferSlice<'_>;
+    /// Functionally the same as [`BufferHandle::id()`].
+    fn id(&self) -> ResourceId;
 }
 
 impl<T: Debug + Pod> AnyBufferHandle for BufferHandle<T> {
@@ -665,4 +1573,109 @@ impl<T: Debug + Pod> AnyBufferHandle for BufferHandle<T> {
     fn as_slice(&self) -> wgpu::BufferSlice<'_> {
         self.as_slice()
     }
+
+    fn id(&self) -> ResourceId {
+        self.id()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn byte_ranges_widen_to_copy_alignment() {
+        assert_eq!(align_byte_range(0..8), 0..8);
+        assert_eq!(align_byte_range(2..4), 0..4);
+        assert_eq!(align_byte_range(6..10), 4..12);
+        assert_eq!(aligned_buffer_size(6), 8);
+        assert_eq!(aligned_buffer_size(16), 16);
+    }
+
+    #[test]
+    fn write_through_pads_the_end_of_the_contents() {
+        assert_eq!(
+            *padded_write_through(0, 0, &[1, 2, 3, 4], 0),
+            [1, 2, 3, 4][..]
+        );
+        assert_eq!(
+            *padded_write_through(4, 2, &[1, 2, 3], 4),
+            [0, 0, 1, 2, 3, 0, 0, 0][..]
+        );
+        assert_eq!(*padded_write_through(8, 0, &[1, 2], 10), [1, 2, 0, 0][..]);
+    }
+
+    #[test]
+    #[should_panic]
+    fn write_through_rejects_an_unaligned_start() {
+        padded_write_through(2, 0, &[1, 2], 4);
+    }
+
+    #[test]
+    #[should_panic]
+    fn write_through_rejects_an_unaligned_end_inside_the_contents() {
+        padded_write_through(0, 0, &[1, 2], 8);
+    }
+
+    #[test]
+    fn mark_disjoint() {
+        let mut dirty = DirtyRanges::new(0);
+        dirty.mark(10..12);
+        dirty.mark(0..2);
+        dirty.mark(5..6);
+        assert_eq!(dirty.ranges, vec![0..2, 5..6, 10..12]);
+    }
+
+    #[test]
+    fn mark_coalesce() {
+        {
+            let mut dirty = DirtyRanges::new(0);
+            dirty.mark(0..2);
+            dirty.mark(2..4);
+            dirty.mark(8..10);
+            dirty.mark(3..9);
+            assert_eq!(dirty.ranges, vec![0..10]);
+        }
+
+        {
+            let mut dirty = DirtyRanges::new(3);
+            dirty.mark(0..2);
+            dirty.mark(5..6);
+            dirty.mark(10..12);
+            assert_eq!(dirty.ranges, vec![0..6, 10..12]);
+        }
+    }
+
+    #[test]
+    fn clear_range() {
+        let mut dirty = DirtyRanges::new(0);
+        dirty.mark(0..10);
+        dirty.mark(20..30);
+        dirty.clear_range(5..25);
+        assert_eq!(dirty.ranges, vec![0..5, 25..30]);
+        dirty.clear_range(0..100);
+        assert!(dirty.ranges.is_empty());
+    }
+
+    #[test]
+    fn growth() {
+        assert_eq!(BufferGrowth::Double.next_capacity(4, 9), 16);
+        assert_eq!(BufferGrowth::OneAndHalf.next_capacity(4, 9), 9);
+        assert_eq!(BufferGrowth::OneAndHalf.next_capacity(1, 2), 2);
+        assert_eq!(BufferGrowth::Exact.next_capacity(4, 9), 9);
+        assert_eq!(
+            BufferGrowth::Capped { max_capacity: 12 }.next_capacity(4, 9),
+            12
+        );
+    }
+
+    #[test]
+    fn truncate() {
+        let mut dirty = DirtyRanges::new(0);
+        dirty.mark(0..4);
+        dirty.mark(6..10);
+        dirty.mark(12..14);
+        dirty.truncate(8);
+        assert_eq!(dirty.ranges, vec![0..4, 6..8]);
+    }
 }
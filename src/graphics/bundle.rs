@@ -0,0 +1,372 @@
+use std::{ops::Range, thread};
+
+use crate::graphics::{
+    buffer::{AnyBufferHandle, BufferHandle},
+    group::BindGroup,
+    id::ResourceId,
+    pass::{
+        BoundState, DrawArgs, DrawIndexedArgs, RenderPassStats, assert_indirect_range, slot_mut,
+        track,
+    },
+    pipeline::Pipeline,
+    texture::TextureFormat,
+};
+
+/// Describes a wrapper around the raw [`wgpu::RenderBundle`], a pre-recorded
+/// sequence of render commands
+///
+/// A bundle is recorded once and replayed with
+/// [`crate::graphics::pass::RenderPass::execute_bundles()`] every frame,
+/// which skips encoding the same commands again, e.g. for static scenery.
+/// Buffer contents can still change between frames, only the commands are fixed.
+#[derive(Debug)]
+pub struct RenderBundle {
+    raw: wgpu::RenderBundle,
+    id: ResourceId,
+    stats: RenderPassStats,
+}
+
+/// Describes a wrapper around the raw [`wgpu::RenderBundleEncoder`], with the same
+/// interface as a [`crate::graphics::pass::RenderPass`]
+///
+/// Like a render pass, the encoder skips setting a resource that is already bound in the same slot.
+pub struct RenderBundleEncoder<'a> {
+    raw: wgpu::RenderBundleEncoder<'a>,
+    state: BoundState,
+    stats: RenderPassStats,
+}
+
+/// Describes a render bundle, the attachments of the render passes it can be executed in
+#[derive(Debug, Clone, Copy)]
+pub struct RenderBundleDescriptor<'a> {
+    /// The optional debugging label of this render bundle
+    pub label: Option<&'a str>,
+    /// The formats of the color attachments, has to match the render pass
+    pub color_formats: &'a [TextureFormat],
+    /// The format of the depth/stencil attachment, if the render pass has one
+    pub depth_format: Option<TextureFormat>,
+    /// The amount of samples per pixel of the attachments (1 without MSAA)
+    pub sample_count: u32,
+    /// Whether the bundle doesn't write depth, which lets it execute in a pass
+    /// with a read-only depth attachment
+    pub depth_read_only: bool,
+    /// Whether the bundle doesn't write stencil, which lets it execute in a pass
+    /// with a read-only stencil attachment
+    pub stencil_read_only: bool,
+}
+
+impl RenderBundle {
+    /// Returns the raw [`wgpu::RenderBundle`]
+    pub fn raw(&self) -> &wgpu::RenderBundle {
+        &self.raw
+    }
+
+    /// Returns the [`ResourceId`] of this render bundle
+    pub fn id(&self) -> ResourceId {
+        self.id
+    }
+
+    /// Returns the state change statistics of recording this render bundle
+    pub fn stats(&self) -> RenderPassStats {
+        self.stats
+    }
+}
+
+impl<'a> RenderBundleEncoder<'a> {
+    /// Returns the raw [`wgpu::RenderBundleEncoder`]
+    pub fn raw(&self) -> &wgpu::RenderBundleEncoder<'a> {
+        &self.raw
+    }
+
+    /// Returns the state change statistics of this render bundle so far
+    pub fn stats(&self) -> RenderPassStats {
+        self.stats
+    }
+
+    /// Sets a geometry buffer in a specific slot
+    /// - `slot` -> the slot to use for this buffer
+    /// - `buffer` -> the geometry buffer to set
+    pub fn use_geometry_buffer(&mut self, slot: u32, buffer: &dyn AnyBufferHandle) {
+        self.use_vertex_buffer(slot, buffer);
+    }
+
+    /// Sets an index buffer to the render bundle
+    /// - `buffer` -> the index buffer to set
+    pub fn use_index_buffer(&mut self, buffer: &dyn AnyBufferHandle) {
+        if track(
+            &mut self.state.index_buffer,
+            buffer.id(),
+            &mut self.stats.index_buffers,
+        ) {
+            self.raw
+                .set_index_buffer(buffer.as_slice(), wgpu::IndexFormat::Uint32);
+        }
+    }
+
+    /// Sets an instance buffer in a specific slot
+    /// - `slot` -> the slot to use for this buffer
+    /// - `buffer` -> the instance buffer to set
+    pub fn use_instance_buffer(&mut self, slot: u32, buffer: &dyn AnyBufferHandle) {
+        self.use_vertex_buffer(slot, buffer);
+    }
+
+    /// Sets a [`BindGroup`] to the render bundle
+    /// - `set` -> the bind group
+    pub fn use_bind_group(&mut self, bind_group: &BindGroup) {
+        self.use_bind_groups(&[bind_group]);
+    }
+
+    /// Sets multiple [`BindGroup`] instances to the render bundle
+    pub fn use_bind_groups(&mut self, bind_groups: &[&BindGroup]) {
+        for (slot, bind_group) in bind_groups.iter().enumerate() {
+            if track(
+                slot_mut(&mut self.state.bind_groups, slot),
+                bind_group.id(),
+                &mut self.stats.bind_groups,
+            ) {
+                slot_mut(&mut self.state.bind_group_offsets, slot).clear();
+                // Unwrap is safe here
+                self.raw
+                    .set_bind_group(slot.try_into().unwrap(), bind_group.raw(), &[]);
+            }
+        }
+    }
+
+    /// Sets a [`BindGroup`] with dynamic offsets in a specific slot
+    /// - `slot` -> the slot to use for this bind group
+    /// - `bind_group` -> the bind group
+    /// - `offsets` -> the dynamic offsets in bytes, one per dynamic entry in binding order
+    ///
+    /// The bind group is only set again if it's not bound in the slot with the same offsets.
+    pub fn use_bind_group_with_offsets(
+        &mut self,
+        slot: u32,
+        bind_group: &BindGroup,
+        offsets: &[u32],
+    ) {
+        let index = slot as usize;
+        let bound_offsets = slot_mut(&mut self.state.bind_group_offsets, index);
+        let bound = slot_mut(&mut self.state.bind_groups, index);
+        if *bound == Some(bind_group.id()) && bound_offsets.as_slice() == offsets {
+            self.stats.bind_groups.skipped += 1;
+            return;
+        }
+
+        *bound = Some(bind_group.id());
+        let bound_offsets = &mut self.state.bind_group_offsets[index];
+        bound_offsets.clear();
+        bound_offsets.extend_from_slice(offsets);
+        self.stats.bind_groups.issued += 1;
+        self.raw.set_bind_group(slot, bind_group.raw(), offsets);
+    }
+
+    /// Sets a pipeline to the render bundle
+    /// - `pipeline` -> the pipeline to set
+    pub fn use_pipeline(&mut self, pipeline: &Pipeline) {
+        if track(
+            &mut self.state.pipeline,
+            pipeline.id(),
+            &mut self.stats.pipelines,
+        ) {
+            self.raw.set_pipeline(pipeline.raw());
+        }
+    }
+
+    /// Records a draw call with the current render bundle configuration
+    /// - `vertex_count` -> how many vertices to draw
+    /// - `instance_count` -> how many instances of the geometry to draw
+    pub fn draw(&mut self, vertex_count: u32, instance_count: u32) {
+        match (vertex_count, instance_count) {
+            (0, 0) => panic!("Attempted to draw with a vertex count and instance count of 0"),
+            (_, 0) => panic!("Attempted to draw with an instance count of 0"),
+            (0, _) => panic!("Attempted to draw with a vertex count of 0"),
+            (_, _) => (),
+        }
+
+        self.raw.draw(0..vertex_count, 0..instance_count);
+    }
+
+    /// Records an indexed draw call with the current render bundle configuration
+    /// - `index_count` -> how many indices to draw
+    /// - `instance_count` how many instances of the geometry to draw
+    pub fn draw_indexed(&mut self, index_count: u32, instance_count: u32) {
+        match (index_count, instance_count) {
+            (0, 0) => panic!("Attempted to draw with an index count and instance count of 0"),
+            (_, 0) => panic!("Attempted to draw with an instance count of 0"),
+            (0, _) => panic!("Attempted to draw with an index count of 0"),
+            (_, _) => (),
+        }
+
+        self.raw.draw_indexed(0..index_count, 0, 0..instance_count);
+    }
+
+    /// Records a draw call over a range of vertices and instances
+    /// - `vertices` -> the range of vertices to draw
+    /// - `instances` -> the range of instances to draw
+    pub fn draw_range(&mut self, vertices: Range<u32>, instances: Range<u32>) {
+        match (vertices.is_empty(), instances.is_empty()) {
+            (true, true) => panic!("Attempted to draw with an empty vertex and instance range"),
+            (_, true) => panic!("Attempted to draw with an empty instance range"),
+            (true, _) => panic!("Attempted to draw with an empty vertex range"),
+            (_, _) => (),
+        }
+
+        self.raw.draw(vertices, instances);
+    }
+
+    /// Records an indexed draw call over a range of indices and instances
+    /// - `indices` -> the range of indices to draw
+    /// - `base_vertex` -> the value added to each index before reading the vertex
+    /// - `instances` -> the range of instances to draw
+    pub fn draw_indexed_range(
+        &mut self,
+        indices: Range<u32>,
+        base_vertex: i32,
+        instances: Range<u32>,
+    ) {
+        match (indices.is_empty(), instances.is_empty()) {
+            (true, true) => panic!("Attempted to draw with an empty index and instance range"),
+            (_, true) => panic!("Attempted to draw with an empty instance range"),
+            (true, _) => panic!("Attempted to draw with an empty index range"),
+            (_, _) => (),
+        }
+
+        self.raw.draw_indexed(indices, base_vertex, instances);
+    }
+
+    /// Records a draw call where the arguments are read from a buffer on the GPU
+    /// - `buffer` -> the buffer containing the [`DrawArgs`]
+    /// - `index` -> the index of the [`DrawArgs`] item to use
+    ///
+    /// # Panics:
+    /// - If `index` exceeds the capacity of the buffer.
+    pub fn draw_indirect(&mut self, buffer: &BufferHandle<DrawArgs>, index: usize) {
+        assert_indirect_range(buffer, index, 1);
+        self.raw.draw_indirect(
+            buffer.raw(),
+            BufferHandle::<DrawArgs>::items_to_bytes(index),
+        );
+    }
+
+    /// Records an indexed draw call where the arguments are read from a buffer on the GPU
+    /// - `buffer` -> the buffer containing the [`DrawIndexedArgs`]
+    /// - `index` -> the index of the [`DrawIndexedArgs`] item to use
+    ///
+    /// # Panics:
+    /// - If `index` exceeds the capacity of the buffer.
+    pub fn draw_indexed_indirect(&mut self, buffer: &BufferHandle<DrawIndexedArgs>, index: usize) {
+        assert_indirect_range(buffer, index, 1);
+        self.raw.draw_indexed_indirect(
+            buffer.raw(),
+            BufferHandle::<DrawIndexedArgs>::items_to_bytes(index),
+        );
+    }
+
+    /// Finishes recording and returns the [`RenderBundle`]
+    pub fn finish(self, label: Option<&str>) -> RenderBundle {
+        RenderBundle {
+            raw: self.raw.finish(&wgpu::RenderBundleDescriptor { label }),
+            id: ResourceId::next(),
+            stats: self.stats,
+        }
+    }
+
+    /// Sets a vertex buffer in a specific slot, unless it's already bound there
+    fn use_vertex_buffer(&mut self, slot: u32, buffer: &dyn AnyBufferHandle) {
+        if track(
+            slot_mut(&mut self.state.vertex_buffers, slot as usize),
+            buffer.id(),
+            &mut self.stats.vertex_buffers,
+        ) {
+            self.raw.set_vertex_buffer(slot, buffer.as_slice());
+        }
+    }
+}
+
+impl<'a> RenderBundleDescriptor<'a> {
+    /// Creates a [`RenderBundleEncoder`] to record a render bundle with
+    /// - `device` is the raw [`wgpu::Device`] which is needed to build GPU resources
+    ///
+    /// # Panics:
+    /// - If the sample count is not a power of two.
+    pub fn build(self, device: &wgpu::Device) -> RenderBundleEncoder<'a> {
+        assert!(
+            self.sample_count.is_power_of_two(),
+            "The sample count of a render bundle must be a power of two!"
+        );
+        let color_formats: Vec<_> = self
+            .color_formats
+            .iter()
+            .map(|format| Some(format.raw()))
+            .collect();
+        let raw = device.create_render_bundle_encoder(&wgpu::RenderBundleEncoderDescriptor {
+            label: self.label,
+            color_formats: &color_formats,
+            depth_stencil: self
+                .depth_format
+                .map(|format| wgpu::RenderBundleDepthStencil {
+                    format: format.raw(),
+                    depth_read_only: self.depth_read_only,
+                    stencil_read_only: self.stencil_read_only,
+                }),
+            sample_count: self.sample_count,
+            multiview: None,
+        });
+        RenderBundleEncoder {
+            raw,
+            state: BoundState::default(),
+            stats: RenderPassStats::default(),
+        }
+    }
+
+    /// Records one render bundle per chunk of `items`, spread across multiple threads
+    /// - `device` is the raw [`wgpu::Device`] which is needed to build GPU resources
+    /// - `items` -> the items to record, e.g. the objects of a static scene
+    /// - `threads` -> the maximum amount of threads to record on
+    /// - `record` -> records the draw calls of a chunk of items into an encoder
+    ///
+    /// The bundles are returned in the order of the chunks, executing all of them
+    /// renders the items in order.
+    ///
+    /// # Panics:
+    /// - If `threads` is 0.
+    /// - If recording a chunk panics.
+    pub fn record_parallel<T, F>(
+        self,
+        device: &wgpu::Device,
+        items: &'a [T],
+        threads: usize,
+        record: F,
+    ) -> Vec<RenderBundle>
+    where
+        T: Sync,
+        F: Fn(&mut RenderBundleEncoder<'a>, &'a [T]) + Sync,
+    {
+        assert!(
+            threads > 0,
+            "Attempted to record render bundles on 0 threads"
+        );
+        if items.is_empty() {
+            return Vec::new();
+        }
+
+        let chunk_size = items.len().div_ceil(threads);
+        let record = &record;
+        thread::scope(|scope| {
+            let handles: Vec<_> = items
+                .chunks(chunk_size)
+                .map(|chunk| {
+                    scope.spawn(move || {
+                        let mut encoder = self.build(device);
+                        record(&mut encoder, chunk);
+                        encoder.finish(self.label)
+                    })
+                })
+                .collect();
+            handles
+                .into_iter()
+                .map(|handle| handle.join().expect("Failed to record a render bundle"))
+                .collect()
+        })
+    }
+}
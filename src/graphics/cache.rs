@@ -0,0 +1,157 @@
+use std::{
+    collections::HashMap,
+    fs, io,
+    path::{Path, PathBuf},
+    sync::Arc,
+};
+
+use crate::graphics::pipeline::{Pipeline, PipelineDescriptor, PipelineKey};
+
+/// A cache of built render pipelines.
+///
+/// Building a pipeline is one of the most expensive GPU operations, the shader has to be
+/// compiled into driver-specific machine code which can take several milliseconds per pipeline.
+///
+/// The cache works on two levels:
+/// - Pipelines are deduplicated by their [`PipelineDescriptor::key()`], so requesting the same
+///   pipeline state twice returns the same [`Arc<Pipeline>`] without touching the driver.
+/// - If the device supports [`wgpu::Features::PIPELINE_CACHE`] and a directory was provided,
+///   a driver-level [`wgpu::PipelineCache`] is used for every pipeline built through the cache,
+///   and its data can be persisted with [`PipelineCache::save()`] so the next run skips compilation.
+#[derive(Debug)]
+pub struct PipelineCache {
+    /// The already built pipelines, keyed by the full state of their descriptor
+    pipelines: HashMap<PipelineKey, Arc<Pipeline>>,
+    /// The optional driver-level pipeline cache
+    raw: Option<wgpu::PipelineCache>,
+    /// The file that the driver-level cache data is loaded from and saved to
+    path: Option<PathBuf>,
+    /// The amount of requests that returned an already built pipeline
+    hits: u64,
+    /// The amount of requests that had to build a new pipeline
+    misses: u64,
+}
+
+impl PipelineCache {
+    /// Creates a new [`PipelineCache`].
+    /// - `device` -> the raw [`wgpu::Device`] which is needed to create GPU resources
+    /// - `adapter_info` -> the info of the adapter the device was created from,
+    ///   used to make the cache file specific to the driver and GPU
+    /// - `directory` -> the optional directory the driver-level cache data is stored in,
+    ///   if `None` only in-memory deduplication is performed
+    ///
+    /// The driver-level cache is only created when the device has
+    /// [`wgpu::Features::PIPELINE_CACHE`] enabled and the backend supports it.
+    pub fn new(
+        device: &wgpu::Device,
+        adapter_info: &wgpu::AdapterInfo,
+        directory: Option<&Path>,
+    ) -> Self {
+        let path = directory
+            .filter(|_| device.features().contains(wgpu::Features::PIPELINE_CACHE))
+            .zip(wgpu::util::pipeline_cache_key(adapter_info))
+            .map(|(directory, key)| directory.join(key));
+        let raw = path.as_ref().map(|path| {
+            let data = fs::read(path).ok();
+            // Safety: the data was either produced by `wgpu::PipelineCache::get_data()`
+            // for the same adapter (the file name is derived from it) or is absent,
+            // and `fallback` makes wgpu discard data that fails validation
+            unsafe {
+                device.create_pipeline_cache(&wgpu::PipelineCacheDescriptor {
+                    label: Some("Pipeline cache"),
+                    data: data.as_deref(),
+                    fallback: true,
+                })
+            }
+        });
+
+        Self {
+            pipelines: HashMap::new(),
+            raw,
+            path,
+            hits: 0,
+            misses: 0,
+        }
+    }
+
+    /// Returns the pipeline described by `descriptor`, building it only if
+    /// a pipeline with the same state hasn't been built through this cache yet.
+    /// - `device` -> the raw [`wgpu::Device`] which is needed to build GPU resources
+    /// - `descriptor` -> the [`PipelineDescriptor`] of the pipeline
+    pub fn get_or_build(
+        &mut self,
+        device: &wgpu::Device,
+        descriptor: PipelineDescriptor,
+    ) -> Arc<Pipeline> {
+        let key = descriptor.key();
+        if let Some(pipeline) = self.pipelines.get(&key) {
+            self.hits += 1;
+            return Arc::clone(pipeline);
+        }
+
+        self.misses += 1;
+        let pipeline = Arc::new(descriptor.build_with_cache(device, self.raw.as_ref()));
+        self.pipelines.insert(key, Arc::clone(&pipeline));
+        pipeline
+    }
+
+    /// Saves the driver-level cache data to disk.
+    ///
+    /// Does nothing if there's no driver-level cache, the data is first written
+    /// to a temporary file which then replaces the old one, so an interrupted save
+    /// never leaves a truncated cache behind.
+    ///
+    /// # Errors:
+    /// - If the cache directory or file cannot be written.
+    pub fn save(&self) -> io::Result<()> {
+        let (Some(raw), Some(path)) = (&self.raw, &self.path) else {
+            return Ok(());
+        };
+        let Some(data) = raw.get_data() else {
+            return Ok(());
+        };
+
+        if let Some(directory) = path.parent() {
+            fs::create_dir_all(directory)?;
+        }
+        let temp_path = path.with_extension("tmp");
+        fs::write(&temp_path, data)?;
+        fs::rename(temp_path, path)
+    }
+
+    /// Removes all pipelines from the cache,
+    /// pipelines that are still referenced elsewhere stay alive.
+    pub fn clear(&mut self) {
+        self.pipelines.clear();
+    }
+
+    /// Returns the internal [`wgpu::PipelineCache`] if the driver-level cache is in use
+    pub fn raw(&self) -> Option<&wgpu::PipelineCache> {
+        self.raw.as_ref()
+    }
+
+    /// Returns the path of the driver-level cache file if the driver-level cache is in use
+    pub fn path(&self) -> Option<&Path> {
+        self.path.as_deref()
+    }
+
+    /// Returns the amount of pipelines currently in the cache
+    pub fn len(&self) -> usize {
+        self.pipelines.len()
+    }
+
+    /// Returns `true` if there are no pipelines in the cache
+    pub fn is_empty(&self) -> bool {
+        self.pipelines.is_empty()
+    }
+
+    /// Returns the amount of requests that returned an already built pipeline
+    pub fn hits(&self) -> u64 {
+        self.hits
+    }
+
+    /// Returns the amount of requests that had to build a new pipeline
+    pub fn misses(&self) -> u64 {
+        self.misses
+    }
+}
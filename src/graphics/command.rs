@@ -0,0 +1,187 @@
+use std::{num::NonZeroUsize, thread};
+
+use crate::graphics::upload::UploadBelt;
+
+/// Describes a pool of command buffers that are recorded independently, possibly on
+/// multiple threads, and submitted together in a declared order
+///
+/// Every independent part of a frame (shadow cascades, the main view, the UI) is recorded
+/// into its own [`wgpu::CommandEncoder`] with an order key, the pool then submits all
+/// command buffers sorted by their order with a single `queue.submit()`.
+/// Buffer uploads are recorded into a dedicated encoder that is always submitted first,
+/// so every pass sees the data of the current frame.
+///
+/// ```rust
+/// let mut pool = CommandPool::new();
+/// // Every frame
+/// instance_buffer.flush_dirty_with(&device, &mut belt, pool.uploads(&device));
+/// pool.record_parallel(
+///     &device,
+///     vec![
+///         CommandJob::new(0, Some("Shadows"), |encoder| record_shadows(encoder)),
+///         CommandJob::new(1, Some("Main view"), |encoder| record_main_view(encoder)),
+///         CommandJob::new(2, Some("UI"), |encoder| record_ui(encoder)),
+///     ],
+/// );
+/// pool.submit(&queue, Some(&mut belt));
+/// ```
+#[derive(Debug, Default)]
+pub struct CommandPool {
+    /// The encoder uploads are recorded into, if any were recorded this frame
+    uploads: Option<wgpu::CommandEncoder>,
+    /// The finished command buffers with their order keys
+    buffers: Vec<(u32, wgpu::CommandBuffer)>,
+}
+
+/// Describes a unit of work of a [`CommandPool`], recorded into its own encoder
+pub struct CommandJob<'a> {
+    /// The order of the resulting command buffer in the submission, lower orders are submitted
+    /// first and equal orders keep the order they were added in
+    pub order: u32,
+    /// The optional debugging label of the encoder
+    pub label: Option<&'a str>,
+    /// Records the commands into the encoder
+    pub record: Box<dyn FnOnce(&mut wgpu::CommandEncoder) + Send + 'a>,
+}
+
+impl CommandPool {
+    /// Creates a new, empty [`CommandPool`]
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Returns the encoder buffer uploads are recorded into, e.g. through
+    /// [`crate::graphics::buffer::BufferHandle::flush_dirty_with()`],
+    /// which is submitted before any other command buffer of the pool
+    /// - `device` is the raw [`wgpu::Device`] which is needed to build GPU resources
+    pub fn uploads(&mut self, device: &wgpu::Device) -> &mut wgpu::CommandEncoder {
+        self.uploads.get_or_insert_with(|| {
+            device.create_command_encoder(&wgpu::CommandEncoderDescriptor {
+                label: Some("Uploads"),
+            })
+        })
+    }
+
+    /// Adds a finished command buffer, e.g. one recorded on a thread the pool doesn't manage
+    /// - `order` -> the order of the command buffer in the submission
+    /// - `buffer` -> the finished command buffer
+    pub fn push(&mut self, order: u32, buffer: wgpu::CommandBuffer) {
+        self.buffers.push((order, buffer));
+    }
+
+    /// Records a single job on the current thread
+    /// - `device` is the raw [`wgpu::Device`] which is needed to build GPU resources
+    /// - `job` -> the job to record
+    pub fn record(&mut self, device: &wgpu::Device, job: CommandJob) {
+        let order = job.order;
+        self.buffers.push((order, job.finish(device)));
+    }
+
+    /// Records the jobs on multiple threads, every job into its own encoder,
+    /// and waits for all of them
+    /// - `device` is the raw [`wgpu::Device`] which is needed to build GPU resources
+    /// - `jobs` -> the jobs to record
+    ///
+    /// The jobs are split into contiguous chunks, one per thread, and no more threads are
+    /// spawned than [`thread::available_parallelism()`], so many small jobs don't each pay
+    /// for a thread of their own.
+    ///
+    /// # Panics:
+    /// - If recording a job panics.
+    pub fn record_parallel(&mut self, device: &wgpu::Device, jobs: Vec<CommandJob>) {
+        let threads = thread::available_parallelism()
+            .map_or(1, NonZeroUsize::get)
+            .min(jobs.len());
+        if threads <= 1 {
+            for job in jobs {
+                self.record(device, job);
+            }
+            return;
+        }
+
+        let chunk_size = jobs.len().div_ceil(threads);
+        let mut jobs = jobs.into_iter();
+        let buffers: Vec<_> = thread::scope(|scope| {
+            let handles: Vec<_> = (0..jobs.len().div_ceil(chunk_size))
+                .map(|_| {
+                    let chunk: Vec<_> = jobs.by_ref().take(chunk_size).collect();
+                    scope.spawn(move || {
+                        chunk
+                            .into_iter()
+                            .map(|job| (job.order, job.finish(device)))
+                            .collect::<Vec<_>>()
+                    })
+                })
+                .collect();
+            handles
+                .into_iter()
+                .flat_map(|handle| handle.join().expect("Failed to record a command job"))
+                .collect()
+        });
+        self.buffers.extend(buffers);
+    }
+
+    /// Submits the uploads and every command buffer sorted by order with a single
+    /// `queue.submit()`, and empties the pool for the next frame
+    /// - `queue` -> the queue to submit to
+    /// - `belt` -> the optional [`UploadBelt`] the uploads were written through,
+    ///   which is finished before and recalled after the submission
+    pub fn submit(
+        &mut self,
+        queue: &wgpu::Queue,
+        belt: Option<&mut UploadBelt>,
+    ) -> wgpu::SubmissionIndex {
+        // The sort is stable, so equal orders keep the order they were added in
+        self.buffers.sort_by_key(|(order, _)| *order);
+        let uploads = self.uploads.take().map(wgpu::CommandEncoder::finish);
+        let buffers = uploads
+            .into_iter()
+            .chain(self.buffers.drain(..).map(|(_, buffer)| buffer));
+
+        match belt {
+            Some(belt) => {
+                belt.finish();
+                let index = queue.submit(buffers);
+                belt.recall();
+                index
+            }
+            None => queue.submit(buffers),
+        }
+    }
+
+    /// Returns the amount of command buffers waiting for submission, excluding the uploads
+    pub fn len(&self) -> usize {
+        self.buffers.len()
+    }
+
+    /// Returns `true` if no command buffers are waiting for submission, excluding the uploads
+    pub fn is_empty(&self) -> bool {
+        self.buffers.is_empty()
+    }
+}
+
+impl<'a> CommandJob<'a> {
+    /// Creates a new [`CommandJob`]
+    /// - `order` -> the order of the resulting command buffer in the submission
+    /// - `label` -> the optional debugging label of the encoder
+    /// - `record` -> records the commands into the encoder
+    pub fn new(
+        order: u32,
+        label: Option<&'a str>,
+        record: impl FnOnce(&mut wgpu::CommandEncoder) + Send + 'a,
+    ) -> Self {
+        Self {
+            order,
+            label,
+            record: Box::new(record),
+        }
+    }
+
+    /// Records the job into a new encoder and returns the finished command buffer
+    fn finish(self, device: &wgpu::Device) -> wgpu::CommandBuffer {
+        let mut encoder =
+            device.create_command_encoder(&wgpu::CommandEncoderDescriptor { label: self.label });
+        (self.record)(&mut encoder);
+        encoder.finish()
+    }
+}
@@ -0,0 +1,431 @@
+use std::{error::Error, fmt};
+
+use crate::graphics::{mipmap, texture::TextureFormat};
+
+/// The identifier every KTX2 file starts with.
+const KTX2_IDENTIFIER: [u8; 12] = [
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A,
+];
+
+/// The magic number every DDS file starts with.
+const DDS_MAGIC: [u8; 4] = *b"DDS ";
+
+/// The size of the KTX2 header and index, up to the level index.
+const KTX2_HEADER_SIZE: usize = 80;
+
+/// The size of a single KTX2 level index entry.
+const KTX2_LEVEL_SIZE: usize = 24;
+
+/// The size of the DDS magic number and header.
+const DDS_HEADER_SIZE: usize = 128;
+
+/// The size of the extended DDS header used by DXGI formats.
+const DDS_DX10_HEADER_SIZE: usize = 20;
+
+/// The DDS pixel format flag signaling a four character code.
+const DDPF_FOURCC: u32 = 0x4;
+
+/// The DDS pixel format flag signaling uncompressed RGB data.
+const DDPF_RGB: u32 = 0x40;
+
+/// Describes a texture loaded from a container file (KTX2 or DDS).
+///
+/// The texel data is kept exactly as stored in the file, so compressed textures
+/// can be uploaded to the GPU without being decoded first.
+#[derive(Debug, Clone)]
+pub struct ContainerImage {
+    /// The format of the texel data
+    pub format: TextureFormat,
+    /// The width of the first mip level (in pixels)
+    pub width: u32,
+    /// The height of the first mip level (in pixels)
+    pub height: u32,
+    /// The texel data of every mip level, starting with the first (largest) one
+    pub levels: Vec<Vec<u8>>,
+}
+
+/// Specifies a container error that may have occurred.
+#[derive(Debug)]
+pub enum ContainerError {
+    /// The file is neither a KTX2 nor a DDS file
+    UnknownContainer,
+    /// The file ended before all of the described data could be read
+    Truncated,
+    /// The texel format stored in the file is not supported
+    UnsupportedFormat {
+        /// The raw format code (a Vulkan format for KTX2, a DXGI format or four character code for DDS)
+        code: u32,
+    },
+    /// The file describes a texture kind that is not supported
+    Unsupported {
+        /// The feature of the file that isn't supported
+        cause: &'static str,
+    },
+    /// The file contradicts itself, e.g. a level count or size that doesn't fit the texture
+    Malformed {
+        /// The inconsistency found in the file
+        cause: &'static str,
+    },
+}
+
+/// Parses a KTX2 or DDS file, detecting the container from its magic number.
+/// - `bytes` -> the entire contents of the file
+pub fn parse(bytes: &[u8]) -> Result<ContainerImage, ContainerError> {
+    if bytes.starts_with(&KTX2_IDENTIFIER) {
+        parse_ktx2(bytes)
+    } else if bytes.starts_with(&DDS_MAGIC) {
+        parse_dds(bytes)
+    } else {
+        Err(ContainerError::UnknownContainer)
+    }
+}
+
+/// Parses a KTX2 file, only single-layer 2D textures without supercompression are supported.
+pub fn parse_ktx2(bytes: &[u8]) -> Result<ContainerImage, ContainerError> {
+    if bytes.len() < KTX2_HEADER_SIZE {
+        return Err(ContainerError::Truncated);
+    }
+
+    let vk_format = read_u32(bytes, 12)?;
+    let width = read_u32(bytes, 20)?;
+    let height = read_u32(bytes, 24)?.max(1);
+    let depth = read_u32(bytes, 28)?;
+    let layer_count = read_u32(bytes, 32)?;
+    let face_count = read_u32(bytes, 36)?;
+    let level_count = read_u32(bytes, 40)?.max(1);
+    let supercompression = read_u32(bytes, 44)?;
+
+    if depth > 1 || layer_count > 1 || face_count > 1 {
+        return Err(ContainerError::Unsupported {
+            cause: "Only single-layer 2D textures are supported",
+        });
+    }
+    if supercompression != 0 {
+        return Err(ContainerError::Unsupported {
+            cause: "Supercompressed textures are not supported",
+        });
+    }
+    let format = format_from_vk(vk_format)?;
+    err_on_level_count(width, height, level_count)?;
+    // The whole level index has to be present before anything gets allocated for it
+    read_bytes(
+        bytes,
+        KTX2_HEADER_SIZE,
+        level_count as usize * KTX2_LEVEL_SIZE,
+    )?;
+
+    let mut levels = Vec::with_capacity(level_count as usize);
+    for level in 0..level_count as usize {
+        let entry = KTX2_HEADER_SIZE + level * KTX2_LEVEL_SIZE;
+        let offset = read_u64(bytes, entry)? as usize;
+        let length = read_u64(bytes, entry + 8)? as usize;
+        if length != level_byte_size(format, width, height, level as u32) {
+            return Err(ContainerError::Malformed {
+                cause: "A level has the wrong amount of bytes for its size",
+            });
+        }
+        levels.push(read_bytes(bytes, offset, length)?.to_vec());
+    }
+
+    Ok(ContainerImage {
+        format,
+        width,
+        height,
+        levels,
+    })
+}
+
+/// Parses a DDS file, only single-layer 2D textures are supported.
+pub fn parse_dds(bytes: &[u8]) -> Result<ContainerImage, ContainerError> {
+    if bytes.len() < DDS_HEADER_SIZE {
+        return Err(ContainerError::Truncated);
+    }
+
+    let height = read_u32(bytes, 12)?;
+    let width = read_u32(bytes, 16)?;
+    let level_count = read_u32(bytes, 28)?.max(1);
+    let pixel_flags = read_u32(bytes, 80)?;
+    let four_cc = read_u32(bytes, 84)?;
+
+    let (format, mut offset) = if pixel_flags & DDPF_FOURCC != 0 {
+        if four_cc == u32::from_le_bytes(*b"DX10") {
+            let dxgi_format = read_u32(bytes, DDS_HEADER_SIZE)?;
+            let array_size = read_u32(bytes, DDS_HEADER_SIZE + 12)?;
+            if array_size > 1 {
+                return Err(ContainerError::Unsupported {
+                    cause: "Only single-layer 2D textures are supported",
+                });
+            }
+            (
+                format_from_dxgi(dxgi_format)?,
+                DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE,
+            )
+        } else {
+            (format_from_four_cc(four_cc)?, DDS_HEADER_SIZE)
+        }
+    } else if pixel_flags & DDPF_RGB != 0 {
+        let bit_count = read_u32(bytes, 88)?;
+        let red_mask = read_u32(bytes, 92)?;
+        let blue_mask = read_u32(bytes, 100)?;
+        if bit_count != 32 || red_mask != 0x0000_00FF || blue_mask != 0x00FF_0000 {
+            return Err(ContainerError::Unsupported {
+                cause: "Only RGBA8 uncompressed textures are supported",
+            });
+        }
+        (TextureFormat::UnsignedNormalized, DDS_HEADER_SIZE)
+    } else {
+        return Err(ContainerError::UnsupportedFormat { code: pixel_flags });
+    };
+
+    err_on_level_count(width, height, level_count)?;
+
+    // DDS doesn't store level offsets, the levels are tightly packed one after another
+    let mut levels = Vec::with_capacity(level_count as usize);
+    for level in 0..level_count {
+        let length = level_byte_size(format, width, height, level);
+        levels.push(read_bytes(bytes, offset, length)?.to_vec());
+        offset += length;
+    }
+
+    Ok(ContainerImage {
+        format,
+        width,
+        height,
+        levels,
+    })
+}
+
+/// Returns the size in bytes of a tightly packed mip level of a texture.
+/// - `format` -> the format of the texture
+/// - `width` -> the width of the first mip level
+/// - `height` -> the height of the first mip level
+/// - `level` -> the mip level
+pub fn level_byte_size(format: TextureFormat, width: u32, height: u32, level: u32) -> usize {
+    let (block_width, block_height, block_size) = format.block_layout();
+    let width = (width >> level).max(1);
+    let height = (height >> level).max(1);
+    (width.div_ceil(block_width) * height.div_ceil(block_height) * block_size) as usize
+}
+
+/// Fails if a texture of `width` x `height` can't have `level_count` mip levels,
+/// which also bounds the allocations made for the levels
+fn err_on_level_count(width: u32, height: u32, level_count: u32) -> Result<(), ContainerError> {
+    if level_count > mipmap::full_mip_level_count(width, height) {
+        return Err(ContainerError::Malformed {
+            cause: "Too many mip levels for the texture size",
+        });
+    }
+
+    Ok(())
+}
+
+/// Maps a Vulkan format code (as stored in KTX2) to a [`TextureFormat`]
+fn format_from_vk(code: u32) -> Result<TextureFormat, ContainerError> {
+    match code {
+        37 => Ok(TextureFormat::UnsignedNormalized),
+        43 => Ok(TextureFormat::Standard),
+        133 => Ok(TextureFormat::Bc1 { is_srgb: false }),
+        134 => Ok(TextureFormat::Bc1 { is_srgb: true }),
+        137 => Ok(TextureFormat::Bc3 { is_srgb: false }),
+        138 => Ok(TextureFormat::Bc3 { is_srgb: true }),
+        141 => Ok(TextureFormat::Bc5),
+        145 => Ok(TextureFormat::Bc7 { is_srgb: false }),
+        146 => Ok(TextureFormat::Bc7 { is_srgb: true }),
+        151 => Ok(TextureFormat::Etc2 { is_srgb: false }),
+        152 => Ok(TextureFormat::Etc2 { is_srgb: true }),
+        157 => Ok(TextureFormat::Astc { is_srgb: false }),
+        158 => Ok(TextureFormat::Astc { is_srgb: true }),
+        _ => Err(ContainerError::UnsupportedFormat { code }),
+    }
+}
+
+/// Maps a DXGI format code (as stored in the DDS DX10 header) to a [`TextureFormat`]
+fn format_from_dxgi(code: u32) -> Result<TextureFormat, ContainerError> {
+    match code {
+        28 => Ok(TextureFormat::UnsignedNormalized),
+        29 => Ok(TextureFormat::Standard),
+        71 => Ok(TextureFormat::Bc1 { is_srgb: false }),
+        72 => Ok(TextureFormat::Bc1 { is_srgb: true }),
+        77 => Ok(TextureFormat::Bc3 { is_srgb: false }),
+        78 => Ok(TextureFormat::Bc3 { is_srgb: true }),
+        83 => Ok(TextureFormat::Bc5),
+        98 => Ok(TextureFormat::Bc7 { is_srgb: false }),
+        99 => Ok(TextureFormat::Bc7 { is_srgb: true }),
+        _ => Err(ContainerError::UnsupportedFormat { code }),
+    }
+}
+
+/// Maps a legacy DDS four character code to a [`TextureFormat`]
+fn format_from_four_cc(code: u32) -> Result<TextureFormat, ContainerError> {
+    match &code.to_le_bytes() {
+        b"DXT1" => Ok(TextureFormat::Bc1 { is_srgb: false }),
+        b"DXT5" => Ok(TextureFormat::Bc3 { is_srgb: false }),
+        b"ATI2" | b"BC5U" => Ok(TextureFormat::Bc5),
+        _ => Err(ContainerError::UnsupportedFormat { code }),
+    }
+}
+
+/// Reads `length` bytes at `offset`, failing if the file is too short
+fn read_bytes(bytes: &[u8], offset: usize, length: usize) -> Result<&[u8], ContainerError> {
+    offset
+        .checked_add(length)
+        .and_then(|end| bytes.get(offset..end))
+        .ok_or(ContainerError::Truncated)
+}
+
+/// Reads a little-endian `u32` at `offset`
+fn read_u32(bytes: &[u8], offset: usize) -> Result<u32, ContainerError> {
+    // Unwrap is safe here, the slice is exactly 4 bytes long
+    Ok(u32::from_le_bytes(
+        read_bytes(bytes, offset, 4)?.try_into().unwrap(),
+    ))
+}
+
+/// Reads a little-endian `u64` at `offset`
+fn read_u64(bytes: &[u8], offset: usize) -> Result<u64, ContainerError> {
+    // Unwrap is safe here, the slice is exactly 8 bytes long
+    Ok(u64::from_le_bytes(
+        read_bytes(bytes, offset, 8)?.try_into().unwrap(),
+    ))
+}
+
+impl fmt::Display for ContainerError {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        match self {
+            ContainerError::UnknownContainer => {
+                write!(f, "Unknown texture container, expected KTX2 or DDS")
+            }
+            ContainerError::Truncated => write!(f, "Texture container is truncated"),
+            ContainerError::UnsupportedFormat { code } => {
+                write!(f, "Unsupported texture container format: {}", code)
+            }
+            ContainerError::Unsupported { cause } => {
+                write!(f, "Unsupported texture container:\n\t{}", cause)
+            }
+            ContainerError::Malformed { cause } => {
+                write!(f, "Malformed texture container:\n\t{}", cause)
+            }
+        }
+    }
+}
+
+impl Error for ContainerError {}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn push_u32(bytes: &mut Vec<u8>, value: u32) {
+        bytes.extend_from_slice(&value.to_le_bytes());
+    }
+
+    fn ktx2(vk_format: u32, width: u32, height: u32, levels: &[Vec<u8>]) -> Vec<u8> {
+        let mut bytes = KTX2_IDENTIFIER.to_vec();
+        for value in [vk_format, 1, width, height, 0, 0, 1, levels.len() as u32, 0] {
+            push_u32(&mut bytes, value);
+        }
+        bytes.resize(KTX2_HEADER_SIZE, 0);
+        let mut offset = (KTX2_HEADER_SIZE + levels.len() * KTX2_LEVEL_SIZE) as u64;
+        for level in levels {
+            bytes.extend_from_slice(&offset.to_le_bytes());
+            bytes.extend_from_slice(&(level.len() as u64).to_le_bytes());
+            bytes.extend_from_slice(&(level.len() as u64).to_le_bytes());
+            offset += level.len() as u64;
+        }
+        for level in levels {
+            bytes.extend_from_slice(level);
+        }
+        bytes
+    }
+
+    fn dds_dxt1(width: u32, height: u32, level_count: u32, data: &[u8]) -> Vec<u8> {
+        let mut bytes = DDS_MAGIC.to_vec();
+        bytes.resize(DDS_HEADER_SIZE, 0);
+        bytes[12..16].copy_from_slice(&height.to_le_bytes());
+        bytes[16..20].copy_from_slice(&width.to_le_bytes());
+        bytes[28..32].copy_from_slice(&level_count.to_le_bytes());
+        bytes[80..84].copy_from_slice(&DDPF_FOURCC.to_le_bytes());
+        bytes[84..88].copy_from_slice(b"DXT1");
+        bytes.extend_from_slice(data);
+        bytes
+    }
+
+    #[test]
+    fn parse_ktx2_levels() {
+        let levels = vec![vec![1; 64], vec![2; 16], vec![3; 16]];
+        let image = parse(&ktx2(145, 8, 8, &levels)).unwrap();
+        assert!(matches!(
+            image.format,
+            TextureFormat::Bc7 { is_srgb: false }
+        ));
+        assert_eq!((image.width, image.height), (8, 8));
+        assert_eq!(image.levels, levels);
+    }
+
+    #[test]
+    fn parse_corrupt_ktx2() {
+        // A level count far past the mip chain of the size
+        let mut bytes = ktx2(145, 8, 8, &[vec![0; 64]]);
+        bytes[40..44].copy_from_slice(&u32::MAX.to_le_bytes());
+        assert!(matches!(
+            parse(&bytes),
+            Err(ContainerError::Malformed { .. })
+        ));
+
+        // A level count the level index doesn't hold
+        let mut bytes = ktx2(145, 8, 8, &[vec![0; 64]]);
+        bytes[40..44].copy_from_slice(&4u32.to_le_bytes());
+        bytes.truncate(KTX2_HEADER_SIZE + 2 * KTX2_LEVEL_SIZE);
+        assert!(matches!(parse(&bytes), Err(ContainerError::Truncated)));
+
+        // A level shorter than its size requires
+        assert!(matches!(
+            parse(&ktx2(145, 8, 8, &[vec![0; 64], vec![0; 8]])),
+            Err(ContainerError::Malformed { .. })
+        ));
+    }
+
+    #[test]
+    fn parse_dds_too_many_levels() {
+        assert!(matches!(
+            parse(&dds_dxt1(8, 8, u32::MAX, &[0; 48])),
+            Err(ContainerError::Malformed { .. })
+        ));
+    }
+
+    #[test]
+    fn parse_dds_levels() {
+        // 8x8 BC1 is 2x2 blocks of 8 bytes, then 1 block for 4x4 and 1 block for 2x2
+        let data: Vec<u8> = (0..48).collect();
+        let image = parse(&dds_dxt1(8, 8, 3, &data)).unwrap();
+        assert!(matches!(
+            image.format,
+            TextureFormat::Bc1 { is_srgb: false }
+        ));
+        assert_eq!(image.levels.len(), 3);
+        assert_eq!(image.levels[0], data[..32]);
+        assert_eq!(image.levels[1], data[32..40]);
+        assert_eq!(image.levels[2], data[40..48]);
+    }
+
+    #[test]
+    fn parse_truncated() {
+        let data = vec![0; 16];
+        assert!(matches!(
+            parse(&dds_dxt1(8, 8, 1, &data)),
+            Err(ContainerError::Truncated)
+        ));
+        assert!(matches!(
+            parse(b"not a texture"),
+            Err(ContainerError::UnknownContainer)
+        ));
+    }
+
+    #[test]
+    fn parse_unsupported_format() {
+        assert!(matches!(
+            parse(&ktx2(9999, 4, 4, &[vec![0; 16]])),
+            Err(ContainerError::UnsupportedFormat { code: 9999 })
+        ));
+    }
+}
@@ -1,10 +1,19 @@
-use crate::graphics::{buffer::AnyBufferHandle, sampler::Sampler, texture::Texture};
+use std::num::{NonZeroU32, NonZeroU64};
+
+use bytemuck::Pod;
+
+use crate::graphics::{
+    arena::UniformArena, buffer::AnyBufferHandle, id::ResourceId, sampler::Sampler,
+    texture::Texture,
+};
 
 /// Describes a wrapper around the raw [`wgpu::BindGroup`]
 #[derive(Debug)]
 pub struct BindGroup {
     /// The internal [`wgpu::BindGroup`]
     raw: wgpu::BindGroup,
+    /// The unique identity of this bind group
+    id: ResourceId,
 }
 
 /// Describes a wrapper around the raw [`wgpu::BindGroupLayout`]
@@ -12,6 +21,8 @@ pub struct BindGroup {
 pub struct BindGroupLayout {
     /// The internal [`wgpu::BindGroupLayout`]
     raw: wgpu::BindGroupLayout,
+    /// The unique identity of this bind group layout
+    id: ResourceId,
 }
 
 /// Describes a [`BindGroup`].
@@ -76,10 +87,26 @@ pub struct BindGroupLayoutEntry {
 pub enum Resource<'a> {
     /// A buffer resource, holding a reference to an [`AnyBufferHandle`] trait object.
     Buffer(&'a dyn AnyBufferHandle),
+    /// A window of a buffer resource, which is required for dynamic offsets,
+    /// since the dynamic offset moves the window within the buffer
+    BufferRange {
+        /// The buffer holding the resource
+        buffer: &'a dyn AnyBufferHandle,
+        /// The offset of the window in bytes
+        offset: u64,
+        /// The size of the window in bytes
+        size: u64,
+    },
     /// A sampler resource, holding a reference to a [`Sampler`]
     Sampler(&'a Sampler),
     /// A texture resource, holding a reference to a [`Texture`]
     Texture(&'a Texture),
+    /// A binding array of textures, holding the views of the textures (see [`Texture::view()`]),
+    /// the amount of views has to match the count of the layout entry
+    TextureArray(&'a [&'a wgpu::TextureView]),
+    /// A binding array of buffers, holding the bindings of the buffers,
+    /// the amount of bindings has to match the count of the layout entry
+    BufferArray(&'a [wgpu::BufferBinding<'a>]),
 }
 
 /// Describes the expected resource type in a [`BindGroupLayout`]
@@ -91,6 +118,22 @@ pub enum LayoutResource {
     Sampler(SamplerConfig),
     /// The expected resource is a texture specified by a [`TextureConfig`]
     Texture(TextureConfig),
+    /// The expected resource is a binding array of `count` textures, which shaders index
+    /// with any value (e.g. a per-instance material index), see [`LayoutResource::required_features()`]
+    TextureArray {
+        /// The configuration of every texture in the array
+        config: TextureConfig,
+        /// The amount of textures in the array
+        count: NonZeroU32,
+    },
+    /// The expected resource is a binding array of `count` storage buffers, which shaders
+    /// index with any value, see [`LayoutResource::required_features()`]
+    BufferArray {
+        /// Whether shaders can also write to the buffers
+        is_writable: bool,
+        /// The amount of buffers in the array
+        count: NonZeroU32,
+    },
 }
 
 /// Describes the configuration of an expected buffer resource
@@ -102,6 +145,18 @@ pub enum BufferConfig {
     /// The expected resource is a storage buffer,
     /// which is meant for large amounts of data
     Storage,
+    /// The expected resource is a storage buffer that shaders can also write to,
+    /// which is meant for compute shaders
+    ///
+    /// It's important to note that writable storage buffers cannot be
+    /// accessed in the vertex shader
+    ReadWriteStorage,
+    /// The expected resource is a uniform buffer bound with a dynamic offset,
+    /// which lets many draws share a single buffer and bind group
+    DynamicUniform,
+    /// The expected resource is a storage buffer bound with a dynamic offset,
+    /// which lets many draws share a single buffer and bind group
+    DynamicStorage,
 }
 
 /// Describes the configuration of an expected sampler resource
@@ -121,6 +176,7 @@ pub enum SamplerConfig {
 ///
 /// - 1D textures are useful for gradients
 /// - 2D textures are the most common type of textures, flat 2D images
+/// - 2D array textures are useful for atlases and sprite sheets that share a single binding
 /// - 3D textures are less common but they're useful for volumetric effects like fog or smoke
 /// - Cubemap textures are useful for skyboxes and environments
 #[derive(Debug, Clone, Copy)]
@@ -129,6 +185,8 @@ pub enum TextureConfig {
     D1(TextureKind),
     /// The expected resource is a 2D texture of any kind
     D2(TextureKind),
+    /// The expected resource is an array of 2D textures of any kind
+    D2Array(TextureKind),
     /// The expected resource is a 3D texture of any kind
     D3(TextureKind),
     /// The expected resource is a cubemap, which is formed by 6 textures
@@ -153,6 +211,10 @@ pub enum ResourceAccess {
     Fragment,
     /// Specifies that the resource is accessible by either shader of the two
     Either,
+    /// Specifies that the resource is accessible only in the compute shader
+    Compute,
+    /// Specifies that the resource is accessible by every shader (vertex, fragment, compute)
+    All,
 }
 
 impl BindGroup {
@@ -160,6 +222,11 @@ impl BindGroup {
     pub fn raw(&self) -> &wgpu::BindGroup {
         &self.raw
     }
+
+    /// Returns the unique [`ResourceId`] of this bind group
+    pub fn id(&self) -> ResourceId {
+        self.id
+    }
 }
 
 impl BindGroupLayout {
@@ -167,6 +234,11 @@ impl BindGroupLayout {
     pub fn raw(&self) -> &wgpu::BindGroupLayout {
         &self.raw
     }
+
+    /// Returns the unique [`ResourceId`] of this bind group layout
+    pub fn id(&self) -> ResourceId {
+        self.id
+    }
 }
 
 impl<'a> BindGroupDescriptor<'a> {
@@ -187,6 +259,7 @@ impl<'a> BindGroupDescriptor<'a> {
                 layout: self.layout.raw(),
                 entries: Box::leak(entries.into_boxed_slice()),
             }),
+            id: ResourceId::next(),
         }
     }
 }
@@ -194,7 +267,43 @@ impl<'a> BindGroupDescriptor<'a> {
 impl<'a> BindGroupLayoutDescriptor<'a> {
     /// Builds a [`BindGroupLayout`]
     /// - `device` -> the [`wgpu::Device`] required to create a raw [`wgpu::BindGroupLayout`]
+    ///
+    /// # Panics:
+    /// - If the device lacks the features a binding array entry requires.
+    /// - If the binding arrays visible to a shader stage hold more elements than
+    ///   [`wgpu::Limits::max_binding_array_elements_per_shader_stage`] allows.
     pub fn build(&self, device: &wgpu::Device) -> BindGroupLayout {
+        let required = self
+            .entries
+            .iter()
+            .fold(wgpu::Features::empty(), |features, entry| {
+                features | entry.resource.required_features()
+            });
+        assert!(
+            device.features().contains(required),
+            "Device lacks the features {:?} required by the binding arrays of the layout!",
+            required - device.features()
+        );
+        let limit = device.limits().max_binding_array_elements_per_shader_stage;
+        for stage in [
+            wgpu::ShaderStages::VERTEX,
+            wgpu::ShaderStages::FRAGMENT,
+            wgpu::ShaderStages::COMPUTE,
+        ] {
+            let elements: u32 = self
+                .entries
+                .iter()
+                .filter(|entry| entry.access.raw().contains(stage))
+                .filter_map(|entry| entry.resource.count())
+                .map(NonZeroU32::get)
+                .sum();
+            assert!(
+                elements <= limit,
+                "Binding arrays of the layout hold {elements} elements in the {stage:?} stage, \
+                 but the device allows only {limit}, raise `max_binding_array_elements_per_shader_stage`!"
+            );
+        }
+
         let entries: Vec<_> = self
             .entries
             .iter()
@@ -202,7 +311,7 @@ impl<'a> BindGroupLayoutDescriptor<'a> {
                 binding: entry.binding,
                 visibility: entry.access.raw(),
                 ty: entry.resource.raw(),
-                count: None,
+                count: entry.resource.count(),
             })
             .collect();
         BindGroupLayout {
@@ -210,6 +319,7 @@ impl<'a> BindGroupLayoutDescriptor<'a> {
                 label: self.label,
                 entries: Box::leak(entries.into_boxed_slice()),
             }),
+            id: ResourceId::next(),
         }
     }
 }
@@ -219,8 +329,19 @@ impl<'a> Resource<'a> {
     pub fn raw(&self) -> wgpu::BindingResource<'a> {
         match self {
             Resource::Buffer(buffer) => buffer.raw().as_entire_binding(),
+            Resource::BufferRange {
+                buffer,
+                offset,
+                size,
+            } => wgpu::BindingResource::Buffer(wgpu::BufferBinding {
+                buffer: buffer.raw(),
+                offset: *offset,
+                size: NonZeroU64::new(*size),
+            }),
             Resource::Sampler(sampler) => wgpu::BindingResource::Sampler(sampler.raw()),
             Resource::Texture(texture) => wgpu::BindingResource::TextureView(texture.view()),
+            Resource::TextureArray(views) => wgpu::BindingResource::TextureViewArray(views),
+            Resource::BufferArray(bindings) => wgpu::BindingResource::BufferArray(bindings),
         }
     }
 }
@@ -232,6 +353,43 @@ impl LayoutResource {
             LayoutResource::Buffer(config) => config.raw(),
             LayoutResource::Sampler(config) => config.raw(),
             LayoutResource::Texture(config) => config.raw(),
+            LayoutResource::TextureArray { config, .. } => config.raw(),
+            LayoutResource::BufferArray { is_writable, .. } => {
+                if *is_writable {
+                    BufferConfig::ReadWriteStorage.raw()
+                } else {
+                    BufferConfig::Storage.raw()
+                }
+            }
+        }
+    }
+
+    /// Returns the amount of resources in a binding array, [`None`] for a single resource
+    pub fn count(&self) -> Option<NonZeroU32> {
+        match self {
+            LayoutResource::TextureArray { count, .. }
+            | LayoutResource::BufferArray { count, .. } => Some(*count),
+            _ => None,
+        }
+    }
+
+    /// Returns the device features the resource requires, binding arrays have to be supported
+    /// and indexable with values that differ between invocations (non-uniform indexing)
+    ///
+    /// Binding arrays also need [`wgpu::Limits::max_binding_array_elements_per_shader_stage`]
+    /// to be at least their count, which has to be requested with the device since it defaults to 0.
+    pub fn required_features(&self) -> wgpu::Features {
+        match self {
+            LayoutResource::TextureArray { .. } => {
+                wgpu::Features::TEXTURE_BINDING_ARRAY
+                    | wgpu::Features::SAMPLED_TEXTURE_AND_STORAGE_BUFFER_ARRAY_NON_UNIFORM_INDEXING
+            }
+            LayoutResource::BufferArray { .. } => {
+                wgpu::Features::BUFFER_BINDING_ARRAY
+                    | wgpu::Features::STORAGE_RESOURCE_BINDING_ARRAY
+                    | wgpu::Features::SAMPLED_TEXTURE_AND_STORAGE_BUFFER_ARRAY_NON_UNIFORM_INDEXING
+            }
+            _ => wgpu::Features::empty(),
         }
     }
 }
@@ -250,6 +408,21 @@ impl BufferConfig {
                 has_dynamic_offset: false,
                 min_binding_size: None,
             },
+            BufferConfig::ReadWriteStorage => wgpu::BindingType::Buffer {
+                ty: wgpu::BufferBindingType::Storage { read_only: false },
+                has_dynamic_offset: false,
+                min_binding_size: None,
+            },
+            BufferConfig::DynamicUniform => wgpu::BindingType::Buffer {
+                ty: wgpu::BufferBindingType::Uniform,
+                has_dynamic_offset: true,
+                min_binding_size: None,
+            },
+            BufferConfig::DynamicStorage => wgpu::BindingType::Buffer {
+                ty: wgpu::BufferBindingType::Storage { read_only: true },
+                has_dynamic_offset: true,
+                min_binding_size: None,
+            },
         }
     }
 }
@@ -278,6 +451,7 @@ impl TextureConfig {
         let sample_type = match self {
             TextureConfig::D1(kind) |
             TextureConfig::D2(kind) |
+            TextureConfig::D2Array(kind) |
             TextureConfig::D3(kind) |
             TextureConfig::Cubemap(kind) => match kind {
                 TextureKind::Image => wgpu::TextureSampleType::Float { filterable: true },
@@ -287,6 +461,7 @@ impl TextureConfig {
         let view_dimension = match self {
             TextureConfig::D1(_) => wgpu::TextureViewDimension::D1,
             TextureConfig::D2(_) => wgpu::TextureViewDimension::D2,
+            TextureConfig::D2Array(_) => wgpu::TextureViewDimension::D2Array,
             TextureConfig::D3(_) => wgpu::TextureViewDimension::D3,
             TextureConfig::Cubemap(_) => wgpu::TextureViewDimension::Cube,
         };
@@ -305,6 +480,8 @@ impl ResourceAccess {
             ResourceAccess::Vertex => wgpu::ShaderStages::VERTEX,
             ResourceAccess::Fragment => wgpu::ShaderStages::FRAGMENT,
             ResourceAccess::Either => wgpu::ShaderStages::VERTEX_FRAGMENT,
+            ResourceAccess::Compute => wgpu::ShaderStages::COMPUTE,
+            ResourceAccess::All => wgpu::ShaderStages::all(),
         }
     }
 }
@@ -347,6 +524,33 @@ impl<'a> BindGroupBuilder<'a> {
         self
     }
 
+    /// Adds a window of a buffer resource.
+    /// - `offset` -> the offset of the window in bytes
+    /// - `size` -> the size of the window in bytes
+    pub fn add_buffer_range(
+        mut self,
+        buffer: &'a dyn AnyBufferHandle,
+        offset: u64,
+        size: u64,
+    ) -> Self {
+        self.entries.push(BindGroupEntry {
+            binding: self.cursor,
+            resource: Resource::BufferRange {
+                buffer,
+                offset,
+                size,
+            },
+        });
+        self.cursor += 1;
+        self
+    }
+
+    /// Adds a [`UniformArena`] resource, which is a single item window of the arena
+    /// meant to be moved with a dynamic offset.
+    pub fn add_uniform_arena<T: Pod>(self, arena: &'a UniformArena<T>) -> Self {
+        self.add_buffer_range(arena.buffer(), 0, arena.binding_size())
+    }
+
     /// Adds a sampler resource.
     pub fn add_sampler(mut self, sampler: &'a Sampler) -> Self {
         self.entries.push(BindGroupEntry {
@@ -367,6 +571,28 @@ impl<'a> BindGroupBuilder<'a> {
         self
     }
 
+    /// Adds a binding array of textures.
+    /// - `views` -> the views of the textures, as many as the layout entry counts
+    pub fn add_texture_array(mut self, views: &'a [&'a wgpu::TextureView]) -> Self {
+        self.entries.push(BindGroupEntry {
+            binding: self.cursor,
+            resource: Resource::TextureArray(views),
+        });
+        self.cursor += 1;
+        self
+    }
+
+    /// Adds a binding array of storage buffers.
+    /// - `bindings` -> the bindings of the buffers, as many as the layout entry counts
+    pub fn add_buffer_array(mut self, bindings: &'a [wgpu::BufferBinding<'a>]) -> Self {
+        self.entries.push(BindGroupEntry {
+            binding: self.cursor,
+            resource: Resource::BufferArray(bindings),
+        });
+        self.cursor += 1;
+        self
+    }
+
     /// Builds a [`BindGroup`] and consumes this [`BindGroupBuilder`].
     /// - `layout` -> the matching [`BindGroupLayout`]
     /// - `device` -> the device needed to create the [`BindGroup`]
@@ -438,6 +664,42 @@ impl<'a> BindGroupLayoutBuilder<'a> {
         self
     }
 
+    /// Adds a read-write storage buffer layout resource.
+    /// - `access` -> the [`ResourceAccess`] specifying the shader accessibility of the resource
+    pub fn add_read_write_storage_buffer(mut self, access: ResourceAccess) -> Self {
+        self.entries.push(BindGroupLayoutEntry {
+            binding: self.cursor,
+            resource: LayoutResource::Buffer(BufferConfig::ReadWriteStorage),
+            access,
+        });
+        self.cursor += 1;
+        self
+    }
+
+    /// Adds a uniform buffer layout resource that is bound with a dynamic offset.
+    /// - `access` -> the [`ResourceAccess`] specifying the shader accessibility of the resource
+    pub fn add_dynamic_uniform_buffer(mut self, access: ResourceAccess) -> Self {
+        self.entries.push(BindGroupLayoutEntry {
+            binding: self.cursor,
+            resource: LayoutResource::Buffer(BufferConfig::DynamicUniform),
+            access,
+        });
+        self.cursor += 1;
+        self
+    }
+
+    /// Adds a storage buffer layout resource that is bound with a dynamic offset.
+    /// - `access` -> the [`ResourceAccess`] specifying the shader accessibility of the resource
+    pub fn add_dynamic_storage_buffer(mut self, access: ResourceAccess) -> Self {
+        self.entries.push(BindGroupLayoutEntry {
+            binding: self.cursor,
+            resource: LayoutResource::Buffer(BufferConfig::DynamicStorage),
+            access,
+        });
+        self.cursor += 1;
+        self
+    }
+
     /// Adds a nearest sampler layout resource.
     /// - `access` -> the [`ResourceAccess`] specifying the shader accessibility of the resource
     pub fn add_nearest_sampler(mut self, access: ResourceAccess) -> Self {
@@ -510,6 +772,18 @@ impl<'a> BindGroupLayoutBuilder<'a> {
         self
     }
 
+    /// Adds a 2D array texture layout resource.
+    /// - `access` -> the [`ResourceAccess`] specifying the shader accessibility of the resource
+    pub fn add_texture_2d_array(mut self, access: ResourceAccess) -> Self {
+        self.entries.push(BindGroupLayoutEntry {
+            binding: self.cursor,
+            resource: LayoutResource::Texture(TextureConfig::D2Array(TextureKind::Image)),
+            access,
+        });
+        self.cursor += 1;
+        self
+    }
+
     /// Adds a 3D texture layout resource.
     /// - `access` -> the [`ResourceAccess`] specifying the shader accessibility of the resource
     pub fn add_texture_3d(mut self, access: ResourceAccess) -> Self {
@@ -534,6 +808,45 @@ impl<'a> BindGroupLayoutBuilder<'a> {
         self
     }
 
+    /// Adds a binding array layout resource of 2D textures.
+    /// - `count` -> the amount of textures in the array
+    /// - `access` -> the [`ResourceAccess`] specifying the shader accessibility of the resource
+    pub fn add_texture_2d_binding_array(
+        mut self,
+        count: NonZeroU32,
+        access: ResourceAccess,
+    ) -> Self {
+        self.entries.push(BindGroupLayoutEntry {
+            binding: self.cursor,
+            resource: LayoutResource::TextureArray {
+                config: TextureConfig::D2(TextureKind::Image),
+                count,
+            },
+            access,
+        });
+        self.cursor += 1;
+        self
+    }
+
+    /// Adds a binding array layout resource of storage buffers.
+    /// - `is_writable` -> whether shaders can also write to the buffers
+    /// - `count` -> the amount of buffers in the array
+    /// - `access` -> the [`ResourceAccess`] specifying the shader accessibility of the resource
+    pub fn add_storage_buffer_binding_array(
+        mut self,
+        is_writable: bool,
+        count: NonZeroU32,
+        access: ResourceAccess,
+    ) -> Self {
+        self.entries.push(BindGroupLayoutEntry {
+            binding: self.cursor,
+            resource: LayoutResource::BufferArray { is_writable, count },
+            access,
+        });
+        self.cursor += 1;
+        self
+    }
+
     /// Builds a [`BindGroupLayout`] and consumes this [`BindGroupLayoutBuilder`].
     /// - `device` -> the device needed to create the [`BindGroupLayout`]
     ///
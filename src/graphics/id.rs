@@ -0,0 +1,22 @@
+use std::sync::atomic::{AtomicU64, Ordering};
+
+/// A unique identity of a GPU resource wrapper.
+///
+/// Identities are handed out once per created GPU resource and are never reused
+/// within a process, which makes them useful for caching and deduplication,
+/// for example when hashing pipeline state or when skipping redundant state changes.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash, PartialOrd, Ord)]
+pub struct ResourceId(u64);
+
+impl ResourceId {
+    /// Returns a new, unique [`ResourceId`].
+    pub fn next() -> Self {
+        static NEXT_ID: AtomicU64 = AtomicU64::new(1);
+        Self(NEXT_ID.fetch_add(1, Ordering::Relaxed))
+    }
+
+    /// Returns the raw value of the identity.
+    pub fn raw(self) -> u64 {
+        self.0
+    }
+}
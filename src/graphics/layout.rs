@@ -1,3 +1,5 @@
+use std::hash::{Hash, Hasher};
+
 /// Describes a wrapper around the internal [`wgpu::VertexBufferLayout`]
 #[derive(Debug, Clone)]
 pub struct BufferLayout {
@@ -54,6 +56,38 @@ impl BufferLayout {
     }
 }
 
+impl Hash for BufferLayout {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        self.raw.array_stride.hash(state);
+        self.raw.step_mode.hash(state);
+        for attribute in self.raw.attributes {
+            attribute.format.hash(state);
+            attribute.offset.hash(state);
+            attribute.shader_location.hash(state);
+        }
+    }
+}
+
+impl PartialEq for BufferLayout {
+    fn eq(&self, other: &Self) -> bool {
+        self.raw.array_stride == other.raw.array_stride
+            && self.raw.step_mode == other.raw.step_mode
+            && self.raw.attributes.len() == other.raw.attributes.len()
+            && self
+                .raw
+                .attributes
+                .iter()
+                .zip(other.raw.attributes)
+                .all(|(a, b)| {
+                    a.format == b.format
+                        && a.offset == b.offset
+                        && a.shader_location == b.shader_location
+                })
+    }
+}
+
+impl Eq for BufferLayout {}
+
 impl BufferLayoutDescriptor {
     /// Consumes self and builds a [`BufferLayout`]
     pub fn build(self) -> BufferLayout {
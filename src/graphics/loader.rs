@@ -0,0 +1,563 @@
+use std::{
+    borrow::Cow,
+    collections::HashMap,
+    path::{Path, PathBuf},
+    sync::{
+        Arc, Condvar, Mutex, OnceLock,
+        atomic::{AtomicBool, Ordering},
+        mpsc,
+    },
+    thread,
+    time::{Duration, Instant},
+};
+
+use image::ImageReader;
+
+use crate::graphics::{
+    container::{self, ContainerImage},
+    mipmap::MipmapGenerator,
+    texture::{
+        MipPolicy, Texture, TextureDescriptor, TextureDimension, TextureError, TextureFormat,
+        TextureSource, TextureUsage,
+    },
+};
+
+/// The default amount of decoded bytes that may wait for an upload at once (256 MiB).
+pub const DEFAULT_STAGING_BUDGET: u64 = 256 << 20;
+
+/// Loads textures from files on a pool of background decode workers.
+///
+/// Opening and decoding an image is by far the slowest part of creating a texture,
+/// so the loader moves it onto worker threads and only does the GPU upload on the thread
+/// that calls [`TextureLoader::poll()`], which streams finished images to the queue.
+///
+/// Decoded images wait in CPU memory until they're uploaded, the total amount of
+/// waiting bytes is bounded by a staging budget, workers pause decoding once it's exhausted.
+/// Every worker reserves the decoded size of an image (read from the image header,
+/// or the file size for containers) before decoding it, and corrects the reservation
+/// to the actual size afterwards.
+///
+/// Every [`TextureLoader::load()`] returns a [`TextureTicket`] that resolves once
+/// the texture has been uploaded:
+///
+/// ```rust
+/// let mut loader = TextureLoader::new(4, DEFAULT_STAGING_BUDGET);
+/// let grass = loader.load("assets/grass.png", usage, MipPolicy::GenerateOnGpu);
+/// // Every frame
+/// loader.poll(&device, &queue);
+/// let texture = grass.get_or(&placeholder);
+/// ```
+///
+/// Files with a `ktx2` or `dds` extension are parsed as containers and uploaded as-is,
+/// every other file is decoded through the `image` crate.
+#[derive(Debug)]
+pub struct TextureLoader {
+    /// Sends load jobs to the workers, dropped on shutdown
+    jobs: Option<mpsc::Sender<LoadJob>>,
+    /// Receives decoded images from the workers
+    results: mpsc::Receiver<DecodeResult>,
+    /// The worker threads
+    workers: Vec<thread::JoinHandle<()>>,
+    /// The staging memory shared with the workers
+    budget: Arc<StagingBudget>,
+    /// The requests that haven't been uploaded yet, keyed by their id
+    pending: HashMap<u64, PendingTexture>,
+    /// The id of the next request
+    next_id: u64,
+    /// The progress of all requests
+    progress: LoadProgress,
+    /// The timings of every finished request
+    timings: Vec<LoadTiming>,
+    /// The mip chain generator shared by every upload, created once a texture needs it
+    mipmaps: Option<MipmapGenerator>,
+}
+
+/// A handle to a texture that is being loaded by a [`TextureLoader`].
+///
+/// The handle is cheap to clone, all clones refer to the same texture.
+#[derive(Debug, Clone)]
+pub struct TextureTicket {
+    /// The slot the loader stores the finished texture in
+    slot: Arc<OnceLock<LoadState>>,
+}
+
+/// Describes the progress of a [`TextureLoader`]
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct LoadProgress {
+    /// How many textures were requested
+    pub requested: usize,
+    /// How many textures were uploaded
+    pub uploaded: usize,
+    /// How many textures failed to load
+    pub failed: usize,
+}
+
+/// Describes how long loading a single texture took
+#[derive(Debug, Clone)]
+pub struct LoadTiming {
+    /// The file the texture was loaded from
+    pub path: PathBuf,
+    /// The time spent opening and decoding the file on a worker
+    pub decode: Duration,
+    /// The time spent creating and uploading the texture
+    pub upload: Duration,
+    /// The amount of decoded bytes that were uploaded
+    pub bytes: u64,
+}
+
+/// The final state of a texture load
+#[derive(Debug)]
+enum LoadState {
+    /// The texture was uploaded
+    Ready(Texture),
+    /// The texture failed to load, holding the reason
+    Failed(String),
+}
+
+/// A request that is waiting for its decoded image
+#[derive(Debug)]
+struct PendingTexture {
+    path: PathBuf,
+    usage: TextureUsage,
+    mipmaps: MipPolicy,
+    slot: Arc<OnceLock<LoadState>>,
+}
+
+/// A request sent to the workers
+#[derive(Debug)]
+struct LoadJob {
+    id: u64,
+    path: PathBuf,
+}
+
+/// An image decoded by a worker
+#[derive(Debug)]
+enum DecodedImage {
+    /// RGBA8 pixels decoded through the `image` crate
+    Pixels {
+        width: u32,
+        height: u32,
+        bytes: Vec<u8>,
+    },
+    /// A parsed container with its mip chain
+    Container(ContainerImage),
+}
+
+/// The result of a single decode, sent back by a worker
+#[derive(Debug)]
+struct DecodeResult {
+    id: u64,
+    image: Result<DecodedImage, String>,
+    decode: Duration,
+    bytes: u64,
+}
+
+/// Bounds the amount of decoded bytes waiting for an upload
+#[derive(Debug)]
+struct StagingBudget {
+    limit: u64,
+    used: Mutex<u64>,
+    released: Condvar,
+    closed: AtomicBool,
+}
+
+impl TextureLoader {
+    /// Creates a new [`TextureLoader`] and spawns its workers.
+    /// - `worker_count` -> the amount of decode worker threads
+    /// - `staging_budget` -> the maximum amount of decoded bytes waiting for an upload,
+    ///   a single image larger than the budget is still loaded, but on its own
+    ///
+    /// # Panics:
+    /// - If `worker_count` is equal to zero.
+    pub fn new(worker_count: usize, staging_budget: u64) -> Self {
+        assert!(worker_count > 0, "Worker count cannot be zero!");
+        let (job_sender, job_receiver) = mpsc::channel::<LoadJob>();
+        let (result_sender, result_receiver) = mpsc::channel();
+        let job_receiver = Arc::new(Mutex::new(job_receiver));
+        let budget = Arc::new(StagingBudget {
+            limit: staging_budget,
+            used: Mutex::new(0),
+            released: Condvar::new(),
+            closed: AtomicBool::new(false),
+        });
+
+        let workers = (0..worker_count)
+            .map(|_| {
+                let jobs = Arc::clone(&job_receiver);
+                let results = result_sender.clone();
+                let budget = Arc::clone(&budget);
+                thread::spawn(move || {
+                    loop {
+                        // The lock is only held while receiving, so decodes run concurrently
+                        let job = jobs.lock().expect("Poisoned job queue").recv();
+                        let Ok(job) = job else {
+                            break;
+                        };
+                        // Jobs still queued when the loader is dropped are skipped
+                        if budget.is_closed() {
+                            break;
+                        }
+                        let reserved = decoded_size_hint(&job.path);
+                        budget.acquire(reserved);
+                        let start = Instant::now();
+                        let image = decode(&job.path);
+                        let bytes = image.as_ref().map_or(0, DecodedImage::byte_size);
+                        let decode = start.elapsed();
+                        budget.adjust(reserved, bytes);
+                        let result = DecodeResult {
+                            id: job.id,
+                            image,
+                            decode,
+                            bytes,
+                        };
+                        if results.send(result).is_err() {
+                            break;
+                        }
+                    }
+                })
+            })
+            .collect();
+
+        Self {
+            jobs: Some(job_sender),
+            results: result_receiver,
+            workers,
+            budget,
+            pending: HashMap::new(),
+            next_id: 0,
+            progress: LoadProgress::default(),
+            timings: Vec::new(),
+            mipmaps: None,
+        }
+    }
+
+    /// Queues a texture to be loaded from `path` and returns its [`TextureTicket`].
+    /// - `path` -> the file to load the texture from
+    /// - `usage` -> the usage of the texture
+    /// - `mipmaps` -> the mip chain policy of the texture, ignored for containers
+    ///   since they carry their own mip chain
+    pub fn load(
+        &mut self,
+        path: impl Into<PathBuf>,
+        usage: TextureUsage,
+        mipmaps: MipPolicy,
+    ) -> TextureTicket {
+        let path = path.into();
+        let id = self.next_id;
+        self.next_id += 1;
+        let ticket = TextureTicket {
+            slot: Arc::new(OnceLock::new()),
+        };
+        self.pending.insert(
+            id,
+            PendingTexture {
+                path: path.clone(),
+                usage,
+                mipmaps,
+                slot: Arc::clone(&ticket.slot),
+            },
+        );
+        self.progress.requested += 1;
+        // Unwrap is safe here, the sender only goes away on drop
+        let _ = self.jobs.as_ref().unwrap().send(LoadJob { id, path });
+        ticket
+    }
+
+    /// Uploads every image that finished decoding since the last poll.
+    /// - `device` -> the [`wgpu::Device`] needed to create the textures
+    /// - `queue` -> the [`wgpu::Queue`] the textures are uploaded with
+    ///
+    /// Returns the amount of textures that were resolved (uploaded or failed).
+    pub fn poll(&mut self, device: &wgpu::Device, queue: &wgpu::Queue) -> usize {
+        let mut resolved = 0;
+        while let Ok(result) = self.results.try_recv() {
+            let Some(pending) = self.pending.remove(&result.id) else {
+                self.budget.release(result.bytes);
+                continue;
+            };
+
+            let start = Instant::now();
+            let label = pending.path.to_string_lossy();
+            let texture = result.image.and_then(|image| {
+                Self::upload(device, queue, &mut self.mipmaps, &label, &pending, image)
+                    .map_err(|error| error.to_string())
+            });
+            let upload = start.elapsed();
+            self.budget.release(result.bytes);
+
+            let state = match texture {
+                Ok(texture) => {
+                    self.progress.uploaded += 1;
+                    LoadState::Ready(texture)
+                }
+                Err(cause) => {
+                    self.progress.failed += 1;
+                    LoadState::Failed(cause)
+                }
+            };
+            let _ = pending.slot.set(state);
+            self.timings.push(LoadTiming {
+                path: pending.path,
+                decode: result.decode,
+                upload,
+                bytes: result.bytes,
+            });
+            resolved += 1;
+        }
+        resolved
+    }
+
+    /// Returns the progress of all requests
+    pub fn progress(&self) -> LoadProgress {
+        self.progress
+    }
+
+    /// Returns the timings of every finished request, in the order they finished
+    pub fn timings(&self) -> &[LoadTiming] {
+        &self.timings
+    }
+
+    /// Returns `true` if every requested texture has been resolved
+    pub fn is_idle(&self) -> bool {
+        self.pending.is_empty()
+    }
+
+    /// Returns the amount of decoded bytes currently waiting for an upload
+    pub fn staged_bytes(&self) -> u64 {
+        *self.budget.used.lock().expect("Poisoned staging budget")
+    }
+
+    /// Creates and uploads the texture of a decoded image
+    fn upload(
+        device: &wgpu::Device,
+        queue: &wgpu::Queue,
+        mipmaps: &mut Option<MipmapGenerator>,
+        label: &str,
+        pending: &PendingTexture,
+        image: DecodedImage,
+    ) -> Result<Texture, TextureError> {
+        match image {
+            DecodedImage::Pixels {
+                width,
+                height,
+                bytes,
+            } => TextureDescriptor {
+                label: Some(label),
+                dimension: TextureDimension::D2,
+                usage: pending.usage,
+                source: TextureSource::Bytes {
+                    width,
+                    height,
+                    format: TextureFormat::Standard,
+                    bytes: Cow::Owned(bytes),
+                },
+                mipmaps: pending.mipmaps.clone(),
+            }
+            .build_with(device, queue, mipmaps),
+            DecodedImage::Container(image) => TextureDescriptor {
+                label: Some(label),
+                dimension: TextureDimension::D2,
+                usage: pending.usage,
+                source: TextureSource::Container {
+                    path: pending.path.clone(),
+                },
+                mipmaps: MipPolicy::None,
+            }
+            .build_from_container(device, queue, image),
+        }
+    }
+}
+
+impl Drop for TextureLoader {
+    fn drop(&mut self) {
+        // Closing the job channel and the budget lets every worker finish
+        self.jobs = None;
+        self.budget.close();
+        for worker in self.workers.drain(..) {
+            let _ = worker.join();
+        }
+    }
+}
+
+impl TextureTicket {
+    /// Returns the texture if it has been uploaded
+    pub fn get(&self) -> Option<&Texture> {
+        match self.slot.get() {
+            Some(LoadState::Ready(texture)) => Some(texture),
+            _ => None,
+        }
+    }
+
+    /// Returns the texture if it has been uploaded, `placeholder` otherwise
+    /// (also when loading failed)
+    pub fn get_or<'a>(&'a self, placeholder: &'a Texture) -> &'a Texture {
+        self.get().unwrap_or(placeholder)
+    }
+
+    /// Returns `true` if the texture has been uploaded
+    pub fn is_ready(&self) -> bool {
+        self.get().is_some()
+    }
+
+    /// Returns the reason the texture failed to load, if it did
+    pub fn error(&self) -> Option<&str> {
+        match self.slot.get() {
+            Some(LoadState::Failed(cause)) => Some(cause),
+            _ => None,
+        }
+    }
+}
+
+impl DecodedImage {
+    /// Returns the amount of decoded bytes of the image
+    fn byte_size(&self) -> u64 {
+        match self {
+            DecodedImage::Pixels { bytes, .. } => bytes.len() as u64,
+            DecodedImage::Container(image) => {
+                image.levels.iter().map(|level| level.len() as u64).sum()
+            }
+        }
+    }
+}
+
+impl StagingBudget {
+    /// Reserves `bytes` of the budget, blocking until enough of it is released,
+    /// a request is always granted when nothing else is staged
+    fn acquire(&self, bytes: u64) {
+        let mut used = self.used.lock().expect("Poisoned staging budget");
+        while *used != 0 && *used + bytes > self.limit && !self.is_closed() {
+            used = self.released.wait(used).expect("Poisoned staging budget");
+        }
+        *used += bytes;
+    }
+
+    /// Corrects a reservation of `reserved` bytes to the `actual` amount of bytes,
+    /// without blocking since the bytes are already decoded
+    fn adjust(&self, reserved: u64, actual: u64) {
+        if actual > reserved {
+            *self.used.lock().expect("Poisoned staging budget") += actual - reserved;
+        } else if actual < reserved {
+            self.release(reserved - actual);
+        }
+    }
+
+    /// Releases `bytes` of the budget and wakes up waiting workers
+    fn release(&self, bytes: u64) {
+        let mut used = self.used.lock().expect("Poisoned staging budget");
+        *used = used.saturating_sub(bytes);
+        self.released.notify_all();
+    }
+
+    /// Closes the budget so no worker stays blocked or starts another decode
+    fn close(&self) {
+        let _used = self.used.lock().expect("Poisoned staging budget");
+        self.closed.store(true, Ordering::Release);
+        self.released.notify_all();
+    }
+
+    /// Returns `true` if the loader is shutting down
+    fn is_closed(&self) -> bool {
+        self.closed.load(Ordering::Acquire)
+    }
+}
+
+/// Returns `true` if the file at `path` is a texture container (ktx2, dds)
+fn is_container(path: &Path) -> bool {
+    path.extension()
+        .and_then(|extension| extension.to_str())
+        .is_some_and(|extension| {
+            extension.eq_ignore_ascii_case("ktx2") || extension.eq_ignore_ascii_case("dds")
+        })
+}
+
+/// Returns the amount of bytes the file at `path` is expected to decode into,
+/// which only reads the image header, or the file size for containers,
+/// zero if the file can't be read (the decode reports the error)
+fn decoded_size_hint(path: &Path) -> u64 {
+    if is_container(path) {
+        return std::fs::metadata(path).map_or(0, |metadata| metadata.len());
+    }
+
+    ImageReader::open(path)
+        .ok()
+        .and_then(|reader| reader.into_dimensions().ok())
+        .map_or(0, |(width, height)| width as u64 * height as u64 * 4)
+}
+
+/// Opens and decodes the file at `path`
+fn decode(path: &Path) -> Result<DecodedImage, String> {
+    if is_container(path) {
+        let bytes = std::fs::read(path)
+            .map_err(|cause| format!("Couldn't open texture from file {:?}:\n\t{}", path, cause))?;
+        return container::parse(&bytes)
+            .map(DecodedImage::Container)
+            .map_err(|cause| {
+                format!("Couldn't decode texture from file {:?}:\n\t{}", path, cause)
+            });
+    }
+
+    let image = ImageReader::open(path)
+        .map_err(|cause| format!("Couldn't open texture from file {:?}:\n\t{}", path, cause))?
+        .decode()
+        .map_err(|cause| format!("Couldn't decode texture from file {:?}:\n\t{}", path, cause))?
+        .into_rgba8();
+    Ok(DecodedImage::Pixels {
+        width: image.width(),
+        height: image.height(),
+        bytes: image.into_raw(),
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn budget_blocks_until_released() {
+        let budget = Arc::new(StagingBudget {
+            limit: 100,
+            used: Mutex::new(0),
+            released: Condvar::new(),
+            closed: AtomicBool::new(false),
+        });
+        budget.acquire(80);
+
+        let worker = {
+            let budget = Arc::clone(&budget);
+            thread::spawn(move || budget.acquire(50))
+        };
+        thread::sleep(Duration::from_millis(20));
+        assert_eq!(*budget.used.lock().unwrap(), 80);
+
+        budget.release(80);
+        worker.join().unwrap();
+        assert_eq!(*budget.used.lock().unwrap(), 50);
+    }
+
+    #[test]
+    fn budget_adjusts_reservations() {
+        let budget = StagingBudget {
+            limit: 100,
+            used: Mutex::new(0),
+            released: Condvar::new(),
+            closed: AtomicBool::new(false),
+        };
+        budget.acquire(60);
+        budget.adjust(60, 40);
+        assert_eq!(*budget.used.lock().unwrap(), 40);
+        budget.adjust(40, 70);
+        assert_eq!(*budget.used.lock().unwrap(), 70);
+    }
+
+    #[test]
+    fn budget_grants_oversized_when_empty() {
+        let budget = StagingBudget {
+            limit: 10,
+            used: Mutex::new(0),
+            released: Condvar::new(),
+            closed: AtomicBool::new(false),
+        };
+        budget.acquire(1000);
+        assert_eq!(*budget.used.lock().unwrap(), 1000);
+    }
+}
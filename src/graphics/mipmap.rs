@@ -0,0 +1,262 @@
+use std::collections::HashMap;
+
+use crate::graphics::texture::Texture;
+
+/// The blit shader used to downsample one mip level into the next.
+///
+/// A single fullscreen triangle samples the previous level with a linear filter,
+/// which averages each 2x2 block of texels.
+const BLIT_SHADER: &str = r#"
+struct VertexOutput {
+    @builtin(position) position: vec4<f32>,
+    @location(0) uv: vec2<f32>,
+};
+
+@vertex
+fn vs_main(@builtin(vertex_index) index: u32) -> VertexOutput {
+    let uv = vec2<f32>(f32((index << 1u) & 2u), f32(index & 2u));
+    var out: VertexOutput;
+    out.position = vec4<f32>(uv * vec2<f32>(2.0, -2.0) + vec2<f32>(-1.0, 1.0), 0.0, 1.0);
+    out.uv = uv;
+    return out;
+}
+
+@group(0) @binding(0) var source: texture_2d<f32>;
+@group(0) @binding(1) var source_sampler: sampler;
+
+@fragment
+fn fs_main(in: VertexOutput) -> @location(0) vec4<f32> {
+    return textureSample(source, source_sampler, in.uv);
+}
+"#;
+
+/// Generates the mip chain of a texture on the GPU.
+///
+/// Every level is rendered from the previous one with a linear blit, so the texture
+/// must be a 2D texture with a renderable, filterable format and a render attachment usage,
+/// which [`crate::graphics::texture::MipPolicy::GenerateOnGpu`] takes care of.
+///
+/// The generator caches one pipeline per texture format, so it's worth keeping it around
+/// when many textures are created.
+#[derive(Debug)]
+pub struct MipmapGenerator {
+    /// The blit shader module
+    shader: wgpu::ShaderModule,
+    /// The layout of the source level bind group
+    bind_group_layout: wgpu::BindGroupLayout,
+    /// The pipeline layout shared by every blit pipeline
+    pipeline_layout: wgpu::PipelineLayout,
+    /// The linear sampler used to read the source level
+    sampler: wgpu::Sampler,
+    /// The blit pipelines, one per target format
+    pipelines: HashMap<wgpu::TextureFormat, wgpu::RenderPipeline>,
+}
+
+impl MipmapGenerator {
+    /// Creates a new [`MipmapGenerator`]
+    /// - `device` -> the [`wgpu::Device`] needed to create GPU resources
+    pub fn new(device: &wgpu::Device) -> Self {
+        let shader = device.create_shader_module(wgpu::ShaderModuleDescriptor {
+            label: Some("Mipmap blit shader"),
+            source: wgpu::ShaderSource::Wgsl(BLIT_SHADER.into()),
+        });
+        let bind_group_layout = device.create_bind_group_layout(&wgpu::BindGroupLayoutDescriptor {
+            label: Some("Mipmap blit bind group layout"),
+            entries: &[
+                wgpu::BindGroupLayoutEntry {
+                    binding: 0,
+                    visibility: wgpu::ShaderStages::FRAGMENT,
+                    ty: wgpu::BindingType::Texture {
+                        sample_type: wgpu::TextureSampleType::Float { filterable: true },
+                        view_dimension: wgpu::TextureViewDimension::D2,
+                        multisampled: false,
+                    },
+                    count: None,
+                },
+                wgpu::BindGroupLayoutEntry {
+                    binding: 1,
+                    visibility: wgpu::ShaderStages::FRAGMENT,
+                    ty: wgpu::BindingType::Sampler(wgpu::SamplerBindingType::Filtering),
+                    count: None,
+                },
+            ],
+        });
+        let pipeline_layout = device.create_pipeline_layout(&wgpu::PipelineLayoutDescriptor {
+            label: Some("Mipmap blit pipeline layout"),
+            bind_group_layouts: &[&bind_group_layout],
+            push_constant_ranges: &[],
+        });
+        let sampler = device.create_sampler(&wgpu::SamplerDescriptor {
+            label: Some("Mipmap blit sampler"),
+            mag_filter: wgpu::FilterMode::Linear,
+            min_filter: wgpu::FilterMode::Linear,
+            ..Default::default()
+        });
+        Self {
+            shader,
+            bind_group_layout,
+            pipeline_layout,
+            sampler,
+            pipelines: HashMap::new(),
+        }
+    }
+
+    /// Generates every mip level of `texture` past the first one, from the first one.
+    /// - `device` -> the [`wgpu::Device`] needed to create GPU resources
+    /// - `queue` -> the [`wgpu::Queue`] the blits are submitted to
+    /// - `texture` -> the texture whose mip chain gets generated
+    ///
+    /// # Panics:
+    /// - If the texture is not a 2D texture with a render attachment usage.
+    pub fn generate(&mut self, device: &wgpu::Device, queue: &wgpu::Queue, texture: &Texture) {
+        let raw = texture.raw();
+        assert!(
+            raw.dimension() == wgpu::TextureDimension::D2,
+            "Mipmaps can only be generated for 2D textures!"
+        );
+        assert!(
+            raw.usage().contains(wgpu::TextureUsages::RENDER_ATTACHMENT),
+            "Mipmaps can only be generated for textures with a render attachment usage!"
+        );
+        if raw.mip_level_count() <= 1 {
+            return;
+        }
+
+        let mut encoder = device.create_command_encoder(&wgpu::CommandEncoderDescriptor {
+            label: Some("Mipmap encoder"),
+        });
+        self.record(device, &mut encoder, texture);
+        queue.submit([encoder.finish()]);
+    }
+
+    /// Records the mip chain generation of `texture` into `encoder`,
+    /// see [`MipmapGenerator::generate()`].
+    pub fn record(
+        &mut self,
+        device: &wgpu::Device,
+        encoder: &mut wgpu::CommandEncoder,
+        texture: &Texture,
+    ) {
+        let raw = texture.raw();
+        let format = raw.format();
+        let pipeline = self.pipeline(device, format).clone();
+        for layer in 0..raw.depth_or_array_layers() {
+            for level in 1..raw.mip_level_count() {
+                let source = Self::level_view(raw, level - 1, layer);
+                let target = Self::level_view(raw, level, layer);
+                let bind_group = device.create_bind_group(&wgpu::BindGroupDescriptor {
+                    label: Some("Mipmap blit bind group"),
+                    layout: &self.bind_group_layout,
+                    entries: &[
+                        wgpu::BindGroupEntry {
+                            binding: 0,
+                            resource: wgpu::BindingResource::TextureView(&source),
+                        },
+                        wgpu::BindGroupEntry {
+                            binding: 1,
+                            resource: wgpu::BindingResource::Sampler(&self.sampler),
+                        },
+                    ],
+                });
+
+                let mut pass = encoder.begin_render_pass(&wgpu::RenderPassDescriptor {
+                    label: Some("Mipmap blit pass"),
+                    color_attachments: &[Some(wgpu::RenderPassColorAttachment {
+                        view: &target,
+                        ops: wgpu::Operations {
+                            load: wgpu::LoadOp::Clear(wgpu::Color::TRANSPARENT),
+                            store: wgpu::StoreOp::Store,
+                        },
+                        depth_slice: None,
+                        resolve_target: None,
+                    })],
+                    depth_stencil_attachment: None,
+                    timestamp_writes: None,
+                    occlusion_query_set: None,
+                });
+                pass.set_pipeline(&pipeline);
+                pass.set_bind_group(0, &bind_group, &[]);
+                pass.draw(0..3, 0..1);
+            }
+        }
+    }
+
+    /// Returns the blit pipeline for `format`, creating it if needed
+    fn pipeline(
+        &mut self,
+        device: &wgpu::Device,
+        format: wgpu::TextureFormat,
+    ) -> &wgpu::RenderPipeline {
+        self.pipelines.entry(format).or_insert_with(|| {
+            device.create_render_pipeline(&wgpu::RenderPipelineDescriptor {
+                label: Some("Mipmap blit pipeline"),
+                layout: Some(&self.pipeline_layout),
+                vertex: wgpu::VertexState {
+                    module: &self.shader,
+                    entry_point: Some("vs_main"),
+                    compilation_options: wgpu::PipelineCompilationOptions::default(),
+                    buffers: &[],
+                },
+                fragment: Some(wgpu::FragmentState {
+                    module: &self.shader,
+                    entry_point: Some("fs_main"),
+                    compilation_options: wgpu::PipelineCompilationOptions::default(),
+                    targets: &[Some(wgpu::ColorTargetState {
+                        format,
+                        blend: None,
+                        write_mask: wgpu::ColorWrites::ALL,
+                    })],
+                }),
+                primitive: wgpu::PrimitiveState::default(),
+                depth_stencil: None,
+                multisample: wgpu::MultisampleState::default(),
+                multiview: None,
+                cache: None,
+            })
+        })
+    }
+
+    /// Creates a view of a single mip level of a single layer
+    fn level_view(texture: &wgpu::Texture, level: u32, layer: u32) -> wgpu::TextureView {
+        texture.create_view(&wgpu::TextureViewDescriptor {
+            label: Some("Mipmap level view"),
+            dimension: Some(wgpu::TextureViewDimension::D2),
+            base_mip_level: level,
+            mip_level_count: Some(1),
+            base_array_layer: layer,
+            array_layer_count: Some(1),
+            ..Default::default()
+        })
+    }
+}
+
+/// Returns the amount of mip levels in a full mip chain of a texture of `width` x `height`
+pub fn full_mip_level_count(width: u32, height: u32) -> u32 {
+    32 - width.max(height).max(1).leading_zeros()
+}
+
+/// Returns the size of a mip level, which is halved for every level but never reaches zero
+pub fn mip_level_size(size: u32, level: u32) -> u32 {
+    (size >> level).max(1)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn full_chain() {
+        assert_eq!(full_mip_level_count(1, 1), 1);
+        assert_eq!(full_mip_level_count(256, 256), 9);
+        assert_eq!(full_mip_level_count(300, 20), 9);
+        assert_eq!(full_mip_level_count(1024, 4096), 13);
+    }
+
+    #[test]
+    fn level_size() {
+        assert_eq!(mip_level_size(256, 0), 256);
+        assert_eq!(mip_level_size(256, 3), 32);
+        assert_eq!(mip_level_size(300, 9), 1);
+        assert_eq!(mip_level_size(5, 1), 2);
+    }
+}
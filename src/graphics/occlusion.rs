@@ -0,0 +1,514 @@
+use std::ops::Range;
+
+use crate::graphics::{
+    mipmap::{full_mip_level_count, mip_level_size},
+    readback::{MapState, MapStatus},
+    texture::Texture,
+};
+
+/// The size of the workgroups of the Hi-Z shaders in both dimensions
+const HIZ_WORKGROUP_SIZE: u32 = 8;
+
+/// The shader that copies the depth buffer into the first level of a Hi-Z pyramid.
+const HIZ_COPY_SHADER: &str = r#"
+@group(0) @binding(0) var source: texture_depth_2d;
+@group(0) @binding(1) var target: texture_storage_2d<r32float, write>;
+
+@compute @workgroup_size(8, 8)
+fn cs_main(@builtin(global_invocation_id) id: vec3<u32>) {
+    let size = textureDimensions(target);
+    if (id.x >= size.x || id.y >= size.y) {
+        return;
+    }
+    let depth = textureLoad(source, id.xy, 0);
+    textureStore(target, id.xy, vec4<f32>(depth, 0.0, 0.0, 0.0));
+}
+"#;
+
+/// The shader that reduces one level of a Hi-Z pyramid into the next.
+///
+/// Every texel keeps the furthest depth of the 2x2 block below it, a source level with an
+/// odd size folds its last row or column into the last texel, so no depth is ever skipped.
+const HIZ_DOWNSAMPLE_SHADER: &str = r#"
+@group(0) @binding(0) var source: texture_2d<f32>;
+@group(0) @binding(1) var target: texture_storage_2d<r32float, write>;
+
+@compute @workgroup_size(8, 8)
+fn cs_main(@builtin(global_invocation_id) id: vec3<u32>) {
+    let size = textureDimensions(target);
+    if (id.x >= size.x || id.y >= size.y) {
+        return;
+    }
+    let source_size = textureDimensions(source);
+    let last = id.xy == size - vec2<u32>(1u);
+    let odd = (source_size & vec2<u32>(1u)) == vec2<u32>(1u);
+    let extent = vec2<u32>(2u) + select(vec2<u32>(0u), vec2<u32>(1u), last & odd);
+
+    var depth = 0.0;
+    for (var y = 0u; y < extent.y; y++) {
+        for (var x = 0u; x < extent.x; x++) {
+            let coord = min(id.xy * 2u + vec2<u32>(x, y), source_size - vec2<u32>(1u));
+            depth = max(depth, textureLoad(source, coord, 0).r);
+        }
+    }
+    textureStore(target, id.xy, vec4<f32>(depth, 0.0, 0.0, 0.0));
+}
+"#;
+
+/// Describes a wrapper around an occlusion [`wgpu::QuerySet`], with the buffers
+/// its results are read back through
+///
+/// Each query counts the samples that passed the depth and stencil tests between
+/// [`crate::graphics::pass::RenderPass::begin_occlusion_query()`] and
+/// [`crate::graphics::pass::RenderPass::end_occlusion_query()`], usually while drawing
+/// the bounding box of an object, the object is hidden if no samples passed.
+///
+/// The results are read back asynchronously, so they describe a frame from the past:
+///
+/// ```rust
+/// let mut queries = OcclusionQuerySet::new(&device, 1024, Some("Occlusion queries"));
+/// // Every frame
+/// let mut pass = RenderPassDescriptor {
+///     occlusion_query_set: Some(&queries),
+///     ...
+/// }
+/// .build(&mut encoder);
+/// for (index, object) in objects.iter().enumerate() {
+///     pass.begin_occlusion_query(index as u32);
+///     object.draw_bounds(&mut pass);
+///     pass.end_occlusion_query();
+/// }
+/// drop(pass);
+/// queries.resolve(&mut encoder, 0..objects.len() as u32);
+/// queue.submit([encoder.finish()]);
+/// queries.map();
+/// // Later on, once the readback completed
+/// queries.collect();
+/// let visible = queries.is_visible(index);
+/// ```
+#[derive(Debug)]
+pub struct OcclusionQuerySet {
+    raw: wgpu::QuerySet,
+    count: u32,
+    /// The buffer the queries are resolved into
+    resolve: wgpu::Buffer,
+    /// The buffer the resolved queries are copied into and mapped
+    readback: wgpu::Buffer,
+    /// The queries whose results are being read back, if any
+    in_flight: Option<Range<u32>>,
+    /// Whether the readback buffer is being mapped
+    mapping: bool,
+    /// The state of the mapping of the readback buffer
+    mapped: MapState,
+    /// The passed sample counts of the most recent readback, indexed by query
+    results: Vec<u64>,
+}
+
+/// Describes a hierarchical-Z (Hi-Z) pyramid, a mip chain of a depth buffer where every texel
+/// holds the furthest depth of the texels below it
+///
+/// A compute culling pass samples the level whose texels cover the screen-space bounds
+/// of an object, if the nearest depth of the object is further than the depth in the pyramid,
+/// the object is hidden behind what was already drawn.
+///
+/// The pyramid is built by a [`HiZGenerator`] from the depth texture it was created for,
+/// it is tied to the size of that texture and has to be recreated when it's resized.
+#[derive(Debug)]
+pub struct HiZPyramid {
+    /// The R32Float texture holding every level
+    texture: wgpu::Texture,
+    /// The view of every level, for sampling in a culling pass
+    view: wgpu::TextureView,
+    /// The bind groups of every level, the first one copies the depth buffer
+    bind_groups: Vec<wgpu::BindGroup>,
+    /// The size of the first level
+    size: (u32, u32),
+}
+
+/// Builds [`HiZPyramid`]s from depth textures on the GPU with compute passes
+#[derive(Debug)]
+pub struct HiZGenerator {
+    copy_layout: wgpu::BindGroupLayout,
+    downsample_layout: wgpu::BindGroupLayout,
+    copy_pipeline: wgpu::ComputePipeline,
+    downsample_pipeline: wgpu::ComputePipeline,
+}
+
+impl OcclusionQuerySet {
+    /// Creates a new occlusion query set
+    /// - `device` -> the [`wgpu::Device`] needed to create GPU resources
+    /// - `count` -> the amount of queries in the set
+    /// - `label` -> the optional debugging label of the query set and its buffers
+    ///
+    /// # Panics:
+    /// - If `count` is equal to zero.
+    pub fn new(device: &wgpu::Device, count: u32, label: Option<&str>) -> Self {
+        assert!(count > 0, "Occlusion query count cannot be zero!");
+        let size = count as u64 * wgpu::QUERY_SIZE as u64;
+        Self {
+            raw: device.create_query_set(&wgpu::QuerySetDescriptor {
+                label,
+                ty: wgpu::QueryType::Occlusion,
+                count,
+            }),
+            count,
+            resolve: device.create_buffer(&wgpu::BufferDescriptor {
+                label,
+                size,
+                usage: wgpu::BufferUsages::QUERY_RESOLVE | wgpu::BufferUsages::COPY_SRC,
+                mapped_at_creation: false,
+            }),
+            readback: device.create_buffer(&wgpu::BufferDescriptor {
+                label,
+                size,
+                usage: wgpu::BufferUsages::MAP_READ | wgpu::BufferUsages::COPY_DST,
+                mapped_at_creation: false,
+            }),
+            in_flight: None,
+            mapping: false,
+            mapped: MapState::new(),
+            results: Vec::new(),
+        }
+    }
+
+    /// Returns the raw [`wgpu::QuerySet`]
+    pub fn raw(&self) -> &wgpu::QuerySet {
+        &self.raw
+    }
+
+    /// Returns the amount of queries in the set
+    pub fn count(&self) -> u32 {
+        self.count
+    }
+
+    /// Records the commands that resolve a range of queries into the readback buffer
+    ///
+    /// Returns `false` if a previous readback is still in flight, in which case
+    /// nothing is recorded and the results of this frame are skipped.
+    ///
+    /// # Panics:
+    /// - If the range is empty or exceeds the query count.
+    pub fn resolve(&mut self, encoder: &mut wgpu::CommandEncoder, queries: Range<u32>) -> bool {
+        assert!(
+            queries.start < queries.end && queries.end <= self.count,
+            "Cannot resolve occlusion queries out of bounds!"
+        );
+        if self.in_flight.is_some() {
+            return false;
+        }
+        // Resolves have to start at an aligned offset, so every range starts at the beginning
+        let size = queries.len() as u64 * wgpu::QUERY_SIZE as u64;
+        encoder.resolve_query_set(&self.raw, queries.clone(), &self.resolve, 0);
+        encoder.copy_buffer_to_buffer(&self.resolve, 0, &self.readback, 0, size);
+        self.in_flight = Some(queries);
+        true
+    }
+
+    /// Maps the readback buffer, this has to be called after the encoder passed to
+    /// [`OcclusionQuerySet::resolve()`] was submitted
+    pub fn map(&mut self) {
+        let Some(queries) = self.in_flight.clone() else {
+            return;
+        };
+        if self.mapping {
+            return;
+        }
+        self.mapping = true;
+        let size = queries.len() as u64 * wgpu::QUERY_SIZE as u64;
+        self.mapped.map_read(self.readback.slice(..size));
+    }
+
+    /// Collects the results of the readback if it has completed, returns `true` if new
+    /// results are available
+    ///
+    /// The results stay unavailable until the device has been polled after
+    /// [`OcclusionQuerySet::map()`].
+    pub fn collect(&mut self) -> bool {
+        if !self.mapping {
+            return false;
+        }
+        let Some(queries) = self.in_flight.clone() else {
+            return false;
+        };
+        match self.mapped.status() {
+            MapStatus::Ready => {}
+            MapStatus::Failed => {
+                self.mapping = false;
+                self.in_flight = None;
+                return false;
+            }
+            MapStatus::Pending => return false,
+        }
+
+        let size = queries.len() as u64 * wgpu::QUERY_SIZE as u64;
+        {
+            let data = self.readback.slice(..size).get_mapped_range();
+            let values: Vec<u64> = bytemuck::pod_collect_to_vec(&data);
+            if self.results.len() < queries.end as usize {
+                self.results.resize(queries.end as usize, 0);
+            }
+            self.results[queries.start as usize..queries.end as usize].copy_from_slice(&values);
+        }
+        self.readback.unmap();
+        self.mapping = false;
+        self.in_flight = None;
+        true
+    }
+
+    /// Returns the passed sample count of every query from the most recent readback,
+    /// indexed by query
+    pub fn results(&self) -> &[u64] {
+        &self.results
+    }
+
+    /// Returns `true` if any samples of the query passed in the most recent readback
+    ///
+    /// A query without a result yet is reported visible, so objects are never
+    /// hidden before their first readback.
+    pub fn is_visible(&self, index: u32) -> bool {
+        self.results
+            .get(index as usize)
+            .is_none_or(|&samples| samples > 0)
+    }
+}
+
+impl HiZPyramid {
+    /// Returns the raw [`wgpu::Texture`] holding every level of the pyramid
+    pub fn raw(&self) -> &wgpu::Texture {
+        &self.texture
+    }
+
+    /// Returns the view of every level of the pyramid, for sampling in a culling pass
+    ///
+    /// The texture is `R32Float`, which is not filterable, so it has to be read with
+    /// `textureLoad` or a non-filtering sampler.
+    pub fn view(&self) -> &wgpu::TextureView {
+        &self.view
+    }
+
+    /// Returns the size of the first level, which is the size of the depth texture
+    pub fn size(&self) -> (u32, u32) {
+        self.size
+    }
+
+    /// Returns the amount of levels in the pyramid
+    pub fn level_count(&self) -> u32 {
+        self.texture.mip_level_count()
+    }
+}
+
+impl HiZGenerator {
+    /// Creates a new [`HiZGenerator`]
+    /// - `device` -> the [`wgpu::Device`] needed to create GPU resources
+    pub fn new(device: &wgpu::Device) -> Self {
+        let target_entry = wgpu::BindGroupLayoutEntry {
+            binding: 1,
+            visibility: wgpu::ShaderStages::COMPUTE,
+            ty: wgpu::BindingType::StorageTexture {
+                access: wgpu::StorageTextureAccess::WriteOnly,
+                format: wgpu::TextureFormat::R32Float,
+                view_dimension: wgpu::TextureViewDimension::D2,
+            },
+            count: None,
+        };
+        let copy_layout = device.create_bind_group_layout(&wgpu::BindGroupLayoutDescriptor {
+            label: Some("Hi-Z copy bind group layout"),
+            entries: &[
+                wgpu::BindGroupLayoutEntry {
+                    binding: 0,
+                    visibility: wgpu::ShaderStages::COMPUTE,
+                    ty: wgpu::BindingType::Texture {
+                        sample_type: wgpu::TextureSampleType::Depth,
+                        view_dimension: wgpu::TextureViewDimension::D2,
+                        multisampled: false,
+                    },
+                    count: None,
+                },
+                target_entry,
+            ],
+        });
+        let downsample_layout = device.create_bind_group_layout(&wgpu::BindGroupLayoutDescriptor {
+            label: Some("Hi-Z downsample bind group layout"),
+            entries: &[
+                wgpu::BindGroupLayoutEntry {
+                    binding: 0,
+                    visibility: wgpu::ShaderStages::COMPUTE,
+                    ty: wgpu::BindingType::Texture {
+                        sample_type: wgpu::TextureSampleType::Float { filterable: false },
+                        view_dimension: wgpu::TextureViewDimension::D2,
+                        multisampled: false,
+                    },
+                    count: None,
+                },
+                target_entry,
+            ],
+        });
+        let copy_pipeline =
+            Self::create_pipeline(device, "Hi-Z copy", HIZ_COPY_SHADER, &copy_layout);
+        let downsample_pipeline = Self::create_pipeline(
+            device,
+            "Hi-Z downsample",
+            HIZ_DOWNSAMPLE_SHADER,
+            &downsample_layout,
+        );
+        Self {
+            copy_layout,
+            downsample_layout,
+            copy_pipeline,
+            downsample_pipeline,
+        }
+    }
+
+    /// Creates a pyramid for a depth texture, the pyramid has a full mip chain
+    /// with its first level being the size of the depth texture
+    /// - `device` -> the [`wgpu::Device`] needed to create GPU resources
+    /// - `depth` -> the depth texture, created with [`crate::graphics::texture::TextureUsage::SampledAttachment`]
+    ///
+    /// # Panics:
+    /// - If the texture is not a depth texture that can be sampled.
+    pub fn create_pyramid(&self, device: &wgpu::Device, depth: &Texture) -> HiZPyramid {
+        let raw = depth.raw();
+        assert!(
+            raw.format().has_depth_aspect(),
+            "A Hi-Z pyramid can only be built from a depth texture!"
+        );
+        assert!(
+            raw.usage().contains(wgpu::TextureUsages::TEXTURE_BINDING),
+            "A Hi-Z pyramid can only be built from a depth texture that can be sampled!"
+        );
+
+        let (width, height) = (raw.width(), raw.height());
+        let level_count = full_mip_level_count(width, height);
+        let texture = device.create_texture(&wgpu::TextureDescriptor {
+            label: Some("Hi-Z pyramid"),
+            size: wgpu::Extent3d {
+                width,
+                height,
+                depth_or_array_layers: 1,
+            },
+            mip_level_count: level_count,
+            sample_count: 1,
+            dimension: wgpu::TextureDimension::D2,
+            format: wgpu::TextureFormat::R32Float,
+            usage: wgpu::TextureUsages::STORAGE_BINDING | wgpu::TextureUsages::TEXTURE_BINDING,
+            view_formats: &[],
+        });
+        let level_views: Vec<_> = (0..level_count)
+            .map(|level| {
+                texture.create_view(&wgpu::TextureViewDescriptor {
+                    label: Some("Hi-Z pyramid level view"),
+                    base_mip_level: level,
+                    mip_level_count: Some(1),
+                    ..Default::default()
+                })
+            })
+            .collect();
+        let depth_view = raw.create_view(&wgpu::TextureViewDescriptor {
+            label: Some("Hi-Z depth view"),
+            aspect: wgpu::TextureAspect::DepthOnly,
+            ..Default::default()
+        });
+
+        let mut bind_groups = Vec::with_capacity(level_count as usize);
+        bind_groups.push(Self::create_bind_group(
+            device,
+            &self.copy_layout,
+            &depth_view,
+            &level_views[0],
+        ));
+        for level in 1..level_count as usize {
+            bind_groups.push(Self::create_bind_group(
+                device,
+                &self.downsample_layout,
+                &level_views[level - 1],
+                &level_views[level],
+            ));
+        }
+
+        HiZPyramid {
+            view: texture.create_view(&wgpu::TextureViewDescriptor {
+                label: Some("Hi-Z pyramid view"),
+                ..Default::default()
+            }),
+            texture,
+            bind_groups,
+            size: (width, height),
+        }
+    }
+
+    /// Records the passes that build every level of the pyramid from its depth texture
+    ///
+    /// This has to be recorded after the depth texture has been rendered to and before
+    /// the culling pass that samples the pyramid.
+    pub fn record(&self, encoder: &mut wgpu::CommandEncoder, pyramid: &HiZPyramid) {
+        let mut pass = encoder.begin_compute_pass(&wgpu::ComputePassDescriptor {
+            label: Some("Hi-Z pass"),
+            timestamp_writes: None,
+        });
+        for (level, bind_group) in pyramid.bind_groups.iter().enumerate() {
+            let pipeline = if level == 0 {
+                &self.copy_pipeline
+            } else {
+                &self.downsample_pipeline
+            };
+            let width = mip_level_size(pyramid.size.0, level as u32);
+            let height = mip_level_size(pyramid.size.1, level as u32);
+            pass.set_pipeline(pipeline);
+            pass.set_bind_group(0, bind_group, &[]);
+            pass.dispatch_workgroups(
+                width.div_ceil(HIZ_WORKGROUP_SIZE),
+                height.div_ceil(HIZ_WORKGROUP_SIZE),
+                1,
+            );
+        }
+    }
+
+    /// Creates a compute pipeline from a Hi-Z shader
+    fn create_pipeline(
+        device: &wgpu::Device,
+        label: &str,
+        source: &str,
+        layout: &wgpu::BindGroupLayout,
+    ) -> wgpu::ComputePipeline {
+        let shader = device.create_shader_module(wgpu::ShaderModuleDescriptor {
+            label: Some(label),
+            source: wgpu::ShaderSource::Wgsl(source.into()),
+        });
+        let pipeline_layout = device.create_pipeline_layout(&wgpu::PipelineLayoutDescriptor {
+            label: Some(label),
+            bind_group_layouts: &[layout],
+            push_constant_ranges: &[],
+        });
+        device.create_compute_pipeline(&wgpu::ComputePipelineDescriptor {
+            label: Some(label),
+            layout: Some(&pipeline_layout),
+            module: &shader,
+            entry_point: Some("cs_main"),
+            compilation_options: wgpu::PipelineCompilationOptions::default(),
+            cache: None,
+        })
+    }
+
+    /// Creates the bind group that reads `source` and writes `target`
+    fn create_bind_group(
+        device: &wgpu::Device,
+        layout: &wgpu::BindGroupLayout,
+        source: &wgpu::TextureView,
+        target: &wgpu::TextureView,
+    ) -> wgpu::BindGroup {
+        device.create_bind_group(&wgpu::BindGroupDescriptor {
+            label: Some("Hi-Z bind group"),
+            layout,
+            entries: &[
+                wgpu::BindGroupEntry {
+                    binding: 0,
+                    resource: wgpu::BindingResource::TextureView(source),
+                },
+                wgpu::BindGroupEntry {
+                    binding: 1,
+                    resource: wgpu::BindingResource::TextureView(target),
+                },
+            ],
+        })
+    }
+}
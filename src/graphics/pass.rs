@@ -1,20 +1,183 @@
+use std::ops::Range;
+
+use bytemuck::{Pod, Zeroable};
+
 use crate::graphics::{
-    buffer::AnyBufferHandle, color::Color, group::BindGroup, pipeline::Pipeline, texture::Texture,
+    buffer::{AnyBufferHandle, BufferHandle},
+    bundle::RenderBundle,
+    color::Color,
+    group::BindGroup,
+    id::ResourceId,
+    occlusion::OcclusionQuerySet,
+    pipeline::{ComputePipeline, Pipeline},
+    profiler::ProfilerScope,
+    texture::Texture,
 };
 
 /// Describes a wrapper around the raw [`wgpu::RenderPass`]
+///
+/// The render pass remembers which pipeline, bind groups and buffers are currently bound,
+/// and skips setting a resource that is already bound in the same slot,
+/// see [`RenderPass::stats()`] for how many state changes were issued and skipped
 pub struct RenderPass<'a> {
     raw: wgpu::RenderPass<'a>,
+    state: BoundState,
+    stats: RenderPassStats,
+    /// Whether a pipeline statistics query has to be ended with the pass
+    statistics_query: bool,
+    /// The amount of queries in the occlusion query set, if the pass has one
+    occlusion_query_count: Option<u32>,
+}
+
+/// Describes the resources currently bound to a [`RenderPass`], by their [`ResourceId`]
+#[derive(Debug, Default)]
+pub(crate) struct BoundState {
+    pub(crate) pipeline: Option<ResourceId>,
+    pub(crate) bind_groups: Vec<Option<ResourceId>>,
+    pub(crate) bind_group_offsets: Vec<Vec<u32>>,
+    pub(crate) vertex_buffers: Vec<Option<ResourceId>>,
+    pub(crate) index_buffer: Option<ResourceId>,
+}
+
+/// Describes how many state changes of a single kind were issued to the GPU and skipped
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct StateCounter {
+    /// How many state changes were forwarded to the GPU
+    pub issued: u32,
+    /// How many state changes were skipped because the same resource was already bound
+    pub skipped: u32,
+}
+
+/// Describes the state change statistics of a [`RenderPass`]
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct RenderPassStats {
+    /// The pipeline state changes
+    pub pipelines: StateCounter,
+    /// The bind group state changes
+    pub bind_groups: StateCounter,
+    /// The vertex (geometry and instance) buffer state changes
+    pub vertex_buffers: StateCounter,
+    /// The index buffer state changes
+    pub index_buffers: StateCounter,
 }
 
 /// Describes a render pass
 pub struct RenderPassDescriptor<'a> {
     /// The optional debugging label of this render pass
     pub label: Option<&'a str>,
-    /// The color attachment of this render pass
-    pub color_attachment: Option<Color>,
+    /// The color attachments of this render pass, one per color target of the pipelines
+    pub color_attachments: &'a [ColorAttachment<'a>],
     /// The depth/stencil attachment of this render pass
-    pub depth_stencil_attachment: Option<&'a Texture>,
+    pub depth_stencil_attachment: Option<DepthStencilAttachment<'a>>,
+    /// The optional profiler scope that measures this render pass,
+    /// see [`crate::graphics::profiler::GpuProfiler::scope()`]
+    pub profiler_scope: Option<ProfilerScope<'a>>,
+    /// The optional occlusion query set of this render pass,
+    /// see [`RenderPass::begin_occlusion_query()`]
+    pub occlusion_query_set: Option<&'a OcclusionQuerySet>,
+}
+
+/// Describes what happens to the contents of an attachment when a render pass begins
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum LoadOp<T> {
+    /// Clears the attachment to the value
+    Clear(T),
+    /// Keeps the previous contents of the attachment
+    Load,
+}
+
+/// Describes what happens to the contents of an attachment when a render pass ends
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum StoreOp {
+    /// Writes the rendered contents to the attachment
+    Store,
+    /// Discards the rendered contents, e.g. of a multisampled attachment after it's resolved
+    Discard,
+}
+
+/// Describes the load and store operations of an attachment
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct AttachmentOps<T> {
+    /// The operation when the render pass begins
+    pub load: LoadOp<T>,
+    /// The operation when the render pass ends
+    pub store: StoreOp,
+}
+
+/// Describes a color attachment of a render pass
+#[derive(Debug, Clone, Copy)]
+pub struct ColorAttachment<'a> {
+    /// The texture view to render to
+    pub view: &'a wgpu::TextureView,
+    /// The optional single-sampled view a multisampled view is resolved into
+    pub resolve_target: Option<&'a wgpu::TextureView>,
+    /// The load and store operations of the attachment
+    pub ops: AttachmentOps<Color>,
+}
+
+/// Describes the depth/stencil attachment of a render pass
+///
+/// The operations of an aspect the texture format doesn't have are ignored.
+#[derive(Debug, Clone, Copy)]
+pub struct DepthStencilAttachment<'a> {
+    /// The depth/stencil texture
+    pub texture: &'a Texture,
+    /// The operations of the depth aspect, [`None`] makes the depth read-only
+    pub depth: Option<AttachmentOps<f32>>,
+    /// The operations of the stencil aspect, [`None`] makes the stencil read-only
+    pub stencil: Option<AttachmentOps<u32>>,
+}
+
+/// Describes the arguments of a single indirect draw call,
+/// as read by [`RenderPass::draw_indirect()`]
+///
+/// The layout matches what the GPU expects, so a compute shader can write these directly
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default, Zeroable, Pod)]
+pub struct DrawArgs {
+    /// How many vertices to draw
+    pub vertex_count: u32,
+    /// How many instances of the geometry to draw
+    pub instance_count: u32,
+    /// The index of the first vertex to draw
+    pub first_vertex: u32,
+    /// The index of the first instance to draw
+    pub first_instance: u32,
+}
+
+/// Describes the arguments of a single indexed indirect draw call,
+/// as read by [`RenderPass::draw_indexed_indirect()`]
+///
+/// The layout matches what the GPU expects, so a compute shader can write these directly
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default, Zeroable, Pod)]
+pub struct DrawIndexedArgs {
+    /// How many indices to draw
+    pub index_count: u32,
+    /// How many instances of the geometry to draw
+    pub instance_count: u32,
+    /// The index of the first index to draw
+    pub first_index: u32,
+    /// The value added to each index before reading the vertex
+    pub base_vertex: i32,
+    /// The index of the first instance to draw
+    pub first_instance: u32,
+}
+
+/// Describes a wrapper around the raw [`wgpu::ComputePass`]
+pub struct ComputePass<'a> {
+    raw: wgpu::ComputePass<'a>,
+    /// Whether a pipeline statistics query has to be ended with the pass
+    statistics_query: bool,
+}
+
+/// Describes a compute pass
+pub struct ComputePassDescriptor<'a> {
+    /// The optional debugging label of this compute pass
+    pub label: Option<&'a str>,
+    /// The optional profiler scope that measures this compute pass,
+    /// see [`crate::graphics::profiler::GpuProfiler::scope()`]
+    pub profiler_scope: Option<ProfilerScope<'a>>,
 }
 
 impl<'a> RenderPass<'a> {
@@ -23,25 +186,73 @@ impl<'a> RenderPass<'a> {
         &self.raw
     }
 
+    /// Returns the state change statistics of this render pass
+    pub fn stats(&self) -> RenderPassStats {
+        self.stats
+    }
+
+    /// Begins an occlusion query, which counts the samples of every draw call until
+    /// [`RenderPass::end_occlusion_query()`] that pass the depth and stencil tests
+    /// - `index` -> the index of the query in the occlusion query set of this render pass
+    ///
+    /// # Panics:
+    /// - If the render pass has no occlusion query set.
+    /// - If `index` exceeds the query count of the occlusion query set.
+    pub fn begin_occlusion_query(&mut self, index: u32) {
+        let count = self
+            .occlusion_query_count
+            .expect("Render pass has no occlusion query set!");
+        assert!(
+            index < count,
+            "Occlusion query index {} exceeds the query count {}!",
+            index,
+            count
+        );
+        self.raw.begin_occlusion_query(index);
+    }
+
+    /// Ends the current occlusion query, see [`RenderPass::begin_occlusion_query()`]
+    pub fn end_occlusion_query(&mut self) {
+        self.raw.end_occlusion_query();
+    }
+
+    /// Replays pre-recorded [`RenderBundle`]s in order
+    /// - `bundles` -> the render bundles to execute
+    ///
+    /// The bundles have to be compatible with the attachments of this render pass.
+    /// Executing bundles resets the bound pipeline, bind groups and buffers of the render pass,
+    /// so they have to be set again before the next draw call.
+    pub fn execute_bundles(&mut self, bundles: &[&RenderBundle]) {
+        self.raw
+            .execute_bundles(bundles.iter().map(|bundle| bundle.raw()));
+        self.state = BoundState::default();
+    }
+
     /// Sets a geometry buffer in a specific slot
     /// - `slot` -> the slot to use for this buffer
     /// - `buffer` -> the geometry buffer to set
     pub fn use_geometry_buffer(&mut self, slot: u32, buffer: &dyn AnyBufferHandle) {
-        self.raw.set_vertex_buffer(slot, buffer.as_slice());
+        self.use_vertex_buffer(slot, buffer);
     }
 
     /// Sets an index buffer to the render pass
     /// - `buffer` -> the index buffer to set
     pub fn use_index_buffer(&mut self, buffer: &dyn AnyBufferHandle) {
-        self.raw
-            .set_index_buffer(buffer.as_slice(), wgpu::IndexFormat::Uint32);
+        if track(
+            &mut self.state.index_buffer,
+            buffer.id(),
+            &mut self.stats.index_buffers,
+        ) {
+            self.raw
+                .set_index_buffer(buffer.as_slice(), wgpu::IndexFormat::Uint32);
+        }
     }
 
     /// Sets an instance buffer in a specific slot
     /// - `slot` -> the slot to use for this buffer
     /// - `buffer` -> the instance buffer to set
     pub fn use_instance_buffer(&mut self, slot: u32, buffer: &dyn AnyBufferHandle) {
-        self.raw.set_vertex_buffer(slot, buffer.as_slice());
+        self.use_vertex_buffer(slot, buffer);
     }
 
     /// Sets a [`BindGroup`] to the render pass
@@ -53,16 +264,57 @@ impl<'a> RenderPass<'a> {
     /// Sets multiple [`BindGroup`] instances to the render pass
     pub fn use_bind_groups(&mut self, bind_groups: &[&BindGroup]) {
         for (slot, bind_group) in bind_groups.iter().enumerate() {
-            // Unwrap is safe here
-            self.raw
-                .set_bind_group(slot.try_into().unwrap(), bind_group.raw(), &[]);
+            if track(
+                slot_mut(&mut self.state.bind_groups, slot),
+                bind_group.id(),
+                &mut self.stats.bind_groups,
+            ) {
+                slot_mut(&mut self.state.bind_group_offsets, slot).clear();
+                // Unwrap is safe here
+                self.raw
+                    .set_bind_group(slot.try_into().unwrap(), bind_group.raw(), &[]);
+            }
         }
     }
 
+    /// Sets a [`BindGroup`] with dynamic offsets in a specific slot
+    /// - `slot` -> the slot to use for this bind group
+    /// - `bind_group` -> the bind group
+    /// - `offsets` -> the dynamic offsets in bytes, one per dynamic entry in binding order
+    ///
+    /// The bind group is only set again if it's not bound in the slot with the same offsets.
+    pub fn use_bind_group_with_offsets(
+        &mut self,
+        slot: u32,
+        bind_group: &BindGroup,
+        offsets: &[u32],
+    ) {
+        let index = slot as usize;
+        let bound_offsets = slot_mut(&mut self.state.bind_group_offsets, index);
+        let bound = slot_mut(&mut self.state.bind_groups, index);
+        if *bound == Some(bind_group.id()) && bound_offsets.as_slice() == offsets {
+            self.stats.bind_groups.skipped += 1;
+            return;
+        }
+
+        *bound = Some(bind_group.id());
+        let bound_offsets = &mut self.state.bind_group_offsets[index];
+        bound_offsets.clear();
+        bound_offsets.extend_from_slice(offsets);
+        self.stats.bind_groups.issued += 1;
+        self.raw.set_bind_group(slot, bind_group.raw(), offsets);
+    }
+
     /// Sets a pipeline to the render pass
     /// - `pipeline` -> the pipeline to set
     pub fn use_pipeline(&mut self, pipeline: &Pipeline) {
-        self.raw.set_pipeline(pipeline.raw());
+        if track(
+            &mut self.state.pipeline,
+            pipeline.id(),
+            &mut self.stats.pipelines,
+        ) {
+            self.raw.set_pipeline(pipeline.raw());
+        }
     }
 
     /// Issues a draw call with the current render pass configuration
@@ -92,48 +344,502 @@ impl<'a> RenderPass<'a> {
 
         self.raw.draw_indexed(0..index_count, 0, 0..instance_count);
     }
+
+    /// Issues a draw call over a range of vertices and instances,
+    /// which is useful when many meshes are packed into a single buffer
+    /// - `vertices` -> the range of vertices to draw
+    /// - `instances` -> the range of instances to draw
+    pub fn draw_range(&mut self, vertices: Range<u32>, instances: Range<u32>) {
+        match (vertices.is_empty(), instances.is_empty()) {
+            (true, true) => panic!("Attempted to draw with an empty vertex and instance range"),
+            (_, true) => panic!("Attempted to draw with an empty instance range"),
+            (true, _) => panic!("Attempted to draw with an empty vertex range"),
+            (_, _) => (),
+        }
+
+        self.raw.draw(vertices, instances);
+    }
+
+    /// Issues an indexed draw call over a range of indices and instances,
+    /// which is useful when many meshes are packed into a single buffer
+    /// - `indices` -> the range of indices to draw
+    /// - `base_vertex` -> the value added to each index before reading the vertex
+    /// - `instances` -> the range of instances to draw
+    pub fn draw_indexed_range(
+        &mut self,
+        indices: Range<u32>,
+        base_vertex: i32,
+        instances: Range<u32>,
+    ) {
+        match (indices.is_empty(), instances.is_empty()) {
+            (true, true) => panic!("Attempted to draw with an empty index and instance range"),
+            (_, true) => panic!("Attempted to draw with an empty instance range"),
+            (true, _) => panic!("Attempted to draw with an empty index range"),
+            (_, _) => (),
+        }
+
+        self.raw.draw_indexed(indices, base_vertex, instances);
+    }
+
+    /// Issues a draw call where the arguments are read from a buffer on the GPU
+    /// - `buffer` -> the buffer containing the [`DrawArgs`]
+    /// - `index` -> the index of the [`DrawArgs`] item to use
+    ///
+    /// # Panics:
+    /// - If `index` exceeds the capacity of the buffer.
+    pub fn draw_indirect(&mut self, buffer: &BufferHandle<DrawArgs>, index: usize) {
+        assert_indirect_range(buffer, index, 1);
+        self.raw.draw_indirect(
+            buffer.raw(),
+            BufferHandle::<DrawArgs>::items_to_bytes(index),
+        );
+    }
+
+    /// Issues an indexed draw call where the arguments are read from a buffer on the GPU
+    /// - `buffer` -> the buffer containing the [`DrawIndexedArgs`]
+    /// - `index` -> the index of the [`DrawIndexedArgs`] item to use
+    ///
+    /// # Panics:
+    /// - If `index` exceeds the capacity of the buffer.
+    pub fn draw_indexed_indirect(&mut self, buffer: &BufferHandle<DrawIndexedArgs>, index: usize) {
+        assert_indirect_range(buffer, index, 1);
+        self.raw.draw_indexed_indirect(
+            buffer.raw(),
+            BufferHandle::<DrawIndexedArgs>::items_to_bytes(index),
+        );
+    }
+
+    /// Issues multiple draw calls where the arguments are read from a buffer on the GPU
+    /// - `buffer` -> the buffer containing the [`DrawArgs`]
+    /// - `first` -> the index of the first [`DrawArgs`] item to use
+    /// - `count` -> how many draw calls to issue
+    ///
+    /// # Panics:
+    /// - If the `count` items starting at `first` exceed the capacity of the buffer.
+    pub fn multi_draw_indirect(
+        &mut self,
+        buffer: &BufferHandle<DrawArgs>,
+        first: usize,
+        count: u32,
+    ) {
+        assert_indirect_range(buffer, first, count as usize);
+        self.raw.multi_draw_indirect(
+            buffer.raw(),
+            BufferHandle::<DrawArgs>::items_to_bytes(first),
+            count,
+        );
+    }
+
+    /// Issues multiple indexed draw calls where the arguments are read from a buffer on the GPU
+    /// - `buffer` -> the buffer containing the [`DrawIndexedArgs`]
+    /// - `first` -> the index of the first [`DrawIndexedArgs`] item to use
+    /// - `count` -> how many draw calls to issue
+    ///
+    /// # Panics:
+    /// - If the `count` items starting at `first` exceed the capacity of the buffer.
+    pub fn multi_draw_indexed_indirect(
+        &mut self,
+        buffer: &BufferHandle<DrawIndexedArgs>,
+        first: usize,
+        count: u32,
+    ) {
+        assert_indirect_range(buffer, first, count as usize);
+        self.raw.multi_draw_indexed_indirect(
+            buffer.raw(),
+            BufferHandle::<DrawIndexedArgs>::items_to_bytes(first),
+            count,
+        );
+    }
+
+    /// Issues multiple indexed draw calls where both the arguments and the amount of draw calls
+    /// are read from buffers on the GPU, which lets a compute culling pass decide what gets drawn
+    /// - `buffer` -> the buffer containing the [`DrawIndexedArgs`]
+    /// - `first` -> the index of the first [`DrawIndexedArgs`] item to use
+    /// - `count_buffer` -> the buffer containing the amount of draw calls as a `u32`
+    /// - `count_offset` -> the offset in bytes of the amount of draw calls in `count_buffer`
+    /// - `max_count` -> the maximum amount of draw calls to issue
+    ///
+    /// This requires the [`wgpu::Features::MULTI_DRAW_INDIRECT_COUNT`] feature.
+    ///
+    /// # Panics:
+    /// - If the `max_count` items starting at `first` exceed the capacity of the buffer.
+    pub fn multi_draw_indexed_indirect_count(
+        &mut self,
+        buffer: &BufferHandle<DrawIndexedArgs>,
+        first: usize,
+        count_buffer: &dyn AnyBufferHandle,
+        count_offset: u64,
+        max_count: u32,
+    ) {
+        assert_indirect_range(buffer, first, max_count as usize);
+        self.raw.multi_draw_indexed_indirect_count(
+            buffer.raw(),
+            BufferHandle::<DrawIndexedArgs>::items_to_bytes(first),
+            count_buffer.raw(),
+            count_offset,
+            max_count,
+        );
+    }
+
+    /// Sets a vertex buffer in a specific slot, unless it's already bound there
+    fn use_vertex_buffer(&mut self, slot: u32, buffer: &dyn AnyBufferHandle) {
+        if track(
+            slot_mut(&mut self.state.vertex_buffers, slot as usize),
+            buffer.id(),
+            &mut self.stats.vertex_buffers,
+        ) {
+            self.raw.set_vertex_buffer(slot, buffer.as_slice());
+        }
+    }
+}
+
+impl<T> AttachmentOps<T> {
+    /// Maps the [`AttachmentOps`] to the internal [`wgpu::Operations`]
+    fn raw<U>(self, value: impl FnOnce(T) -> U) -> wgpu::Operations<U> {
+        wgpu::Operations {
+            load: match self.load {
+                LoadOp::Clear(clear) => wgpu::LoadOp::Clear(value(clear)),
+                LoadOp::Load => wgpu::LoadOp::Load,
+            },
+            store: match self.store {
+                StoreOp::Store => wgpu::StoreOp::Store,
+                StoreOp::Discard => wgpu::StoreOp::Discard,
+            },
+        }
+    }
+}
+
+impl<'a> ColorAttachment<'a> {
+    /// Creates an attachment that is cleared to a color and stored
+    /// - `view` -> the texture view to render to
+    /// - `color` -> the clear color
+    pub fn clear(view: &'a wgpu::TextureView, color: Color) -> Self {
+        Self {
+            view,
+            resolve_target: None,
+            ops: AttachmentOps {
+                load: LoadOp::Clear(color),
+                store: StoreOp::Store,
+            },
+        }
+    }
+
+    /// Creates an attachment that keeps its previous contents and is stored
+    /// - `view` -> the texture view to render to
+    pub fn load(view: &'a wgpu::TextureView) -> Self {
+        Self {
+            view,
+            resolve_target: None,
+            ops: AttachmentOps {
+                load: LoadOp::Load,
+                store: StoreOp::Store,
+            },
+        }
+    }
+
+    /// Resolves the multisampled attachment into a single-sampled view
+    /// and discards the multisampled contents, which are rarely needed afterwards
+    /// - `target` -> the view to resolve into
+    pub fn resolve(mut self, target: &'a wgpu::TextureView) -> Self {
+        self.resolve_target = Some(target);
+        self.ops.store = StoreOp::Discard;
+        self
+    }
+
+    /// Maps the [`ColorAttachment`] to the internal [`wgpu::RenderPassColorAttachment`]
+    fn raw(&self) -> wgpu::RenderPassColorAttachment<'a> {
+        wgpu::RenderPassColorAttachment {
+            view: self.view,
+            depth_slice: None,
+            resolve_target: self.resolve_target,
+            ops: self.ops.raw(Color::raw),
+        }
+    }
+}
+
+impl<'a> DepthStencilAttachment<'a> {
+    /// Creates an attachment that clears the depth to 1.0 and the stencil to 0 and stores both
+    /// - `texture` -> the depth/stencil texture
+    pub fn clear(texture: &'a Texture) -> Self {
+        Self {
+            texture,
+            depth: Some(AttachmentOps {
+                load: LoadOp::Clear(1.0),
+                store: StoreOp::Store,
+            }),
+            stencil: Some(AttachmentOps {
+                load: LoadOp::Clear(0),
+                store: StoreOp::Store,
+            }),
+        }
+    }
+
+    /// Creates an attachment that keeps the depth and stencil of a previous pass
+    /// (e.g. a depth prepass) and stores both
+    /// - `texture` -> the depth/stencil texture
+    pub fn load(texture: &'a Texture) -> Self {
+        let ops = Some(AttachmentOps {
+            load: LoadOp::Load,
+            store: StoreOp::Store,
+        });
+        Self {
+            texture,
+            depth: ops,
+            stencil: ops,
+        }
+    }
+
+    /// Creates a read-only attachment, which can only be tested against
+    /// and may be sampled in the same pass
+    /// - `texture` -> the depth/stencil texture
+    pub fn read_only(texture: &'a Texture) -> Self {
+        Self {
+            texture,
+            depth: None,
+            stencil: None,
+        }
+    }
+
+    /// Maps the [`DepthStencilAttachment`] to the internal [`wgpu::RenderPassDepthStencilAttachment`]
+    fn raw(&self) -> wgpu::RenderPassDepthStencilAttachment<'a> {
+        let format = self.texture.raw().format();
+        wgpu::RenderPassDepthStencilAttachment {
+            view: self.texture.view(),
+            depth_ops: self
+                .depth
+                .filter(|_| format.has_depth_aspect())
+                .map(|ops| ops.raw(|depth| depth)),
+            stencil_ops: self
+                .stencil
+                .filter(|_| format.has_stencil_aspect())
+                .map(|ops| ops.raw(|stencil| stencil)),
+        }
+    }
 }
 
 impl<'a> RenderPassDescriptor<'a> {
     /// Builds a [`RenderPass`]
-    /// - `frame` -> the texture view of the current frame we want to render to
     /// - `encoder` -> the command encoder that records the render pass
-    pub fn build(
-        self,
-        frame: &wgpu::TextureView,
-        encoder: &'a mut wgpu::CommandEncoder,
-    ) -> RenderPass<'a> {
+    pub fn build(self, encoder: &'a mut wgpu::CommandEncoder) -> RenderPass<'a> {
+        let color_attachments: Vec<_> = self
+            .color_attachments
+            .iter()
+            .map(|attachment| Some(attachment.raw()))
+            .collect();
+        let mut raw = encoder.begin_render_pass(&wgpu::RenderPassDescriptor {
+            label: self.label,
+            color_attachments: &color_attachments,
+            depth_stencil_attachment: self
+                .depth_stencil_attachment
+                .as_ref()
+                .map(DepthStencilAttachment::raw),
+            timestamp_writes: self
+                .profiler_scope
+                .as_ref()
+                .map(ProfilerScope::render_timestamp_writes),
+            occlusion_query_set: self.occlusion_query_set.map(OcclusionQuerySet::raw),
+        });
+        let statistics = self.profiler_scope.and_then(|scope| scope.statistics());
+        if let Some((query_set, index)) = statistics {
+            raw.begin_pipeline_statistics_query(query_set, index);
+        }
         RenderPass {
-            raw: encoder.begin_render_pass(&wgpu::RenderPassDescriptor {
-                label: self.label,
-                color_attachments: &[Some(wgpu::RenderPassColorAttachment {
-                    view: frame,
-                    ops: wgpu::Operations {
-                        load: match self.color_attachment {
-                            Some(color) => wgpu::LoadOp::Clear(color.raw()),
-                            None => wgpu::LoadOp::Load,
-                        },
-                        store: wgpu::StoreOp::Store,
-                    },
-                    depth_slice: None,
-                    resolve_target: None,
-                })],
-                depth_stencil_attachment: self.depth_stencil_attachment.map(|depth_stencil| {
-                    wgpu::RenderPassDepthStencilAttachment {
-                        view: depth_stencil.view(),
-                        depth_ops: Some(wgpu::Operations {
-                            load: wgpu::LoadOp::Clear(1.0),
-                            store: wgpu::StoreOp::Store,
-                        }),
-                        stencil_ops: Some(wgpu::Operations {
-                            load: wgpu::LoadOp::Clear(0),
-                            store: wgpu::StoreOp::Store,
-                        }),
-                    }
-                }),
-                timestamp_writes: None,
-                occlusion_query_set: None,
-            }),
+            raw,
+            state: BoundState::default(),
+            stats: RenderPassStats::default(),
+            statistics_query: statistics.is_some(),
+            occlusion_query_count: self.occlusion_query_set.map(OcclusionQuerySet::count),
+        }
+    }
+}
+
+impl<'a> ComputePass<'a> {
+    /// Returns the raw [`wgpu::ComputePass`]
+    pub fn raw(&self) -> &wgpu::ComputePass<'a> {
+        &self.raw
+    }
+
+    /// Sets a [`BindGroup`] to the compute pass
+    /// - `set` -> the bind group
+    pub fn use_bind_group(&mut self, bind_group: &BindGroup) {
+        self.use_bind_groups(&[bind_group]);
+    }
+
+    /// Sets multiple [`BindGroup`] instances to the compute pass
+    pub fn use_bind_groups(&mut self, bind_groups: &[&BindGroup]) {
+        for (slot, bind_group) in bind_groups.iter().enumerate() {
+            // Unwrap is safe here
+            self.raw
+                .set_bind_group(slot.try_into().unwrap(), bind_group.raw(), &[]);
         }
     }
+
+    /// Sets a [`BindGroup`] with dynamic offsets in a specific slot
+    /// - `slot` -> the slot to use for this bind group
+    /// - `bind_group` -> the bind group
+    /// - `offsets` -> the dynamic offsets in bytes, one per dynamic entry in binding order
+    pub fn use_bind_group_with_offsets(
+        &mut self,
+        slot: u32,
+        bind_group: &BindGroup,
+        offsets: &[u32],
+    ) {
+        self.raw.set_bind_group(slot, bind_group.raw(), offsets);
+    }
+
+    /// Sets a compute pipeline to the compute pass
+    /// - `pipeline` -> the compute pipeline to set
+    pub fn use_pipeline(&mut self, pipeline: &ComputePipeline) {
+        self.raw.set_pipeline(pipeline.raw());
+    }
+
+    /// Dispatches a grid of workgroups with the current compute pass configuration
+    /// - `x` -> how many workgroups to dispatch in the X dimension
+    /// - `y` -> how many workgroups to dispatch in the Y dimension
+    /// - `z` -> how many workgroups to dispatch in the Z dimension
+    pub fn dispatch(&mut self, x: u32, y: u32, z: u32) {
+        if x == 0 || y == 0 || z == 0 {
+            panic!(
+                "Attempted to dispatch with a workgroup count of 0: ({}, {}, {})",
+                x, y, z
+            );
+        }
+
+        self.raw.dispatch_workgroups(x, y, z);
+    }
+
+    /// Dispatches a grid of workgroups, where the workgroup counts are read from a buffer
+    /// - `buffer` -> the buffer containing the workgroup counts `(x, y, z)` as 3 `u32` values
+    /// - `offset` -> the offset in bytes where the workgroup counts start in the buffer
+    pub fn dispatch_indirect(&mut self, buffer: &dyn AnyBufferHandle, offset: u64) {
+        self.raw.dispatch_workgroups_indirect(buffer.raw(), offset);
+    }
+}
+
+impl<'a> ComputePassDescriptor<'a> {
+    /// Builds a [`ComputePass`]
+    /// - `encoder` -> the command encoder that records the compute pass
+    pub fn build(self, encoder: &'a mut wgpu::CommandEncoder) -> ComputePass<'a> {
+        let mut raw = encoder.begin_compute_pass(&wgpu::ComputePassDescriptor {
+            label: self.label,
+            timestamp_writes: self
+                .profiler_scope
+                .as_ref()
+                .map(ProfilerScope::compute_timestamp_writes),
+        });
+        let statistics = self.profiler_scope.and_then(|scope| scope.statistics());
+        if let Some((query_set, index)) = statistics {
+            raw.begin_pipeline_statistics_query(query_set, index);
+        }
+        ComputePass {
+            raw,
+            statistics_query: statistics.is_some(),
+        }
+    }
+}
+
+impl Drop for RenderPass<'_> {
+    fn drop(&mut self) {
+        if self.statistics_query {
+            self.raw.end_pipeline_statistics_query();
+        }
+    }
+}
+
+impl Drop for ComputePass<'_> {
+    fn drop(&mut self) {
+        if self.statistics_query {
+            self.raw.end_pipeline_statistics_query();
+        }
+    }
+}
+
+impl StateCounter {
+    /// Returns the total amount of requested state changes
+    pub fn requested(&self) -> u32 {
+        self.issued + self.skipped
+    }
+}
+
+impl RenderPassStats {
+    /// Returns how many state changes of any kind were forwarded to the GPU
+    pub fn issued(&self) -> u32 {
+        self.pipelines.issued
+            + self.bind_groups.issued
+            + self.vertex_buffers.issued
+            + self.index_buffers.issued
+    }
+
+    /// Returns how many state changes of any kind were skipped
+    pub fn skipped(&self) -> u32 {
+        self.pipelines.skipped
+            + self.bind_groups.skipped
+            + self.vertex_buffers.skipped
+            + self.index_buffers.skipped
+    }
+}
+
+/// Asserts that the `count` indirect arguments starting at `first` lie within the capacity
+/// of `buffer`, since the GPU would otherwise read past its end
+pub(crate) fn assert_indirect_range<T: Pod>(buffer: &BufferHandle<T>, first: usize, count: usize) {
+    assert!(
+        first
+            .checked_add(count)
+            .is_some_and(|end| end <= buffer.item_capacity()),
+        "Indirect arguments {}..{} exceed the buffer capacity {}!",
+        first,
+        first.saturating_add(count),
+        buffer.item_capacity()
+    );
+}
+
+/// Records `id` as bound in `bound`, returns `true` if the state change has to be issued
+pub(crate) fn track(
+    bound: &mut Option<ResourceId>,
+    id: ResourceId,
+    counter: &mut StateCounter,
+) -> bool {
+    if *bound == Some(id) {
+        counter.skipped += 1;
+        false
+    } else {
+        *bound = Some(id);
+        counter.issued += 1;
+        true
+    }
+}
+
+/// Returns the bound state in `slot`, growing `slots` if needed
+pub(crate) fn slot_mut<T: Clone + Default>(slots: &mut Vec<T>, slot: usize) -> &mut T {
+    if slots.len() <= slot {
+        slots.resize(slot + 1, T::default());
+    }
+    &mut slots[slot]
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn track_skips_redundant() {
+        let mut bound = None;
+        let mut counter = StateCounter::default();
+        let first = ResourceId::next();
+        let second = ResourceId::next();
+        assert!(track(&mut bound, first, &mut counter));
+        assert!(!track(&mut bound, first, &mut counter));
+        assert!(track(&mut bound, second, &mut counter));
+        assert!(track(&mut bound, first, &mut counter));
+        assert_eq!(counter.issued, 3);
+        assert_eq!(counter.skipped, 1);
+    }
+
+    #[test]
+    fn slot_mut_grows() {
+        let mut slots: Vec<Option<ResourceId>> = Vec::new();
+        *slot_mut(&mut slots, 3) = Some(ResourceId::next());
+        assert_eq!(slots.len(), 4);
+        assert!(slots[..3].iter().all(Option::is_none));
+    }
 }
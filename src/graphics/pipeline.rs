@@ -1,9 +1,12 @@
+use std::sync::Arc;
+
 use crate::graphics::{
-    group::BindGroupLayout, layout::BufferLayout, shader::Shader, texture::TextureFormat,
+    cache::PipelineCache, group::BindGroupLayout, id::ResourceId, layout::BufferLayout,
+    shader::Shader, texture::TextureFormat,
 };
 
 /// Specifies which operation the GPU should perform when assembling geometry
-#[derive(Debug, Clone, Copy)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
 pub enum Draw {
     /// Fills out the geometry
     Fill,
@@ -17,7 +20,7 @@ pub enum Draw {
 ///
 /// It's important to note that what is considered a front or a back face
 /// depends on the [`Winding`] setting
-#[derive(Debug, Clone, Copy)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
 pub enum Cull {
     /// Culls front faces
     Front,
@@ -29,7 +32,7 @@ pub enum Cull {
 
 /// Specifies the winding order when drawing geometry which then determines
 /// if a face is in the front or in the back
-#[derive(Debug, Clone, Copy)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
 pub enum Winding {
     /// The face is considered front-facing if its indices are clockwise
     Clockwise,
@@ -38,7 +41,7 @@ pub enum Winding {
 }
 
 /// Specifies the primitive which the GPU should use for assembling geometry
-#[derive(Debug, Clone, Copy)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
 pub enum Primitive {
     /// Useful for debugging and visualizing points in space,
     /// the geometry primitive is a single point.
@@ -51,7 +54,7 @@ pub enum Primitive {
 }
 
 /// Specifies the blending mode for the GPU during the rasterization stage
-#[derive(Debug, Clone, Copy)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
 pub enum Blend {
     /// Specifies that the GPU will blend the new pixel with an old pixel in the framebuffer
     /// based on the new pixel's alpha value
@@ -60,7 +63,20 @@ pub enum Blend {
     Replace,
 }
 
-#[derive(Debug, Clone, Copy)]
+/// Describes a single color target of a [`Pipeline`], the attachment format
+/// the pipeline renders to and how fragments are blended into it
+///
+/// A pipeline renders to one target per fragment shader output location,
+/// in the same order as the color attachments of the render pass it's used in.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub struct ColorTarget {
+    /// The format of the attachment
+    pub format: TextureFormat,
+    /// The blending mode of fragments, integer formats can't be blended and always replace
+    pub blend: Blend,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
 pub enum CompareFunction {
     Less,
     LessEqual,
@@ -75,12 +91,21 @@ pub enum CompareFunction {
 #[derive(Debug)]
 pub struct Pipeline {
     raw: wgpu::RenderPipeline,
+    id: ResourceId,
+}
+
+/// Describes a wrapper around the raw [`wgpu::ComputePipeline`]
+#[derive(Debug)]
+pub struct ComputePipeline {
+    raw: wgpu::ComputePipeline,
+    id: ResourceId,
 }
 
 /// Describes a wrapper around the raw `wgpu::PipelineLayout`
 #[derive(Debug)]
 pub struct PipelineLayout {
     raw: wgpu::PipelineLayout,
+    id: ResourceId,
 }
 
 /// Describes a [`Pipeline`]
@@ -92,6 +117,13 @@ pub struct PipelineDescriptor<'a> {
     pub label: Option<&'a str>,
     /// The pipeline shader
     pub shader: &'a Shader,
+    /// The name of the vertex shader entry point
+    pub vertex_entry_point: &'a str,
+    /// The name of the fragment shader entry point
+    pub fragment_entry_point: &'a str,
+    /// The values of the WGSL `override` constants, by name or numeric id,
+    /// shared by the vertex and fragment stages
+    pub constants: Vec<(&'a str, f64)>,
     /// The pipeline layout specifying pipeline resources
     pub pipeline_layout: &'a PipelineLayout,
     /// The geometry layout, can be optional for procedurally generated geometry
@@ -106,10 +138,62 @@ pub struct PipelineDescriptor<'a> {
     pub winding: Winding,
     /// The geometry primitive
     pub primitive: Primitive,
-    /// The blending mode of fragments
-    pub blend: Blend,
+    /// The color targets of the pipeline, one per fragment shader output location,
+    /// a pipeline without color targets skips the fragment stage (e.g. a depth prepass)
+    pub color_targets: Vec<ColorTarget>,
+    /// The amount of samples per pixel, which has to match the attachments (1 without MSAA)
+    pub sample_count: u32,
     /// The depth function to enable depth testing
     pub depth_function: Option<CompareFunction>,
+    /// The format of the depth/stencil attachment, used if depth testing is enabled
+    pub depth_format: TextureFormat,
+    /// Whether fragments that pass the depth test write their depth,
+    /// disabling it lets a pass reuse the depth from a depth prepass
+    pub depth_write: bool,
+}
+
+/// Describes the entire pipeline state of a [`PipelineDescriptor`], which identifies
+/// the pipeline it builds, the debugging label is not part of the key
+///
+/// The key owns its state, so cached pipelines are compared field by field
+/// and never mixed up on a hash collision.
+#[derive(Debug, Clone, PartialEq, Eq, Hash)]
+pub struct PipelineKey {
+    shader: ResourceId,
+    vertex_entry_point: String,
+    fragment_entry_point: String,
+    /// The override constants, with the values stored as their bits
+    constants: Vec<(String, u64)>,
+    pipeline_layout: ResourceId,
+    geometry_layout: Option<BufferLayout>,
+    instance_layout: Option<BufferLayout>,
+    draw: Draw,
+    cull: Cull,
+    winding: Winding,
+    primitive: Primitive,
+    color_targets: Vec<ColorTarget>,
+    sample_count: u32,
+    depth_function: Option<CompareFunction>,
+    depth_format: TextureFormat,
+    depth_write: bool,
+}
+
+/// Describes a [`ComputePipeline`]
+///
+/// A compute pipeline runs a single compute shader entry point over a grid of workgroups,
+/// which is useful for general-purpose work such as simulations or culling
+#[derive(Debug)]
+pub struct ComputePipelineDescriptor<'a> {
+    /// The optional debugging label of the compute pipeline
+    pub label: Option<&'a str>,
+    /// The pipeline shader
+    pub shader: &'a Shader,
+    /// The pipeline layout specifying pipeline resources
+    pub pipeline_layout: &'a PipelineLayout,
+    /// The name of the compute shader entry point
+    pub entry_point: &'a str,
+    /// The values of the WGSL `override` constants, by name or numeric id
+    pub constants: Vec<(&'a str, f64)>,
 }
 
 /// Describes a [`PipelineLayout`]
@@ -126,6 +210,23 @@ impl Pipeline {
     pub fn raw(&self) -> &wgpu::RenderPipeline {
         &self.raw
     }
+
+    /// Returns the unique [`ResourceId`] of this pipeline
+    pub fn id(&self) -> ResourceId {
+        self.id
+    }
+}
+
+impl ComputePipeline {
+    /// Returns the internal [`wgpu::ComputePipeline`]
+    pub fn raw(&self) -> &wgpu::ComputePipeline {
+        &self.raw
+    }
+
+    /// Returns the unique [`ResourceId`] of this compute pipeline
+    pub fn id(&self) -> ResourceId {
+        self.id
+    }
 }
 
 impl PipelineLayout {
@@ -133,12 +234,70 @@ impl PipelineLayout {
     pub fn raw(&self) -> &wgpu::PipelineLayout {
         &self.raw
     }
+
+    /// Returns the unique [`ResourceId`] of this pipeline layout
+    pub fn id(&self) -> ResourceId {
+        self.id
+    }
 }
 
 impl<'a> PipelineDescriptor<'a> {
     /// Builds a new [`Pipeline`]
     /// - `device` is the raw [`wgpu::Device`] which is needed to build GPU resources
     pub fn build(self, device: &wgpu::Device) -> Pipeline {
+        self.build_with_cache(device, None)
+    }
+
+    /// Returns the [`PipelineKey`] of the entire pipeline state described by this descriptor
+    ///
+    /// Two descriptors with the same shader, layouts and fixed-function state
+    /// produce equal keys, the debugging label is not part of the key
+    pub fn key(&self) -> PipelineKey {
+        PipelineKey {
+            shader: self.shader.id(),
+            vertex_entry_point: self.vertex_entry_point.to_owned(),
+            fragment_entry_point: self.fragment_entry_point.to_owned(),
+            constants: self
+                .constants
+                .iter()
+                .map(|(name, value)| ((*name).to_owned(), value.to_bits()))
+                .collect(),
+            pipeline_layout: self.pipeline_layout.id(),
+            geometry_layout: self.geometry_layout.clone(),
+            instance_layout: self.instance_layout.clone(),
+            draw: self.draw,
+            cull: self.cull,
+            winding: self.winding,
+            primitive: self.primitive,
+            color_targets: self.color_targets.clone(),
+            sample_count: self.sample_count,
+            depth_function: self.depth_function,
+            depth_format: self.depth_format,
+            depth_write: self.depth_write,
+        }
+    }
+
+    /// Builds a new [`Pipeline`] using a driver-level [`wgpu::PipelineCache`]
+    /// - `device` is the raw [`wgpu::Device`] which is needed to build GPU resources
+    /// - `cache` is the optional [`wgpu::PipelineCache`] that lets the driver skip compilation
+    ///
+    /// # Panics:
+    /// - If both buffer layouts are missing.
+    /// - If the sample count is not a power of two.
+    pub fn build_with_cache(
+        self,
+        device: &wgpu::Device,
+        cache: Option<&wgpu::PipelineCache>,
+    ) -> Pipeline {
+        assert!(
+            self.sample_count.is_power_of_two(),
+            "The sample count of a pipeline must be a power of two!"
+        );
+        let targets: Vec<_> = self
+            .color_targets
+            .iter()
+            .map(|target| Some(target.raw()))
+            .collect();
         let buffer_layouts: &[wgpu::VertexBufferLayout] =
             match (self.geometry_layout, self.instance_layout) {
                 (None, None) => panic!("Missing buffer layouts!"),
@@ -154,19 +313,21 @@ impl<'a> PipelineDescriptor<'a> {
                 layout: Some(self.pipeline_layout.raw()),
                 vertex: wgpu::VertexState {
                     module: self.shader.raw(),
-                    entry_point: Some("vs_main"),
-                    compilation_options: wgpu::PipelineCompilationOptions::default(),
+                    entry_point: Some(self.vertex_entry_point),
+                    compilation_options: wgpu::PipelineCompilationOptions {
+                        constants: &self.constants,
+                        ..Default::default()
+                    },
                     buffers: buffer_layouts,
                 },
-                fragment: Some(wgpu::FragmentState {
+                fragment: (!targets.is_empty()).then(|| wgpu::FragmentState {
                     module: self.shader.raw(),
-                    entry_point: Some("fs_main"),
-                    compilation_options: wgpu::PipelineCompilationOptions::default(),
-                    targets: &[Some(wgpu::ColorTargetState {
-                        format: TextureFormat::Standard.raw(),
-                        blend: Some(self.blend.raw()),
-                        write_mask: wgpu::ColorWrites::ALL,
-                    })],
+                    entry_point: Some(self.fragment_entry_point),
+                    compilation_options: wgpu::PipelineCompilationOptions {
+                        constants: &self.constants,
+                        ..Default::default()
+                    },
+                    targets: &targets,
                 }),
                 primitive: wgpu::PrimitiveState {
                     topology: self.primitive.raw(),
@@ -182,20 +343,53 @@ impl<'a> PipelineDescriptor<'a> {
                     conservative: false,
                 },
                 multisample: wgpu::MultisampleState {
-                    count: 1,
+                    count: self.sample_count,
                     mask: !0,
                     alpha_to_coverage_enabled: false,
                 },
                 depth_stencil: self.depth_function.map(|mode| wgpu::DepthStencilState {
-                    format: wgpu::TextureFormat::Depth24PlusStencil8,
-                    depth_write_enabled: true,
+                    format: self.depth_format.raw(),
+                    depth_write_enabled: self.depth_write,
                     depth_compare: mode.raw(),
                     stencil: wgpu::StencilState::default(),
                     bias: wgpu::DepthBiasState::default(),
                 }),
                 multiview: None,
-                cache: None,
+                cache,
             }),
+            id: ResourceId::next(),
+        }
+    }
+}
+
+impl<'a> ComputePipelineDescriptor<'a> {
+    /// Builds a new [`ComputePipeline`]
+    /// - `device` is the raw [`wgpu::Device`] which is needed to build GPU resources
+    pub fn build(self, device: &wgpu::Device) -> ComputePipeline {
+        self.build_with_cache(device, None)
+    }
+
+    /// Builds a new [`ComputePipeline`] using a driver-level [`wgpu::PipelineCache`]
+    /// - `device` is the raw [`wgpu::Device`] which is needed to build GPU resources
+    /// - `cache` is the optional [`wgpu::PipelineCache`] that lets the driver skip compilation
+    pub fn build_with_cache(
+        self,
+        device: &wgpu::Device,
+        cache: Option<&wgpu::PipelineCache>,
+    ) -> ComputePipeline {
+        ComputePipeline {
+            raw: device.create_compute_pipeline(&wgpu::ComputePipelineDescriptor {
+                label: self.label,
+                layout: Some(self.pipeline_layout.raw()),
+                module: self.shader.raw(),
+                entry_point: Some(self.entry_point),
+                compilation_options: wgpu::PipelineCompilationOptions {
+                    constants: &self.constants,
+                    ..Default::default()
+                },
+                cache,
+            }),
+            id: ResourceId::next(),
         }
     }
 }
@@ -211,6 +405,7 @@ impl<'a> PipelineLayoutDescriptor<'a> {
                 bind_group_layouts: Box::leak(layouts.into_boxed_slice()),
                 push_constant_ranges: &[],
             }),
+            id: ResourceId::next(),
         }
     }
 }
@@ -268,6 +463,18 @@ impl Blend {
     }
 }
 
+impl ColorTarget {
+    /// Maps the [`ColorTarget`] to the internal [`wgpu::ColorTargetState`]
+    fn raw(self) -> wgpu::ColorTargetState {
+        let is_integer = matches!(self.format, TextureFormat::Signed | TextureFormat::Unsigned);
+        wgpu::ColorTargetState {
+            format: self.format.raw(),
+            blend: (!is_integer).then(|| self.blend.raw()),
+            write_mask: wgpu::ColorWrites::ALL,
+        }
+    }
+}
+
 impl CompareFunction {
     /// Maps the [`CompareFunction`] to the internal [`wgpu::CompareFunction`]
     fn raw(self) -> wgpu::CompareFunction {
@@ -296,6 +503,14 @@ pub struct PipelineBuilder<'a> {
     primitive: Option<Primitive>,
     geometry_layout: Option<BufferLayout>,
     instance_layout: Option<BufferLayout>,
+    color_targets: Vec<ColorTarget>,
+    depth_only: bool,
+    sample_count: Option<u32>,
+    depth_format: Option<TextureFormat>,
+    depth_write: Option<bool>,
+    vertex_entry_point: Option<&'a str>,
+    fragment_entry_point: Option<&'a str>,
+    constants: Vec<(&'a str, f64)>,
 }
 
 impl<'a> PipelineBuilder<'a> {
@@ -358,20 +573,155 @@ impl<'a> PipelineBuilder<'a> {
         self
     }
 
+    /// Adds a color target, in the order of the fragment shader output locations
+    ///
+    /// Without any color targets, the pipeline renders to a single [`TextureFormat::Standard`]
+    /// target with the blend mode set by [`PipelineBuilder::blend()`].
+    pub fn color_target(mut self, target: ColorTarget) -> Self {
+        self.color_targets.push(target);
+        self
+    }
+
+    /// Makes the pipeline render only depth, without any color targets or fragment stage
+    pub fn depth_only(mut self) -> Self {
+        self.depth_only = true;
+        self
+    }
+
+    /// Sets the amount of samples per pixel for MSAA, defaults to 1
+    pub fn sample_count(mut self, sample_count: u32) -> Self {
+        self.sample_count = Some(sample_count);
+        self
+    }
+
+    /// Sets the format of the depth/stencil attachment, defaults to [`TextureFormat::DepthStencil`]
+    pub fn depth_format(mut self, format: TextureFormat) -> Self {
+        self.depth_format = Some(format);
+        self
+    }
+
+    /// Sets whether fragments write their depth, defaults to `true`
+    pub fn depth_write(mut self, depth_write: bool) -> Self {
+        self.depth_write = Some(depth_write);
+        self
+    }
+
+    /// Sets the vertex shader entry point, defaults to `vs_main`
+    pub fn vertex_entry_point(mut self, entry_point: &'a str) -> Self {
+        self.vertex_entry_point = Some(entry_point);
+        self
+    }
+
+    /// Sets the fragment shader entry point, defaults to `fs_main`
+    pub fn fragment_entry_point(mut self, entry_point: &'a str) -> Self {
+        self.fragment_entry_point = Some(entry_point);
+        self
+    }
+
+    /// Sets the value of a WGSL `override` constant, which specializes the shader
+    /// without preprocessing it into a separate module
+    /// - `name` -> the name or numeric id of the constant
+    /// - `value` -> the value, converted to the type of the constant
+    pub fn constant(mut self, name: &'a str, value: f64) -> Self {
+        self.constants.push((name, value));
+        self
+    }
+
     pub fn build(self, device: &wgpu::Device) -> Pipeline {
+        self.descriptor().build(device)
+    }
+
+    /// Builds a [`Pipeline`] through a [`PipelineCache`],
+    /// returning the already built pipeline if one with the same state exists
+    pub fn build_cached(self, device: &wgpu::Device, cache: &mut PipelineCache) -> Arc<Pipeline> {
+        cache.get_or_build(device, self.descriptor())
+    }
+
+    /// Returns the [`PipelineDescriptor`] described by this builder
+    pub fn descriptor(self) -> PipelineDescriptor<'a> {
+        let color_targets = if self.depth_only {
+            Vec::new()
+        } else if self.color_targets.is_empty() {
+            vec![ColorTarget {
+                format: TextureFormat::Standard,
+                blend: self.blend.expect("Missing blend mode in pipeline"),
+            }]
+        } else {
+            self.color_targets
+        };
         PipelineDescriptor {
             label: self.label,
             shader: self.shader.expect("Missing shader in pipeline"),
+            vertex_entry_point: self.vertex_entry_point.unwrap_or("vs_main"),
+            fragment_entry_point: self.fragment_entry_point.unwrap_or("fs_main"),
+            constants: self.constants,
             pipeline_layout: self.layout.expect("Missing layout in pipeline"),
             geometry_layout: self.geometry_layout,
             instance_layout: self.instance_layout,
             draw: self.draw.expect("Missing draw mode in pipeline"),
             cull: self.cull.expect("Missing cull mode in pipeline"),
-            blend: self.blend.expect("Missing blend mode in pipeline"),
+            color_targets,
+            sample_count: self.sample_count.unwrap_or(1),
             depth_function: self.depth_function,
+            depth_format: self.depth_format.unwrap_or(TextureFormat::DepthStencil),
+            depth_write: self.depth_write.unwrap_or(true),
             winding: self.winding.unwrap_or(Winding::Clockwise),
             primitive: self.primitive.unwrap_or(Primitive::TriangleList),
         }
+    }
+}
+
+#[derive(Debug, Default)]
+pub struct ComputePipelineBuilder<'a> {
+    label: Option<&'a str>,
+    shader: Option<&'a Shader>,
+    layout: Option<&'a PipelineLayout>,
+    entry_point: Option<&'a str>,
+    constants: Vec<(&'a str, f64)>,
+}
+
+impl<'a> ComputePipelineBuilder<'a> {
+    pub fn new() -> Self {
+        Default::default()
+    }
+
+    pub fn label(mut self, label: &'a str) -> Self {
+        self.label = Some(label);
+        self
+    }
+
+    pub fn shader(mut self, shader: &'a Shader) -> Self {
+        self.shader = Some(shader);
+        self
+    }
+
+    pub fn layout(mut self, layout: &'a PipelineLayout) -> Self {
+        self.layout = Some(layout);
+        self
+    }
+
+    /// Sets the compute shader entry point, defaults to `cs_main`
+    pub fn entry_point(mut self, entry_point: &'a str) -> Self {
+        self.entry_point = Some(entry_point);
+        self
+    }
+
+    /// Sets the value of a WGSL `override` constant, e.g. a workgroup size
+    /// - `name` -> the name or numeric id of the constant
+    /// - `value` -> the value, converted to the type of the constant
+    pub fn constant(mut self, name: &'a str, value: f64) -> Self {
+        self.constants.push((name, value));
+        self
+    }
+
+    pub fn build(self, device: &wgpu::Device) -> ComputePipeline {
+        ComputePipelineDescriptor {
+            label: self.label,
+            shader: self.shader.expect("Missing shader in compute pipeline"),
+            pipeline_layout: self.layout.expect("Missing layout in compute pipeline"),
+            entry_point: self.entry_point.unwrap_or("cs_main"),
+            constants: self.constants,
+        }
         .build(device)
     }
 }
@@ -0,0 +1,481 @@
+use std::{collections::HashMap, hash::Hash};
+
+use bytemuck::Pod;
+
+use crate::graphics::{
+    buffer::{BufferHandle, BufferStorage, BufferUsage},
+    texture::{
+        MipPolicy, Texture, TextureDescriptor, TextureDimension, TextureError, TextureFormat,
+        TextureSource, TextureUsage,
+    },
+};
+
+/// The smallest buffer the pool allocates, smaller requests share its size class
+const MIN_BUFFER_SIZE: u64 = 256;
+/// The default amount of frames an idle resource is kept before it gets evicted
+const DEFAULT_MAX_AGE: u32 = 8;
+
+/// Describes a pool of transient textures and buffers, which are recycled between frames
+/// instead of being created and dropped every frame
+///
+/// Per-frame intermediates (bloom chains, shadow maps, scratch buffers) are leased from
+/// the pool and released back to it once they aren't needed anymore. A released resource
+/// is handed out again to a matching request (same size, format and usage) once
+/// `frames_in_flight` frames have passed, so the GPU is done with the previous user.
+/// Idle resources that no request matched for `max_age` frames are evicted,
+/// e.g. the render targets of the size before a window resize.
+///
+/// ```rust
+/// let mut pool = ResourcePool::new(2);
+/// // Every frame
+/// pool.begin_frame();
+/// let bloom = pool.texture(&device, &queue, &TransientTextureDescriptor {
+///     label: Some("Bloom"),
+///     width: width / 2,
+///     height: height / 2,
+///     dimension: TextureDimension::D2,
+///     format: TextureFormat::HalfFloat,
+///     usage: TextureUsage::SampledAttachment { is_writable: false, is_readable: false },
+/// })?;
+/// render_bloom(&mut encoder, &bloom);
+/// pool.release_texture(bloom);
+/// ```
+///
+/// Recycled textures are not cleared and recycled buffers are empty, but may hold
+/// the data of their previous user on the GPU. Both keep the label they were created with.
+#[derive(Debug)]
+pub struct ResourcePool {
+    /// The idle textures
+    textures: Recycler<TextureKey, Texture>,
+    /// The idle buffers
+    buffers: Recycler<BufferKey, wgpu::Buffer>,
+    /// The current frame
+    frame: u64,
+    /// The amount of frames a released resource waits before it is handed out again
+    frames_in_flight: u64,
+    /// The amount of frames an idle resource is kept before it gets evicted
+    max_age: u64,
+    /// The requests that were served with an idle resource
+    hits: u64,
+    /// The requests that had to create a new resource
+    misses: u64,
+    /// The idle resources that were evicted
+    evictions: u64,
+}
+
+/// Describes a transient texture requested from a [`ResourcePool`]
+///
+/// The texture has a single mip level, depth and stencil formats get an empty depth
+/// (or stencil) buffer and every other format a blank texture.
+#[derive(Debug, Clone, Copy)]
+pub struct TransientTextureDescriptor<'a> {
+    /// The optional debugging label of the texture, if a new one has to be created
+    pub label: Option<&'a str>,
+    /// The width of the texture (in pixels)
+    pub width: u32,
+    /// The height of the texture (in pixels)
+    pub height: u32,
+    /// The dimension of the texture
+    pub dimension: TextureDimension,
+    /// The format of the texture
+    pub format: TextureFormat,
+    /// The usage of the texture
+    pub usage: TextureUsage,
+}
+
+/// Describes the statistics of a [`ResourcePool`]
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct PoolStats {
+    /// The requests that were served with an idle resource
+    pub hits: u64,
+    /// The requests that had to create a new resource
+    pub misses: u64,
+    /// The idle resources that were evicted
+    pub evictions: u64,
+    /// The amount of idle resources the pool holds
+    pub resident_count: usize,
+    /// The estimated GPU memory of the idle resources the pool holds (in bytes)
+    pub resident_bytes: u64,
+}
+
+/// Describes the properties a recycled texture has to match
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+struct TextureKey {
+    size: wgpu::Extent3d,
+    view_dimension: wgpu::TextureViewDimension,
+    format: wgpu::TextureFormat,
+    usage: wgpu::TextureUsages,
+    sample_count: u32,
+    mip_level_count: u32,
+}
+
+/// Describes the properties a recycled buffer has to match
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+struct BufferKey {
+    size: u64,
+    usage: wgpu::BufferUsages,
+}
+
+/// Keeps the idle resources of a kind sorted by their keys
+#[derive(Debug)]
+struct Recycler<K, T> {
+    /// The idle resources of every key
+    idle: HashMap<K, Vec<Idle<T>>>,
+    /// The amount of idle resources
+    len: usize,
+    /// The estimated GPU memory of the idle resources (in bytes)
+    bytes: u64,
+}
+
+/// Describes an idle resource
+#[derive(Debug)]
+struct Idle<T> {
+    resource: T,
+    /// The estimated GPU memory of the resource (in bytes)
+    bytes: u64,
+    /// The frame the resource was released in
+    released: u64,
+}
+
+impl ResourcePool {
+    /// Creates a new, empty [`ResourcePool`]
+    /// - `frames_in_flight` -> the amount of frames a released resource waits
+    ///   before it is handed out again, usually the amount of frames the CPU records ahead
+    pub fn new(frames_in_flight: u32) -> Self {
+        Self {
+            textures: Recycler::new(),
+            buffers: Recycler::new(),
+            frame: 0,
+            frames_in_flight: frames_in_flight as u64,
+            max_age: DEFAULT_MAX_AGE as u64,
+            hits: 0,
+            misses: 0,
+            evictions: 0,
+        }
+    }
+
+    /// Sets the amount of frames an idle resource is kept before it gets evicted,
+    /// once it could be handed out again (8 frames by default)
+    pub fn set_max_age(&mut self, max_age: u32) {
+        self.max_age = max_age as u64;
+    }
+
+    /// Returns the amount of frames an idle resource is kept before it gets evicted
+    pub fn max_age(&self) -> u32 {
+        self.max_age as u32
+    }
+
+    /// Starts a new frame, which ages every idle resource and evicts the ones that
+    /// weren't requested for too long, and returns the amount of evicted resources
+    pub fn begin_frame(&mut self) -> usize {
+        self.frame += 1;
+        let oldest = self
+            .frame
+            .saturating_sub(self.frames_in_flight + self.max_age);
+        let evicted = self.textures.evict(oldest) + self.buffers.evict(oldest);
+        self.evictions += evicted as u64;
+        evicted
+    }
+
+    /// Returns the current frame, counted by [`ResourcePool::begin_frame()`]
+    pub fn frame(&self) -> u64 {
+        self.frame
+    }
+
+    /// Leases a transient texture, recycling an idle one if it matches,
+    /// returns a [`TextureError`] if a new texture had to be created and that failed
+    /// - `device` -> the [`wgpu::Device`] needed to create a new texture
+    /// - `queue` -> the [`wgpu::Queue`] needed to create a new texture
+    /// - `descriptor` -> the description of the texture
+    pub fn texture(
+        &mut self,
+        device: &wgpu::Device,
+        queue: &wgpu::Queue,
+        descriptor: &TransientTextureDescriptor,
+    ) -> Result<Texture, TextureError> {
+        let key = TextureKey::describe(descriptor);
+        if let Some(texture) = self.textures.take(&key, self.frame, self.frames_in_flight) {
+            self.hits += 1;
+            return Ok(texture);
+        }
+
+        self.misses += 1;
+        let (width, height) = (descriptor.width, descriptor.height);
+        let source = match descriptor.format {
+            TextureFormat::Depth => TextureSource::Depth { width, height },
+            TextureFormat::Stencil => TextureSource::Stencil { width, height },
+            TextureFormat::DepthStencil => TextureSource::DepthStencil { width, height },
+            format => TextureSource::Blank {
+                width,
+                height,
+                format,
+            },
+        };
+        TextureDescriptor {
+            label: descriptor.label,
+            dimension: descriptor.dimension,
+            usage: descriptor.usage,
+            source,
+            mipmaps: MipPolicy::None,
+        }
+        .build(device, queue)
+    }
+
+    /// Releases a texture back to the pool, which hands it out again
+    /// after `frames_in_flight` frames
+    /// - `texture` -> the texture, which doesn't have to come from the pool
+    pub fn release_texture(&mut self, texture: Texture) {
+        let bytes = texture_bytes(&texture);
+        self.textures
+            .put(TextureKey::of(&texture), texture, bytes, self.frame);
+    }
+
+    /// Leases an empty transient buffer that can hold at least `item_capacity` items,
+    /// recycling an idle one if it matches
+    /// - `device` -> the [`wgpu::Device`] needed to create a new buffer
+    /// - `item_capacity` -> the least amount of items the buffer can hold,
+    ///   which is rounded up to a power of two size class
+    /// - `usage` -> the usage of the buffer
+    /// - `storage` -> the [`BufferStorage`] mode of the buffer
+    /// - `label` -> the optional debugging label of the buffer, if a new one has to be created
+    ///
+    /// # Panics:
+    /// - If `item_capacity` is equal to zero.
+    /// - If `T` is a zero-sized type.
+    /// - If `storage` is [`BufferStorage::DiscardAfterCreate`], since a leased buffer has no contents.
+    pub fn buffer<T: Pod>(
+        &mut self,
+        device: &wgpu::Device,
+        item_capacity: usize,
+        usage: BufferUsage,
+        storage: BufferStorage,
+        label: Option<&str>,
+    ) -> BufferHandle<T> {
+        assert!(item_capacity > 0, "Item capacity cannot be zero!");
+        assert!(
+            size_of::<T>() > 0,
+            "Cannot lease a buffer of zero-sized items!"
+        );
+        let item_size = size_of::<T>() as u64;
+        let key = BufferKey {
+            size: buffer_size_class(item_capacity as u64 * item_size),
+            usage: usage.raw(),
+        };
+        let raw = match self.buffers.take(&key, self.frame, self.frames_in_flight) {
+            Some(raw) => {
+                self.hits += 1;
+                raw
+            }
+            None => {
+                self.misses += 1;
+                device.create_buffer(&wgpu::BufferDescriptor {
+                    label,
+                    size: key.size,
+                    usage: key.usage,
+                    mapped_at_creation: false,
+                })
+            }
+        };
+        BufferHandle::from_raw(raw, (key.size / item_size) as usize, usage, storage)
+    }
+
+    /// Releases a buffer back to the pool, which drops its items and hands it out again
+    /// after `frames_in_flight` frames
+    /// - `buffer` -> the buffer, which doesn't have to come from the pool
+    pub fn release_buffer<T: Pod>(&mut self, buffer: BufferHandle<T>) {
+        let raw = buffer.into_raw();
+        let key = BufferKey {
+            size: raw.size(),
+            usage: raw.usage(),
+        };
+        self.buffers.put(key, raw, key.size, self.frame);
+    }
+
+    /// Drops every idle resource right away, e.g. after a window resize
+    pub fn trim(&mut self) {
+        self.evictions += (self.textures.len + self.buffers.len) as u64;
+        self.textures.clear();
+        self.buffers.clear();
+    }
+
+    /// Returns the statistics of the pool
+    pub fn stats(&self) -> PoolStats {
+        PoolStats {
+            hits: self.hits,
+            misses: self.misses,
+            evictions: self.evictions,
+            resident_count: self.textures.len + self.buffers.len,
+            resident_bytes: self.textures.bytes + self.buffers.bytes,
+        }
+    }
+
+    /// Resets the hit, miss and eviction counters of the statistics, e.g. every frame
+    pub fn reset_stats(&mut self) {
+        self.hits = 0;
+        self.misses = 0;
+        self.evictions = 0;
+    }
+}
+
+impl TextureKey {
+    /// Returns the key of an existing texture
+    fn of(texture: &Texture) -> Self {
+        let raw = texture.raw();
+        Self {
+            size: raw.size(),
+            view_dimension: texture.view_dimension(),
+            format: raw.format(),
+            usage: raw.usage(),
+            sample_count: raw.sample_count(),
+            mip_level_count: raw.mip_level_count(),
+        }
+    }
+
+    /// Returns the key of the texture a descriptor builds
+    fn describe(descriptor: &TransientTextureDescriptor) -> Self {
+        Self {
+            size: wgpu::Extent3d {
+                width: descriptor.width,
+                height: descriptor.height,
+                depth_or_array_layers: descriptor.dimension.layer_count(),
+            },
+            view_dimension: descriptor.dimension.view_raw(),
+            format: descriptor.format.raw(),
+            usage: descriptor.usage.raw(),
+            sample_count: descriptor.dimension.sample_count(),
+            mip_level_count: 1,
+        }
+    }
+}
+
+impl<K: Eq + Hash, T> Recycler<K, T> {
+    /// Creates a new, empty [`Recycler`]
+    fn new() -> Self {
+        Self {
+            idle: HashMap::new(),
+            len: 0,
+            bytes: 0,
+        }
+    }
+
+    /// Takes an idle resource of the key that was released at least `frames_in_flight`
+    /// frames ago, if any
+    fn take(&mut self, key: &K, frame: u64, frames_in_flight: u64) -> Option<T> {
+        let list = self.idle.get_mut(key)?;
+        let position = list
+            .iter()
+            .position(|idle| idle.released + frames_in_flight <= frame)?;
+        let idle = list.swap_remove(position);
+        self.len -= 1;
+        self.bytes -= idle.bytes;
+        Some(idle.resource)
+    }
+
+    /// Adds an idle resource of the key, released in `frame`
+    fn put(&mut self, key: K, resource: T, bytes: u64, frame: u64) {
+        self.idle.entry(key).or_default().push(Idle {
+            resource,
+            bytes,
+            released: frame,
+        });
+        self.len += 1;
+        self.bytes += bytes;
+    }
+
+    /// Drops every idle resource released before the `oldest` frame,
+    /// and returns the amount of dropped resources
+    fn evict(&mut self, oldest: u64) -> usize {
+        let mut evicted = 0;
+        let mut evicted_bytes = 0;
+        self.idle.retain(|_, list| {
+            list.retain(|idle| {
+                let is_kept = idle.released >= oldest;
+                if !is_kept {
+                    evicted += 1;
+                    evicted_bytes += idle.bytes;
+                }
+                is_kept
+            });
+            !list.is_empty()
+        });
+        self.len -= evicted;
+        self.bytes -= evicted_bytes;
+        evicted
+    }
+
+    /// Drops every idle resource
+    fn clear(&mut self) {
+        self.idle.clear();
+        self.len = 0;
+        self.bytes = 0;
+    }
+}
+
+/// Returns the power of two size class of a buffer, which is at least [`MIN_BUFFER_SIZE`]
+fn buffer_size_class(size: u64) -> u64 {
+    size.next_power_of_two().max(MIN_BUFFER_SIZE)
+}
+
+/// Returns the estimated GPU memory of a texture (in bytes), including every mip level
+fn texture_bytes(texture: &Texture) -> u64 {
+    let raw = texture.raw();
+    let format = raw.format();
+    let (block_width, block_height) = format.block_dimensions();
+    // Combined depth + stencil formats have no single copy size, they're estimated at 4 bytes
+    let block_size = format.block_copy_size(None).unwrap_or(4) as u64;
+    let size = raw.size();
+    let layers = match raw.dimension() {
+        wgpu::TextureDimension::D3 => 1,
+        _ => size.depth_or_array_layers as u64,
+    };
+    (0..raw.mip_level_count())
+        .map(|level| {
+            let width = (size.width >> level).max(1).div_ceil(block_width) as u64;
+            let height = (size.height >> level).max(1).div_ceil(block_height) as u64;
+            let depth = match raw.dimension() {
+                wgpu::TextureDimension::D3 => (size.depth_or_array_layers >> level).max(1) as u64,
+                _ => 1,
+            };
+            width * height * depth * block_size
+        })
+        .sum::<u64>()
+        * layers
+        * raw.sample_count() as u64
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn released_resources_wait_for_frames_in_flight() {
+        let mut recycler = Recycler::new();
+        recycler.put("shadow", 1, 64, 10);
+        assert_eq!(recycler.take(&"shadow", 11, 2), None);
+        assert_eq!(recycler.take(&"bloom", 12, 2), None);
+        assert_eq!(recycler.take(&"shadow", 12, 2), Some(1));
+        assert_eq!(recycler.take(&"shadow", 12, 2), None);
+        assert_eq!((recycler.len, recycler.bytes), (0, 0));
+    }
+
+    #[test]
+    fn idle_resources_get_evicted_by_age() {
+        let mut recycler = Recycler::new();
+        recycler.put("old", 1, 64, 3);
+        recycler.put("new", 2, 32, 5);
+        recycler.put("new", 3, 32, 7);
+        assert_eq!(recycler.evict(5), 1);
+        assert_eq!((recycler.len, recycler.bytes), (2, 64));
+        assert_eq!(recycler.take(&"old", 10, 0), None);
+        assert_eq!(recycler.evict(8), 2);
+        assert!(recycler.idle.is_empty());
+    }
+
+    #[test]
+    fn buffer_sizes_are_rounded_to_size_classes() {
+        assert_eq!(buffer_size_class(1), MIN_BUFFER_SIZE);
+        assert_eq!(buffer_size_class(256), 256);
+        assert_eq!(buffer_size_class(257), 512);
+        assert_eq!(buffer_size_class(3000), 4096);
+    }
+}
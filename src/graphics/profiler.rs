@@ -0,0 +1,626 @@
+use std::{error::Error, fmt, time::Duration};
+
+use crate::graphics::readback::{MapState, MapStatus};
+
+/// The default amount of frames whose queries can be in flight at once.
+pub const DEFAULT_FRAMES_IN_FLIGHT: usize = 3;
+
+/// The default amount of scopes that can be profiled in a single frame.
+pub const DEFAULT_MAX_SCOPES: u32 = 32;
+
+/// The amount of values a single pipeline statistics query resolves to,
+/// see [`PipelineStatistics`]
+const STATISTICS_PER_QUERY: u64 = 5;
+
+/// Measures how long passes take on the GPU, with timestamp queries written at
+/// the beginning and end of every profiled pass.
+///
+/// Every profiled pass is a named scope, opened with [`GpuProfiler::scope()`] and handed to the
+/// pass through [`crate::graphics::pass::RenderPassDescriptor::profiler_scope`]
+/// (or [`crate::graphics::pass::ComputePassDescriptor::profiler_scope`]).
+///
+/// The queries are resolved into a readback buffer that's mapped asynchronously,
+/// so the results of a frame become available a few frames later, once the GPU is done with it.
+/// Each frame in flight has its own query sets and buffers, so recording never waits
+/// on a previous readback, if every frame is still in flight, the frame is not profiled.
+///
+/// ```rust
+/// let mut profiler = GpuProfiler::new(&device, &queue, ProfilerDescriptor::default())?;
+/// // Every frame
+/// profiler.begin_frame();
+/// let pass = RenderPassDescriptor {
+///     label: Some("Main pass"),
+///     color_attachments: &[ColorAttachment::clear(&frame, Color::BLACK)],
+///     depth_stencil_attachment: None,
+///     profiler_scope: profiler.scope("Main pass"),
+///     occlusion_query_set: None,
+/// }
+/// .build(&mut encoder);
+/// ...
+/// drop(pass);
+/// profiler.resolve(&mut encoder);
+/// queue.submit([encoder.finish()]);
+/// profiler.end_frame();
+///
+/// if let Some(profile) = profiler.latest() {
+///     for scope in &profile.scopes {
+///         println!("{}: {:?}", scope.label, scope.duration);
+///     }
+/// }
+/// ```
+///
+/// Like every readback, a frame's results only arrive after the device has been polled,
+/// see [`crate::graphics::readback::ReadbackPool`].
+#[derive(Debug)]
+pub struct GpuProfiler {
+    /// The query sets and buffers of every frame in flight
+    frames: Vec<ProfilerFrame>,
+    /// The index into `frames` of the frame being recorded, if it's profiled
+    current: Option<usize>,
+    /// The amount of scopes a single frame can hold
+    max_scopes: u32,
+    /// The amount of nanoseconds a single timestamp tick takes
+    timestamp_period: f32,
+    /// Whether pipeline statistics are queried alongside the timestamps
+    pipeline_statistics: bool,
+    /// The index of the next frame
+    next_frame: u64,
+    /// The results of the most recent frame that finished reading back
+    latest: Option<FrameProfile>,
+    /// The counters of the profiler itself
+    stats: ProfilerStats,
+}
+
+/// Describes a [`GpuProfiler`]
+#[derive(Debug, Clone, Copy)]
+pub struct ProfilerDescriptor<'a> {
+    /// The optional debugging label of the query sets and buffers
+    pub label: Option<&'a str>,
+    /// The amount of frames whose queries can be in flight at once
+    pub frames_in_flight: usize,
+    /// The amount of scopes that can be profiled in a single frame
+    pub max_scopes: u32,
+    /// Whether to query pipeline statistics for every scope,
+    /// this only takes effect if the device has [`wgpu::Features::PIPELINE_STATISTICS_QUERY`]
+    pub pipeline_statistics: bool,
+}
+
+/// A named scope of a [`GpuProfiler`], handed to a single pass
+///
+/// The scope borrows the query sets of the profiler, so it has to be given to a pass
+/// before the next scope is opened.
+#[derive(Debug, Clone, Copy)]
+pub struct ProfilerScope<'a> {
+    /// The query set the timestamps are written to
+    timestamps: &'a wgpu::QuerySet,
+    /// The index of the timestamp written at the beginning of the pass,
+    /// the end timestamp follows right after it
+    timestamp_index: u32,
+    /// The query set and index of the pipeline statistics query, if enabled
+    statistics: Option<(&'a wgpu::QuerySet, u32)>,
+}
+
+/// The results of a single profiled frame
+#[derive(Debug, Clone, Default, PartialEq)]
+pub struct FrameProfile {
+    /// The index of the frame, counted by [`GpuProfiler::begin_frame()`]
+    pub frame: u64,
+    /// The results of every scope of the frame, in the order they were opened
+    pub scopes: Vec<ScopeProfile>,
+}
+
+/// The results of a single profiled scope
+#[derive(Debug, Clone, Default, PartialEq)]
+pub struct ScopeProfile {
+    /// The name the scope was opened with
+    pub label: String,
+    /// How long the pass took on the GPU
+    pub duration: Duration,
+    /// The pipeline statistics of the pass, if they were queried
+    pub statistics: Option<PipelineStatistics>,
+}
+
+/// The pipeline statistics of a single pass
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct PipelineStatistics {
+    /// How many times the vertex shader was invoked
+    pub vertex_shader_invocations: u64,
+    /// How many primitives reached the clipper
+    pub clipper_invocations: u64,
+    /// How many primitives were output by the clipper
+    pub clipper_primitives_out: u64,
+    /// How many times the fragment shader was invoked
+    pub fragment_shader_invocations: u64,
+    /// How many times the compute shader was invoked
+    pub compute_shader_invocations: u64,
+}
+
+/// Describes the counters of a [`GpuProfiler`]
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct ProfilerStats {
+    /// How many frames were profiled and read back
+    pub frames_resolved: u64,
+    /// How many frames weren't profiled because every frame was still in flight
+    pub frames_skipped: u64,
+    /// How many scopes weren't profiled because the frame was out of scopes
+    pub scopes_dropped: u64,
+}
+
+/// Specifies a profiler error that may have occurred.
+#[derive(Debug)]
+pub enum ProfilerError {
+    /// The device doesn't support the queries the profiler needs
+    UnsupportedFeatures {
+        /// The device features the profiler requires
+        required_features: wgpu::Features,
+    },
+}
+
+/// The query sets and buffers of a single frame in flight
+#[derive(Debug)]
+struct ProfilerFrame {
+    timestamps: wgpu::QuerySet,
+    statistics: Option<wgpu::QuerySet>,
+    /// The buffer the queries are resolved into
+    resolve: wgpu::Buffer,
+    /// The buffer the resolved queries are copied into and mapped
+    readback: wgpu::Buffer,
+    /// The labels of the scopes recorded in this frame
+    labels: Vec<String>,
+    /// The index of the frame being recorded in this slot
+    frame: u64,
+    state: FrameState,
+    /// The state of the mapping of the readback buffer
+    mapped: MapState,
+}
+
+/// Describes where a frame in flight currently is
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum FrameState {
+    /// The frame can be recorded into
+    Idle,
+    /// Scopes are being recorded into the frame
+    Recording,
+    /// The resolve commands of the frame have been recorded, but not submitted yet
+    Resolved,
+    /// The readback buffer of the frame is being mapped
+    Mapping,
+}
+
+impl GpuProfiler {
+    /// Creates a new profiler
+    ///
+    /// # Panics:
+    /// - If `frames_in_flight` or `max_scopes` is equal to zero.
+    ///
+    /// # Errors:
+    /// - If the device doesn't have [`wgpu::Features::TIMESTAMP_QUERY`].
+    pub fn new(
+        device: &wgpu::Device,
+        queue: &wgpu::Queue,
+        desc: ProfilerDescriptor,
+    ) -> Result<Self, ProfilerError> {
+        assert!(
+            desc.frames_in_flight > 0,
+            "Frames in flight of a profiler cannot be zero!"
+        );
+        assert!(
+            desc.max_scopes > 0,
+            "Max scopes of a profiler cannot be zero!"
+        );
+        if !device.features().contains(wgpu::Features::TIMESTAMP_QUERY) {
+            return Err(ProfilerError::UnsupportedFeatures {
+                required_features: wgpu::Features::TIMESTAMP_QUERY,
+            });
+        }
+        let pipeline_statistics = desc.pipeline_statistics
+            && device
+                .features()
+                .contains(wgpu::Features::PIPELINE_STATISTICS_QUERY);
+
+        let layout = ReadbackLayout::new(desc.max_scopes, pipeline_statistics);
+        let frames = (0..desc.frames_in_flight)
+            .map(|_| ProfilerFrame {
+                timestamps: device.create_query_set(&wgpu::QuerySetDescriptor {
+                    label: desc.label,
+                    ty: wgpu::QueryType::Timestamp,
+                    count: desc.max_scopes * 2,
+                }),
+                statistics: pipeline_statistics.then(|| {
+                    device.create_query_set(&wgpu::QuerySetDescriptor {
+                        label: desc.label,
+                        ty: wgpu::QueryType::PipelineStatistics(
+                            wgpu::PipelineStatisticsTypes::all(),
+                        ),
+                        count: desc.max_scopes,
+                    })
+                }),
+                resolve: device.create_buffer(&wgpu::BufferDescriptor {
+                    label: desc.label,
+                    size: layout.size,
+                    usage: wgpu::BufferUsages::QUERY_RESOLVE | wgpu::BufferUsages::COPY_SRC,
+                    mapped_at_creation: false,
+                }),
+                readback: device.create_buffer(&wgpu::BufferDescriptor {
+                    label: desc.label,
+                    size: layout.size,
+                    usage: wgpu::BufferUsages::MAP_READ | wgpu::BufferUsages::COPY_DST,
+                    mapped_at_creation: false,
+                }),
+                labels: Vec::with_capacity(desc.max_scopes as usize),
+                frame: 0,
+                state: FrameState::Idle,
+                mapped: MapState::new(),
+            })
+            .collect();
+
+        Ok(Self {
+            frames,
+            current: None,
+            max_scopes: desc.max_scopes,
+            timestamp_period: queue.get_timestamp_period(),
+            pipeline_statistics,
+            next_frame: 0,
+            latest: None,
+            stats: ProfilerStats::default(),
+        })
+    }
+
+    /// Begins profiling a new frame, collecting the results of every frame
+    /// that has finished reading back since the last call
+    ///
+    /// If the frame slot this frame would use is still in flight, the frame is not profiled
+    /// and [`GpuProfiler::scope()`] returns [`None`] until the next frame.
+    ///
+    /// If the previous frame wasn't ended yet, it's ended first, see [`GpuProfiler::end_frame()`].
+    pub fn begin_frame(&mut self) {
+        // A frame that was never ended is ended here
+        self.end_frame();
+        self.collect();
+
+        let slot = (self.next_frame % self.frames.len() as u64) as usize;
+        let frame = &mut self.frames[slot];
+        if frame.state == FrameState::Idle {
+            frame.state = FrameState::Recording;
+            frame.frame = self.next_frame;
+            frame.labels.clear();
+            self.current = Some(slot);
+        } else {
+            self.stats.frames_skipped += 1;
+        }
+        self.next_frame += 1;
+    }
+
+    /// Opens a named scope in the current frame, to be handed to a single pass
+    ///
+    /// Returns [`None`] if the current frame isn't profiled or is out of scopes,
+    /// a pass given [`None`] simply isn't profiled.
+    pub fn scope(&mut self, label: &str) -> Option<ProfilerScope<'_>> {
+        let frame = &mut self.frames[self.current?];
+        if frame.labels.len() as u32 >= self.max_scopes {
+            self.stats.scopes_dropped += 1;
+            return None;
+        }
+        let index = frame.labels.len() as u32;
+        frame.labels.push(label.to_owned());
+        Some(ProfilerScope {
+            timestamps: &frame.timestamps,
+            timestamp_index: index * 2,
+            statistics: frame
+                .statistics
+                .as_ref()
+                .map(|statistics| (statistics, index)),
+        })
+    }
+
+    /// Records the commands that resolve the queries of the current frame into its readback buffer
+    ///
+    /// This has to be called after the last profiled pass of the frame has ended,
+    /// and the encoder has to be submitted before [`GpuProfiler::end_frame()`].
+    pub fn resolve(&mut self, encoder: &mut wgpu::CommandEncoder) {
+        let Some(current) = self.current else {
+            return;
+        };
+        let frame = &mut self.frames[current];
+        if frame.state != FrameState::Recording {
+            return;
+        }
+        let scope_count = frame.labels.len() as u32;
+        if scope_count == 0 {
+            frame.state = FrameState::Idle;
+            return;
+        }
+
+        let layout = ReadbackLayout::new(self.max_scopes, frame.statistics.is_some());
+        encoder.resolve_query_set(&frame.timestamps, 0..scope_count * 2, &frame.resolve, 0);
+        if let Some(statistics) = &frame.statistics {
+            encoder.resolve_query_set(
+                statistics,
+                0..scope_count,
+                &frame.resolve,
+                layout.statistics_offset,
+            );
+        }
+        encoder.copy_buffer_to_buffer(&frame.resolve, 0, &frame.readback, 0, layout.size);
+        frame.state = FrameState::Resolved;
+    }
+
+    /// Ends the current frame, mapping its readback buffer
+    ///
+    /// This has to be called after the encoder passed to [`GpuProfiler::resolve()`] was submitted.
+    pub fn end_frame(&mut self) {
+        let Some(current) = self.current.take() else {
+            return;
+        };
+        let frame = &mut self.frames[current];
+        match frame.state {
+            FrameState::Resolved => {
+                frame.state = FrameState::Mapping;
+                frame.mapped.map_read(frame.readback.slice(..));
+            }
+            // The frame wasn't resolved, so its queries are discarded
+            FrameState::Recording => frame.state = FrameState::Idle,
+            FrameState::Idle | FrameState::Mapping => {}
+        }
+    }
+
+    /// Collects the results of every frame that has finished reading back,
+    /// returns `true` if new results are available
+    ///
+    /// This is called by [`GpuProfiler::begin_frame()`], but can be called at any time
+    /// after polling the device.
+    pub fn collect(&mut self) -> bool {
+        let mut collected = false;
+        for index in 0..self.frames.len() {
+            let frame = &mut self.frames[index];
+            if frame.state != FrameState::Mapping {
+                continue;
+            }
+            match frame.mapped.status() {
+                MapStatus::Ready => {}
+                MapStatus::Failed => {
+                    frame.state = FrameState::Idle;
+                    continue;
+                }
+                MapStatus::Pending => continue,
+            }
+
+            let layout = ReadbackLayout::new(self.max_scopes, frame.statistics.is_some());
+            let scope_count = frame.labels.len();
+            let (timestamps, statistics) = {
+                let data = frame.readback.slice(..).get_mapped_range();
+                let timestamps: Vec<u64> =
+                    bytemuck::pod_collect_to_vec(&data[..scope_count * 2 * size_of::<u64>()]);
+                let statistics: Option<Vec<u64>> = frame.statistics.as_ref().map(|_| {
+                    let start = layout.statistics_offset as usize;
+                    let end =
+                        start + scope_count * STATISTICS_PER_QUERY as usize * size_of::<u64>();
+                    bytemuck::pod_collect_to_vec(&data[start..end])
+                });
+                (timestamps, statistics)
+            };
+            frame.readback.unmap();
+
+            let durations = scope_durations(&timestamps, self.timestamp_period);
+            let profile = FrameProfile {
+                frame: frame.frame,
+                scopes: frame
+                    .labels
+                    .drain(..)
+                    .zip(durations)
+                    .enumerate()
+                    .map(|(index, (label, duration))| ScopeProfile {
+                        label,
+                        duration,
+                        statistics: statistics.as_ref().map(|statistics| {
+                            let start = index * STATISTICS_PER_QUERY as usize;
+                            PipelineStatistics::from_raw(&statistics[start..])
+                        }),
+                    })
+                    .collect(),
+            };
+            frame.state = FrameState::Idle;
+            self.stats.frames_resolved += 1;
+            collected = true;
+
+            // Frames can finish out of order on some backends, only the newest one is kept
+            if self
+                .latest
+                .as_ref()
+                .is_none_or(|latest| latest.frame < profile.frame)
+            {
+                self.latest = Some(profile);
+            }
+        }
+        collected
+    }
+
+    /// Returns the results of the most recent frame that finished reading back
+    pub fn latest(&self) -> Option<&FrameProfile> {
+        self.latest.as_ref()
+    }
+
+    /// Returns `true` if pipeline statistics are queried alongside the timestamps
+    pub fn has_pipeline_statistics(&self) -> bool {
+        self.pipeline_statistics
+    }
+
+    /// Returns `true` if the current frame is being profiled
+    pub fn is_profiling(&self) -> bool {
+        self.current.is_some()
+    }
+
+    /// Returns the counters of the profiler
+    pub fn stats(&self) -> ProfilerStats {
+        self.stats
+    }
+}
+
+impl<'a> ProfilerScope<'a> {
+    /// Returns the timestamp writes of a render pass profiled by this scope
+    pub(crate) fn render_timestamp_writes(&self) -> wgpu::RenderPassTimestampWrites<'a> {
+        wgpu::RenderPassTimestampWrites {
+            query_set: self.timestamps,
+            beginning_of_pass_write_index: Some(self.timestamp_index),
+            end_of_pass_write_index: Some(self.timestamp_index + 1),
+        }
+    }
+
+    /// Returns the timestamp writes of a compute pass profiled by this scope
+    pub(crate) fn compute_timestamp_writes(&self) -> wgpu::ComputePassTimestampWrites<'a> {
+        wgpu::ComputePassTimestampWrites {
+            query_set: self.timestamps,
+            beginning_of_pass_write_index: Some(self.timestamp_index),
+            end_of_pass_write_index: Some(self.timestamp_index + 1),
+        }
+    }
+
+    /// Returns the query set and index of the pipeline statistics query, if enabled
+    pub(crate) fn statistics(&self) -> Option<(&'a wgpu::QuerySet, u32)> {
+        self.statistics
+    }
+}
+
+impl FrameProfile {
+    /// Returns the total GPU time of every scope in the frame
+    pub fn total(&self) -> Duration {
+        self.scopes.iter().map(|scope| scope.duration).sum()
+    }
+
+    /// Returns the results of the first scope with the label
+    pub fn scope(&self, label: &str) -> Option<&ScopeProfile> {
+        self.scopes.iter().find(|scope| scope.label == label)
+    }
+}
+
+impl PipelineStatistics {
+    /// Parses the statistics from the resolved query values, which are ordered
+    /// by the bits of [`wgpu::PipelineStatisticsTypes`]
+    fn from_raw(values: &[u64]) -> Self {
+        Self {
+            vertex_shader_invocations: values[0],
+            clipper_invocations: values[1],
+            clipper_primitives_out: values[2],
+            fragment_shader_invocations: values[3],
+            compute_shader_invocations: values[4],
+        }
+    }
+}
+
+impl Default for ProfilerDescriptor<'_> {
+    fn default() -> Self {
+        Self {
+            label: Some("GPU profiler"),
+            frames_in_flight: DEFAULT_FRAMES_IN_FLIGHT,
+            max_scopes: DEFAULT_MAX_SCOPES,
+            pipeline_statistics: false,
+        }
+    }
+}
+
+impl fmt::Display for ProfilerError {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        match self {
+            ProfilerError::UnsupportedFeatures { required_features } => {
+                write!(
+                    f,
+                    "Unsupported GPU profiler:\n\tRequires device features {:?}",
+                    required_features
+                )
+            }
+        }
+    }
+}
+
+impl Error for ProfilerError {}
+
+/// Describes where the resolved queries of a frame live in its readback buffer
+struct ReadbackLayout {
+    /// The offset of the pipeline statistics, aligned for resolving
+    statistics_offset: u64,
+    /// The size of the whole buffer
+    size: u64,
+}
+
+impl ReadbackLayout {
+    fn new(max_scopes: u32, pipeline_statistics: bool) -> Self {
+        let timestamps_size = max_scopes as u64 * 2 * wgpu::QUERY_SIZE as u64;
+        let statistics_offset =
+            timestamps_size.next_multiple_of(wgpu::QUERY_RESOLVE_BUFFER_ALIGNMENT);
+        let size = if pipeline_statistics {
+            statistics_offset + max_scopes as u64 * STATISTICS_PER_QUERY * wgpu::QUERY_SIZE as u64
+        } else {
+            timestamps_size
+        };
+        Self {
+            statistics_offset,
+            size,
+        }
+    }
+}
+
+/// Converts pairs of begin and end timestamps into durations
+/// - `timestamps` -> the begin and end timestamp of every scope, interleaved
+/// - `period` -> the amount of nanoseconds a single timestamp tick takes
+///
+/// A pair whose end is before its begin (e.g. an unwritten query) results in a zero duration.
+fn scope_durations(timestamps: &[u64], period: f32) -> Vec<Duration> {
+    timestamps
+        .chunks_exact(2)
+        .map(|pair| {
+            let ticks = pair[1].saturating_sub(pair[0]);
+            Duration::from_nanos((ticks as f64 * period as f64).round() as u64)
+        })
+        .collect()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn durations_scale_by_period() {
+        let durations = scope_durations(&[100, 350, 1000, 1000, 500, 200], 2.0);
+        assert_eq!(
+            durations,
+            [Duration::from_nanos(500), Duration::ZERO, Duration::ZERO]
+        );
+        let durations = scope_durations(&[0, 3], 0.5);
+        assert_eq!(durations, [Duration::from_nanos(2)]);
+    }
+
+    #[test]
+    fn statistics_follow_type_bits() {
+        let statistics = PipelineStatistics::from_raw(&[1, 2, 3, 4, 5, 6]);
+        assert_eq!(statistics.vertex_shader_invocations, 1);
+        assert_eq!(statistics.clipper_invocations, 2);
+        assert_eq!(statistics.clipper_primitives_out, 3);
+        assert_eq!(statistics.fragment_shader_invocations, 4);
+        assert_eq!(statistics.compute_shader_invocations, 5);
+    }
+
+    #[test]
+    fn frame_profile_lookup() {
+        let profile = FrameProfile {
+            frame: 4,
+            scopes: vec![
+                ScopeProfile {
+                    label: "Shadows".to_owned(),
+                    duration: Duration::from_micros(300),
+                    statistics: None,
+                },
+                ScopeProfile {
+                    label: "Main".to_owned(),
+                    duration: Duration::from_micros(900),
+                    statistics: None,
+                },
+            ],
+        };
+        assert_eq!(profile.total(), Duration::from_micros(1200));
+        assert_eq!(
+            profile.scope("Main").map(|scope| scope.duration),
+            Some(Duration::from_micros(900))
+        );
+        assert!(profile.scope("Bloom").is_none());
+    }
+}
@@ -0,0 +1,557 @@
+use std::{
+    error::Error,
+    fmt,
+    future::Future,
+    marker::PhantomData,
+    pin::Pin,
+    sync::{
+        Arc, Mutex,
+        atomic::{AtomicU8, Ordering},
+    },
+    task::{Context, Poll, Waker},
+};
+
+use bytemuck::Pod;
+
+/// The readback buffer is still being mapped
+const MAP_PENDING: u8 = 0;
+/// The readback buffer has been mapped and can be read
+const MAP_READY: u8 = 1;
+/// The readback buffer failed to map, the request is dropped
+const MAP_FAILED: u8 = 2;
+
+/// The smallest readback buffer the pool allocates, smaller requests share its size class
+const MIN_BUFFER_SIZE: u64 = 256;
+
+/// Describes a pool of reusable readback buffers, which reads data back from the GPU
+/// without ever blocking
+///
+/// Reads are recorded with [`crate::graphics::buffer::BufferHandle::read_async()`] and
+/// [`crate::graphics::texture::Texture::read_async()`], which copy the data into a pooled
+/// readback buffer and return a [`Readback`] handle. The pool is then used in 2 steps every frame:
+/// - Call [`ReadbackPool::map()`] after submitting the encoders the reads were recorded into
+/// - Call [`ReadbackPool::poll()`] once per frame, which completes every finished read
+///
+/// ```rust
+/// let mut pool = ReadbackPool::new();
+/// let picked = picking_buffer.read_async(&device, &mut encoder, &mut pool, 0..1);
+/// queue.submit([encoder.finish()]);
+/// pool.map();
+/// // Every frame
+/// pool.poll();
+/// if let Some(Ok(items)) = picked.try_take() {
+///     println!("Picked object {}", items[0]);
+/// }
+/// ```
+///
+/// The readback completes when the device is polled, which also happens on every
+/// `queue.submit()`, so a read usually completes a frame or two after it was recorded.
+/// Instead of checking [`Readback::try_take()`], a [`Readback`] can also be awaited
+/// or given a callback with [`Readback::on_ready()`].
+#[derive(Debug, Default)]
+pub struct ReadbackPool {
+    /// The readback buffers that are not in use
+    free: Vec<wgpu::Buffer>,
+    /// The requests whose copies were recorded, but not mapped yet
+    recorded: Vec<ReadbackRequest>,
+    /// The requests whose readback buffers are being mapped
+    mapping: Vec<ReadbackRequest>,
+}
+
+/// Describes a handle to data that is being read back from the GPU
+///
+/// The handle is completed by [`ReadbackPool::poll()`], dropping it doesn't cancel the read.
+#[derive(Debug)]
+pub struct Readback<T: Pod> {
+    slot: Arc<Mutex<ReadbackSlot>>,
+    _marker: PhantomData<T>,
+}
+
+/// Specifies the error of a failed readback
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum ReadbackError {
+    /// The readback buffer could not be mapped, e.g. because the device was lost
+    MapFailed,
+}
+
+/// Specifies the progress of an asynchronous read mapping
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub(crate) enum MapStatus {
+    /// The buffer is still being mapped
+    Pending,
+    /// The buffer has been mapped and can be read
+    Ready,
+    /// The buffer failed to map, its contents are dropped
+    Failed,
+}
+
+/// Tracks an asynchronous read mapping of a buffer, the state is shared with the map callback
+///
+/// Every GPU readback (readback pools, profilers, occlusion queries) maps its buffer through this.
+#[derive(Debug, Clone)]
+pub(crate) struct MapState {
+    state: Arc<AtomicU8>,
+}
+
+/// Describes a single copy into a readback buffer that is waiting to be read
+#[derive(Debug)]
+struct ReadbackRequest {
+    buffer: wgpu::Buffer,
+    /// The amount of bytes to map from the start of the buffer
+    size: u64,
+    /// Where the requested bytes are in the mapped bytes
+    layout: ReadbackLayout,
+    mapped: MapState,
+    slot: Arc<Mutex<ReadbackSlot>>,
+}
+
+/// Specifies where the requested bytes are in the mapped bytes of a readback buffer
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum ReadbackLayout {
+    /// The bytes are a contiguous range, starting at the offset
+    Contiguous { offset: usize, len: usize },
+    /// The bytes are rows of a texture, each padded to the row pitch
+    Rows {
+        row_len: usize,
+        row_pitch: usize,
+        rows: usize,
+    },
+}
+
+/// Describes the completion state of a [`Readback`], shared between the handle and the pool
+#[derive(Default)]
+struct ReadbackSlot {
+    /// The result, until it's taken
+    result: Option<Result<Vec<u8>, ReadbackError>>,
+    /// Whether the result has been taken out of the slot
+    taken: bool,
+    /// The waker of the task awaiting the readback
+    waker: Option<Waker>,
+    /// The callback that takes the result once it's completed
+    callback: Option<Box<dyn FnOnce(Result<Vec<u8>, ReadbackError>) + Send>>,
+}
+
+impl ReadbackPool {
+    /// Creates a new, empty [`ReadbackPool`]
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Records a copy of a range of a buffer into a readback buffer
+    /// - `device` is the raw [`wgpu::Device`] which is needed to build GPU resources
+    /// - `encoder` -> the command encoder that records the copy
+    /// - `source` -> the buffer to read from, which needs the [`wgpu::BufferUsages::COPY_SRC`] usage
+    /// - `offset` -> the offset of the bytes to read
+    /// - `len` -> the amount of bytes to read
+    ///
+    /// The copied range is widened to [`wgpu::COPY_BUFFER_ALIGNMENT`], only the requested bytes
+    /// are returned.
+    ///
+    /// # Panics:
+    /// - If the buffer can't be copied from.
+    /// - If the range exceeds the buffer.
+    /// - If the range ends in the last bytes of a buffer whose size isn't a multiple of
+    ///   [`wgpu::COPY_BUFFER_ALIGNMENT`], since they can't be copied.
+    pub(crate) fn read_buffer<T: Pod>(
+        &mut self,
+        device: &wgpu::Device,
+        encoder: &mut wgpu::CommandEncoder,
+        source: &wgpu::Buffer,
+        offset: u64,
+        len: u64,
+    ) -> Readback<T> {
+        assert!(
+            source.usage().contains(wgpu::BufferUsages::COPY_SRC),
+            "Buffer is not readable!"
+        );
+        assert!(
+            offset + len <= source.size(),
+            "Cannot read the items because the range exceeds the buffer!"
+        );
+        let (start, end) = aligned_range(offset, len, source.size()).expect(
+            "Cannot read the unaligned tail of a buffer whose size isn't a multiple of 4 bytes!",
+        );
+        let buffer = self.acquire(device, end - start);
+        if end > start {
+            encoder.copy_buffer_to_buffer(source, start, &buffer, 0, end - start);
+        }
+        self.push(
+            buffer,
+            end - start,
+            ReadbackLayout::Contiguous {
+                offset: (offset - start) as usize,
+                len: len as usize,
+            },
+        )
+    }
+
+    /// Records a copy of a rectangle of a single layer of the first mip level of a texture
+    /// into a readback buffer
+    /// - `device` is the raw [`wgpu::Device`] which is needed to build GPU resources
+    /// - `encoder` -> the command encoder that records the copy
+    /// - `source` -> the texture to read from, which needs the [`wgpu::TextureUsages::COPY_SRC`] usage
+    /// - `origin` -> the (x, y, layer) of the top left corner of the rectangle
+    /// - `size` -> the (width, height) of the rectangle (in pixels)
+    /// - `pixel_size` -> the size of a single pixel in bytes
+    ///
+    /// The rows are copied with a pitch aligned to [`wgpu::COPY_BYTES_PER_ROW_ALIGNMENT`],
+    /// the returned pixels are tightly packed.
+    pub(crate) fn read_texture(
+        &mut self,
+        device: &wgpu::Device,
+        encoder: &mut wgpu::CommandEncoder,
+        source: &wgpu::Texture,
+        origin: (u32, u32, u32),
+        size: (u32, u32),
+        pixel_size: u32,
+    ) -> Readback<u8> {
+        let (width, height) = size;
+        let row_len = width * pixel_size;
+        let row_pitch = row_len.next_multiple_of(wgpu::COPY_BYTES_PER_ROW_ALIGNMENT);
+        let buffer_size = row_pitch as u64 * height as u64;
+        let buffer = self.acquire(device, buffer_size);
+        let (x, y, z) = origin;
+        encoder.copy_texture_to_buffer(
+            wgpu::TexelCopyTextureInfo {
+                texture: source,
+                mip_level: 0,
+                origin: wgpu::Origin3d { x, y, z },
+                aspect: wgpu::TextureAspect::All,
+            },
+            wgpu::TexelCopyBufferInfo {
+                buffer: &buffer,
+                layout: wgpu::TexelCopyBufferLayout {
+                    offset: 0,
+                    bytes_per_row: Some(row_pitch),
+                    rows_per_image: Some(height),
+                },
+            },
+            wgpu::Extent3d {
+                width,
+                height,
+                depth_or_array_layers: 1,
+            },
+        );
+        self.push(
+            buffer,
+            buffer_size,
+            ReadbackLayout::Rows {
+                row_len: row_len as usize,
+                row_pitch: row_pitch as usize,
+                rows: height as usize,
+            },
+        )
+    }
+
+    /// Starts mapping the readback buffers of every recorded read
+    ///
+    /// This must be called after the encoders the reads were recorded into have been submitted.
+    pub fn map(&mut self) {
+        for request in self.recorded.drain(..) {
+            request.mapped.map_read(
+                request
+                    .buffer
+                    .slice(..request.size.max(wgpu::COPY_BUFFER_ALIGNMENT)),
+            );
+            self.mapping.push(request);
+        }
+    }
+
+    /// Completes every read whose readback buffer has been mapped, without waiting on the GPU,
+    /// returns how many reads were completed
+    ///
+    /// Callbacks registered with [`Readback::on_ready()`] are called from here.
+    pub fn poll(&mut self) -> usize {
+        let mut completed = 0;
+        let mut index = 0;
+        while index < self.mapping.len() {
+            let result = match self.mapping[index].mapped.status() {
+                MapStatus::Ready => {
+                    let request = self.mapping.swap_remove(index);
+                    let bytes = {
+                        let mapped = request
+                            .buffer
+                            .slice(..request.size.max(wgpu::COPY_BUFFER_ALIGNMENT))
+                            .get_mapped_range();
+                        request.layout.extract(&mapped)
+                    };
+                    request.buffer.unmap();
+                    self.free.push(request.buffer);
+                    (request.slot, Ok(bytes))
+                }
+                MapStatus::Failed => {
+                    // A buffer that failed to map is simply dropped
+                    let request = self.mapping.swap_remove(index);
+                    (request.slot, Err(ReadbackError::MapFailed))
+                }
+                MapStatus::Pending => {
+                    index += 1;
+                    continue;
+                }
+            };
+            let (slot, result) = result;
+            complete(&slot, result);
+            completed += 1;
+        }
+        completed
+    }
+
+    /// Returns the amount of reads that have not completed yet
+    pub fn pending_count(&self) -> usize {
+        self.recorded.len() + self.mapping.len()
+    }
+
+    /// Returns the amount of readback buffers that are not in use
+    pub fn free_count(&self) -> usize {
+        self.free.len()
+    }
+
+    /// Drops every readback buffer that is not in use
+    pub fn trim(&mut self) {
+        self.free.clear();
+    }
+
+    /// Returns a free readback buffer of at least `size` bytes, or creates a new one
+    fn acquire(&mut self, device: &wgpu::Device, size: u64) -> wgpu::Buffer {
+        let size = size.max(MIN_BUFFER_SIZE).next_power_of_two();
+        let best = self
+            .free
+            .iter()
+            .enumerate()
+            .filter(|(_, buffer)| buffer.size() >= size)
+            .min_by_key(|(_, buffer)| buffer.size())
+            .map(|(index, _)| index);
+        match best {
+            Some(index) => self.free.swap_remove(index),
+            None => device.create_buffer(&wgpu::BufferDescriptor {
+                label: Some("Readback buffer"),
+                size,
+                usage: wgpu::BufferUsages::MAP_READ | wgpu::BufferUsages::COPY_DST,
+                mapped_at_creation: false,
+            }),
+        }
+    }
+
+    /// Adds a recorded read and returns its handle
+    fn push<T: Pod>(
+        &mut self,
+        buffer: wgpu::Buffer,
+        size: u64,
+        layout: ReadbackLayout,
+    ) -> Readback<T> {
+        let slot = Arc::new(Mutex::new(ReadbackSlot::default()));
+        self.recorded.push(ReadbackRequest {
+            buffer,
+            size,
+            layout,
+            mapped: MapState::new(),
+            slot: slot.clone(),
+        });
+        Readback {
+            slot,
+            _marker: PhantomData,
+        }
+    }
+}
+
+impl MapState {
+    /// Creates a new [`MapState`], which is pending until a mapping completes
+    pub(crate) fn new() -> Self {
+        Self {
+            state: Arc::new(AtomicU8::new(MAP_PENDING)),
+        }
+    }
+
+    /// Starts mapping `slice` for reading, resetting the status to pending,
+    /// the mapping completes once the device is polled (see [`ReadbackPool`])
+    pub(crate) fn map_read(&self, slice: wgpu::BufferSlice) {
+        self.state.store(MAP_PENDING, Ordering::Release);
+        let state = Arc::clone(&self.state);
+        slice.map_async(wgpu::MapMode::Read, move |result| {
+            let status = if result.is_ok() {
+                MAP_READY
+            } else {
+                MAP_FAILED
+            };
+            state.store(status, Ordering::Release);
+        });
+    }
+
+    /// Returns the progress of the most recent mapping
+    pub(crate) fn status(&self) -> MapStatus {
+        match self.state.load(Ordering::Acquire) {
+            MAP_READY => MapStatus::Ready,
+            MAP_FAILED => MapStatus::Failed,
+            _ => MapStatus::Pending,
+        }
+    }
+}
+
+impl<T: Pod> Readback<T> {
+    /// Returns `true` if the read has completed and the result has not been taken yet
+    pub fn is_ready(&self) -> bool {
+        self.lock().result.is_some()
+    }
+
+    /// Takes the result of the read if it has completed, returns [`None`] otherwise
+    /// or if the result has already been taken
+    pub fn try_take(&self) -> Option<Result<Vec<T>, ReadbackError>> {
+        let mut slot = self.lock();
+        let result = slot.result.take()?;
+        slot.taken = true;
+        Some(result.map(|bytes| cast_bytes(&bytes)))
+    }
+
+    /// Calls `callback` with the result once the read completes, from [`ReadbackPool::poll()`],
+    /// or right away if it has already completed
+    ///
+    /// The callback is not called if the result has already been taken.
+    pub fn on_ready(self, callback: impl FnOnce(Result<Vec<T>, ReadbackError>) + Send + 'static) {
+        let mut slot = self.lock();
+        if let Some(result) = slot.result.take() {
+            slot.taken = true;
+            drop(slot);
+            callback(result.map(|bytes| cast_bytes(&bytes)));
+        } else if !slot.taken {
+            slot.callback = Some(Box::new(move |result| {
+                callback(result.map(|bytes| cast_bytes(&bytes)))
+            }));
+        }
+    }
+
+    /// Locks the shared slot
+    fn lock(&self) -> std::sync::MutexGuard<'_, ReadbackSlot> {
+        // The slot is never left in an invalid state, so a poisoned lock is still usable
+        self.slot.lock().unwrap_or_else(|error| error.into_inner())
+    }
+}
+
+impl<T: Pod> Future for Readback<T> {
+    type Output = Result<Vec<T>, ReadbackError>;
+
+    /// Resolves once the read completes, the future never resolves if the result has
+    /// already been taken
+    fn poll(self: Pin<&mut Self>, context: &mut Context<'_>) -> Poll<Self::Output> {
+        let mut slot = self.lock();
+        match slot.result.take() {
+            Some(result) => {
+                slot.taken = true;
+                Poll::Ready(result.map(|bytes| cast_bytes(&bytes)))
+            }
+            None => {
+                slot.waker = Some(context.waker().clone());
+                Poll::Pending
+            }
+        }
+    }
+}
+
+impl ReadbackLayout {
+    /// Extracts the requested bytes out of the mapped bytes
+    fn extract(self, mapped: &[u8]) -> Vec<u8> {
+        match self {
+            ReadbackLayout::Contiguous { offset, len } => mapped[offset..offset + len].to_vec(),
+            ReadbackLayout::Rows {
+                row_len,
+                row_pitch,
+                rows,
+            } => {
+                let mut bytes = Vec::with_capacity(row_len * rows);
+                for row in mapped.chunks(row_pitch).take(rows) {
+                    bytes.extend_from_slice(&row[..row_len]);
+                }
+                bytes
+            }
+        }
+    }
+}
+
+impl fmt::Debug for ReadbackSlot {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("ReadbackSlot")
+            .field("result", &self.result)
+            .field("taken", &self.taken)
+            .field("has_callback", &self.callback.is_some())
+            .finish()
+    }
+}
+
+impl fmt::Display for ReadbackError {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match self {
+            ReadbackError::MapFailed => write!(f, "Failed to map the readback buffer"),
+        }
+    }
+}
+
+impl Error for ReadbackError {}
+
+/// Completes the slot with the result, by calling its callback or by storing the result
+/// and waking the task awaiting it
+fn complete(slot: &Mutex<ReadbackSlot>, result: Result<Vec<u8>, ReadbackError>) {
+    let mut slot = slot.lock().unwrap_or_else(|error| error.into_inner());
+    match slot.callback.take() {
+        Some(callback) => {
+            slot.taken = true;
+            drop(slot);
+            callback(result);
+        }
+        None => {
+            slot.result = Some(result);
+            if let Some(waker) = slot.waker.take() {
+                waker.wake();
+            }
+        }
+    }
+}
+
+/// Widens the byte range to [`wgpu::COPY_BUFFER_ALIGNMENT`], returns the (start, end)
+/// of the range to copy, [`None`] if the widened range exceeds the buffer
+fn aligned_range(offset: u64, len: u64, buffer_size: u64) -> Option<(u64, u64)> {
+    let start = offset - offset % wgpu::COPY_BUFFER_ALIGNMENT;
+    let end = (offset + len).next_multiple_of(wgpu::COPY_BUFFER_ALIGNMENT);
+    (end <= buffer_size).then_some((start, end))
+}
+
+/// Copies the bytes into a list of items, the bytes don't have to be aligned
+fn cast_bytes<T: Pod>(bytes: &[u8]) -> Vec<T> {
+    let mut items = vec![T::zeroed(); bytes.len() / size_of::<T>()];
+    bytemuck::cast_slice_mut(&mut items).copy_from_slice(bytes);
+    items
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn aligned_range_widens() {
+        assert_eq!(aligned_range(0, 8, 64), Some((0, 8)));
+        assert_eq!(aligned_range(6, 6, 64), Some((4, 12)));
+        assert_eq!(aligned_range(60, 2, 64), Some((60, 64)));
+        assert_eq!(aligned_range(0, 60, 62), Some((0, 60)));
+        assert_eq!(aligned_range(60, 2, 62), None);
+    }
+
+    #[test]
+    fn extract_rows_strips_padding() {
+        let layout = ReadbackLayout::Rows {
+            row_len: 3,
+            row_pitch: 4,
+            rows: 2,
+        };
+        assert_eq!(
+            layout.extract(&[1, 2, 3, 0, 4, 5, 6, 0]),
+            vec![1, 2, 3, 4, 5, 6]
+        );
+
+        let layout = ReadbackLayout::Contiguous { offset: 2, len: 4 };
+        assert_eq!(layout.extract(&[0, 0, 1, 2, 3, 4, 0, 0]), vec![1, 2, 3, 4]);
+    }
+
+    #[test]
+    fn cast_unaligned_bytes() {
+        let bytes = [0u8, 1, 0, 0, 0, 2, 0, 0, 0];
+        assert_eq!(cast_bytes::<u32>(&bytes[1..]), vec![1, 2]);
+    }
+}
@@ -0,0 +1,614 @@
+use std::{
+    error::Error,
+    fmt, fs,
+    future::Future,
+    path::{Path, PathBuf},
+    pin::pin,
+    sync::{
+        Arc, RwLock,
+        atomic::{AtomicU64, Ordering},
+    },
+    task::{Context, Poll, Waker},
+    time::{Duration, Instant, SystemTime},
+};
+
+use crate::graphics::{
+    group::BindGroup,
+    id::ResourceId,
+    pipeline::Pipeline,
+    shader::Shader,
+    texture::{Texture, TextureError},
+};
+
+/// The default interval between two checks of the watched files
+const DEFAULT_POLL_INTERVAL: Duration = Duration::from_millis(250);
+
+/// Describes an opt-in hot-reloading subsystem for shaders, textures and everything built from them
+///
+/// Shaders and textures loaded through the reloader remember their file, the reloader
+/// periodically checks the modification time of every file and rebuilds only what changed:
+/// - A changed shader file rebuilds the shader and the pipelines built from it
+/// - A changed texture file rebuilds the texture and the bind groups that reference it
+///
+/// Everything the reloader builds is handed out as a [`Hot`] handle, rebuilt resources are
+/// swapped into the handles inside [`HotReloader::update()`], so calling it between frames
+/// means a frame never sees a mix of old and new resources.
+/// Rebuilds run inside a validation error scope, if a rebuild fails (e.g. a shader with
+/// a syntax error), the old resource is kept and the failure is reported.
+///
+/// ```rust
+/// let mut reloader = HotReloader::new();
+/// let shader = reloader.shader(&device, Path::new("assets/sprite.wgsl"), Some("Sprite"))?;
+/// let pipeline = reloader.pipeline(&device, &shader, move |device, shader| {
+///     PipelineBuilder::new().shader(shader).layout(&layout)...build(device)
+/// });
+/// // Every frame, before recording
+/// let report = reloader.update(&device, &queue);
+/// for entry in &report.entries {
+///     println!("Reloaded {} in {:?}", entry.label, entry.duration);
+/// }
+/// pass.use_pipeline(&pipeline.get());
+/// ```
+///
+/// Only the files given to the reloader are watched, files included by a preprocessed shader
+/// can be watched too with [`HotReloader::watch_dependency()`].
+#[derive(Debug)]
+pub struct HotReloader {
+    /// The unique identity of this reloader, to reject handles of other reloaders
+    id: ResourceId,
+    /// The watched resources, every resource comes after its dependencies
+    nodes: Vec<ReloadNode>,
+    /// The minimum interval between two checks of the watched files
+    poll_interval: Duration,
+    /// The time of the last check of the watched files
+    last_poll: Option<Instant>,
+}
+
+/// Describes a handle to a hot-reloaded resource, which always refers to its latest version
+///
+/// The handle is cheap to clone, all clones refer to the same resource.
+/// The resource returned by [`Hot::get()`] stays alive while it's used, even if a newer
+/// version is swapped in meanwhile.
+#[derive(Debug)]
+pub struct Hot<T> {
+    slot: Arc<HotSlot<T>>,
+    /// The identity of the reloader that owns the resource
+    reloader: ResourceId,
+    /// The index of the resource in the reloader
+    node: usize,
+}
+
+/// Specifies the kind of a hot-reloaded resource
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub enum ReloadKind {
+    /// A shader loaded from a file
+    Shader,
+    /// A texture loaded from a file
+    Texture,
+    /// A pipeline built from a shader
+    Pipeline,
+    /// A bind group built from textures
+    BindGroup,
+    /// A file other resources depend on, see [`HotReloader::watch_dependency()`]
+    Dependency,
+}
+
+/// Describes the resources rebuilt by a single [`HotReloader::update()`]
+#[derive(Debug, Clone, Default)]
+pub struct ReloadReport {
+    /// The rebuilt (or failed) resources, in the order they were rebuilt
+    pub entries: Vec<ReloadEntry>,
+    /// The amount of files that were checked for changes
+    pub checked_files: usize,
+    /// The time spent checking the files and rebuilding the resources
+    pub duration: Duration,
+}
+
+/// Describes a single resource rebuilt by [`HotReloader::update()`]
+#[derive(Debug, Clone)]
+pub struct ReloadEntry {
+    /// The kind of the resource
+    pub kind: ReloadKind,
+    /// The file or label of the resource
+    pub label: String,
+    /// The time spent rebuilding the resource
+    pub duration: Duration,
+    /// The cause of the failure if the resource failed to rebuild and the old one is kept
+    pub error: Option<String>,
+}
+
+/// Describes the shared slot of a [`Hot`] handle
+#[derive(Debug)]
+struct HotSlot<T> {
+    value: RwLock<Arc<T>>,
+    /// How many times the resource has been swapped
+    generation: AtomicU64,
+}
+
+/// Describes a single resource watched by a [`HotReloader`]
+struct ReloadNode {
+    kind: ReloadKind,
+    label: String,
+    /// The file of the resource and its last known modification time
+    file: Option<(PathBuf, Option<SystemTime>)>,
+    /// The indices of the resources this one is built from
+    dependencies: Vec<usize>,
+    /// Rebuilds the resource and swaps it into its handle
+    rebuild: RebuildFn,
+}
+
+/// A closure that rebuilds a resource and swaps it into its handle
+type RebuildFn = Box<dyn FnMut(&wgpu::Device, &wgpu::Queue) -> Result<(), String> + Send>;
+
+impl HotReloader {
+    /// Creates a new [`HotReloader`] without any watched resources
+    pub fn new() -> Self {
+        Self {
+            id: ResourceId::next(),
+            nodes: Vec::new(),
+            poll_interval: DEFAULT_POLL_INTERVAL,
+            last_poll: None,
+        }
+    }
+
+    /// Sets the minimum interval between two checks of the watched files, defaults to 250ms
+    pub fn set_poll_interval(&mut self, interval: Duration) {
+        self.poll_interval = interval;
+    }
+
+    /// Loads a shader from a file and watches the file
+    /// - `device` -> the raw [`wgpu::Device`] which is needed to create GPU resources
+    /// - `path` -> the path of the shader file, see [`Shader::new()`]
+    /// - `label` -> the optional debugging label of the shader
+    ///
+    /// # Errors:
+    /// - If the shader file can't be read.
+    pub fn shader(
+        &mut self,
+        device: &wgpu::Device,
+        path: &Path,
+        label: Option<&str>,
+    ) -> Result<Hot<Shader>, Box<dyn Error>> {
+        let label = label.map(str::to_string);
+        self.file_resource(ReloadKind::Shader, device, path, move |device, path| {
+            Shader::new(device, path, label.as_deref()).map_err(|error| error.to_string())
+        })
+        .map_err(Into::into)
+    }
+
+    /// Loads a shader through a custom function and watches its file, e.g. to preprocess it
+    /// - `device` -> the raw [`wgpu::Device`] which is needed to create GPU resources
+    /// - `path` -> the path of the shader file
+    /// - `load` -> loads the shader from the file
+    ///
+    /// # Errors:
+    /// - If loading the shader fails.
+    pub fn shader_with<F>(
+        &mut self,
+        device: &wgpu::Device,
+        path: &Path,
+        load: F,
+    ) -> Result<Hot<Shader>, String>
+    where
+        F: Fn(&wgpu::Device, &Path) -> Result<Shader, String> + Send + 'static,
+    {
+        self.file_resource(ReloadKind::Shader, device, path, load)
+    }
+
+    /// Loads a texture from a file and watches the file
+    /// - `device` -> the raw [`wgpu::Device`] which is needed to create GPU resources
+    /// - `queue` -> the [`wgpu::Queue`] the texture is uploaded with
+    /// - `path` -> the path of the texture file
+    /// - `load` -> loads the texture from the file, usually by building a
+    ///   [`crate::graphics::texture::TextureDescriptor`] with a
+    ///   [`crate::graphics::texture::TextureSource::File`] source
+    ///
+    /// # Errors:
+    /// - If loading the texture fails.
+    pub fn texture<F>(
+        &mut self,
+        device: &wgpu::Device,
+        queue: &wgpu::Queue,
+        path: &Path,
+        load: F,
+    ) -> Result<Hot<Texture>, TextureError>
+    where
+        F: Fn(&wgpu::Device, &wgpu::Queue, &Path) -> Result<Texture, TextureError> + Send + 'static,
+    {
+        let texture = load(device, queue, path)?;
+        let handle = Hot::new(texture, self.id, self.nodes.len());
+        let slot = Arc::clone(&handle.slot);
+        let owned_path = path.to_path_buf();
+        self.push(
+            ReloadKind::Texture,
+            path.display().to_string(),
+            Some(path),
+            Vec::new(),
+            Box::new(move |device, queue| {
+                let texture = validated(device, || load(device, queue, &owned_path))?
+                    .map_err(|error| error.to_string())?;
+                slot.swap(texture);
+                Ok(())
+            }),
+        );
+        Ok(handle)
+    }
+
+    /// Builds a pipeline from a hot-reloaded shader, which is rebuilt whenever the shader is
+    /// - `device` -> the raw [`wgpu::Device`] which is needed to build GPU resources
+    /// - `shader` -> the shader the pipeline is built from
+    /// - `build` -> builds the pipeline from the shader
+    ///
+    /// # Panics:
+    /// - If the shader handle belongs to a different reloader.
+    pub fn pipeline<F>(
+        &mut self,
+        device: &wgpu::Device,
+        shader: &Hot<Shader>,
+        build: F,
+    ) -> Hot<Pipeline>
+    where
+        F: Fn(&wgpu::Device, &Shader) -> Pipeline + Send + 'static,
+    {
+        self.assert_owned(shader.reloader);
+        let handle = Hot::new(build(device, &shader.get()), self.id, self.nodes.len());
+        let slot = Arc::clone(&handle.slot);
+        let shader = shader.clone();
+        self.push(
+            ReloadKind::Pipeline,
+            format!("Pipeline #{}", handle.node),
+            None,
+            vec![shader.node],
+            Box::new(move |device, _| {
+                slot.swap(validated(device, || build(device, &shader.get()))?);
+                Ok(())
+            }),
+        );
+        handle
+    }
+
+    /// Builds a bind group from hot-reloaded textures, which is rebuilt whenever any of them is
+    /// - `device` -> the raw [`wgpu::Device`] which is needed to build GPU resources
+    /// - `textures` -> the textures the bind group references
+    /// - `build` -> builds the bind group from the textures, in the same order as `textures`
+    ///
+    /// # Panics:
+    /// - If a texture handle belongs to a different reloader.
+    pub fn bind_group<F>(
+        &mut self,
+        device: &wgpu::Device,
+        textures: &[&Hot<Texture>],
+        build: F,
+    ) -> Hot<BindGroup>
+    where
+        F: Fn(&wgpu::Device, &[&Texture]) -> BindGroup + Send + 'static,
+    {
+        for texture in textures {
+            self.assert_owned(texture.reloader);
+        }
+        let textures: Vec<Hot<Texture>> = textures.iter().map(|&texture| texture.clone()).collect();
+        let build_from = move |device: &wgpu::Device, textures: &[Hot<Texture>]| {
+            let current: Vec<_> = textures.iter().map(Hot::get).collect();
+            let current: Vec<_> = current.iter().map(Arc::as_ref).collect();
+            build(device, &current)
+        };
+        let handle = Hot::new(build_from(device, &textures), self.id, self.nodes.len());
+        let slot = Arc::clone(&handle.slot);
+        let dependencies = textures.iter().map(|texture| texture.node).collect();
+        self.push(
+            ReloadKind::BindGroup,
+            format!("Bind group #{}", handle.node),
+            None,
+            dependencies,
+            Box::new(move |device, _| {
+                slot.swap(validated(device, || build_from(device, &textures))?);
+                Ok(())
+            }),
+        );
+        handle
+    }
+
+    /// Watches an additional file of a shader, e.g. one it includes,
+    /// the shader and everything built from it is rebuilt when the file changes
+    /// - `shader` -> the shader that depends on the file
+    /// - `path` -> the path of the file
+    ///
+    /// # Panics:
+    /// - If the shader handle belongs to a different reloader.
+    pub fn watch_dependency(&mut self, shader: &Hot<Shader>, path: &Path) {
+        self.assert_owned(shader.reloader);
+        let node = self.nodes.len();
+        self.push(
+            ReloadKind::Dependency,
+            path.display().to_string(),
+            Some(path),
+            Vec::new(),
+            Box::new(|_, _| Ok(())),
+        );
+        // The shader now depends on a later node, which the rebuild order accounts for
+        self.nodes[shader.node].dependencies.push(node);
+    }
+
+    /// Checks the watched files and rebuilds every changed resource and everything built from it,
+    /// returns a report of what was rebuilt
+    /// - `device` -> the raw [`wgpu::Device`] which is needed to build GPU resources
+    /// - `queue` -> the [`wgpu::Queue`] textures are uploaded with
+    ///
+    /// The files are checked at most once per poll interval, see [`HotReloader::set_poll_interval()`].
+    /// This should be called between frames, so every frame sees a consistent set of resources.
+    pub fn update(&mut self, device: &wgpu::Device, queue: &wgpu::Queue) -> ReloadReport {
+        let mut report = ReloadReport::default();
+        if self
+            .last_poll
+            .is_some_and(|last_poll| last_poll.elapsed() < self.poll_interval)
+        {
+            return report;
+        }
+        let start = Instant::now();
+        self.last_poll = Some(start);
+
+        let mut changed = vec![false; self.nodes.len()];
+        for (node, changed) in self.nodes.iter_mut().zip(&mut changed) {
+            let Some((path, modified)) = &mut node.file else {
+                continue;
+            };
+            report.checked_files += 1;
+            // A file that can't be read right now (e.g. it's being saved) is checked again later
+            if let Ok(current) = fs::metadata(&*path).and_then(|metadata| metadata.modified())
+                && *modified != Some(current)
+            {
+                *modified = Some(current);
+                *changed = true;
+            }
+        }
+
+        for index in rebuild_order(&self.nodes) {
+            let node = &self.nodes[index];
+            let is_dirty = changed[index]
+                || node
+                    .dependencies
+                    .iter()
+                    .any(|&dependency| changed[dependency]);
+            if !is_dirty {
+                continue;
+            }
+
+            let node = &mut self.nodes[index];
+            let rebuild_start = Instant::now();
+            let result = (node.rebuild)(device, queue);
+            changed[index] = result.is_ok();
+            if node.kind != ReloadKind::Dependency {
+                report.entries.push(ReloadEntry {
+                    kind: node.kind,
+                    label: node.label.clone(),
+                    duration: rebuild_start.elapsed(),
+                    error: result.err(),
+                });
+            }
+        }
+        report.duration = start.elapsed();
+        report
+    }
+
+    /// Returns the amount of watched resources
+    pub fn len(&self) -> usize {
+        self.nodes.len()
+    }
+
+    /// Returns `true` if no resources are watched
+    pub fn is_empty(&self) -> bool {
+        self.nodes.is_empty()
+    }
+
+    /// Loads a resource from a file and adds it with its file
+    fn file_resource<T, F>(
+        &mut self,
+        kind: ReloadKind,
+        device: &wgpu::Device,
+        path: &Path,
+        load: F,
+    ) -> Result<Hot<T>, String>
+    where
+        T: Send + Sync + 'static,
+        F: Fn(&wgpu::Device, &Path) -> Result<T, String> + Send + 'static,
+    {
+        let handle = Hot::new(load(device, path)?, self.id, self.nodes.len());
+        let slot = Arc::clone(&handle.slot);
+        let owned_path = path.to_path_buf();
+        self.push(
+            kind,
+            path.display().to_string(),
+            Some(path),
+            Vec::new(),
+            Box::new(move |device, _| {
+                slot.swap(validated(device, || load(device, &owned_path))??);
+                Ok(())
+            }),
+        );
+        Ok(handle)
+    }
+
+    /// Adds a resource, recording the current modification time of its file
+    fn push(
+        &mut self,
+        kind: ReloadKind,
+        label: String,
+        path: Option<&Path>,
+        dependencies: Vec<usize>,
+        rebuild: RebuildFn,
+    ) {
+        let file = path.map(|path| {
+            let modified = fs::metadata(path).and_then(|metadata| metadata.modified());
+            (path.to_path_buf(), modified.ok())
+        });
+        self.nodes.push(ReloadNode {
+            kind,
+            label,
+            file,
+            dependencies,
+            rebuild,
+        });
+    }
+
+    /// Asserts that a handle belongs to this reloader
+    fn assert_owned(&self, reloader: ResourceId) {
+        assert_eq!(
+            reloader, self.id,
+            "The handle belongs to a different hot reloader!"
+        );
+    }
+}
+
+impl fmt::Debug for ReloadNode {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("ReloadNode")
+            .field("kind", &self.kind)
+            .field("label", &self.label)
+            .field("file", &self.file)
+            .field("dependencies", &self.dependencies)
+            .finish()
+    }
+}
+
+impl Default for HotReloader {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl<T> Hot<T> {
+    /// Returns the latest version of the resource
+    pub fn get(&self) -> Arc<T> {
+        // The slot only ever holds a complete resource, so a poisoned lock is still usable
+        let value = self
+            .slot
+            .value
+            .read()
+            .unwrap_or_else(|error| error.into_inner());
+        Arc::clone(&value)
+    }
+
+    /// Returns how many times the resource has been reloaded, which lets dependent state
+    /// that isn't managed by the reloader detect a reload
+    pub fn generation(&self) -> u64 {
+        self.slot.generation.load(Ordering::Acquire)
+    }
+
+    /// Creates a new handle to a resource of a reloader
+    fn new(value: T, reloader: ResourceId, node: usize) -> Self {
+        Self {
+            slot: Arc::new(HotSlot {
+                value: RwLock::new(Arc::new(value)),
+                generation: AtomicU64::new(0),
+            }),
+            reloader,
+            node,
+        }
+    }
+}
+
+impl<T> Clone for Hot<T> {
+    fn clone(&self) -> Self {
+        Self {
+            slot: Arc::clone(&self.slot),
+            reloader: self.reloader,
+            node: self.node,
+        }
+    }
+}
+
+impl<T> HotSlot<T> {
+    /// Swaps a new version of the resource in
+    fn swap(&self, value: T) {
+        let mut current = self
+            .value
+            .write()
+            .unwrap_or_else(|error| error.into_inner());
+        *current = Arc::new(value);
+        self.generation.fetch_add(1, Ordering::AcqRel);
+    }
+}
+
+impl ReloadReport {
+    /// Returns `true` if nothing was rebuilt
+    pub fn is_empty(&self) -> bool {
+        self.entries.is_empty()
+    }
+
+    /// Returns the resources that failed to rebuild
+    pub fn failures(&self) -> impl Iterator<Item = &ReloadEntry> {
+        self.entries.iter().filter(|entry| entry.error.is_some())
+    }
+}
+
+/// Runs `create` inside a validation error scope, so an invalid resource (e.g. a shader with
+/// a syntax error) is returned as an error instead of reaching the uncaptured error handler
+fn validated<T>(device: &wgpu::Device, create: impl FnOnce() -> T) -> Result<T, String> {
+    device.push_error_scope(wgpu::ErrorFilter::Validation);
+    let value = create();
+    let mut error = pin!(device.pop_error_scope());
+    // Native backends resolve the error scope right away, so the future is polled only once
+    match error.as_mut().poll(&mut Context::from_waker(Waker::noop())) {
+        Poll::Ready(Some(error)) => Err(error.to_string()),
+        _ => Ok(value),
+    }
+}
+
+/// Returns the order to rebuild the resources in, every resource comes after its dependencies
+///
+/// Resources are added after the resources they're built from, except for dependencies added
+/// with [`HotReloader::watch_dependency()`], so those are moved in front of their dependents.
+fn rebuild_order(nodes: &[ReloadNode]) -> Vec<usize> {
+    let dependencies: Vec<_> = nodes
+        .iter()
+        .map(|node| node.dependencies.as_slice())
+        .collect();
+    topological_order(&dependencies)
+}
+
+/// Orders the indices so every index comes after the indices it depends on,
+/// keeping the original order where possible
+fn topological_order(dependencies: &[&[usize]]) -> Vec<usize> {
+    fn visit(
+        index: usize,
+        dependencies: &[&[usize]],
+        visited: &mut [bool],
+        order: &mut Vec<usize>,
+    ) {
+        if visited[index] {
+            return;
+        }
+        visited[index] = true;
+        for &dependency in dependencies[index] {
+            visit(dependency, dependencies, visited, order);
+        }
+        order.push(index);
+    }
+
+    let mut visited = vec![false; dependencies.len()];
+    let mut order = Vec::with_capacity(dependencies.len());
+    for index in 0..dependencies.len() {
+        visit(index, dependencies, &mut visited, &mut order);
+    }
+    order
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn topological_order_puts_dependencies_first() {
+        // 0: shader, 1: pipeline of 0, 2: include of 0 (added last)
+        let dependencies: [&[usize]; 3] = [&[2], &[0], &[]];
+        assert_eq!(topological_order(&dependencies), vec![2, 0, 1]);
+    }
+
+    #[test]
+    fn hot_swap_keeps_old_versions_alive() {
+        let handle = Hot::new(1, ResourceId::next(), 0);
+        let old = handle.get();
+        handle.slot.swap(2);
+        assert_eq!((*old, *handle.get(), handle.generation()), (1, 2, 1));
+    }
+}
@@ -14,6 +14,9 @@ pub struct SamplerDescriptor<'a> {
     pub wrapping: TextureWrapping,
     /// The texture filtering more to use
     pub filtering: TextureFiltering,
+    /// The filtering mode to use between mip levels,
+    /// linear filtering between levels is also known as trilinear filtering
+    pub mipmap_filtering: TextureFiltering,
 }
 
 /// Describes a texture wrapping configuration
@@ -67,7 +70,7 @@ impl<'a> SamplerDescriptor<'a> {
                 address_mode_w: wrapping,
                 mag_filter: filtering,
                 min_filter: filtering,
-                mipmap_filter: filtering,
+                mipmap_filter: self.mipmap_filtering.raw(),
                 lod_min_clamp: 0.0,
                 lod_max_clamp: 100.0,
                 compare: None,
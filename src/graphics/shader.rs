@@ -1,10 +1,107 @@
-use std::{borrow::Cow, error::Error, fs, path::Path};
+use std::{
+    borrow::Cow,
+    collections::{HashMap, HashSet},
+    error::Error,
+    fmt, fs, io,
+    path::{Path, PathBuf},
+    sync::Arc,
+};
+
+use crate::graphics::id::ResourceId;
 
 /// Describes a wrapper around [`wgpu::ShaderModule`]
 #[derive(Debug)]
 pub struct Shader {
     /// The internal [`wgpu::ShaderModule`]
     raw: wgpu::ShaderModule,
+    /// The unique identity of this shader
+    id: ResourceId,
+}
+
+/// Describes a WGSL preprocessor, which resolves includes and feature permutations
+/// before the source is compiled
+///
+/// The preprocessor understands the following directives, each on its own line:
+/// - `#include "file.wgsl"` inserts a file, each file is only inserted once per shader
+/// - `#define NAME` or `#define NAME value` defines a name, which is replaced by its value
+///   in the following lines
+/// - `#undef NAME` removes a definition
+/// - `#ifdef NAME`, `#ifndef NAME`, `#else` and `#endif` keep or drop lines
+///   depending on whether a name is defined
+///
+/// Includes are looked up in the registered virtual files first, then relative to the file
+/// that includes them and finally in the include directories, in the order they were added.
+///
+/// ```rust
+/// let preprocessor = ShaderPreprocessor::new().include_dir("assets/shaders");
+/// let source = preprocessor.preprocess_file(
+///     Path::new("assets/shaders/material.wgsl"),
+///     &[("NORMAL_MAP", ""), ("MAX_LIGHTS", "16")],
+/// )?;
+/// ```
+#[derive(Debug, Clone, Default)]
+pub struct ShaderPreprocessor {
+    /// The directories includes are looked up in
+    include_dirs: Vec<PathBuf>,
+    /// The sources that can be included by name, without a file
+    virtual_files: HashMap<String, String>,
+}
+
+/// Describes a cache of compiled shader modules, keyed by their preprocessed source
+///
+/// Every permutation of a shader is compiled once per cache, requesting the same source
+/// with the same defines again returns the same [`Arc<Shader>`] without touching the driver.
+/// Every request is preprocessed, which is cheap compared to compiling, so editing
+/// an included file results in a new shader instead of the stale one.
+#[derive(Debug, Default)]
+pub struct ShaderCache {
+    /// The preprocessor every shader of the cache goes through
+    preprocessor: ShaderPreprocessor,
+    /// The compiled shaders, keyed by their preprocessed source
+    shaders: HashMap<String, Arc<Shader>>,
+    /// The amount of requests that returned an already compiled shader
+    hits: u64,
+    /// The amount of requests that had to compile a new shader
+    misses: u64,
+}
+
+/// Specifies the error of a shader that failed to load or preprocess
+#[derive(Debug)]
+pub enum ShaderError {
+    /// The shader file couldn't be read
+    ReadFailure {
+        /// The file the shader tried to read from
+        file: PathBuf,
+        /// The underlying cause of the failure
+        cause: io::Error,
+    },
+    /// An included file couldn't be found
+    MissingInclude {
+        /// The file that includes the missing file, empty for sources without a file
+        file: PathBuf,
+        /// The line of the include (starting at 1)
+        line: usize,
+        /// The name of the missing file
+        include: String,
+    },
+    /// A directive is malformed or unknown
+    InvalidDirective {
+        /// The file that contains the directive, empty for sources without a file
+        file: PathBuf,
+        /// The line of the directive (starting at 1)
+        line: usize,
+        /// The underlying cause of the failure
+        cause: &'static str,
+    },
+}
+
+/// Describes a conditional block of the preprocessor
+#[derive(Debug, Clone, Copy)]
+struct Conditional {
+    /// Whether the lines of the current branch are kept
+    is_active: bool,
+    /// Whether the block has reached its `#else` branch
+    has_else: bool,
 }
 
 impl Shader {
@@ -18,15 +115,422 @@ impl Shader {
         label: Option<&str>,
     ) -> Result<Self, Box<dyn Error>> {
         let source = fs::read_to_string(path)?;
+        Ok(Self::from_wgsl(device, source, label))
+    }
+
+    /// Creates a new shader from WGSL source code:
+    /// - `device` is the raw [`wgpu::Device`]
+    /// - `source` is the WGSL source code of the shader
+    /// - `label` is an optional debugging label which is assigned to the shader unit
+    pub fn from_wgsl(
+        device: &wgpu::Device,
+        source: impl Into<Cow<'static, str>>,
+        label: Option<&str>,
+    ) -> Self {
         let shader = device.create_shader_module(wgpu::ShaderModuleDescriptor {
             label,
-            source: wgpu::ShaderSource::Wgsl(Cow::Owned(source)),
+            source: wgpu::ShaderSource::Wgsl(source.into()),
         });
-        Ok(Self { raw: shader })
+        Self {
+            raw: shader,
+            id: ResourceId::next(),
+        }
     }
 
     /// Returns the raw [`wgpu::ShaderModule`] to use in pipeline creation
     pub fn raw(&self) -> &wgpu::ShaderModule {
         &self.raw
     }
+
+    /// Returns the unique [`ResourceId`] of this shader
+    pub fn id(&self) -> ResourceId {
+        self.id
+    }
+}
+
+impl ShaderPreprocessor {
+    /// Creates a new [`ShaderPreprocessor`] without any include directories or virtual files
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Adds a directory includes are looked up in
+    pub fn include_dir(mut self, directory: impl Into<PathBuf>) -> Self {
+        self.include_dirs.push(directory.into());
+        self
+    }
+
+    /// Adds a source that can be included by name without a file, e.g. an embedded library
+    /// - `name` -> the name used in `#include "name"`
+    /// - `source` -> the WGSL source code
+    pub fn virtual_file(mut self, name: impl Into<String>, source: impl Into<String>) -> Self {
+        self.virtual_files.insert(name.into(), source.into());
+        self
+    }
+
+    /// Reads and preprocesses a shader file, returns a [`ShaderError`] upon failure
+    /// - `path` -> the path of the shader file
+    /// - `defines` -> the names to define before the first line, with their values
+    ///   (an empty value only defines the name)
+    pub fn preprocess_file(
+        &self,
+        path: &Path,
+        defines: &[(&str, &str)],
+    ) -> Result<String, ShaderError> {
+        let source = fs::read_to_string(path).map_err(|cause| ShaderError::ReadFailure {
+            file: path.to_path_buf(),
+            cause,
+        })?;
+        self.preprocess(&source, Some(path), defines)
+    }
+
+    /// Preprocesses WGSL source code, returns a [`ShaderError`] upon failure
+    /// - `source` -> the WGSL source code
+    /// - `path` -> the optional path the source was read from, includes are looked up
+    ///   relative to its directory
+    /// - `defines` -> the names to define before the first line, with their values
+    ///   (an empty value only defines the name)
+    pub fn preprocess(
+        &self,
+        source: &str,
+        path: Option<&Path>,
+        defines: &[(&str, &str)],
+    ) -> Result<String, ShaderError> {
+        let mut defines = defines
+            .iter()
+            .map(|(name, value)| (name.to_string(), value.to_string()))
+            .collect();
+        let mut included = HashSet::new();
+        if let Some(path) = path {
+            included.insert(path.canonicalize().unwrap_or_else(|_| path.to_path_buf()));
+        }
+        let mut output = String::with_capacity(source.len());
+        self.process(source, path, &mut defines, &mut included, &mut output)?;
+        Ok(output)
+    }
+
+    /// Preprocesses a single file into `output`, recursing into its includes
+    fn process(
+        &self,
+        source: &str,
+        path: Option<&Path>,
+        defines: &mut HashMap<String, String>,
+        included: &mut HashSet<PathBuf>,
+        output: &mut String,
+    ) -> Result<(), ShaderError> {
+        let file = path.map(Path::to_path_buf).unwrap_or_default();
+        let invalid = |line: usize, cause: &'static str| ShaderError::InvalidDirective {
+            file: file.clone(),
+            line: line + 1,
+            cause,
+        };
+        let mut conditionals: Vec<Conditional> = Vec::new();
+
+        for (line, text) in source.lines().enumerate() {
+            let is_active = conditionals.iter().all(|block| block.is_active);
+            let Some(directive) = text.trim_start().strip_prefix('#') else {
+                if is_active {
+                    substitute(text, defines, output);
+                    output.push('\n');
+                }
+                continue;
+            };
+
+            let (name, argument) = directive
+                .split_once(char::is_whitespace)
+                .map(|(name, argument)| (name, argument.trim()))
+                .unwrap_or((directive.trim_end(), ""));
+            match name {
+                "ifdef" | "ifndef" => {
+                    if argument.is_empty() {
+                        return Err(invalid(line, "Missing name of the condition"));
+                    }
+                    conditionals.push(Conditional {
+                        is_active: defines.contains_key(argument) == (name == "ifdef"),
+                        has_else: false,
+                    });
+                }
+                "else" => {
+                    let block = conditionals
+                        .last_mut()
+                        .ok_or_else(|| invalid(line, "#else without #ifdef"))?;
+                    if block.has_else {
+                        return Err(invalid(line, "Multiple #else in the same block"));
+                    }
+                    block.is_active = !block.is_active;
+                    block.has_else = true;
+                }
+                "endif" => {
+                    conditionals
+                        .pop()
+                        .ok_or_else(|| invalid(line, "#endif without #ifdef"))?;
+                }
+                _ if !is_active => {}
+                "define" => {
+                    let (define, value) = argument
+                        .split_once(char::is_whitespace)
+                        .map(|(define, value)| (define, value.trim()))
+                        .unwrap_or((argument, ""));
+                    if define.is_empty() {
+                        return Err(invalid(line, "Missing name of the definition"));
+                    }
+                    defines.insert(define.to_string(), value.to_string());
+                }
+                "undef" => {
+                    defines.remove(argument);
+                }
+                "include" => {
+                    let include = argument
+                        .strip_prefix('"')
+                        .and_then(|argument| argument.strip_suffix('"'))
+                        .ok_or_else(|| invalid(line, "The included file must be quoted"))?;
+                    let (key, source) =
+                        self.resolve(include, path)
+                            .ok_or_else(|| ShaderError::MissingInclude {
+                                file: file.clone(),
+                                line: line + 1,
+                                include: include.to_string(),
+                            })?;
+                    // Every file is inserted once, which also breaks include cycles
+                    if included.insert(key.clone()) {
+                        let source = source.map_err(|cause| ShaderError::ReadFailure {
+                            file: key.clone(),
+                            cause,
+                        })?;
+                        let is_file = !self.virtual_files.contains_key(include);
+                        let include_path = is_file.then_some(key.as_path());
+                        self.process(&source, include_path, defines, included, output)?;
+                    }
+                }
+                _ => return Err(invalid(line, "Unknown directive")),
+            }
+        }
+
+        if conditionals.is_empty() {
+            Ok(())
+        } else {
+            Err(invalid(source.lines().count(), "Missing #endif"))
+        }
+    }
+
+    /// Looks up an included file, returns its unique key and its source
+    fn resolve(&self, include: &str, path: Option<&Path>) -> Option<(PathBuf, io::Result<String>)> {
+        if let Some(source) = self.virtual_files.get(include) {
+            return Some((PathBuf::from(include), Ok(source.clone())));
+        }
+        let relative = path
+            .and_then(Path::parent)
+            .map(|directory| directory.join(include));
+        relative
+            .into_iter()
+            .chain(
+                self.include_dirs
+                    .iter()
+                    .map(|directory| directory.join(include)),
+            )
+            .find(|candidate| candidate.is_file())
+            .map(|candidate| {
+                let key = candidate.canonicalize().unwrap_or(candidate);
+                let source = fs::read_to_string(&key);
+                (key, source)
+            })
+    }
+}
+
+impl ShaderCache {
+    /// Creates a new, empty [`ShaderCache`]
+    /// - `preprocessor` -> the [`ShaderPreprocessor`] every shader of the cache goes through
+    pub fn new(preprocessor: ShaderPreprocessor) -> Self {
+        Self {
+            preprocessor,
+            ..Default::default()
+        }
+    }
+
+    /// Returns the shader compiled from a file with the defines, reading, preprocessing and
+    /// compiling it only if the same permutation hasn't been compiled through this cache yet
+    /// - `device` -> the raw [`wgpu::Device`] which is needed to create GPU resources
+    /// - `path` -> the path of the shader file
+    /// - `defines` -> the names to define before the first line, with their values
+    /// - `label` -> the optional debugging label of the shader
+    ///
+    /// The file and its includes are read on every request, since the key is derived from them.
+    pub fn get_file(
+        &mut self,
+        device: &wgpu::Device,
+        path: &Path,
+        defines: &[(&str, &str)],
+        label: Option<&str>,
+    ) -> Result<Arc<Shader>, ShaderError> {
+        let source = fs::read_to_string(path).map_err(|cause| ShaderError::ReadFailure {
+            file: path.to_path_buf(),
+            cause,
+        })?;
+        self.get(device, &source, Some(path), defines, label)
+    }
+
+    /// Returns the shader compiled from WGSL source code with the defines, preprocessing and
+    /// compiling it only if the same permutation hasn't been compiled through this cache yet
+    /// - `device` -> the raw [`wgpu::Device`] which is needed to create GPU resources
+    /// - `source` -> the WGSL source code
+    /// - `path` -> the optional path the source was read from, includes are looked up
+    ///   relative to its directory
+    /// - `defines` -> the names to define before the first line, with their values
+    /// - `label` -> the optional debugging label of the shader
+    pub fn get(
+        &mut self,
+        device: &wgpu::Device,
+        source: &str,
+        path: Option<&Path>,
+        defines: &[(&str, &str)],
+        label: Option<&str>,
+    ) -> Result<Arc<Shader>, ShaderError> {
+        let source = self.preprocessor.preprocess(source, path, defines)?;
+        if let Some(shader) = self.shaders.get(&source) {
+            self.hits += 1;
+            return Ok(Arc::clone(shader));
+        }
+
+        let shader = Arc::new(Shader::from_wgsl(device, source.clone(), label));
+        self.misses += 1;
+        self.shaders.insert(source, Arc::clone(&shader));
+        Ok(shader)
+    }
+
+    /// Returns the [`ShaderPreprocessor`] of this cache
+    pub fn preprocessor(&self) -> &ShaderPreprocessor {
+        &self.preprocessor
+    }
+
+    /// Returns the amount of compiled shaders in the cache
+    pub fn len(&self) -> usize {
+        self.shaders.len()
+    }
+
+    /// Returns `true` if no shaders have been compiled through this cache
+    pub fn is_empty(&self) -> bool {
+        self.shaders.is_empty()
+    }
+
+    /// Returns the amount of requests that returned an already compiled shader
+    pub fn hits(&self) -> u64 {
+        self.hits
+    }
+
+    /// Returns the amount of requests that had to compile a new shader
+    pub fn misses(&self) -> u64 {
+        self.misses
+    }
+
+    /// Removes every compiled shader from the cache, e.g. to free stale permutations,
+    /// shaders that are still in use stay alive until their last [`Arc`] is dropped
+    pub fn clear(&mut self) {
+        self.shaders.clear();
+    }
+}
+
+impl fmt::Display for ShaderError {
+    fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
+        match self {
+            ShaderError::ReadFailure { file, cause } => {
+                write!(f, "Couldn't read shader from file {:?}:\n\t{}", file, cause)
+            }
+            ShaderError::MissingInclude {
+                file,
+                line,
+                include,
+            } => {
+                write!(
+                    f,
+                    "Couldn't find include {:?} in file {:?} at line {}",
+                    include, file, line
+                )
+            }
+            ShaderError::InvalidDirective { file, line, cause } => {
+                write!(
+                    f,
+                    "Invalid directive in file {:?} at line {}:\n\t{}",
+                    file, line, cause
+                )
+            }
+        }
+    }
+}
+
+impl Error for ShaderError {}
+
+/// Writes `text` into `output`, replacing every identifier that is defined with a value
+fn substitute(text: &str, defines: &HashMap<String, String>, output: &mut String) {
+    let is_identifier = |c: char| c.is_alphanumeric() || c == '_';
+    let mut rest = text;
+    while let Some(start) = rest.find(is_identifier) {
+        output.push_str(&rest[..start]);
+        rest = &rest[start..];
+        let end = rest.find(|c: char| !is_identifier(c)).unwrap_or(rest.len());
+        let word = &rest[..end];
+        match defines.get(word) {
+            Some(value) if !value.is_empty() => output.push_str(value),
+            _ => output.push_str(word),
+        }
+        rest = &rest[end..];
+    }
+    output.push_str(rest);
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn preprocess(
+        preprocessor: &ShaderPreprocessor,
+        source: &str,
+        defines: &[(&str, &str)],
+    ) -> Result<String, ShaderError> {
+        preprocessor.preprocess(source, None, defines)
+    }
+
+    #[test]
+    fn conditionals_and_defines() {
+        let source = "#ifdef NORMAL_MAP\nnormal\n#else\nflat\n#endif\n\
+                      #define COUNT 4\nvar<private> lights: array<Light, COUNT>;\n\
+                      #ifndef COUNT\nmissing\n#endif\n";
+        let preprocessor = ShaderPreprocessor::new();
+        assert_eq!(
+            preprocess(&preprocessor, source, &[("NORMAL_MAP", "")]).unwrap(),
+            "normal\nvar<private> lights: array<Light, 4>;\n"
+        );
+        assert_eq!(
+            preprocess(&preprocessor, source, &[]).unwrap(),
+            "flat\nvar<private> lights: array<Light, 4>;\n"
+        );
+    }
+
+    #[test]
+    fn includes_are_inserted_once() {
+        let preprocessor = ShaderPreprocessor::new()
+            .virtual_file("common.wgsl", "#include \"math.wgsl\"\ncommon")
+            .virtual_file("math.wgsl", "#include \"common.wgsl\"\nmath");
+        let source = "#include \"common.wgsl\"\n#include \"math.wgsl\"\nmain";
+        assert_eq!(
+            preprocess(&preprocessor, source, &[]).unwrap(),
+            "math\ncommon\nmain\n"
+        );
+    }
+
+    #[test]
+    fn invalid_directives() {
+        let preprocessor = ShaderPreprocessor::new();
+        assert!(matches!(
+            preprocess(&preprocessor, "#ifdef A\n", &[]),
+            Err(ShaderError::InvalidDirective { line: 2, .. })
+        ));
+        assert!(matches!(
+            preprocess(&preprocessor, "#endif", &[]),
+            Err(ShaderError::InvalidDirective { line: 1, .. })
+        ));
+        assert!(matches!(
+            preprocess(&preprocessor, "\n#include \"missing.wgsl\"", &[]),
+            Err(ShaderError::MissingInclude { line: 2, .. })
+        ));
+    }
 }
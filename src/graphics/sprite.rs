@@ -0,0 +1,569 @@
+use std::{ops::Range, sync::Arc};
+
+use bytemuck::{Pod, Zeroable};
+use wgpu::{Device, Queue};
+
+use crate::graphics::{
+    buffer::{BufferHandle, BufferStorage, BufferUsage},
+    group::BindGroup,
+    layout::{BufferAttribute, BufferAttributeFormat, BufferLayout, create_instance_layout},
+    pass::RenderPass,
+    pipeline::Pipeline,
+};
+
+/// The default amount of instances a sprite batch draws with a single draw call.
+pub const DEFAULT_MAX_INSTANCES_PER_DRAW: u32 = 1 << 16;
+
+/// A sprite shader matching the [`SpriteInstance`] layout.
+///
+/// Each sprite is a quad of 6 vertices generated from the vertex index, so the pipeline
+/// needs no geometry buffer, only [`SpriteInstance::layout()`] as its instance layout.
+///
+/// The material bind group (group 0) is expected to contain:
+/// - binding 0 -> a 2D array texture, such as a [`crate::graphics::atlas::TextureAtlas`]
+/// - binding 1 -> a filtering sampler
+/// - binding 2 -> a uniform buffer with the view projection matrix
+pub const SPRITE_SHADER: &str = r#"
+struct Sprite {
+    @location(0) position: vec2<f32>,
+    @location(1) size: vec2<f32>,
+    @location(2) uv_min: vec2<f32>,
+    @location(3) uv_max: vec2<f32>,
+    @location(4) color: vec4<f32>,
+    @location(5) rotation: f32,
+    @location(6) layer: u32,
+};
+
+struct VertexOutput {
+    @builtin(position) position: vec4<f32>,
+    @location(0) uv: vec2<f32>,
+    @location(1) color: vec4<f32>,
+    @location(2) @interpolate(flat) layer: u32,
+};
+
+@group(0) @binding(0) var sprite_texture: texture_2d_array<f32>;
+@group(0) @binding(1) var sprite_sampler: sampler;
+@group(0) @binding(2) var<uniform> view_projection: mat4x4<f32>;
+
+@vertex
+fn vs_main(@builtin(vertex_index) index: u32, sprite: Sprite) -> VertexOutput {
+    var corners = array<vec2<f32>, 6>(
+        vec2<f32>(0.0, 0.0), vec2<f32>(1.0, 0.0), vec2<f32>(0.0, 1.0),
+        vec2<f32>(0.0, 1.0), vec2<f32>(1.0, 0.0), vec2<f32>(1.0, 1.0),
+    );
+    let corner = corners[index];
+    let offset = (corner - vec2<f32>(0.5)) * sprite.size;
+    let c = cos(sprite.rotation);
+    let s = sin(sprite.rotation);
+    let rotated = vec2<f32>(offset.x * c - offset.y * s, offset.x * s + offset.y * c);
+    var out: VertexOutput;
+    out.position = view_projection * vec4<f32>(sprite.position + rotated, 0.0, 1.0);
+    out.uv = mix(sprite.uv_min, sprite.uv_max, corner);
+    out.color = sprite.color;
+    out.layer = sprite.layer;
+    return out;
+}
+
+@fragment
+fn fs_main(in: VertexOutput) -> @location(0) vec4<f32> {
+    return textureSample(sprite_texture, sprite_sampler, in.uv, in.layer) * in.color;
+}
+"#;
+
+/// The buffer attributes of a [`SpriteInstance`], in field order.
+const SPRITE_ATTRIBUTES: &[BufferAttribute] = &[
+    BufferAttribute {
+        location: 0,
+        size: 2,
+        format: BufferAttributeFormat::F32,
+    },
+    BufferAttribute {
+        location: 1,
+        size: 2,
+        format: BufferAttributeFormat::F32,
+    },
+    BufferAttribute {
+        location: 2,
+        size: 2,
+        format: BufferAttributeFormat::F32,
+    },
+    BufferAttribute {
+        location: 3,
+        size: 2,
+        format: BufferAttributeFormat::F32,
+    },
+    BufferAttribute {
+        location: 4,
+        size: 4,
+        format: BufferAttributeFormat::F32,
+    },
+    BufferAttribute {
+        location: 5,
+        size: 1,
+        format: BufferAttributeFormat::F32,
+    },
+    BufferAttribute {
+        location: 6,
+        size: 1,
+        format: BufferAttributeFormat::U32,
+    },
+];
+
+/// Describes a single sprite, a textured quad drawn as one instance
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq, Zeroable, Pod)]
+pub struct SpriteInstance {
+    /// The center of the sprite
+    pub position: [f32; 2],
+    /// The width and height of the sprite
+    pub size: [f32; 2],
+    /// The top left texture coordinate of the sprite
+    pub uv_min: [f32; 2],
+    /// The bottom right texture coordinate of the sprite
+    pub uv_max: [f32; 2],
+    /// The color the texture is multiplied with
+    pub color: [f32; 4],
+    /// The rotation of the sprite around its center (in radians)
+    pub rotation: f32,
+    /// The texture array layer the sprite samples from
+    pub layer: u32,
+}
+
+/// Identifies a material registered with [`SpriteBatch::add_material()`]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub struct MaterialId(u32);
+
+/// Specifies the order in which the sprites of a batch are drawn
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub enum SpriteOrder {
+    /// Sprites are grouped by pipeline and then by bind group, which needs the fewest draw calls,
+    /// sprites of the same material keep their submission order
+    #[default]
+    Material,
+    /// Sprites are drawn in submission order, only neighbouring sprites of the same material
+    /// share a draw call, which is needed when blended sprites overlap
+    Submission,
+}
+
+/// Describes the statistics of the last [`SpriteBatch::prepare()`]
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct SpriteBatchStats {
+    /// How many sprites were prepared
+    pub sprites: u32,
+    /// How many draw calls the sprites take
+    pub draws: u32,
+    /// How many bytes of instance data were uploaded
+    pub uploaded_bytes: u64,
+}
+
+/// Describes a material, the pipeline and bind group a sprite is drawn with
+#[derive(Debug)]
+struct SpriteMaterial {
+    pipeline: Arc<Pipeline>,
+    bind_group: Arc<BindGroup>,
+}
+
+/// Describes a single draw call of a range of instances with a single material
+#[derive(Debug, Clone, PartialEq, Eq)]
+struct SpriteDraw {
+    material: u32,
+    instances: Range<u32>,
+}
+
+/// Accumulates sprites into a persistent instance buffer and draws them
+/// in as few draw calls as possible.
+///
+/// Every sprite is pushed with the [`MaterialId`] of the pipeline and bind group it's drawn with,
+/// [`SpriteBatch::prepare()`] orders the sprites by material, uploads them with a single write
+/// and splits them into draw calls, which [`SpriteBatch::draw()`] then records:
+///
+/// ```rust
+/// let material = batch.add_material(pipeline, atlas_group);
+/// batch.clear();
+/// batch.extend(material, &sprites);
+/// batch.prepare(&device, &queue);
+/// batch.draw(&mut pass);
+/// ```
+///
+/// The instance buffer has no CPU mirror, the sprites are only kept once on the CPU side,
+/// and it grows as needed, so it should be pre-sized with [`SpriteBatch::new()`].
+///
+/// No draw call covers more than the maximum amount of instances per draw,
+/// larger runs of a single material are split into several draw calls.
+#[derive(Debug)]
+pub struct SpriteBatch {
+    materials: Vec<SpriteMaterial>,
+    sprites: Vec<SpriteInstance>,
+    sprite_materials: Vec<u32>,
+    sorted: Vec<SpriteInstance>,
+    counts: Vec<u32>,
+    draws: Vec<SpriteDraw>,
+    buffer: BufferHandle<SpriteInstance>,
+    order: SpriteOrder,
+    max_instances_per_draw: u32,
+    stats: SpriteBatchStats,
+}
+
+impl SpriteInstance {
+    /// Returns the instance [`BufferLayout`] of a sprite, as used by [`SPRITE_SHADER`]
+    pub fn layout() -> BufferLayout {
+        create_instance_layout(SPRITE_ATTRIBUTES)
+    }
+}
+
+impl MaterialId {
+    /// Returns the raw index of the material
+    pub fn raw(self) -> u32 {
+        self.0
+    }
+}
+
+impl SpriteBatch {
+    /// Creates a new empty [`SpriteBatch`]
+    /// - `device` -> the [`wgpu::Device`] needed to create the instance buffer
+    /// - `capacity` -> the amount of sprites the instance buffer initially holds
+    ///
+    /// # Panics:
+    /// - If `capacity` is equal to zero.
+    pub fn new(device: &Device, capacity: usize) -> Self {
+        Self {
+            materials: Vec::new(),
+            sprites: Vec::with_capacity(capacity),
+            sprite_materials: Vec::with_capacity(capacity),
+            sorted: Vec::new(),
+            counts: Vec::new(),
+            draws: Vec::new(),
+            buffer: BufferHandle::allocate_with_storage(
+                device,
+                capacity,
+                BufferUsage::Vertex { is_writable: true },
+                BufferStorage::WriteOnly,
+                Some("Sprite batch instances"),
+            ),
+            order: SpriteOrder::default(),
+            max_instances_per_draw: DEFAULT_MAX_INSTANCES_PER_DRAW,
+            stats: SpriteBatchStats::default(),
+        }
+    }
+
+    /// Registers a material, the pipeline and bind group (in slot 0) sprites get drawn with
+    pub fn add_material(
+        &mut self,
+        pipeline: Arc<Pipeline>,
+        bind_group: Arc<BindGroup>,
+    ) -> MaterialId {
+        self.materials.push(SpriteMaterial {
+            pipeline,
+            bind_group,
+        });
+        MaterialId(self.materials.len() as u32 - 1)
+    }
+
+    /// Sets the [`SpriteOrder`] the sprites are drawn in
+    pub fn set_order(&mut self, order: SpriteOrder) {
+        self.order = order;
+    }
+
+    /// Sets the maximum amount of instances a single draw call covers
+    ///
+    /// # Panics:
+    /// - If `max_instances_per_draw` is equal to zero.
+    pub fn set_max_instances_per_draw(&mut self, max_instances_per_draw: u32) {
+        assert!(
+            max_instances_per_draw > 0,
+            "Max instances per draw cannot be zero!"
+        );
+        self.max_instances_per_draw = max_instances_per_draw;
+    }
+
+    /// Adds a sprite drawn with `material`
+    ///
+    /// # Panics:
+    /// - If the material is not registered with this batch.
+    pub fn push(&mut self, material: MaterialId, sprite: SpriteInstance) {
+        self.assert_material(material);
+        self.sprites.push(sprite);
+        self.sprite_materials.push(material.0);
+    }
+
+    /// Adds a list of sprites that are all drawn with `material`
+    ///
+    /// # Panics:
+    /// - If the material is not registered with this batch.
+    pub fn extend(&mut self, material: MaterialId, sprites: &[SpriteInstance]) {
+        self.assert_material(material);
+        self.sprites.extend_from_slice(sprites);
+        self.sprite_materials
+            .resize(self.sprite_materials.len() + sprites.len(), material.0);
+    }
+
+    /// Removes every sprite, the materials stay registered
+    pub fn clear(&mut self) {
+        self.sprites.clear();
+        self.sprite_materials.clear();
+        self.draws.clear();
+    }
+
+    /// Orders the sprites, uploads them to the instance buffer and splits them into draw calls
+    /// - `device` -> the [`wgpu::Device`] needed in case the instance buffer grows
+    /// - `queue` -> the [`wgpu::Queue`] the sprites are written through
+    pub fn prepare(&mut self, device: &Device, queue: &Queue) {
+        self.draws.clear();
+        self.stats = SpriteBatchStats {
+            sprites: self.sprites.len() as u32,
+            ..Default::default()
+        };
+        if self.sprites.is_empty() {
+            return;
+        }
+
+        let uploaded = match self.order {
+            SpriteOrder::Material => {
+                let ranks = self.material_ranks();
+                let runs = sort_by_key(
+                    &self.sprites,
+                    &self.sprite_materials,
+                    &ranks,
+                    &mut self.counts,
+                    &mut self.sorted,
+                );
+                self.draws.extend(runs);
+                &self.sorted
+            }
+            SpriteOrder::Submission => {
+                self.draws.extend(adjacent_runs(&self.sprite_materials));
+                &self.sprites
+            }
+        };
+        self.buffer
+            .skip_and_write_item_list_and_flush(device, queue, 0, uploaded);
+        split_draws(&mut self.draws, self.max_instances_per_draw);
+        self.stats.draws = self.draws.len() as u32;
+        self.stats.uploaded_bytes = self.buffer.last_flush_bytes();
+    }
+
+    /// Records the draw calls of the last [`SpriteBatch::prepare()`] into `pass`
+    ///
+    /// The instance buffer is bound to slot 0 and the material bind group to group 0,
+    /// the render pass skips rebinding a pipeline or bind group that's already bound.
+    pub fn draw(&self, pass: &mut RenderPass) {
+        if self.draws.is_empty() {
+            return;
+        }
+
+        pass.use_instance_buffer(0, &self.buffer);
+        for draw in &self.draws {
+            let material = &self.materials[draw.material as usize];
+            pass.use_pipeline(&material.pipeline);
+            pass.use_bind_group(&material.bind_group);
+            pass.draw_range(0..6, draw.instances.clone());
+        }
+    }
+
+    /// Returns the statistics of the last [`SpriteBatch::prepare()`]
+    pub fn stats(&self) -> SpriteBatchStats {
+        self.stats
+    }
+
+    /// Returns the amount of sprites in the batch
+    pub fn len(&self) -> usize {
+        self.sprites.len()
+    }
+
+    /// Returns `true` if the batch has no sprites
+    pub fn is_empty(&self) -> bool {
+        self.sprites.is_empty()
+    }
+
+    /// Returns a reference to the instance buffer
+    pub fn buffer(&self) -> &BufferHandle<SpriteInstance> {
+        &self.buffer
+    }
+
+    /// Returns the draw order rank of every material, materials sharing a pipeline
+    /// get neighbouring ranks so the pipeline is only bound once
+    fn material_ranks(&self) -> Vec<u32> {
+        let mut by_key: Vec<u32> = (0..self.materials.len() as u32).collect();
+        by_key.sort_by_key(|&index| {
+            let material = &self.materials[index as usize];
+            (material.pipeline.id().raw(), material.bind_group.id().raw())
+        });
+        let mut ranks = vec![0; by_key.len()];
+        for (rank, index) in by_key.into_iter().enumerate() {
+            ranks[index as usize] = rank as u32;
+        }
+        ranks
+    }
+
+    fn assert_material(&self, material: MaterialId) {
+        assert!(
+            (material.0 as usize) < self.materials.len(),
+            "Material is not registered with this sprite batch!"
+        );
+    }
+}
+
+/// Stably sorts `items` by the rank of their key with a counting sort into `sorted`,
+/// returning the instance range of every key, in rank order
+fn sort_by_key<T: Copy>(
+    items: &[T],
+    keys: &[u32],
+    ranks: &[u32],
+    counts: &mut Vec<u32>,
+    sorted: &mut Vec<T>,
+) -> Vec<SpriteDraw> {
+    counts.clear();
+    counts.resize(ranks.len() + 1, 0);
+    for &key in keys {
+        counts[ranks[key as usize] as usize + 1] += 1;
+    }
+    for rank in 1..counts.len() {
+        counts[rank] += counts[rank - 1];
+    }
+
+    let mut rank_to_key = vec![0; ranks.len()];
+    for (key, &rank) in ranks.iter().enumerate() {
+        rank_to_key[rank as usize] = key as u32;
+    }
+    let runs = counts
+        .windows(2)
+        .enumerate()
+        .filter(|(_, bounds)| bounds[0] != bounds[1])
+        .map(|(rank, bounds)| SpriteDraw {
+            material: rank_to_key[rank],
+            instances: bounds[0]..bounds[1],
+        })
+        .collect();
+
+    sorted.clear();
+    sorted.extend_from_slice(items);
+    for (item, &key) in items.iter().zip(keys) {
+        let slot = &mut counts[ranks[key as usize] as usize];
+        sorted[*slot as usize] = *item;
+        *slot += 1;
+    }
+    runs
+}
+
+/// Returns the instance range of every run of neighbouring equal keys
+fn adjacent_runs(keys: &[u32]) -> Vec<SpriteDraw> {
+    let mut runs: Vec<SpriteDraw> = Vec::new();
+    for (index, &key) in keys.iter().enumerate() {
+        let index = index as u32;
+        match runs.last_mut() {
+            Some(run) if run.material == key => run.instances.end = index + 1,
+            _ => runs.push(SpriteDraw {
+                material: key,
+                instances: index..index + 1,
+            }),
+        }
+    }
+    runs
+}
+
+/// Splits every draw covering more than `max_instances` instances into several draws
+fn split_draws(draws: &mut Vec<SpriteDraw>, max_instances: u32) {
+    if draws
+        .iter()
+        .all(|draw| draw.instances.len() as u32 <= max_instances)
+    {
+        return;
+    }
+
+    let mut split = Vec::with_capacity(draws.len());
+    for draw in draws.drain(..) {
+        let mut start = draw.instances.start;
+        while start < draw.instances.end {
+            let end = draw.instances.end.min(start + max_instances);
+            split.push(SpriteDraw {
+                material: draw.material,
+                instances: start..end,
+            });
+            start = end;
+        }
+    }
+    *draws = split;
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn counting_sort_is_stable() {
+        let items = [10, 11, 12, 13, 14, 15];
+        let keys = [1, 0, 1, 2, 0, 1];
+        // Key 2 is drawn first, then key 0, then key 1
+        let ranks = [1, 2, 0];
+        let mut counts = Vec::new();
+        let mut sorted = Vec::new();
+        let runs = sort_by_key(&items, &keys, &ranks, &mut counts, &mut sorted);
+        assert_eq!(sorted, [13, 11, 14, 10, 12, 15]);
+        assert_eq!(
+            runs,
+            [
+                SpriteDraw {
+                    material: 2,
+                    instances: 0..1
+                },
+                SpriteDraw {
+                    material: 0,
+                    instances: 1..3
+                },
+                SpriteDraw {
+                    material: 1,
+                    instances: 3..6
+                },
+            ]
+        );
+    }
+
+    #[test]
+    fn unused_keys_have_no_runs() {
+        let mut counts = Vec::new();
+        let mut sorted = Vec::new();
+        let runs = sort_by_key(&[1, 2], &[3, 3], &[0, 1, 2, 3], &mut counts, &mut sorted);
+        assert_eq!(
+            runs,
+            [SpriteDraw {
+                material: 3,
+                instances: 0..2
+            }]
+        );
+    }
+
+    #[test]
+    fn adjacent_runs_merge_neighbours() {
+        let runs = adjacent_runs(&[0, 0, 1, 0, 0, 0]);
+        let ranges: Vec<_> = runs.iter().map(|run| run.instances.clone()).collect();
+        assert_eq!(ranges, [0..2, 2..3, 3..6]);
+    }
+
+    #[test]
+    fn draws_are_split() {
+        let mut draws = vec![
+            SpriteDraw {
+                material: 0,
+                instances: 0..10,
+            },
+            SpriteDraw {
+                material: 1,
+                instances: 10..12,
+            },
+        ];
+        split_draws(&mut draws, 4);
+        let ranges: Vec<_> = draws.iter().map(|draw| draw.instances.clone()).collect();
+        assert_eq!(ranges, [0..4, 4..8, 8..10, 10..12]);
+        assert_eq!(draws[2].material, 0);
+        assert_eq!(draws[3].material, 1);
+    }
+
+    #[test]
+    fn sprite_layout_matches_struct() {
+        let floats: u32 = SPRITE_ATTRIBUTES
+            .iter()
+            .map(|attribute| attribute.size)
+            .sum();
+        assert_eq!(floats as usize * 4, size_of::<SpriteInstance>());
+    }
+}
@@ -0,0 +1,290 @@
+use std::num::NonZeroU32;
+
+use crate::graphics::{
+    group::{
+        BindGroup, BindGroupBuilder, BindGroupLayout, BindGroupLayoutBuilder, LayoutResource,
+        ResourceAccess, TextureConfig, TextureKind,
+    },
+    texture::Texture,
+};
+
+/// Describes a bindless-style table of 2D textures, bound as a single binding array
+///
+/// Every texture gets a stable index once inserted, which stays valid until it is removed.
+/// Draws pass that index (e.g. a per-instance material index) instead of binding a bind
+/// group per texture, so a whole scene renders with one bind group and fewer draw calls.
+/// The bind group is rebuilt only when the table changed, unused indices are bound to
+/// a fallback texture.
+///
+/// The layout requires the features of [`ResourceTable::required_features()`] and the limits
+/// of [`ResourceTable::required_limits()`].
+///
+/// ```rust
+/// let mut table = ResourceTable::new(&device, NonZeroU32::new(1024).unwrap(), &fallback, ResourceAccess::Fragment);
+/// let material = table.insert(&albedo);
+/// // Every frame
+/// pass.set_bind_group(1, table.bind_group(&device));
+/// // In the shader:
+/// // @group(1) @binding(0) var textures: binding_array<texture_2d<f32>>;
+/// // textureSample(textures[in.material], linear_sampler, in.uv)
+/// ```
+#[derive(Debug)]
+pub struct ResourceTable {
+    /// The layout with the single binding array
+    layout: BindGroupLayout,
+    /// The view bound to every unused index
+    fallback: wgpu::TextureView,
+    /// The views of the inserted textures
+    slots: SlotList<wgpu::TextureView>,
+    /// The bind group of the current contents, [`None`] if the table changed since
+    bind_group: Option<BindGroup>,
+}
+
+impl ResourceTable {
+    /// Creates a new, empty [`ResourceTable`]
+    /// - `device` is the raw [`wgpu::Device`] which is needed to build GPU resources
+    /// - `capacity` -> the amount of textures the binding array holds
+    /// - `fallback` -> the texture bound to every unused index
+    /// - `access` -> the [`ResourceAccess`] specifying the shader accessibility of the array
+    ///
+    /// # Panics:
+    /// - If the device lacks the features of [`ResourceTable::required_features()`].
+    /// - If the device limits are below [`ResourceTable::required_limits()`] for `capacity`.
+    pub fn new(
+        device: &wgpu::Device,
+        capacity: NonZeroU32,
+        fallback: &Texture,
+        access: ResourceAccess,
+    ) -> Self {
+        let layout = BindGroupLayoutBuilder::new()
+            .label("Resource table layout")
+            .add_texture_2d_binding_array(capacity, access)
+            .build(device);
+        Self {
+            layout,
+            fallback: fallback.view().clone(),
+            slots: SlotList::new(capacity.get()),
+            bind_group: None,
+        }
+    }
+
+    /// Returns the device features a [`ResourceTable`] requires
+    pub fn required_features() -> wgpu::Features {
+        LayoutResource::TextureArray {
+            config: TextureConfig::D2(TextureKind::Image),
+            count: NonZeroU32::MIN,
+        }
+        .required_features()
+    }
+
+    /// Returns `limits` with [`wgpu::Limits::max_binding_array_elements_per_shader_stage`]
+    /// raised to fit a table of `capacity` textures, which has to be requested with the device
+    /// since the limit defaults to 0
+    /// - `capacity` -> the amount of textures the binding array holds
+    /// - `limits` -> the limits to start from, e.g. [`wgpu::Limits::default()`]
+    pub fn required_limits(capacity: NonZeroU32, limits: wgpu::Limits) -> wgpu::Limits {
+        wgpu::Limits {
+            max_binding_array_elements_per_shader_stage: limits
+                .max_binding_array_elements_per_shader_stage
+                .max(capacity.get()),
+            ..limits
+        }
+    }
+
+    /// Inserts a texture and returns its index into the binding array,
+    /// reusing the indices of removed textures first
+    /// - `texture` -> the texture to insert, which is kept alive by the table
+    ///
+    /// # Panics:
+    /// - If the table is full.
+    pub fn insert(&mut self, texture: &Texture) -> u32 {
+        let index = self
+            .slots
+            .insert(texture.view().clone())
+            .expect("Resource table is full!");
+        self.bind_group = None;
+        index
+    }
+
+    /// Replaces the texture at an index, e.g. after reloading it
+    /// - `index` -> the index of the texture
+    /// - `texture` -> the new texture
+    ///
+    /// # Panics:
+    /// - If no texture is stored at the index.
+    pub fn replace(&mut self, index: u32, texture: &Texture) {
+        assert!(
+            self.slots.replace(index, texture.view().clone()).is_some(),
+            "No texture is stored at index {index} of the resource table!"
+        );
+        self.bind_group = None;
+    }
+
+    /// Removes the texture at an index, which is bound to the fallback texture afterwards,
+    /// and returns `true` if a texture was stored there
+    /// - `index` -> the index of the texture
+    pub fn remove(&mut self, index: u32) -> bool {
+        let removed = self.slots.remove(index).is_some();
+        if removed {
+            self.bind_group = None;
+        }
+        removed
+    }
+
+    /// Returns `true` if a texture is stored at the index
+    pub fn contains(&self, index: u32) -> bool {
+        self.slots.get(index).is_some()
+    }
+
+    /// Returns the bind group of the current contents, which is rebuilt only if the table
+    /// changed since the last call
+    /// - `device` is the raw [`wgpu::Device`] which is needed to build GPU resources
+    pub fn bind_group(&mut self, device: &wgpu::Device) -> &BindGroup {
+        let Self {
+            layout,
+            fallback,
+            slots,
+            bind_group,
+        } = self;
+        bind_group.get_or_insert_with(|| {
+            let views: Vec<_> = (0..slots.capacity())
+                .map(|index| slots.get(index).unwrap_or(fallback))
+                .collect();
+            BindGroupBuilder::new()
+                .label("Resource table")
+                .add_texture_array(&views)
+                .build(layout, device)
+        })
+    }
+
+    /// Returns the layout of the table, which pipelines drawing with it have to include
+    pub fn layout(&self) -> &BindGroupLayout {
+        &self.layout
+    }
+
+    /// Returns the amount of textures in the table
+    pub fn len(&self) -> usize {
+        self.slots.len()
+    }
+
+    /// Returns `true` if the table holds no textures
+    pub fn is_empty(&self) -> bool {
+        self.slots.len() == 0
+    }
+
+    /// Returns `true` if every index of the table is in use
+    pub fn is_full(&self) -> bool {
+        self.slots.len() == self.slots.capacity() as usize
+    }
+
+    /// Returns the amount of textures the table holds at most
+    pub fn capacity(&self) -> u32 {
+        self.slots.capacity()
+    }
+}
+
+/// Describes a list of values with stable indices, reusing the indices of removed values
+#[derive(Debug)]
+struct SlotList<T> {
+    /// The values, [`None`] for removed ones
+    slots: Vec<Option<T>>,
+    /// The indices of removed values, reused by later inserts
+    free: Vec<u32>,
+    /// The amount of values the list holds at most
+    capacity: u32,
+    /// The amount of values in the list
+    len: usize,
+}
+
+impl<T> SlotList<T> {
+    /// Creates a new, empty [`SlotList`], which grows on demand up to `capacity` values
+    fn new(capacity: u32) -> Self {
+        Self {
+            slots: Vec::new(),
+            free: Vec::new(),
+            capacity,
+            len: 0,
+        }
+    }
+
+    /// Inserts a value and returns its index, [`None`] if the list is full
+    fn insert(&mut self, value: T) -> Option<u32> {
+        let index = match self.free.pop() {
+            Some(index) => index,
+            None if self.slots.len() < self.capacity as usize => {
+                self.slots.push(None);
+                self.slots.len() as u32 - 1
+            }
+            None => return None,
+        };
+        self.slots[index as usize] = Some(value);
+        self.len += 1;
+        Some(index)
+    }
+
+    /// Replaces the value at an index and returns the previous one,
+    /// [`None`] (leaving the list unchanged) if no value is stored there
+    fn replace(&mut self, index: u32, value: T) -> Option<T> {
+        self.slots
+            .get_mut(index as usize)
+            .and_then(Option::as_mut)
+            .map(|slot| std::mem::replace(slot, value))
+    }
+
+    /// Removes the value at an index and returns it, if any
+    fn remove(&mut self, index: u32) -> Option<T> {
+        let value = self.slots.get_mut(index as usize)?.take()?;
+        self.free.push(index);
+        self.len -= 1;
+        Some(value)
+    }
+
+    /// Returns the value at an index, if any
+    fn get(&self, index: u32) -> Option<&T> {
+        self.slots.get(index as usize)?.as_ref()
+    }
+
+    /// Returns the amount of values in the list
+    fn len(&self) -> usize {
+        self.len
+    }
+
+    /// Returns the amount of values the list holds at most
+    fn capacity(&self) -> u32 {
+        self.capacity
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn indices_stay_stable_and_get_reused() {
+        let mut list = SlotList::new(4);
+        assert_eq!(list.insert('a'), Some(0));
+        assert_eq!(list.insert('b'), Some(1));
+        assert_eq!(list.insert('c'), Some(2));
+
+        assert_eq!(list.remove(1), Some('b'));
+        assert_eq!(list.remove(1), None);
+        assert_eq!(list.get(2), Some(&'c'));
+        assert_eq!(list.len(), 2);
+
+        assert_eq!(list.insert('d'), Some(1));
+        assert_eq!(list.insert('e'), Some(3));
+        assert_eq!(list.insert('f'), None);
+        assert_eq!(list.len(), 4);
+    }
+
+    #[test]
+    fn replace_only_touches_stored_values() {
+        let mut list = SlotList::new(2);
+        let index = list.insert(1).unwrap();
+        assert_eq!(list.replace(index, 2), Some(1));
+        assert_eq!(list.get(index), Some(&2));
+        assert_eq!(list.replace(1, 3), None);
+        assert_eq!(list.get(1), None);
+        assert_eq!(list.len(), 1);
+    }
+}
@@ -1,7 +1,18 @@
-use std::{error::Error, fmt, path::PathBuf};
+use std::{
+    borrow::Cow,
+    error::Error,
+    fmt, fs,
+    path::{Path, PathBuf},
+};
 
 use image::{EncodableLayout, ImageReader};
 
+use crate::graphics::{
+    container::{self, ContainerImage},
+    mipmap::{self, MipmapGenerator},
+    readback::{Readback, ReadbackPool},
+};
+
 /// Describes a wrapper around [`wgpu::Texture`] with more information
 #[derive(Debug)]
 pub struct Texture {
@@ -11,6 +22,8 @@ pub struct Texture {
     raw_view: wgpu::TextureView,
     /// Represents the dimensions (width, height, depth) of the texture
     size: TextureSize,
+    /// Represents the dimension of the default texture view
+    view_dimension: wgpu::TextureViewDimension,
 }
 
 /// Describes a texture
@@ -18,12 +31,14 @@ pub struct Texture {
 pub struct TextureDescriptor<'a> {
     /// The optional debugging label of this texture
     pub label: Option<&'a str>,
-    /// The dimension of this texture (1D, 2D, 3D)
+    /// The dimension of this texture (1D, 2D, 2D array, 3D)
     pub dimension: TextureDimension,
     /// The usage of this texture (image binding, storage binding, render attachment)
     pub usage: TextureUsage,
     /// The data source of this texture (file, depth, stencil, blank, bytes)
-    pub source: TextureSource,
+    pub source: TextureSource<'a>,
+    /// The mip chain policy of this texture (none, generated on the GPU, pre-built levels)
+    pub mipmaps: MipPolicy,
 }
 
 /// Describes the size of a texture
@@ -34,6 +49,7 @@ pub struct TextureSize {
     /// The height of this texture (in pixels)
     pub height: u32,
     /// The depth of this texture (in pixels), this is 1 for 2D textures
+    /// and the amount of layers for 2D array textures
     pub depth: u32,
 }
 
@@ -44,12 +60,25 @@ pub enum TextureDimension {
     D1,
     /// Represents a 2D texture (a grid of pixels)
     D2,
+    /// Represents an array of equally sized 2D textures, which are bound and sampled
+    /// as a single texture with a layer index.
+    ///
+    /// Depth, stencil, blank and byte sources get `layers` layers,
+    /// byte sources and pre-built mip levels contain the layers one after the other.
+    /// File and container sources always have a single layer.
+    D2Array { layers: u32 },
+    /// Represents a multisampled 2D texture with `samples` samples per pixel,
+    /// which is rendered to as an MSAA attachment and resolved into a regular 2D texture.
+    ///
+    /// Multisampled textures always have a single mip level and no source data,
+    /// so only depth, stencil and blank sources make sense for them.
+    D2Multisampled { samples: u32 },
     /// Represents a 3D texture (a cube of pixels)
     D3,
 }
 
 /// Specifies the format of the texture
-#[derive(Debug, Clone, Copy)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
 pub enum TextureFormat {
     /// The standard RGBA format
     Standard,
@@ -61,12 +90,32 @@ pub enum TextureFormat {
     Signed,
     /// An unsigned integer format
     Unsigned,
+    /// A half-precision floating point RGBA format, useful for HDR and G-buffer targets
+    HalfFloat,
     /// A depth buffer format
     Depth,
     /// A stencil buffer format
     Stencil,
     /// A combined depth + stencil buffer format
     DepthStencil,
+    /// A block-compressed RGBA format with 1-bit alpha (4 bits per pixel),
+    /// requires [`wgpu::Features::TEXTURE_COMPRESSION_BC`]
+    Bc1 { is_srgb: bool },
+    /// A block-compressed RGBA format with smooth alpha (8 bits per pixel),
+    /// requires [`wgpu::Features::TEXTURE_COMPRESSION_BC`]
+    Bc3 { is_srgb: bool },
+    /// A block-compressed two channel format, useful for normal maps (8 bits per pixel),
+    /// requires [`wgpu::Features::TEXTURE_COMPRESSION_BC`]
+    Bc5,
+    /// A high quality block-compressed RGBA format (8 bits per pixel),
+    /// requires [`wgpu::Features::TEXTURE_COMPRESSION_BC`]
+    Bc7 { is_srgb: bool },
+    /// A block-compressed RGBA format common on mobile GPUs (8 bits per pixel),
+    /// requires [`wgpu::Features::TEXTURE_COMPRESSION_ETC2`]
+    Etc2 { is_srgb: bool },
+    /// A block-compressed RGBA format with 4x4 blocks common on mobile GPUs (8 bits per pixel),
+    /// requires [`wgpu::Features::TEXTURE_COMPRESSION_ASTC`]
+    Astc { is_srgb: bool },
 }
 
 /// Specifies the usage of the texture
@@ -89,11 +138,20 @@ pub enum TextureUsage {
         is_writable: bool,
         is_readable: bool,
     },
+    /// The texture serves as a render attachment that can also be sampled in a shader
+    /// afterwards, e.g. a depth buffer that a Hi-Z pyramid is built from
+    SampledAttachment {
+        is_writable: bool,
+        is_readable: bool,
+    },
 }
 
 /// Specifies the source of the texture
+///
+/// Byte sources can borrow their pixels, e.g. from a memory-mapped asset file,
+/// in which case the pixels go straight into the upload without being copied first
 #[derive(Debug, Clone)]
-pub enum TextureSource {
+pub enum TextureSource<'a> {
     /// The texture's source data comes from a file (png, jpeg, bmp)
     File { path: PathBuf },
     /// The texture's source data is an empty depth buffer of specified dimensions
@@ -113,7 +171,33 @@ pub enum TextureSource {
         width: u32,
         height: u32,
         format: TextureFormat,
-        bytes: Vec<u8>,
+        bytes: Cow<'a, [u8]>,
+    },
+    /// The texture's source data comes from a container file (ktx2, dds),
+    /// the texel data and mip chain of the file are uploaded as they are, without decoding
+    Container { path: PathBuf },
+}
+
+/// Specifies how the mip chain of a texture is created
+///
+/// Mipmaps are progressively halved copies of the texture, sampling a minified texture
+/// from a smaller level keeps the texture cache warm and avoids aliasing.
+///
+/// Depth and stencil textures always have a single mip level.
+#[derive(Debug, Clone, Default)]
+pub enum MipPolicy {
+    /// The texture has a single mip level
+    #[default]
+    None,
+    /// The full mip chain is allocated and generated on the GPU after uploading,
+    /// which requires a 2D (array) texture of the [`TextureFormat::Standard`] or
+    /// [`TextureFormat::UnsignedNormalized`] format
+    GenerateOnGpu,
+    /// The mip chain is uploaded from pre-built levels, starting at level 1
+    /// (level 0 comes from the texture source)
+    FromSource {
+        /// The pixels of each level past the first one, each level halving the previous size
+        levels: Vec<Vec<u8>>,
     },
 }
 
@@ -148,6 +232,20 @@ pub enum TextureError {
         /// Specifies which extent (width/height) was of an illegal size
         cause: &'static str,
     },
+    /// The texture format is not supported by the device
+    UnsupportedFormat {
+        /// The unsupported format
+        format: TextureFormat,
+        /// The device features the format requires
+        required_features: wgpu::Features,
+    },
+    /// The mip chain of the texture couldn't be created
+    MipmapFailure {
+        /// The mip level that failed
+        level: u32,
+        /// The underlying cause of the failure
+        cause: &'static str,
+    },
 }
 
 impl Texture {
@@ -165,48 +263,180 @@ impl Texture {
     pub fn size(&self) -> TextureSize {
         self.size
     }
+
+    /// Returns the amount of mip levels of the texture
+    pub fn mip_level_count(&self) -> u32 {
+        self.raw.mip_level_count()
+    }
+
+    /// Returns the amount of array layers of the texture
+    pub fn layer_count(&self) -> u32 {
+        self.raw.depth_or_array_layers()
+    }
+
+    /// Returns the amount of samples per pixel of the texture, which is 1 unless it's multisampled
+    pub fn sample_count(&self) -> u32 {
+        self.raw.sample_count()
+    }
+
+    /// Returns the dimension of the default texture view (see [`Texture::view()`])
+    pub fn view_dimension(&self) -> wgpu::TextureViewDimension {
+        self.view_dimension
+    }
+
+    /// Writes pixels into a rectangle of a single layer of the first mip level,
+    /// leaving the rest of the texture untouched
+    /// - `queue` -> the [`wgpu::Queue`] the write is scheduled on
+    /// - `origin` -> the (x, y, layer) of the top left corner of the rectangle
+    /// - `size` -> the (width, height) of the rectangle (in pixels)
+    /// - `bytes` -> the tightly packed pixels of the rectangle
+    ///
+    /// # Panics:
+    /// - If the texture has a compressed format.
+    /// - If the amount of bytes doesn't match the rectangle size.
+    pub fn write_region(
+        &self,
+        queue: &wgpu::Queue,
+        origin: (u32, u32, u32),
+        size: (u32, u32),
+        bytes: &[u8],
+    ) {
+        let pixel_size = self
+            .raw
+            .format()
+            .block_copy_size(None)
+            .filter(|_| !self.raw.format().is_compressed())
+            .expect("Regions can only be written to uncompressed color textures!");
+        let (width, height) = size;
+        assert_eq!(
+            bytes.len(),
+            (width * height * pixel_size) as usize,
+            "The amount of bytes doesn't match the region size!"
+        );
+        let (x, y, z) = origin;
+        queue.write_texture(
+            wgpu::TexelCopyTextureInfo {
+                texture: &self.raw,
+                mip_level: 0,
+                origin: wgpu::Origin3d { x, y, z },
+                aspect: wgpu::TextureAspect::All,
+            },
+            bytes,
+            wgpu::TexelCopyBufferLayout {
+                offset: 0,
+                bytes_per_row: Some(width * pixel_size),
+                rows_per_image: Some(height),
+            },
+            wgpu::Extent3d {
+                width,
+                height,
+                depth_or_array_layers: 1,
+            },
+        );
+    }
+
+    /// Reads pixels of a rectangle of a single layer of the first mip level back from the GPU
+    /// without blocking, e.g. for picking or screenshots
+    /// - `device` -> the [`wgpu::Device`] which is needed to build GPU resources
+    /// - `encoder` -> the command encoder that records the copy into a readback buffer
+    /// - `pool` -> the [`ReadbackPool`] that completes the read
+    /// - `origin` -> the (x, y, layer) of the top left corner of the rectangle
+    /// - `size` -> the (width, height) of the rectangle (in pixels)
+    ///
+    /// The pixels are tightly packed, the row padding the GPU copy needs is removed.
+    /// The read completes a few frames later, see [`ReadbackPool`].
+    ///
+    /// # Panics:
+    /// - If the texture is not readable.
+    /// - If the texture has a compressed or depth/stencil format.
+    /// - If the texture is multisampled.
+    pub fn read_async(
+        &self,
+        device: &wgpu::Device,
+        encoder: &mut wgpu::CommandEncoder,
+        pool: &mut ReadbackPool,
+        origin: (u32, u32, u32),
+        size: (u32, u32),
+    ) -> Readback<u8> {
+        assert!(
+            self.raw.usage().contains(wgpu::TextureUsages::COPY_SRC),
+            "Texture is not readable!"
+        );
+        assert_eq!(
+            self.raw.sample_count(),
+            1,
+            "Multisampled textures can't be read, read the resolved texture instead!"
+        );
+        let pixel_size = self
+            .raw
+            .format()
+            .block_copy_size(None)
+            .filter(|_| !self.raw.format().is_compressed())
+            .expect("Regions can only be read from uncompressed color textures!");
+        pool.read_texture(device, encoder, &self.raw, origin, size, pixel_size)
+    }
 }
 
 impl<'a> TextureDescriptor<'a> {
     /// Attempts to build a [`Texture`] from this descriptor, returns a [`TextureError`] upon failure
     /// - `device` -> the [`wgpu::Device`] needed to create this GPU resource
     /// - `queue` -> the [`wgpu::Queue`] needed to write the image data to this texture on the GPU
+    ///
+    /// A texture with [`MipPolicy::GenerateOnGpu`] creates a temporary [`MipmapGenerator`],
+    /// when building many of them, use [`TextureDescriptor::build_with()`] to share one.
     pub fn build(
         self,
         device: &wgpu::Device,
         queue: &wgpu::Queue,
     ) -> Result<Texture, TextureError> {
-        match self.source.clone() {
-            TextureSource::File { path } => Self::into_file(self, device, queue, path),
-            TextureSource::Depth { width, height } => Self::into_depth(self, device, width, height),
-            TextureSource::Stencil { width, height } => {
-                Self::into_stencil(self, device, width, height)
-            }
+        self.build_with(device, queue, &mut None)
+    }
+
+    /// Attempts to build a [`Texture`] from this descriptor, returns a [`TextureError`] upon failure
+    /// - `device` -> the [`wgpu::Device`] needed to create this GPU resource
+    /// - `queue` -> the [`wgpu::Queue`] needed to write the image data to this texture on the GPU
+    /// - `generator` -> the [`MipmapGenerator`] shared between builds, which is created
+    ///   the first time a texture with [`MipPolicy::GenerateOnGpu`] needs it
+    pub fn build_with(
+        self,
+        device: &wgpu::Device,
+        queue: &wgpu::Queue,
+        generator: &mut Option<MipmapGenerator>,
+    ) -> Result<Texture, TextureError> {
+        match &self.source {
+            TextureSource::File { path } => self.into_file(device, queue, generator, path),
+            TextureSource::Depth { width, height } => self.into_depth(device, *width, *height),
+            TextureSource::Stencil { width, height } => self.into_stencil(device, *width, *height),
             TextureSource::DepthStencil { width, height } => {
-                Self::into_depth_stencil(self, device, width, height)
+                self.into_depth_stencil(device, *width, *height)
             }
             TextureSource::Blank {
                 width,
                 height,
                 format,
-            } => Self::into_blank(self, device, width, height, format),
+            } => self.into_blank(device, queue, generator, *width, *height, *format),
             TextureSource::Bytes {
                 width,
                 height,
                 format,
                 bytes,
-            } => Self::into_bytes(self, device, queue, width, height, format, bytes),
+            } => self.into_bytes_with(device, queue, generator, *width, *height, *format, bytes),
+            TextureSource::Container { path } => self.into_container(device, queue, path),
         }
     }
 
-    fn upload_texture(
+    /// Uploads a single mip level, taking the block layout of `format` into account
+    fn upload_level(
         queue: &wgpu::Queue,
         texture: &Texture,
-        texture_size: TextureSize,
-        pixel_size: u32,
+        format: TextureFormat,
+        level_size: TextureSize,
         mip_level: u32,
         bytes: &[u8],
     ) {
+        let (block_width, block_height, block_size) = format.block_layout();
+        let blocks_per_row = level_size.width.div_ceil(block_width);
+        let block_rows = level_size.height.div_ceil(block_height);
         queue.write_texture(
             wgpu::TexelCopyTextureInfo {
                 texture: texture.raw(),
@@ -217,42 +447,83 @@ impl<'a> TextureDescriptor<'a> {
             bytes,
             wgpu::TexelCopyBufferLayout {
                 offset: 0,
-                bytes_per_row: Some(pixel_size * texture_size.width),
-                rows_per_image: Some(texture_size.height),
+                bytes_per_row: Some(blocks_per_row * block_size),
+                rows_per_image: Some(block_rows),
+            },
+            // Copies of compressed textures cover whole blocks,
+            // even when the mip level is smaller than a block
+            wgpu::Extent3d {
+                width: blocks_per_row * block_width,
+                height: block_rows * block_height,
+                depth_or_array_layers: level_size.depth,
             },
-            texture_size.raw(),
         );
     }
 
-    fn into_args(self, device: &wgpu::Device, size: TextureSize, format: TextureFormat) -> Texture {
+    fn into_args(
+        &self,
+        device: &wgpu::Device,
+        size: TextureSize,
+        format: TextureFormat,
+    ) -> Texture {
+        let is_depth_or_stencil = matches!(
+            format,
+            TextureFormat::Depth | TextureFormat::Stencil | TextureFormat::DepthStencil
+        );
+        let is_multisampled = self.dimension.sample_count() > 1;
+        let (mip_level_count, usage) = match &self.mipmaps {
+            _ if is_depth_or_stencil || is_multisampled => (1, self.usage.raw()),
+            MipPolicy::None => (1, self.usage.raw()),
+            MipPolicy::GenerateOnGpu => (
+                mipmap::full_mip_level_count(size.width, size.height),
+                self.usage.raw() | wgpu::TextureUsages::RENDER_ATTACHMENT,
+            ),
+            MipPolicy::FromSource { levels } => (levels.len() as u32 + 1, self.usage.raw()),
+        };
+        self.create_texture(device, size, format, mip_level_count, usage)
+    }
+
+    fn create_texture(
+        &self,
+        device: &wgpu::Device,
+        size: TextureSize,
+        format: TextureFormat,
+        mip_level_count: u32,
+        usage: wgpu::TextureUsages,
+    ) -> Texture {
         let raw_texture = device.create_texture(&wgpu::TextureDescriptor {
-            label: self.label, 
+            label: self.label,
             size: size.raw(),
-            mip_level_count: 1,
-            sample_count: 1,
+            mip_level_count,
+            sample_count: self.dimension.sample_count(),
             dimension: self.dimension.raw(),
             format: format.raw(),
-            usage: self.usage.raw(),
+            usage,
             view_formats: &[],
         });
         Texture {
-            raw_view: raw_texture.create_view(&wgpu::TextureViewDescriptor::default()),
+            raw_view: raw_texture.create_view(&wgpu::TextureViewDescriptor {
+                dimension: Some(self.dimension.view_raw()),
+                ..Default::default()
+            }),
             raw: raw_texture,
             size,
+            view_dimension: self.dimension.view_raw(),
         }
     }
 
     fn into_file(
-        self,
+        &self,
         device: &wgpu::Device,
         queue: &wgpu::Queue,
-        path: PathBuf,
+        generator: &mut Option<MipmapGenerator>,
+        path: &Path,
     ) -> Result<Texture, TextureError> {
-        let image_reader = match ImageReader::open(&path) {
+        let image_reader = match ImageReader::open(path) {
             Ok(image_reader) => image_reader,
             Err(cause) => {
                 return Err(TextureError::OpenFailure {
-                    file: path,
+                    file: path.to_path_buf(),
                     cause: Box::new(cause),
                 });
             }
@@ -261,7 +532,7 @@ impl<'a> TextureDescriptor<'a> {
             Ok(image) => image,
             Err(cause) => {
                 return Err(TextureError::DecodeFailure {
-                    file: path,
+                    file: path.to_path_buf(),
                     cause: Box::new(cause),
                 });
             }
@@ -278,24 +549,26 @@ impl<'a> TextureDescriptor<'a> {
             && !is_writable
         {
             return Err(TextureError::WriteFailure {
-                file: path,
+                file: path.to_path_buf(),
                 cause: "Texture is not writable",
             });
         }
+        self.validate_mipmaps(image_size, TextureFormat::Standard)?;
         let texture = self.into_args(device, image_size, TextureFormat::Standard);
-        Self::upload_texture(
+        Self::upload_level(
             queue,
             &texture,
+            TextureFormat::Standard,
             image_size,
-            4,
             0,
             image.into_rgba8().as_bytes(),
         );
+        self.upload_mipmaps(device, queue, generator, &texture, TextureFormat::Standard);
         Ok(texture)
     }
 
     fn into_depth(
-        self,
+        &self,
         device: &wgpu::Device,
         width: u32,
         height: u32,
@@ -304,13 +577,13 @@ impl<'a> TextureDescriptor<'a> {
         let size = TextureSize {
             width,
             height,
-            depth: 1,
+            depth: self.dimension.layer_count(),
         };
         Ok(self.into_args(device, size, TextureFormat::Depth))
     }
 
     fn into_stencil(
-        self,
+        &self,
         device: &wgpu::Device,
         width: u32,
         height: u32,
@@ -321,14 +594,14 @@ impl<'a> TextureDescriptor<'a> {
             TextureSize {
                 width,
                 height,
-                depth: 1,
+                depth: self.dimension.layer_count(),
             },
             TextureFormat::Stencil,
         ))
     }
 
     fn into_depth_stencil(
-        self,
+        &self,
         device: &wgpu::Device,
         width: u32,
         height: u32,
@@ -339,29 +612,35 @@ impl<'a> TextureDescriptor<'a> {
             TextureSize {
                 width,
                 height,
-                depth: 1,
+                depth: self.dimension.layer_count(),
             },
             TextureFormat::DepthStencil,
         ))
     }
 
     fn into_blank(
-        self,
+        &self,
         device: &wgpu::Device,
+        queue: &wgpu::Queue,
+        generator: &mut Option<MipmapGenerator>,
         width: u32,
         height: u32,
         format: TextureFormat,
     ) -> Result<Texture, TextureError> {
         Self::err_on_zero(width, height)?;
-        Ok(self.into_args(
-            device,
-            TextureSize {
-                width,
-                height,
-                depth: 1,
-            },
-            format,
-        ))
+        let size = TextureSize {
+            width,
+            height,
+            depth: self.dimension.layer_count(),
+        };
+        self.validate_mipmaps(size, format)?;
+        let texture = self.into_args(device, size, format);
+        // A blank texture has nothing to generate from yet,
+        // call `MipmapGenerator::generate()` once it's been rendered to
+        if let MipPolicy::FromSource { .. } = self.mipmaps {
+            self.upload_mipmaps(device, queue, generator, &texture, format);
+        }
+        Ok(texture)
     }
 
     pub fn into_bytes(
@@ -372,18 +651,276 @@ impl<'a> TextureDescriptor<'a> {
         height: u32,
         format: TextureFormat,
         bytes: Vec<u8>,
+    ) -> Result<Texture, TextureError> {
+        self.into_bytes_with(device, queue, &mut None, width, height, format, &bytes)
+    }
+
+    fn into_bytes_with(
+        &self,
+        device: &wgpu::Device,
+        queue: &wgpu::Queue,
+        generator: &mut Option<MipmapGenerator>,
+        width: u32,
+        height: u32,
+        format: TextureFormat,
+        bytes: &[u8],
     ) -> Result<Texture, TextureError> {
         Self::err_on_zero(width, height)?;
         let texture_size = TextureSize {
             width,
             height,
-            depth: 1,
+            depth: self.dimension.layer_count(),
         };
+        Self::err_on_unsupported(device, format)?;
+        Self::err_on_unaligned(width, height, format)?;
+        self.validate_mipmaps(texture_size, format)?;
         let texture = self.into_args(device, texture_size, format);
-        Self::upload_texture(queue, &texture, texture_size, 4, 0, &bytes);
+        Self::upload_level(queue, &texture, format, texture_size, 0, bytes);
+        self.upload_mipmaps(device, queue, generator, &texture, format);
         Ok(texture)
     }
 
+    fn into_container(
+        &self,
+        device: &wgpu::Device,
+        queue: &wgpu::Queue,
+        path: &Path,
+    ) -> Result<Texture, TextureError> {
+        let bytes = match fs::read(path) {
+            Ok(bytes) => bytes,
+            Err(cause) => {
+                return Err(TextureError::OpenFailure {
+                    file: path.to_path_buf(),
+                    cause: Box::new(cause),
+                });
+            }
+        };
+        let image = match container::parse(&bytes) {
+            Ok(image) => image,
+            Err(cause) => {
+                return Err(TextureError::DecodeFailure {
+                    file: path.to_path_buf(),
+                    cause: Box::new(cause),
+                });
+            }
+        };
+        self.upload_container(device, queue, image)
+    }
+
+    /// Attempts to build a [`Texture`] from an already parsed container image,
+    /// the [`TextureDescriptor::source`] is ignored and the mip chain of the image is used
+    /// - `device` -> the [`wgpu::Device`] needed to create this GPU resource
+    /// - `queue` -> the [`wgpu::Queue`] needed to write the texel data to this texture on the GPU
+    /// - `image` -> the parsed [`ContainerImage`]
+    ///
+    /// # Errors:
+    /// - If the texture is not writable.
+    /// - If the image has no mip levels, more than its size allows, or a level with the wrong
+    ///   amount of bytes.
+    pub fn build_from_container(
+        self,
+        device: &wgpu::Device,
+        queue: &wgpu::Queue,
+        image: ContainerImage,
+    ) -> Result<Texture, TextureError> {
+        self.upload_container(device, queue, image)
+    }
+
+    fn upload_container(
+        &self,
+        device: &wgpu::Device,
+        queue: &wgpu::Queue,
+        image: ContainerImage,
+    ) -> Result<Texture, TextureError> {
+        Self::err_on_zero(image.width, image.height)?;
+        Self::err_on_unsupported(device, image.format)?;
+        Self::err_on_unaligned(image.width, image.height, image.format)?;
+        if let TextureUsage::Image {
+            is_writable,
+            is_readable: _is_readable,
+        } = self.usage
+            && !is_writable
+        {
+            let file = match &self.source {
+                TextureSource::Container { path } => path.to_path_buf(),
+                _ => PathBuf::new(),
+            };
+            return Err(TextureError::WriteFailure {
+                file,
+                cause: "Texture is not writable",
+            });
+        }
+        Self::validate_container_levels(&image)?;
+
+        let size = TextureSize {
+            width: image.width,
+            height: image.height,
+            depth: 1,
+        };
+        let texture = self.create_texture(
+            device,
+            size,
+            image.format,
+            image.levels.len() as u32,
+            self.usage.raw(),
+        );
+        for (level, bytes) in image.levels.iter().enumerate() {
+            let level = level as u32;
+            let level_size = TextureSize {
+                width: mipmap::mip_level_size(size.width, level),
+                height: mipmap::mip_level_size(size.height, level),
+                depth: 1,
+            };
+            Self::upload_level(queue, &texture, image.format, level_size, level, bytes);
+        }
+        Ok(texture)
+    }
+
+    /// Checks that the mip chain of a container image fits its size and every level
+    /// holds exactly the bytes of a tightly packed level
+    fn validate_container_levels(image: &ContainerImage) -> Result<(), TextureError> {
+        let level_count = image.levels.len() as u32;
+        if level_count == 0 {
+            return Err(TextureError::MipmapFailure {
+                level: 0,
+                cause: "Container image has no mip levels",
+            });
+        }
+        if level_count > mipmap::full_mip_level_count(image.width, image.height) {
+            return Err(TextureError::MipmapFailure {
+                level: level_count - 1,
+                cause: "Too many mip levels for the texture size",
+            });
+        }
+        for (level, bytes) in image.levels.iter().enumerate() {
+            let level = level as u32;
+            if bytes.len()
+                != container::level_byte_size(image.format, image.width, image.height, level)
+            {
+                return Err(TextureError::MipmapFailure {
+                    level,
+                    cause: "Mip level has the wrong amount of bytes",
+                });
+            }
+        }
+
+        Ok(())
+    }
+
+    fn err_on_unsupported(
+        device: &wgpu::Device,
+        format: TextureFormat,
+    ) -> Result<(), TextureError> {
+        let required_features = format.required_features();
+        if !device.features().contains(required_features) {
+            return Err(TextureError::UnsupportedFormat {
+                format,
+                required_features,
+            });
+        }
+
+        Ok(())
+    }
+
+    fn err_on_unaligned(
+        width: u32,
+        height: u32,
+        format: TextureFormat,
+    ) -> Result<(), TextureError> {
+        let (block_width, block_height, _) = format.block_layout();
+        if width % block_width != 0 || height % block_height != 0 {
+            return Err(TextureError::IllegalSize {
+                size: (width, height),
+                cause: "Compressed texture size must be a multiple of the block size",
+            });
+        }
+
+        Ok(())
+    }
+
+    /// Checks that the mip policy can be applied to a texture of `size` and `format`
+    fn validate_mipmaps(
+        &self,
+        size: TextureSize,
+        format: TextureFormat,
+    ) -> Result<(), TextureError> {
+        match &self.mipmaps {
+            MipPolicy::None => Ok(()),
+            MipPolicy::GenerateOnGpu => {
+                if !matches!(
+                    self.dimension,
+                    TextureDimension::D2 | TextureDimension::D2Array { .. }
+                ) {
+                    return Err(TextureError::MipmapFailure {
+                        level: 1,
+                        cause: "Mipmaps can only be generated for 2D and 2D array textures",
+                    });
+                }
+                if !matches!(
+                    format,
+                    TextureFormat::Standard | TextureFormat::UnsignedNormalized
+                ) {
+                    return Err(TextureError::MipmapFailure {
+                        level: 1,
+                        cause: "Mipmaps can only be generated for renderable, filterable formats",
+                    });
+                }
+                Ok(())
+            }
+            MipPolicy::FromSource { levels } => {
+                let level_count = levels.len() as u32 + 1;
+                if level_count > mipmap::full_mip_level_count(size.width, size.height) {
+                    return Err(TextureError::MipmapFailure {
+                        level: level_count - 1,
+                        cause: "Too many mip levels for the texture size",
+                    });
+                }
+                for (index, level) in levels.iter().enumerate() {
+                    let level_index = index as u32 + 1;
+                    let width = mipmap::mip_level_size(size.width, level_index);
+                    let height = mipmap::mip_level_size(size.height, level_index);
+                    let layer_size = container::level_byte_size(format, width, height, 0);
+                    if level.len() != layer_size * size.depth as usize {
+                        return Err(TextureError::MipmapFailure {
+                            level: level_index,
+                            cause: "Mip level has the wrong amount of bytes",
+                        });
+                    }
+                }
+                Ok(())
+            }
+        }
+    }
+
+    /// Fills out the mip levels past the first one according to the mip policy
+    fn upload_mipmaps(
+        &self,
+        device: &wgpu::Device,
+        queue: &wgpu::Queue,
+        generator: &mut Option<MipmapGenerator>,
+        texture: &Texture,
+        format: TextureFormat,
+    ) {
+        match &self.mipmaps {
+            MipPolicy::None => (),
+            MipPolicy::GenerateOnGpu => generator
+                .get_or_insert_with(|| MipmapGenerator::new(device))
+                .generate(device, queue, texture),
+            MipPolicy::FromSource { levels } => {
+                let size = texture.size();
+                for (index, level) in levels.iter().enumerate() {
+                    let level_index = index as u32 + 1;
+                    let level_size = TextureSize {
+                        width: mipmap::mip_level_size(size.width, level_index),
+                        height: mipmap::mip_level_size(size.height, level_index),
+                        depth: size.depth,
+                    };
+                    Self::upload_level(queue, texture, format, level_size, level_index, level);
+                }
+            }
+        }
+    }
+
     fn err_on_zero(width: u32, height: u32) -> Result<(), TextureError> {
         if width == 0 {
             return Err(TextureError::IllegalSize {
@@ -419,10 +956,56 @@ impl TextureDimension {
     pub fn raw(self) -> wgpu::TextureDimension {
         match self {
             TextureDimension::D1 => wgpu::TextureDimension::D1,
-            TextureDimension::D2 => wgpu::TextureDimension::D2,
+            TextureDimension::D2
+            | TextureDimension::D2Array { .. }
+            | TextureDimension::D2Multisampled { .. } => wgpu::TextureDimension::D2,
             TextureDimension::D3 => wgpu::TextureDimension::D3,
         }
     }
+
+    /// Maps the high level [`TextureDimension`] to the [`wgpu::TextureViewDimension`]
+    /// of the default texture view
+    pub fn view_raw(self) -> wgpu::TextureViewDimension {
+        match self {
+            TextureDimension::D1 => wgpu::TextureViewDimension::D1,
+            TextureDimension::D2 | TextureDimension::D2Multisampled { .. } => {
+                wgpu::TextureViewDimension::D2
+            }
+            TextureDimension::D2Array { .. } => wgpu::TextureViewDimension::D2Array,
+            TextureDimension::D3 => wgpu::TextureViewDimension::D3,
+        }
+    }
+
+    /// Returns the amount of layers of a texture of this dimension
+    ///
+    /// # Panics:
+    /// - If a [`TextureDimension::D2Array`] has zero layers.
+    pub fn layer_count(self) -> u32 {
+        match self {
+            TextureDimension::D2Array { layers } => {
+                assert!(layers > 0, "A 2D array texture needs at least one layer!");
+                layers
+            }
+            _ => 1,
+        }
+    }
+
+    /// Returns the amount of samples per pixel of a texture of this dimension
+    ///
+    /// # Panics:
+    /// - If a [`TextureDimension::D2Multisampled`] has a sample count that's not a power of two.
+    pub fn sample_count(self) -> u32 {
+        match self {
+            TextureDimension::D2Multisampled { samples } => {
+                assert!(
+                    samples.is_power_of_two(),
+                    "The sample count of a multisampled texture must be a power of two!"
+                );
+                samples
+            }
+            _ => 1,
+        }
+    }
 }
 
 impl TextureFormat {
@@ -434,9 +1017,67 @@ impl TextureFormat {
             TextureFormat::UnsignedNormalized => wgpu::TextureFormat::Rgba8Unorm,
             TextureFormat::Signed => wgpu::TextureFormat::Rgba8Sint,
             TextureFormat::Unsigned => wgpu::TextureFormat::Rgba8Uint,
+            TextureFormat::HalfFloat => wgpu::TextureFormat::Rgba16Float,
             TextureFormat::Depth => wgpu::TextureFormat::Depth32Float,
             TextureFormat::Stencil => wgpu::TextureFormat::Stencil8,
             TextureFormat::DepthStencil => wgpu::TextureFormat::Depth24PlusStencil8,
+            TextureFormat::Bc1 { is_srgb: true } => wgpu::TextureFormat::Bc1RgbaUnormSrgb,
+            TextureFormat::Bc1 { is_srgb: false } => wgpu::TextureFormat::Bc1RgbaUnorm,
+            TextureFormat::Bc3 { is_srgb: true } => wgpu::TextureFormat::Bc3RgbaUnormSrgb,
+            TextureFormat::Bc3 { is_srgb: false } => wgpu::TextureFormat::Bc3RgbaUnorm,
+            TextureFormat::Bc5 => wgpu::TextureFormat::Bc5RgUnorm,
+            TextureFormat::Bc7 { is_srgb: true } => wgpu::TextureFormat::Bc7RgbaUnormSrgb,
+            TextureFormat::Bc7 { is_srgb: false } => wgpu::TextureFormat::Bc7RgbaUnorm,
+            TextureFormat::Etc2 { is_srgb: true } => wgpu::TextureFormat::Etc2Rgba8UnormSrgb,
+            TextureFormat::Etc2 { is_srgb: false } => wgpu::TextureFormat::Etc2Rgba8Unorm,
+            TextureFormat::Astc { is_srgb } => wgpu::TextureFormat::Astc {
+                block: wgpu::AstcBlock::B4x4,
+                channel: if is_srgb {
+                    wgpu::AstcChannel::UnormSrgb
+                } else {
+                    wgpu::AstcChannel::Unorm
+                },
+            },
+        }
+    }
+
+    /// Returns the device features required to use this format
+    pub fn required_features(self) -> wgpu::Features {
+        match self {
+            TextureFormat::Bc1 { .. }
+            | TextureFormat::Bc3 { .. }
+            | TextureFormat::Bc5
+            | TextureFormat::Bc7 { .. } => wgpu::Features::TEXTURE_COMPRESSION_BC,
+            TextureFormat::Etc2 { .. } => wgpu::Features::TEXTURE_COMPRESSION_ETC2,
+            TextureFormat::Astc { .. } => wgpu::Features::TEXTURE_COMPRESSION_ASTC,
+            _ => wgpu::Features::empty(),
+        }
+    }
+
+    /// Returns `true` if this is a block-compressed format
+    pub fn is_compressed(self) -> bool {
+        self.block_layout().0 > 1
+    }
+
+    /// Returns the block layout of this format as `(block width, block height, block size in bytes)`,
+    /// uncompressed formats have 1x1 blocks, one per pixel
+    pub fn block_layout(self) -> (u32, u32, u32) {
+        match self {
+            TextureFormat::Standard
+            | TextureFormat::SignedNormalized
+            | TextureFormat::UnsignedNormalized
+            | TextureFormat::Signed
+            | TextureFormat::Unsigned
+            | TextureFormat::Depth
+            | TextureFormat::DepthStencil => (1, 1, 4),
+            TextureFormat::HalfFloat => (1, 1, 8),
+            TextureFormat::Stencil => (1, 1, 1),
+            TextureFormat::Bc1 { .. } => (4, 4, 8),
+            TextureFormat::Bc3 { .. }
+            | TextureFormat::Bc5
+            | TextureFormat::Bc7 { .. }
+            | TextureFormat::Etc2 { .. }
+            | TextureFormat::Astc { .. } => (4, 4, 16),
         }
     }
 }
@@ -474,6 +1115,19 @@ impl TextureUsage {
                 (false, true) => wgpu::TextureUsages::RENDER_ATTACHMENT | readable,
                 (false, false) => wgpu::TextureUsages::RENDER_ATTACHMENT,
             },
+            TextureUsage::SampledAttachment {
+                is_writable,
+                is_readable,
+            } => {
+                let sampled =
+                    wgpu::TextureUsages::RENDER_ATTACHMENT | wgpu::TextureUsages::TEXTURE_BINDING;
+                match (is_writable, is_readable) {
+                    (true, true) => sampled | writable | readable,
+                    (true, false) => sampled | writable,
+                    (false, true) => sampled | readable,
+                    (false, false) => sampled,
+                }
+            }
         }
     }
 }
@@ -505,6 +1159,23 @@ impl fmt::Display for TextureError {
             TextureError::IllegalSize { size, cause } => {
                 write!(f, "Illegal texture size: {:?}:\n\t{}", size, cause)
             }
+            TextureError::UnsupportedFormat {
+                format,
+                required_features,
+            } => {
+                write!(
+                    f,
+                    "Unsupported texture format {:?}:\n\tRequires device features {:?}",
+                    format, required_features
+                )
+            }
+            TextureError::MipmapFailure { level, cause } => {
+                write!(
+                    f,
+                    "Couldn't create texture mip level {}:\n\t{}",
+                    level, cause
+                )
+            }
         }
     }
 }
@@ -0,0 +1,222 @@
+use std::sync::mpsc;
+
+use wgpu::{BufferDescriptor, CommandEncoder, Device};
+
+/// The default size of a single staging chunk (1 MiB).
+pub const DEFAULT_CHUNK_SIZE: u64 = 1 << 20;
+
+/// A ring of reusable staging chunks, used for uploading data to GPU buffers.
+///
+/// Every [`wgpu::Queue::write_buffer()`] call allocates its own staging memory internally,
+/// which adds up quickly when a lot of small buffers are flushed every frame.
+///
+/// An [`UploadBelt`] instead writes the data into mapped staging chunks that it owns,
+/// and records a copy from the chunk to the target buffer into a caller-supplied
+/// [`wgpu::CommandEncoder`], the chunks are then recycled once the GPU is done with them.
+///
+/// The belt is used in 3 steps every frame:
+/// - Write data with [`UploadBelt::write()`] (or any of the `BufferHandle::*_with()` flushes)
+/// - Call [`UploadBelt::finish()`] before submitting the encoder
+/// - Call [`UploadBelt::recall()`] after submitting the encoder
+///
+/// ```rust
+/// let mut encoder = device.create_command_encoder(&Default::default());
+/// instance_buffer.flush_dirty_with(&device, &mut belt, &mut encoder);
+/// belt.finish();
+/// queue.submit([encoder.finish()]);
+/// belt.recall();
+/// ```
+///
+/// Recalled chunks become available again once the GPU signals that the submission
+/// has completed, which happens on the next `device.poll()` or `queue.submit()`.
+#[derive(Debug)]
+pub struct UploadBelt {
+    /// The default size of a newly allocated chunk
+    chunk_size: u64,
+    /// The chunks that are mapped and currently being written to
+    active_chunks: Vec<UploadChunk>,
+    /// The chunks that have been unmapped and are waiting for the GPU
+    closed_chunks: Vec<UploadChunk>,
+    /// The chunks that are mapped and ready to be reused
+    free_chunks: Vec<UploadChunk>,
+    /// Sends chunks back to the belt once they've been re-mapped
+    sender: mpsc::Sender<UploadChunk>,
+    /// Receives chunks that have been re-mapped
+    receiver: mpsc::Receiver<UploadChunk>,
+    /// The total amount of bytes written through the belt since the last [`UploadBelt::finish()`]
+    written_bytes: u64,
+}
+
+/// A single staging chunk of an [`UploadBelt`].
+#[derive(Debug)]
+struct UploadChunk {
+    /// The raw staging buffer
+    buffer: wgpu::Buffer,
+    /// The size of the staging buffer in bytes
+    size: u64,
+    /// The offset of the next write in bytes
+    offset: u64,
+}
+
+impl UploadBelt {
+    /// Creates a new [`UploadBelt`].
+    /// - `chunk_size` -> the size of a single staging chunk in bytes,
+    ///   writes larger than this get a dedicated chunk of their own
+    ///
+    /// # Panics:
+    /// - If `chunk_size` is equal to zero.
+    pub fn new(chunk_size: u64) -> Self {
+        assert!(chunk_size > 0, "Chunk size cannot be zero!");
+        let (sender, receiver) = mpsc::channel();
+        Self {
+            chunk_size,
+            active_chunks: Vec::new(),
+            closed_chunks: Vec::new(),
+            free_chunks: Vec::new(),
+            sender,
+            receiver,
+            written_bytes: 0,
+        }
+    }
+
+    /// Writes `bytes` into the `target` buffer at `offset`.
+    ///
+    /// The bytes are written into a staging chunk right away, and a copy from the chunk
+    /// to the `target` buffer is recorded into `encoder`.
+    ///
+    /// # Panics:
+    /// - If the length of `bytes` or `offset` is not a multiple of [`wgpu::COPY_BUFFER_ALIGNMENT`].
+    pub fn write(
+        &mut self,
+        device: &Device,
+        encoder: &mut CommandEncoder,
+        target: &wgpu::Buffer,
+        offset: u64,
+        bytes: &[u8],
+    ) {
+        let size = bytes.len() as u64;
+        assert!(
+            size % wgpu::COPY_BUFFER_ALIGNMENT == 0,
+            "Cannot upload {} bytes, the size must be a multiple of {}!",
+            size,
+            wgpu::COPY_BUFFER_ALIGNMENT
+        );
+        assert!(
+            offset % wgpu::COPY_BUFFER_ALIGNMENT == 0,
+            "Cannot upload at offset {}, the offset must be a multiple of {}!",
+            offset,
+            wgpu::COPY_BUFFER_ALIGNMENT
+        );
+        if size == 0 {
+            return;
+        }
+
+        let chunk = self.acquire_chunk(device, size);
+        chunk
+            .buffer
+            .slice(chunk.offset..chunk.offset + size)
+            .get_mapped_range_mut()
+            .copy_from_slice(bytes);
+        encoder.copy_buffer_to_buffer(&chunk.buffer, chunk.offset, target, offset, size);
+        chunk.offset = align_to(chunk.offset + size, wgpu::MAP_ALIGNMENT);
+        self.written_bytes += size;
+    }
+
+    /// Finishes the current batch of writes by unmapping all active chunks.
+    ///
+    /// This must be called before the encoders that were written to get submitted.
+    pub fn finish(&mut self) {
+        for chunk in self.active_chunks.drain(..) {
+            chunk.buffer.unmap();
+            self.closed_chunks.push(chunk);
+        }
+        self.written_bytes = 0;
+    }
+
+    /// Recalls all finished chunks so they can be reused once the GPU is done with them.
+    ///
+    /// This must be called after the encoders that were written to have been submitted.
+    pub fn recall(&mut self) {
+        self.receive_chunks();
+        for chunk in self.closed_chunks.drain(..) {
+            let sender = self.sender.clone();
+            let buffer = chunk.buffer.clone();
+            buffer
+                .slice(..)
+                .map_async(wgpu::MapMode::Write, move |result| {
+                    // A chunk that failed to map is simply dropped
+                    if result.is_ok() {
+                        let _ = sender.send(chunk);
+                    }
+                });
+        }
+    }
+
+    /// Returns the amount of bytes written through the belt since the last [`UploadBelt::finish()`].
+    pub fn written_bytes(&self) -> u64 {
+        self.written_bytes
+    }
+
+    /// Returns the total amount of chunks owned by the belt
+    /// (excluding chunks that are still in flight on the GPU).
+    pub fn chunk_count(&self) -> usize {
+        self.active_chunks.len() + self.closed_chunks.len() + self.free_chunks.len()
+    }
+
+    /// Returns the default size of a single staging chunk in bytes.
+    pub fn chunk_size(&self) -> u64 {
+        self.chunk_size
+    }
+
+    /// Moves the chunks that the GPU is done with back into the free list.
+    fn receive_chunks(&mut self) {
+        while let Ok(mut chunk) = self.receiver.try_recv() {
+            chunk.offset = 0;
+            self.free_chunks.push(chunk);
+        }
+    }
+
+    /// Finds an active chunk with enough room for `size` bytes,
+    /// reuses a free chunk or allocates a new one if there's none.
+    fn acquire_chunk(&mut self, device: &Device, size: u64) -> &mut UploadChunk {
+        if let Some(index) = self
+            .active_chunks
+            .iter()
+            .position(|chunk| chunk.offset + size <= chunk.size)
+        {
+            return &mut self.active_chunks[index];
+        }
+
+        self.receive_chunks();
+        let chunk = match self.free_chunks.iter().position(|chunk| size <= chunk.size) {
+            Some(index) => self.free_chunks.swap_remove(index),
+            None => {
+                let chunk_size = align_to(size.max(self.chunk_size), wgpu::MAP_ALIGNMENT);
+                UploadChunk {
+                    buffer: device.create_buffer(&BufferDescriptor {
+                        label: Some("Upload belt chunk"),
+                        size: chunk_size,
+                        usage: wgpu::BufferUsages::MAP_WRITE | wgpu::BufferUsages::COPY_SRC,
+                        mapped_at_creation: true,
+                    }),
+                    size: chunk_size,
+                    offset: 0,
+                }
+            }
+        };
+        self.active_chunks.push(chunk);
+        // Unwrap is safe here, a chunk was just pushed
+        self.active_chunks.last_mut().unwrap()
+    }
+}
+
+impl Default for UploadBelt {
+    fn default() -> Self {
+        Self::new(DEFAULT_CHUNK_SIZE)
+    }
+}
+
+/// Aligns `value` up to the next multiple of `alignment`.
+fn align_to(value: u64, alignment: u64) -> u64 {
+    value.div_ceil(alignment) * alignment
+}
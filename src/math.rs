@@ -14,6 +14,16 @@ pub mod mat4;
 /// Contains functionality related to quaternions.
 pub mod quat;
 
+/// Contains functionality related to batched operations over many values.
+pub mod batch;
+/// Contains functionality related to bounding volumes.
+pub mod bounds;
+/// Contains functionality related to view frustums and culling.
+pub mod frustum;
+
+/// Contains the SIMD kernels behind the matrix and quaternion operations.
+mod simd;
+
 /// `EPSILON` is a small number `(0.001)` that is used for equality comparisons
 pub const EPSILON: f32 = 1e-3;
 
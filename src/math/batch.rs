@@ -0,0 +1,421 @@
+use crate::math::{mat4::Mat4, quat::Quat, vec3::Vec3, vec4::Vec4};
+
+/// Composes a transformation matrix for every translation, rotation and scale,
+/// see [`Mat4::from_trs()`]
+///
+/// The matrices can be written straight into the items of a buffer,
+/// see [`crate::graphics::buffer::BufferHandle::items_mut()`]
+///
+/// # Panics:
+/// - If the slices are of different lengths.
+/// - If any of the rotations has a near-zero length.
+pub fn compose_trs_batch(
+    translations: &[Vec3],
+    rotations: &[Quat],
+    scales: &[Vec3],
+    out: &mut [Mat4],
+) {
+    assert!(
+        translations.len() == out.len()
+            && rotations.len() == out.len()
+            && scales.len() == out.len(),
+        "Translations, rotations, scales and output matrices are of different lengths!"
+    );
+    for (((translation, rotation), scale), out) in
+        translations.iter().zip(rotations).zip(scales).zip(out)
+    {
+        *out = Mat4::from_trs(*translation, *rotation, *scale);
+    }
+}
+
+/// Normalizes every vector in place, see [`Vec3::normalize_self()`]
+///
+/// Vectors of a near-zero length are left as they are.
+pub fn normalize_all(vectors: &mut [Vec3]) {
+    for vector in vectors {
+        let len = vector.length();
+        // Selecting the scale instead of skipping keeps the loop free of branches
+        let scale = if len < f32::EPSILON { 1.0 } else { 1.0 / len };
+        *vector = *vector * scale;
+    }
+}
+
+/// A structure-of-arrays collection of 3D vectors
+///
+/// Every component is stored in its own contiguous array, so a batched operation works on
+/// as many vectors at once as the SIMD registers fit, instead of a single vector per register.
+///
+/// The operations are written as plain loops over the component arrays,
+/// which the compiler vectorizes for whatever instruction set it targets.
+#[derive(Debug, Clone, Default, PartialEq)]
+pub struct Vec3Soa {
+    x: Vec<f32>,
+    y: Vec<f32>,
+    z: Vec<f32>,
+}
+
+/// A structure-of-arrays collection of 4D vectors, see [`Vec3Soa`]
+#[derive(Debug, Clone, Default, PartialEq)]
+pub struct Vec4Soa {
+    x: Vec<f32>,
+    y: Vec<f32>,
+    z: Vec<f32>,
+    w: Vec<f32>,
+}
+
+impl Vec3Soa {
+    /// Creates a new empty collection
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Creates a new empty collection that can hold `capacity` vectors without reallocating
+    pub fn with_capacity(capacity: usize) -> Self {
+        Self {
+            x: Vec::with_capacity(capacity),
+            y: Vec::with_capacity(capacity),
+            z: Vec::with_capacity(capacity),
+        }
+    }
+
+    /// Creates a new collection from a slice of vectors
+    pub fn from_slice(vectors: &[Vec3]) -> Self {
+        let mut soa = Self::with_capacity(vectors.len());
+        soa.extend_from_slice(vectors);
+        soa
+    }
+
+    /// Adds a vector to the end of the collection
+    pub fn push(&mut self, vector: Vec3) {
+        self.x.push(vector.x);
+        self.y.push(vector.y);
+        self.z.push(vector.z);
+    }
+
+    /// Adds a slice of vectors to the end of the collection
+    pub fn extend_from_slice(&mut self, vectors: &[Vec3]) {
+        self.x.extend(vectors.iter().map(|vector| vector.x));
+        self.y.extend(vectors.iter().map(|vector| vector.y));
+        self.z.extend(vectors.iter().map(|vector| vector.z));
+    }
+
+    /// Returns the vector at `index`
+    ///
+    /// # Panics:
+    /// - If `index` is out of bounds.
+    pub fn get(&self, index: usize) -> Vec3 {
+        Vec3::new(self.x[index], self.y[index], self.z[index])
+    }
+
+    /// Replaces the vector at `index`
+    ///
+    /// # Panics:
+    /// - If `index` is out of bounds.
+    pub fn set(&mut self, index: usize, vector: Vec3) {
+        self.x[index] = vector.x;
+        self.y[index] = vector.y;
+        self.z[index] = vector.z;
+    }
+
+    /// Writes every vector into `out`
+    ///
+    /// # Panics:
+    /// - If `out` is of a different length than the collection.
+    pub fn write_to(&self, out: &mut [Vec3]) {
+        assert_eq!(
+            self.len(),
+            out.len(),
+            "Output vectors are of a different length than the collection!"
+        );
+        for (index, out) in out.iter_mut().enumerate() {
+            *out = self.get(index);
+        }
+    }
+
+    /// Transforms every vector as a point (with a `w` of `1.0`) by `mat` in place
+    pub fn transform_points(&mut self, mat: &Mat4) {
+        let m = mat.raw();
+        for ((x, y), z) in self.x.iter_mut().zip(&mut self.y).zip(&mut self.z) {
+            let (px, py, pz) = (*x, *y, *z);
+            *x = m[0][0] * px + m[1][0] * py + m[2][0] * pz + m[3][0];
+            *y = m[0][1] * px + m[1][1] * py + m[2][1] * pz + m[3][1];
+            *z = m[0][2] * px + m[1][2] * py + m[2][2] * pz + m[3][2];
+        }
+    }
+
+    /// Normalizes every vector in place, see [`normalize_all()`]
+    pub fn normalize(&mut self) {
+        for ((x, y), z) in self.x.iter_mut().zip(&mut self.y).zip(&mut self.z) {
+            let len = (*x * *x + *y * *y + *z * *z).sqrt();
+            let scale = if len < f32::EPSILON { 1.0 } else { 1.0 / len };
+            *x *= scale;
+            *y *= scale;
+            *z *= scale;
+        }
+    }
+
+    /// Computes the dot product of every vector with `other`, writing the results into `out`
+    ///
+    /// # Panics:
+    /// - If `out` is of a different length than the collection.
+    pub fn dot(&self, other: Vec3, out: &mut [f32]) {
+        assert_eq!(
+            self.len(),
+            out.len(),
+            "Output values are of a different length than the collection!"
+        );
+        for (((x, y), z), out) in self.x.iter().zip(&self.y).zip(&self.z).zip(out) {
+            *out = x * other.x + y * other.y + z * other.z;
+        }
+    }
+
+    /// Returns the X components of every vector
+    pub fn x(&self) -> &[f32] {
+        &self.x
+    }
+
+    /// Returns the Y components of every vector
+    pub fn y(&self) -> &[f32] {
+        &self.y
+    }
+
+    /// Returns the Z components of every vector
+    pub fn z(&self) -> &[f32] {
+        &self.z
+    }
+
+    /// Removes every vector
+    pub fn clear(&mut self) {
+        self.x.clear();
+        self.y.clear();
+        self.z.clear();
+    }
+
+    /// Returns the amount of vectors
+    pub fn len(&self) -> usize {
+        self.x.len()
+    }
+
+    /// Returns `true` if there are no vectors
+    pub fn is_empty(&self) -> bool {
+        self.x.is_empty()
+    }
+}
+
+impl Vec4Soa {
+    /// Creates a new empty collection
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Creates a new empty collection that can hold `capacity` vectors without reallocating
+    pub fn with_capacity(capacity: usize) -> Self {
+        Self {
+            x: Vec::with_capacity(capacity),
+            y: Vec::with_capacity(capacity),
+            z: Vec::with_capacity(capacity),
+            w: Vec::with_capacity(capacity),
+        }
+    }
+
+    /// Creates a new collection from a slice of vectors
+    pub fn from_slice(vectors: &[Vec4]) -> Self {
+        let mut soa = Self::with_capacity(vectors.len());
+        soa.extend_from_slice(vectors);
+        soa
+    }
+
+    /// Adds a vector to the end of the collection
+    pub fn push(&mut self, vector: Vec4) {
+        self.x.push(vector.x);
+        self.y.push(vector.y);
+        self.z.push(vector.z);
+        self.w.push(vector.w);
+    }
+
+    /// Adds a slice of vectors to the end of the collection
+    pub fn extend_from_slice(&mut self, vectors: &[Vec4]) {
+        self.x.extend(vectors.iter().map(|vector| vector.x));
+        self.y.extend(vectors.iter().map(|vector| vector.y));
+        self.z.extend(vectors.iter().map(|vector| vector.z));
+        self.w.extend(vectors.iter().map(|vector| vector.w));
+    }
+
+    /// Returns the vector at `index`
+    ///
+    /// # Panics:
+    /// - If `index` is out of bounds.
+    pub fn get(&self, index: usize) -> Vec4 {
+        Vec4::new(self.x[index], self.y[index], self.z[index], self.w[index])
+    }
+
+    /// Replaces the vector at `index`
+    ///
+    /// # Panics:
+    /// - If `index` is out of bounds.
+    pub fn set(&mut self, index: usize, vector: Vec4) {
+        self.x[index] = vector.x;
+        self.y[index] = vector.y;
+        self.z[index] = vector.z;
+        self.w[index] = vector.w;
+    }
+
+    /// Writes every vector into `out`
+    ///
+    /// # Panics:
+    /// - If `out` is of a different length than the collection.
+    pub fn write_to(&self, out: &mut [Vec4]) {
+        assert_eq!(
+            self.len(),
+            out.len(),
+            "Output vectors are of a different length than the collection!"
+        );
+        for (index, out) in out.iter_mut().enumerate() {
+            *out = self.get(index);
+        }
+    }
+
+    /// Multiplies `mat` by every vector in place
+    pub fn transform(&mut self, mat: &Mat4) {
+        let m = mat.raw();
+        for (((x, y), z), w) in self
+            .x
+            .iter_mut()
+            .zip(&mut self.y)
+            .zip(&mut self.z)
+            .zip(&mut self.w)
+        {
+            let (px, py, pz, pw) = (*x, *y, *z, *w);
+            *x = m[0][0] * px + m[1][0] * py + m[2][0] * pz + m[3][0] * pw;
+            *y = m[0][1] * px + m[1][1] * py + m[2][1] * pz + m[3][1] * pw;
+            *z = m[0][2] * px + m[1][2] * py + m[2][2] * pz + m[3][2] * pw;
+            *w = m[0][3] * px + m[1][3] * py + m[2][3] * pz + m[3][3] * pw;
+        }
+    }
+
+    /// Returns the X components of every vector
+    pub fn x(&self) -> &[f32] {
+        &self.x
+    }
+
+    /// Returns the Y components of every vector
+    pub fn y(&self) -> &[f32] {
+        &self.y
+    }
+
+    /// Returns the Z components of every vector
+    pub fn z(&self) -> &[f32] {
+        &self.z
+    }
+
+    /// Returns the W components of every vector
+    pub fn w(&self) -> &[f32] {
+        &self.w
+    }
+
+    /// Removes every vector
+    pub fn clear(&mut self) {
+        self.x.clear();
+        self.y.clear();
+        self.z.clear();
+        self.w.clear();
+    }
+
+    /// Returns the amount of vectors
+    pub fn len(&self) -> usize {
+        self.x.len()
+    }
+
+    /// Returns `true` if there are no vectors
+    pub fn is_empty(&self) -> bool {
+        self.x.is_empty()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::math::EPSILON;
+
+    fn sample_matrix() -> Mat4 {
+        Mat4::from_trs(
+            Vec3::new(1.0, -2.0, 3.0),
+            Quat::from_euler(0.2, 0.9, -0.4),
+            Vec3::new(1.5, 1.5, 0.5),
+        )
+    }
+
+    fn sample_points() -> Vec<Vec3> {
+        (0..13)
+            .map(|i| Vec3::new(i as f32, 1.0 - i as f32 * 0.5, (i * i) as f32 * 0.1))
+            .collect()
+    }
+
+    #[test]
+    fn compose() {
+        let translations = [Vec3::new(1.0, 2.0, 3.0), Vec3::ZERO];
+        let rotations = [Quat::from_euler(0.3, 0.0, 1.0), Quat::new()];
+        let scales = [Vec3::splat(2.0), Vec3::splat(1.0)];
+        let mut out = [Mat4::new(); 2];
+        compose_trs_batch(&translations, &rotations, &scales, &mut out);
+        for i in 0..2 {
+            let expected = Mat4::translate(translations[i])
+                * Mat4::rotate(rotations[i])
+                * Mat4::scale(scales[i]);
+            assert!(out[i].cmp(&expected, EPSILON));
+        }
+    }
+
+    #[test]
+    fn normalize() {
+        let mut vectors = sample_points();
+        vectors.push(Vec3::ZERO);
+        let expected: Vec<_> = vectors.iter().map(|vector| vector.normalize()).collect();
+
+        let mut soa = Vec3Soa::from_slice(&vectors);
+        normalize_all(&mut vectors);
+        soa.normalize();
+        for (i, expected) in expected.into_iter().enumerate() {
+            assert!(vectors[i].cmp(expected, EPSILON));
+            assert!(soa.get(i).cmp(expected, EPSILON));
+        }
+    }
+
+    #[test]
+    fn soa_transform_matches_aos() {
+        let m = sample_matrix();
+        let points = sample_points();
+        let mut expected = vec![Vec3::ZERO; points.len()];
+        m.transform_points(&points, &mut expected);
+
+        let mut soa = Vec3Soa::from_slice(&points);
+        soa.transform_points(&m);
+        let mut out = vec![Vec3::ZERO; points.len()];
+        soa.write_to(&mut out);
+        for (out, expected) in out.into_iter().zip(expected) {
+            assert!(out.cmp(expected, EPSILON));
+        }
+
+        let vectors: Vec<_> = points
+            .iter()
+            .map(|point| Vec4::new(point.x, point.y, point.z, 0.5))
+            .collect();
+        let mut soa = Vec4Soa::from_slice(&vectors);
+        soa.transform(&m);
+        for (i, vector) in vectors.into_iter().enumerate() {
+            assert!(soa.get(i).cmp(m * vector, EPSILON));
+        }
+    }
+
+    #[test]
+    fn soa_dot() {
+        let points = sample_points();
+        let soa = Vec3Soa::from_slice(&points);
+        let direction = Vec3::new(0.0, 1.0, -1.0);
+        let mut out = vec![0.0; points.len()];
+        soa.dot(direction, &mut out);
+        for (point, dot) in points.into_iter().zip(out) {
+            assert!((point.dot(direction) - dot).abs() < EPSILON);
+        }
+    }
+}
@@ -0,0 +1,235 @@
+use bytemuck::{Pod, Zeroable};
+
+use crate::math::{mat4::Mat4, vec3::Vec3};
+
+/// An axis-aligned bounding box, the smallest box aligned to the X, Y and Z axes
+/// that encloses a shape
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq, Zeroable, Pod)]
+pub struct Aabb {
+    /// The corner of the box with the smallest components
+    pub min: Vec3,
+    /// The corner of the box with the largest components
+    pub max: Vec3,
+}
+
+/// A bounding sphere, cheaper to test than an [`Aabb`] but usually less tight
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq, Zeroable, Pod)]
+pub struct Sphere {
+    /// The center of the sphere
+    pub center: Vec3,
+    /// The radius of the sphere
+    pub radius: f32,
+}
+
+impl Aabb {
+    /// Creates a new box from its corners
+    /// - `min` -> the corner with the smallest components
+    /// - `max` -> the corner with the largest components
+    ///
+    /// # Panics:
+    /// - If any component of `min` is larger than the same component of `max`.
+    pub fn new(min: Vec3, max: Vec3) -> Self {
+        assert!(
+            min.x <= max.x && min.y <= max.y && min.z <= max.z,
+            "The minimum corner of a bounding box is larger than the maximum corner!"
+        );
+        Self { min, max }
+    }
+
+    /// Creates a new box from its center and half of its size
+    pub fn from_center(center: Vec3, extents: Vec3) -> Self {
+        Self::new(center - extents, center + extents)
+    }
+
+    /// Creates the smallest box enclosing all of the points, returns [`None`] if there are none
+    pub fn from_points(points: &[Vec3]) -> Option<Self> {
+        let (first, rest) = points.split_first()?;
+        let mut aabb = Self {
+            min: *first,
+            max: *first,
+        };
+        for point in rest {
+            aabb.min = Vec3::new(
+                aabb.min.x.min(point.x),
+                aabb.min.y.min(point.y),
+                aabb.min.z.min(point.z),
+            );
+            aabb.max = Vec3::new(
+                aabb.max.x.max(point.x),
+                aabb.max.y.max(point.y),
+                aabb.max.z.max(point.z),
+            );
+        }
+        Some(aabb)
+    }
+
+    /// Returns the center of the box
+    pub fn center(&self) -> Vec3 {
+        (self.min + self.max) * 0.5
+    }
+
+    /// Returns half of the size of the box
+    pub fn extents(&self) -> Vec3 {
+        (self.max - self.min) * 0.5
+    }
+
+    /// Returns the smallest box enclosing both boxes
+    pub fn union(&self, other: &Self) -> Self {
+        Self {
+            min: Vec3::new(
+                self.min.x.min(other.min.x),
+                self.min.y.min(other.min.y),
+                self.min.z.min(other.min.z),
+            ),
+            max: Vec3::new(
+                self.max.x.max(other.max.x),
+                self.max.y.max(other.max.y),
+                self.max.z.max(other.max.z),
+            ),
+        }
+    }
+
+    /// Returns `true` if the point lies inside of the box or on its surface
+    pub fn contains(&self, point: Vec3) -> bool {
+        (self.min.x <= point.x && point.x <= self.max.x)
+            && (self.min.y <= point.y && point.y <= self.max.y)
+            && (self.min.z <= point.z && point.z <= self.max.z)
+    }
+
+    /// Transforms the box by an affine matrix, returning the axis-aligned box
+    /// that encloses the transformed one
+    ///
+    /// Only the center and the extents are transformed instead of all 8 corners,
+    /// the new extents are the absolute values of the matrix applied to the old ones
+    pub fn transform(&self, mat: &Mat4) -> Self {
+        let m = mat.raw();
+        let center = self.center();
+        let extents = self.extents();
+
+        let mut new_center = [m[3][0], m[3][1], m[3][2]];
+        let mut new_extents = [0.0; 3];
+        for (row, (new_center, new_extents)) in
+            new_center.iter_mut().zip(&mut new_extents).enumerate()
+        {
+            *new_center += m[0][row] * center.x + m[1][row] * center.y + m[2][row] * center.z;
+            *new_extents = m[0][row].abs() * extents.x
+                + m[1][row].abs() * extents.y
+                + m[2][row].abs() * extents.z;
+        }
+        Self::from_center(
+            Vec3::new(new_center[0], new_center[1], new_center[2]),
+            Vec3::new(new_extents[0], new_extents[1], new_extents[2]),
+        )
+    }
+}
+
+impl Sphere {
+    /// Creates a new sphere
+    /// - `center` -> the center of the sphere
+    /// - `radius` -> the radius of the sphere
+    ///
+    /// # Panics:
+    /// - If the radius is negative.
+    pub fn new(center: Vec3, radius: f32) -> Self {
+        assert!(
+            radius >= 0.0,
+            "The radius of a bounding sphere is negative!"
+        );
+        Self { center, radius }
+    }
+
+    /// Creates the sphere that encloses the box
+    pub fn from_aabb(aabb: &Aabb) -> Self {
+        Self::new(aabb.center(), aabb.extents().length())
+    }
+
+    /// Returns `true` if the point lies inside of the sphere or on its surface
+    pub fn contains(&self, point: Vec3) -> bool {
+        self.center.dist_sq(point) <= self.radius * self.radius
+    }
+
+    /// Transforms the sphere by an affine matrix, returning a sphere that encloses
+    /// the transformed one
+    ///
+    /// The radius is scaled by the largest scale of the matrix, so non-uniform
+    /// scaling results in a looser sphere.
+    pub fn transform(&self, mat: &Mat4) -> Self {
+        let m = mat.raw();
+        let scale_sq = (0..3)
+            .map(|column| {
+                m[column][0] * m[column][0]
+                    + m[column][1] * m[column][1]
+                    + m[column][2] * m[column][2]
+            })
+            .fold(0.0, f32::max);
+        let center = Vec3::new(
+            m[0][0] * self.center.x + m[1][0] * self.center.y + m[2][0] * self.center.z + m[3][0],
+            m[0][1] * self.center.x + m[1][1] * self.center.y + m[2][1] * self.center.z + m[3][1],
+            m[0][2] * self.center.x + m[1][2] * self.center.y + m[2][2] * self.center.z + m[3][2],
+        );
+        Self::new(center, self.radius * scale_sq.sqrt())
+    }
+}
+
+impl From<Aabb> for Sphere {
+    fn from(value: Aabb) -> Self {
+        Self::from_aabb(&value)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::math::{EPSILON, quat::Quat};
+
+    #[test]
+    fn aabb_from_points() {
+        assert!(Aabb::from_points(&[]).is_none());
+        let aabb = Aabb::from_points(&[
+            Vec3::new(1.0, -2.0, 0.0),
+            Vec3::new(-1.0, 4.0, 2.0),
+            Vec3::new(0.5, 0.0, -3.0),
+        ])
+        .unwrap();
+        assert!(aabb.min.cmp(Vec3::new(-1.0, -2.0, -3.0), EPSILON));
+        assert!(aabb.max.cmp(Vec3::new(1.0, 4.0, 2.0), EPSILON));
+        assert!(aabb.contains(Vec3::ZERO));
+        assert!(!aabb.contains(Vec3::new(0.0, 5.0, 0.0)));
+    }
+
+    #[test]
+    fn aabb_transform_encloses_corners() {
+        let aabb = Aabb::new(Vec3::new(-1.0, -2.0, -0.5), Vec3::new(3.0, 1.0, 0.5));
+        let m = Mat4::from_trs(
+            Vec3::new(2.0, 0.0, -4.0),
+            Quat::from_euler(0.4, 1.1, -0.2),
+            Vec3::new(1.0, 2.0, 0.5),
+        );
+        let transformed = aabb.transform(&m);
+
+        let mut corners = [Vec3::ZERO; 8];
+        for (i, corner) in corners.iter_mut().enumerate() {
+            *corner = Vec3::new(
+                if i & 1 == 0 { aabb.min.x } else { aabb.max.x },
+                if i & 2 == 0 { aabb.min.y } else { aabb.max.y },
+                if i & 4 == 0 { aabb.min.z } else { aabb.max.z },
+            );
+        }
+        let mut out = [Vec3::ZERO; 8];
+        m.transform_points(&corners, &mut out);
+        let expected = Aabb::from_points(&out).unwrap();
+        assert!(transformed.min.cmp(expected.min, EPSILON));
+        assert!(transformed.max.cmp(expected.max, EPSILON));
+    }
+
+    #[test]
+    fn sphere_transform() {
+        let sphere = Sphere::new(Vec3::new(1.0, 0.0, 0.0), 2.0);
+        let m = Mat4::translate(Vec3::new(0.0, 3.0, 0.0)) * Mat4::scale(Vec3::new(1.0, 3.0, 0.5));
+        let transformed = sphere.transform(&m);
+        assert!(transformed.center.cmp(Vec3::new(1.0, 3.0, 0.0), EPSILON));
+        assert!((transformed.radius - 6.0).abs() < EPSILON);
+    }
+}
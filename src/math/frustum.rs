@@ -0,0 +1,339 @@
+use bytemuck::{Pod, Zeroable};
+
+use crate::math::{
+    batch::Vec3Soa,
+    bounds::{Aabb, Sphere},
+    mat4::Mat4,
+    vec3::Vec3,
+};
+
+/// A plane in 3D space, made of the points `p` for which `normal.dot(p) + distance` is zero
+///
+/// The side of the plane the normal points to is its inside.
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq, Zeroable, Pod)]
+pub struct Plane {
+    /// The unit vector perpendicular to the plane, pointing to its inside
+    pub normal: Vec3,
+    /// The signed distance of the plane from the origin along the normal
+    pub distance: f32,
+}
+
+/// A view frustum, the volume that's visible through a camera, made of 6 planes
+/// pointing inwards
+///
+/// It's extracted from a view-projection matrix, see [`Frustum::from_matrix()`],
+/// and is used to skip drawing objects whose bounding volumes lie outside of it before
+/// any GPU work is recorded for them.
+///
+/// The tests are conservative, an object may be reported visible when it's just outside
+/// of a corner of the frustum, but a visible object is never reported invisible.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct Frustum {
+    planes: [Plane; 6],
+}
+
+impl Plane {
+    /// Creates a new plane from the equation `a * x + b * y + c * z + d = 0`,
+    /// normalizing it so the normal is a unit vector
+    ///
+    /// # Panics:
+    /// - If `(a, b, c)` has a near-zero length.
+    pub fn from_equation(a: f32, b: f32, c: f32, d: f32) -> Self {
+        let len = (a * a + b * b + c * c).sqrt();
+        assert!(
+            len > f32::EPSILON,
+            "Division by near-zero ({}) length in plane normal!",
+            len
+        );
+        let inv_len = 1.0 / len;
+        Self {
+            normal: Vec3::new(a * inv_len, b * inv_len, c * inv_len),
+            distance: d * inv_len,
+        }
+    }
+
+    /// Computes the signed distance of a point from the plane,
+    /// which is positive if the point is on the inside
+    pub fn signed_distance(&self, point: Vec3) -> f32 {
+        self.normal.dot(point) + self.distance
+    }
+}
+
+impl Frustum {
+    /// Index of the left plane in [`Frustum::planes()`]
+    pub const LEFT: usize = 0;
+    /// Index of the right plane in [`Frustum::planes()`]
+    pub const RIGHT: usize = 1;
+    /// Index of the bottom plane in [`Frustum::planes()`]
+    pub const BOTTOM: usize = 2;
+    /// Index of the top plane in [`Frustum::planes()`]
+    pub const TOP: usize = 3;
+    /// Index of the near plane in [`Frustum::planes()`]
+    pub const NEAR: usize = 4;
+    /// Index of the far plane in [`Frustum::planes()`]
+    pub const FAR: usize = 5;
+
+    /// Extracts the frustum from a view-projection matrix (`projection * view`)
+    ///
+    /// The planes come straight from the rows of the matrix (Gribb-Hartmann), the frustum
+    /// is in world space if the matrix transforms from world to clip space, or in the
+    /// object space of a model if the model matrix is multiplied in too.
+    ///
+    /// The near plane is extracted for a depth range of `-1.0..1.0`, which is what
+    /// [`Mat4::perspective()`] produces, for a projection with a depth range of `0.0..1.0`
+    /// (e.g. [`Mat4::ortho()`]) the near plane ends up behind the real one,
+    /// which keeps the tests conservative.
+    ///
+    /// # Panics:
+    /// - If the matrix is degenerate and any of the planes has a near-zero normal.
+    pub fn from_matrix(view_projection: &Mat4) -> Self {
+        let m = view_projection.raw();
+        let row = |i: usize| [m[0][i], m[1][i], m[2][i], m[3][i]];
+        let (r0, r1, r2, r3) = (row(0), row(1), row(2), row(3));
+        let plane = |sign: f32, r: [f32; 4]| {
+            Plane::from_equation(
+                r3[0] + sign * r[0],
+                r3[1] + sign * r[1],
+                r3[2] + sign * r[2],
+                r3[3] + sign * r[3],
+            )
+        };
+
+        Self {
+            planes: [
+                plane(1.0, r0),
+                plane(-1.0, r0),
+                plane(1.0, r1),
+                plane(-1.0, r1),
+                plane(1.0, r2),
+                plane(-1.0, r2),
+            ],
+        }
+    }
+
+    /// Returns the planes of the frustum, indexed by [`Frustum::LEFT`], [`Frustum::RIGHT`], ...
+    pub fn planes(&self) -> &[Plane; 6] {
+        &self.planes
+    }
+
+    /// Returns `true` if the point lies inside of the frustum
+    pub fn contains_point(&self, point: Vec3) -> bool {
+        self.planes
+            .iter()
+            .all(|plane| plane.signed_distance(point) >= 0.0)
+    }
+
+    /// Returns `true` if the sphere is at least partially inside of the frustum
+    pub fn intersects_sphere(&self, sphere: &Sphere) -> bool {
+        // Every plane is tested without an early exit, so the loop has no branches
+        self.planes.iter().fold(true, |visible, plane| {
+            visible & (plane.signed_distance(sphere.center) >= -sphere.radius)
+        })
+    }
+
+    /// Returns `true` if the box is at least partially inside of the frustum
+    ///
+    /// Only the corner furthest along each plane normal is tested, which is the same as
+    /// testing a sphere whose radius is the box extents projected onto the normal.
+    pub fn intersects_aabb(&self, aabb: &Aabb) -> bool {
+        let center = aabb.center();
+        let extents = aabb.extents();
+        self.planes.iter().fold(true, |visible, plane| {
+            let radius = extents.x * plane.normal.x.abs()
+                + extents.y * plane.normal.y.abs()
+                + extents.z * plane.normal.z.abs();
+            visible & (plane.signed_distance(center) >= -radius)
+        })
+    }
+
+    /// Tests every sphere against the frustum, writing the results into `visible`
+    ///
+    /// # Panics:
+    /// - If the spheres and results are of different lengths.
+    pub fn test_spheres(&self, spheres: &[Sphere], visible: &mut [bool]) {
+        assert_eq!(
+            spheres.len(),
+            visible.len(),
+            "Spheres and visibility results are of different lengths!"
+        );
+        for (sphere, visible) in spheres.iter().zip(visible) {
+            *visible = self.intersects_sphere(sphere);
+        }
+    }
+
+    /// Tests every box against the frustum, writing the results into `visible`
+    ///
+    /// # Panics:
+    /// - If the boxes and results are of different lengths.
+    pub fn test_aabbs(&self, aabbs: &[Aabb], visible: &mut [bool]) {
+        assert_eq!(
+            aabbs.len(),
+            visible.len(),
+            "Boxes and visibility results are of different lengths!"
+        );
+        for (aabb, visible) in aabbs.iter().zip(visible) {
+            *visible = self.intersects_aabb(aabb);
+        }
+    }
+
+    /// Tests every sphere against the frustum, with the sphere centers stored
+    /// as a structure of arrays, writing the results into `visible`
+    ///
+    /// Each plane is tested against all of the spheres in a single loop over the component
+    /// arrays, which the compiler vectorizes to test several spheres at once.
+    ///
+    /// # Panics:
+    /// - If the centers, radii and results are of different lengths.
+    pub fn test_spheres_soa(&self, centers: &Vec3Soa, radii: &[f32], visible: &mut [bool]) {
+        assert!(
+            centers.len() == visible.len() && radii.len() == visible.len(),
+            "Sphere centers, radii and visibility results are of different lengths!"
+        );
+        visible.fill(true);
+        for plane in &self.planes {
+            for ((((x, y), z), radius), visible) in centers
+                .x()
+                .iter()
+                .zip(centers.y())
+                .zip(centers.z())
+                .zip(radii)
+                .zip(visible.iter_mut())
+            {
+                let distance =
+                    plane.normal.x * x + plane.normal.y * y + plane.normal.z * z + plane.distance;
+                *visible &= distance >= -radius;
+            }
+        }
+    }
+
+    /// Collects the items whose bounding spheres are at least partially inside of the frustum
+    /// - `spheres` -> the bounding sphere of every item
+    /// - `items` -> the items, e.g. instance data, in the same order as the spheres
+    /// - `out` -> the list the visible items are appended to, e.g. before overwriting the
+    ///   contents of a [`crate::graphics::buffer::BufferHandle`] with it
+    ///
+    /// Returns the amount of visible items.
+    ///
+    /// # Panics:
+    /// - If the spheres and items are of different lengths.
+    pub fn cull_spheres<T: Copy>(
+        &self,
+        spheres: &[Sphere],
+        items: &[T],
+        out: &mut Vec<T>,
+    ) -> usize {
+        assert_eq!(
+            spheres.len(),
+            items.len(),
+            "Spheres and items are of different lengths!"
+        );
+        let len = out.len();
+        out.extend(
+            spheres
+                .iter()
+                .zip(items)
+                .filter(|(sphere, _)| self.intersects_sphere(sphere))
+                .map(|(_, item)| *item),
+        );
+        out.len() - len
+    }
+
+    /// Collects the items whose bounding boxes are at least partially inside of the frustum,
+    /// see [`Frustum::cull_spheres()`]
+    ///
+    /// # Panics:
+    /// - If the boxes and items are of different lengths.
+    pub fn cull_aabbs<T: Copy>(&self, aabbs: &[Aabb], items: &[T], out: &mut Vec<T>) -> usize {
+        assert_eq!(
+            aabbs.len(),
+            items.len(),
+            "Boxes and items are of different lengths!"
+        );
+        let len = out.len();
+        out.extend(
+            aabbs
+                .iter()
+                .zip(items)
+                .filter(|(aabb, _)| self.intersects_aabb(aabb))
+                .map(|(_, item)| *item),
+        );
+        out.len() - len
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::math::EPSILON;
+    use std::f32::consts::PI;
+
+    fn camera() -> Frustum {
+        let projection = Mat4::perspective(PI / 2.0, 1.0, 0.1, 100.0);
+        let view = Mat4::look_at(Vec3::new(0.0, 0.0, 10.0), Vec3::ZERO, Vec3::UP);
+        Frustum::from_matrix(&(projection * view))
+    }
+
+    #[test]
+    fn planes_are_normalized() {
+        for plane in camera().planes() {
+            assert!((plane.normal.length() - 1.0).abs() < EPSILON);
+        }
+        let near = camera().planes()[Frustum::NEAR];
+        assert!((near.signed_distance(Vec3::new(0.0, 0.0, 9.9))).abs() < EPSILON);
+    }
+
+    #[test]
+    fn points() {
+        let frustum = camera();
+        assert!(frustum.contains_point(Vec3::ZERO));
+        assert!(frustum.contains_point(Vec3::new(4.0, -4.0, 0.0)));
+        assert!(!frustum.contains_point(Vec3::new(11.0, 0.0, 0.0)));
+        assert!(!frustum.contains_point(Vec3::new(0.0, 0.0, 11.0)));
+        assert!(!frustum.contains_point(Vec3::new(0.0, 0.0, -95.0)));
+    }
+
+    #[test]
+    fn volumes() {
+        let frustum = camera();
+        let spheres = [
+            Sphere::new(Vec3::ZERO, 1.0),
+            Sphere::new(Vec3::new(12.0, 0.0, 0.0), 1.0),
+            Sphere::new(Vec3::new(12.0, 0.0, 0.0), 2.0),
+            Sphere::new(Vec3::new(0.0, 0.0, 12.0), 1.0),
+        ];
+        let expected = [true, false, true, false];
+
+        let mut visible = [false; 4];
+        frustum.test_spheres(&spheres, &mut visible);
+        assert_eq!(visible, expected);
+
+        let centers: Vec<_> = spheres.iter().map(|sphere| sphere.center).collect();
+        let radii: Vec<_> = spheres.iter().map(|sphere| sphere.radius).collect();
+        let mut visible = [false; 4];
+        frustum.test_spheres_soa(&Vec3Soa::from_slice(&centers), &radii, &mut visible);
+        assert_eq!(visible, expected);
+
+        let aabbs = [
+            Aabb::from_center(Vec3::ZERO, Vec3::splat(1.0)),
+            Aabb::from_center(Vec3::new(11.5, 0.0, 0.0), Vec3::splat(0.4)),
+            Aabb::from_center(Vec3::new(11.5, 0.0, 0.0), Vec3::splat(2.0)),
+        ];
+        let mut visible = [false; 3];
+        frustum.test_aabbs(&aabbs, &mut visible);
+        assert_eq!(visible, [true, false, true]);
+    }
+
+    #[test]
+    fn cull() {
+        let frustum = camera();
+        let spheres = [
+            Sphere::new(Vec3::ZERO, 1.0),
+            Sphere::new(Vec3::new(0.0, 50.0, 0.0), 1.0),
+            Sphere::new(Vec3::new(0.0, 0.0, -50.0), 1.0),
+        ];
+        let mut out = vec![7];
+        assert_eq!(frustum.cull_spheres(&spheres, &[0, 1, 2], &mut out), 2);
+        assert_eq!(out, [7, 0, 2]);
+    }
+}
@@ -2,7 +2,7 @@ use std::ops::Mul;
 
 use bytemuck::{Pod, Zeroable};
 
-use crate::math::{quat::Quat, vec3::Vec3, vec4::Vec4};
+use crate::math::{quat::Quat, simd, vec3::Vec3, vec4::Vec4};
 
 /// A matrix represents a linear transformation that is performed on a vector
 ///
@@ -10,7 +10,9 @@ use crate::math::{quat::Quat, vec3::Vec3, vec4::Vec4};
 /// - Translation -> translating (shifting) a vector in 3D space
 /// - Scaling -> scaling a vector in 3D space
 /// - Rotating -> rotating a vector in 3D space (with the help of quaternions)
-#[repr(C)]
+///
+/// The matrix is 16-byte aligned, each of its columns can be loaded into a SIMD register directly.
+#[repr(C, align(16))]
 #[derive(Debug, Clone, Copy, Zeroable, Pod)]
 pub struct Mat4 {
     /// The vector that determines where the X basis unit vector lands
@@ -88,19 +90,59 @@ impl Mat4 {
         }
     }
 
+    /// Creates a new transformation matrix from a translation, a rotation and a scale
+    ///
+    /// This is the same as `translate(translation) * rotate(rotation) * scale(scale)`,
+    /// without the matrix multiplications
+    /// - `translation` -> the [`Vec3`] containing the translation values for `x`, `y` and `z`
+    /// - `rotation` -> the [`Quat`] that specifies the rotation, it doesn't need to be normalized
+    /// - `scale` -> the [`Vec3`] containing the scalar values for `x`, `y` and `z`
+    ///
+    /// # Panics:
+    /// - If the rotation has a near-zero length.
+    pub fn from_trs(translation: Vec3, rotation: Quat, scale: Vec3) -> Self {
+        let len_sq = rotation.dot(&rotation);
+        assert!(
+            len_sq >= f32::EPSILON * f32::EPSILON,
+            "Division by near-zero ({}) length in quaternion!",
+            len_sq.sqrt()
+        );
+        // Scaling by the squared length normalizes the rotation without a square root
+        let s = 2.0 / len_sq;
+        let (x, y, z, w) = (rotation.x, rotation.y, rotation.z, rotation.w);
+        let (xx, yy, zz) = (x * x * s, y * y * s, z * z * s);
+        let (xy, xz, yz) = (x * y * s, x * z * s, y * z * s);
+        let (xw, yw, zw) = (x * w * s, y * w * s, z * w * s);
+        Self {
+            x_axis: Vec4::new(
+                (1.0 - (yy + zz)) * scale.x,
+                (xy + zw) * scale.x,
+                (xz - yw) * scale.x,
+                0.0,
+            ),
+            y_axis: Vec4::new(
+                (xy - zw) * scale.y,
+                (1.0 - (xx + zz)) * scale.y,
+                (yz + xw) * scale.y,
+                0.0,
+            ),
+            z_axis: Vec4::new(
+                (xz + yw) * scale.z,
+                (yz - xw) * scale.z,
+                (1.0 - (xx + yy)) * scale.z,
+                0.0,
+            ),
+            w_axis: Vec4::new(translation.x, translation.y, translation.z, 1.0),
+        }
+    }
+
     /// Multiplies this matrix by a vector
     ///
     /// This effectively applies the linear transformation described by the matrix
     /// - `self` -> this matrix
     /// - `vec` -> the vector
-    #[rustfmt::skip]
     pub fn multiply_vec(&self, vec: Vec4) -> Vec4 {
-        Vec4 {
-            x: (self.x_axis.x * vec.x) + (self.y_axis.x * vec.y) + (self.z_axis.x * vec.z) + (self.w_axis.x * vec.w),
-            y: (self.x_axis.y * vec.x) + (self.y_axis.y * vec.y) + (self.z_axis.y * vec.z) + (self.w_axis.y * vec.w),
-            z: (self.x_axis.z * vec.x) + (self.y_axis.z * vec.y) + (self.z_axis.z * vec.z) + (self.w_axis.z * vec.w),
-            w: (self.x_axis.w * vec.x) + (self.y_axis.w * vec.y) + (self.z_axis.w * vec.z) + (self.w_axis.w * vec.w),
-        }
+        simd::mat4_mul_vec4(self, vec)
     }
 
     /// Multiplies this matrix by a matrix
@@ -110,13 +152,136 @@ impl Mat4 {
     ///
     /// `self` -> the first matrix
     /// `mat` -> the second matrix
-    #[rustfmt::skip]
     pub fn multiply_mat(&self, mat: &Self) -> Self {
+        simd::mat4_mul_mat4(self, mat)
+    }
+
+    /// Multiplies this matrix by every matrix of `mats`, writing the results into `out`
+    ///
+    /// This is the batched version of [`Mat4::multiply_mat()`], `out[i] = self * mats[i]`
+    ///
+    /// # Panics:
+    /// - If `mats` and `out` are of different lengths.
+    pub fn multiply_many(&self, mats: &[Self], out: &mut [Self]) {
+        assert_eq!(
+            mats.len(),
+            out.len(),
+            "Input and output matrices are of different lengths!"
+        );
+        for (mat, out) in mats.iter().zip(out) {
+            *out = simd::mat4_mul_mat4(self, mat);
+        }
+    }
+
+    /// Transforms every point of `points` by this matrix, writing the results into `out`
+    ///
+    /// Points are transformed with a `w` of `1.0`, so they're affected by translation,
+    /// no perspective division is performed
+    ///
+    /// # Panics:
+    /// - If `points` and `out` are of different lengths.
+    pub fn transform_points(&self, points: &[Vec3], out: &mut [Vec3]) {
+        assert_eq!(
+            points.len(),
+            out.len(),
+            "Input and output points are of different lengths!"
+        );
+        simd::mat4_transform(self, points, 1.0, out);
+    }
+
+    /// Transforms every direction of `directions` by this matrix, writing the results into `out`
+    ///
+    /// Directions are transformed with a `w` of `0.0`, so they're not affected by translation
+    ///
+    /// # Panics:
+    /// - If `directions` and `out` are of different lengths.
+    pub fn transform_directions(&self, directions: &[Vec3], out: &mut [Vec3]) {
+        assert_eq!(
+            directions.len(),
+            out.len(),
+            "Input and output directions are of different lengths!"
+        );
+        simd::mat4_transform(self, directions, 0.0, out);
+    }
+
+    /// Inverts this matrix, which results in the inverse transformation
+    ///
+    /// Multiplying a matrix by its inverse results in the identity matrix
+    ///
+    /// # Panics:
+    /// - If the matrix is singular (its determinant is zero), see [`Mat4::try_inverse()`].
+    pub fn inverse(&self) -> Self {
+        self.try_inverse()
+            .expect("Attempted to invert a singular matrix!")
+    }
+
+    /// Inverts this matrix, returns [`None`] if the matrix is singular (its determinant is zero)
+    pub fn try_inverse(&self) -> Option<Self> {
+        simd::mat4_inverse(self)
+    }
+
+    /// Inverts this matrix, assuming it's an affine transformation
+    /// (its last row is `(0, 0, 0, 1)`), e.g. a model matrix made of translation,
+    /// rotation and scale
+    ///
+    /// This is much cheaper than [`Mat4::inverse()`], as only the upper 3x3 part
+    /// needs a full inverse and the translation is inverted separately
+    ///
+    /// # Panics:
+    /// - If the upper 3x3 part is singular (its determinant is zero).
+    pub fn inverse_affine(&self) -> Self {
+        let c0 = Vec3::new(self.x_axis.x, self.x_axis.y, self.x_axis.z);
+        let c1 = Vec3::new(self.y_axis.x, self.y_axis.y, self.y_axis.z);
+        let c2 = Vec3::new(self.z_axis.x, self.z_axis.y, self.z_axis.z);
+        let translation = Vec3::new(self.w_axis.x, self.w_axis.y, self.w_axis.z);
+
+        let r0 = c1.cross(c2);
+        let r1 = c2.cross(c0);
+        let r2 = c0.cross(c1);
+        let det = c0.dot(r0);
+        assert!(
+            det.abs() > f32::EPSILON,
+            "Attempted to invert a singular matrix!"
+        );
+        let inv_det = 1.0 / det;
+        let (r0, r1, r2) = (r0 * inv_det, r1 * inv_det, r2 * inv_det);
+
+        Self {
+            x_axis: Vec4::new(r0.x, r1.x, r2.x, 0.0),
+            y_axis: Vec4::new(r0.y, r1.y, r2.y, 0.0),
+            z_axis: Vec4::new(r0.z, r1.z, r2.z, 0.0),
+            w_axis: Vec4::new(
+                -r0.dot(translation),
+                -r1.dot(translation),
+                -r2.dot(translation),
+                1.0,
+            ),
+        }
+    }
+
+    /// Inverts this matrix, assuming it's made of only rotation and translation,
+    /// e.g. a view matrix from [`Mat4::look_at()`]
+    ///
+    /// The upper 3x3 part of such matrix is orthonormal, so its inverse is just its transpose
+    ///
+    /// This function does not check the assumption, a matrix with scale results
+    /// in a wrong inverse, use [`Mat4::inverse_affine()`] for those instead.
+    pub fn inverse_orthonormal(&self) -> Self {
+        let c0 = Vec3::new(self.x_axis.x, self.x_axis.y, self.x_axis.z);
+        let c1 = Vec3::new(self.y_axis.x, self.y_axis.y, self.y_axis.z);
+        let c2 = Vec3::new(self.z_axis.x, self.z_axis.y, self.z_axis.z);
+        let translation = Vec3::new(self.w_axis.x, self.w_axis.y, self.w_axis.z);
+
         Self {
-            x_axis: self.multiply_vec(mat.x_axis),
-            y_axis: self.multiply_vec(mat.y_axis),
-            z_axis: self.multiply_vec(mat.z_axis),
-            w_axis: self.multiply_vec(mat.w_axis),
+            x_axis: Vec4::new(c0.x, c1.x, c2.x, 0.0),
+            y_axis: Vec4::new(c0.y, c1.y, c2.y, 0.0),
+            z_axis: Vec4::new(c0.z, c1.z, c2.z, 0.0),
+            w_axis: Vec4::new(
+                -c0.dot(translation),
+                -c1.dot(translation),
+                -c2.dot(translation),
+                1.0,
+            ),
         }
     }
 
@@ -452,6 +617,42 @@ mod tests {
         }
     }
 
+    #[test]
+    fn from_trs() {
+        let translation = Vec3::new(10.0, 5.0, -3.0);
+        let rotation = Quat::from_euler(0.4, -1.3, 2.1);
+        let scale = Vec3::new(2.0, 0.5, 3.0);
+        let expected = Mat4::translate(translation) * Mat4::rotate(rotation) * Mat4::scale(scale);
+        assert!(Mat4::from_trs(translation, rotation, scale).cmp(&expected, EPSILON));
+
+        let unnormalized = Quat::of(
+            rotation.x * 3.0,
+            rotation.y * 3.0,
+            rotation.z * 3.0,
+            rotation.w * 3.0,
+        );
+        assert!(Mat4::from_trs(translation, unnormalized, scale).cmp(&expected, EPSILON));
+    }
+
+    #[test]
+    fn batched() {
+        let m = Mat4::translate(Vec3::new(1.0, 2.0, 3.0)) * Mat4::scale(Vec3::new(2.0, 2.0, 2.0));
+        let points = [Vec3::new(1.0, 0.0, 0.0), Vec3::new(0.0, -1.0, 4.0)];
+        let mut out = [Vec3::ZERO; 2];
+        m.transform_points(&points, &mut out);
+        assert!(out[0].cmp(Vec3::new(3.0, 2.0, 3.0), EPSILON));
+        assert!(out[1].cmp(Vec3::new(1.0, 0.0, 11.0), EPSILON));
+        m.transform_directions(&points, &mut out);
+        assert!(out[0].cmp(Vec3::new(2.0, 0.0, 0.0), EPSILON));
+        assert!(out[1].cmp(Vec3::new(0.0, -2.0, 8.0), EPSILON));
+
+        let mats = [Mat4::rotate(Quat::from_euler(0.5, 0.0, 0.0)), Mat4::new()];
+        let mut products = [Mat4::new(); 2];
+        m.multiply_many(&mats, &mut products);
+        assert!(products[0].cmp(&(m * mats[0]), EPSILON));
+        assert!(products[1].cmp(&m, EPSILON));
+    }
+
     #[test]
     fn transform() {
         {
@@ -472,4 +673,22 @@ mod tests {
             assert!((translation * rotation * scale * vertex).cmp(expected, EPSILON));
         }
     }
+
+    #[test]
+    fn inverse_fast_paths() {
+        let affine = Mat4::from_trs(
+            Vec3::new(4.0, -1.0, 2.5),
+            Quat::from_euler(0.7, -0.3, 1.2),
+            Vec3::new(2.0, 0.5, 3.0),
+        );
+        assert!(affine.inverse_affine().cmp(&affine.inverse(), EPSILON));
+        assert!((affine * affine.inverse_affine()).cmp(&Mat4::new(), EPSILON));
+
+        let view = Mat4::look_at(
+            Vec3::new(3.0, 2.0, -5.0),
+            Vec3::new(0.0, 1.0, 0.0),
+            Vec3::UP,
+        );
+        assert!(view.inverse_orthonormal().cmp(&view.inverse(), EPSILON));
+    }
 }
@@ -1,9 +1,11 @@
 use std::ops::Mul;
 
-use crate::math::vec3::Vec3;
+use crate::math::{simd, vec3::Vec3};
 
 /// A quaternion describes rotation in 3D with an axis and an angle
-#[repr(C)]
+///
+/// The quaternion is 16-byte aligned so it can be loaded into a SIMD register directly.
+#[repr(C, align(16))]
 #[derive(Debug, Clone, Copy, PartialEq)]
 pub struct Quat {
     /// The X component of the rotation axis
@@ -92,13 +94,7 @@ impl Quat {
     /// - `self` -> the first quaternion
     /// - `other` -> the second quaternion
     pub fn multiply(&self, other: &Self) -> Self {
-        Self {
-            x: (self.w * other.x) + (self.x * other.w) + (self.y * other.z) - (self.z * other.y),
-            y: (self.w * other.y) - (self.x * other.z) + (self.y * other.w) + (self.z * other.x),
-            z: (self.w * other.z) + (self.x * other.y) - (self.y * other.x) + (self.z * other.w),
-            w: (self.w * other.w) - (self.x * other.x) - (self.y * other.y) - (self.z * other.z),
-        }
-        .normalize()
+        simd::quat_mul(self, other).normalize()
     }
 
     /// Inverses the quaternion, which results in an inversed rotation effect
@@ -120,16 +116,12 @@ impl Quat {
 
     /// Normalizes the quaternion
     pub fn normalize(&self) -> Self {
-        let len = self.length();
-        if len < f32::EPSILON {
-            panic!("Division by near-zero ({}) length in quaternion!", len);
-        }
-
-        Self {
-            x: self.x / len,
-            y: self.y / len,
-            z: self.z / len,
-            w: self.w / len,
+        match simd::quat_normalize(self) {
+            Some(quat) => quat,
+            None => panic!(
+                "Division by near-zero ({}) length in quaternion!",
+                self.length()
+            ),
         }
     }
 
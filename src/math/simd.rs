@@ -0,0 +1,535 @@
+//! SIMD kernels behind the [`Mat4`] and [`Quat`] operations.
+//!
+//! The kernels are selected at compile time:
+//! - `x86_64` -> SSE2, which every `x86_64` CPU supports
+//! - `aarch64` -> NEON, which every `aarch64` CPU supports
+//! - anything else -> the scalar fallback
+//!
+//! [`Vec4`], [`Mat4`] and [`Quat`] are 16-byte aligned, so every load and store is aligned.
+
+use crate::math::{mat4::Mat4, quat::Quat, vec3::Vec3, vec4::Vec4};
+
+/// Multiplies a matrix by a vector
+pub fn mat4_mul_vec4(mat: &Mat4, vec: Vec4) -> Vec4 {
+    #[cfg(target_arch = "x86_64")]
+    return sse2::mat4_mul_vec4(mat, vec);
+    #[cfg(target_arch = "aarch64")]
+    return neon::mat4_mul_vec4(mat, vec);
+    #[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+    return scalar::mat4_mul_vec4(mat, vec);
+}
+
+/// Multiplies a matrix by a matrix
+pub fn mat4_mul_mat4(a: &Mat4, b: &Mat4) -> Mat4 {
+    #[cfg(target_arch = "x86_64")]
+    return sse2::mat4_mul_mat4(a, b);
+    #[cfg(target_arch = "aarch64")]
+    return neon::mat4_mul_mat4(a, b);
+    #[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+    return scalar::mat4_mul_mat4(a, b);
+}
+
+/// Multiplies a matrix by every vector `(x, y, z, w)` made of a 3D vector and `w`,
+/// writing the `(x, y, z)` of the results into `out`
+pub fn mat4_transform(mat: &Mat4, vecs: &[Vec3], w: f32, out: &mut [Vec3]) {
+    #[cfg(target_arch = "x86_64")]
+    return sse2::mat4_transform(mat, vecs, w, out);
+    #[cfg(target_arch = "aarch64")]
+    return neon::mat4_transform(mat, vecs, w, out);
+    #[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+    return scalar::mat4_transform(mat, vecs, w, out);
+}
+
+/// Inverts a matrix, returns [`None`] if the matrix is singular
+pub fn mat4_inverse(mat: &Mat4) -> Option<Mat4> {
+    #[cfg(target_arch = "x86_64")]
+    return sse2::mat4_inverse(mat);
+    #[cfg(not(target_arch = "x86_64"))]
+    return scalar::mat4_inverse(mat);
+}
+
+/// Multiplies 2 quaternions, without normalizing the result
+pub fn quat_mul(a: &Quat, b: &Quat) -> Quat {
+    #[cfg(target_arch = "x86_64")]
+    return sse2::quat_mul(a, b);
+    #[cfg(target_arch = "aarch64")]
+    return neon::quat_mul(a, b);
+    #[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+    return scalar::quat_mul(a, b);
+}
+
+/// Normalizes a quaternion, returns [`None`] if its length is near zero
+pub fn quat_normalize(quat: &Quat) -> Option<Quat> {
+    #[cfg(target_arch = "x86_64")]
+    return sse2::quat_normalize(quat);
+    #[cfg(target_arch = "aarch64")]
+    return neon::quat_normalize(quat);
+    #[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+    return scalar::quat_normalize(quat);
+}
+
+/// The reference implementations, used when no SIMD instruction set is available
+#[cfg_attr(any(target_arch = "x86_64", target_arch = "aarch64"), allow(dead_code))]
+mod scalar {
+    use super::*;
+
+    #[rustfmt::skip]
+    pub fn mat4_mul_vec4(mat: &Mat4, vec: Vec4) -> Vec4 {
+        Vec4 {
+            x: (mat.x_axis.x * vec.x) + (mat.y_axis.x * vec.y) + (mat.z_axis.x * vec.z) + (mat.w_axis.x * vec.w),
+            y: (mat.x_axis.y * vec.x) + (mat.y_axis.y * vec.y) + (mat.z_axis.y * vec.z) + (mat.w_axis.y * vec.w),
+            z: (mat.x_axis.z * vec.x) + (mat.y_axis.z * vec.y) + (mat.z_axis.z * vec.z) + (mat.w_axis.z * vec.w),
+            w: (mat.x_axis.w * vec.x) + (mat.y_axis.w * vec.y) + (mat.z_axis.w * vec.z) + (mat.w_axis.w * vec.w),
+        }
+    }
+
+    pub fn mat4_mul_mat4(a: &Mat4, b: &Mat4) -> Mat4 {
+        Mat4 {
+            x_axis: mat4_mul_vec4(a, b.x_axis),
+            y_axis: mat4_mul_vec4(a, b.y_axis),
+            z_axis: mat4_mul_vec4(a, b.z_axis),
+            w_axis: mat4_mul_vec4(a, b.w_axis),
+        }
+    }
+
+    pub fn mat4_transform(mat: &Mat4, vecs: &[Vec3], w: f32, out: &mut [Vec3]) {
+        for (vec, out) in vecs.iter().zip(out) {
+            let result = mat4_mul_vec4(mat, Vec4::new(vec.x, vec.y, vec.z, w));
+            *out = Vec3::new(result.x, result.y, result.z);
+        }
+    }
+
+    /// Inverts through the 2x2 sub-determinants of the upper and lower halves (Laplace expansion)
+    #[rustfmt::skip]
+    pub fn mat4_inverse(mat: &Mat4) -> Option<Mat4> {
+        let [
+            [a00, a01, a02, a03],
+            [a10, a11, a12, a13],
+            [a20, a21, a22, a23],
+            [a30, a31, a32, a33],
+        ] = mat.raw();
+
+        let s0 = a00 * a11 - a10 * a01;
+        let s1 = a00 * a12 - a10 * a02;
+        let s2 = a00 * a13 - a10 * a03;
+        let s3 = a01 * a12 - a11 * a02;
+        let s4 = a01 * a13 - a11 * a03;
+        let s5 = a02 * a13 - a12 * a03;
+
+        let c0 = a20 * a31 - a30 * a21;
+        let c1 = a20 * a32 - a30 * a22;
+        let c2 = a20 * a33 - a30 * a23;
+        let c3 = a21 * a32 - a31 * a22;
+        let c4 = a21 * a33 - a31 * a23;
+        let c5 = a22 * a33 - a32 * a23;
+
+        let det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+        if det == 0.0 {
+            return None;
+        }
+
+        let inv = 1.0 / det;
+        Some(Mat4::of([
+            [
+                ( a11 * c5 - a12 * c4 + a13 * c3) * inv,
+                (-a01 * c5 + a02 * c4 - a03 * c3) * inv,
+                ( a31 * s5 - a32 * s4 + a33 * s3) * inv,
+                (-a21 * s5 + a22 * s4 - a23 * s3) * inv,
+            ],
+            [
+                (-a10 * c5 + a12 * c2 - a13 * c1) * inv,
+                ( a00 * c5 - a02 * c2 + a03 * c1) * inv,
+                (-a30 * s5 + a32 * s2 - a33 * s1) * inv,
+                ( a20 * s5 - a22 * s2 + a23 * s1) * inv,
+            ],
+            [
+                ( a10 * c4 - a11 * c2 + a13 * c0) * inv,
+                (-a00 * c4 + a01 * c2 - a03 * c0) * inv,
+                ( a30 * s4 - a31 * s2 + a33 * s0) * inv,
+                (-a20 * s4 + a21 * s2 - a23 * s0) * inv,
+            ],
+            [
+                (-a10 * c3 + a11 * c1 - a12 * c0) * inv,
+                ( a00 * c3 - a01 * c1 + a02 * c0) * inv,
+                (-a30 * s3 + a31 * s1 - a32 * s0) * inv,
+                ( a20 * s3 - a21 * s1 + a22 * s0) * inv,
+            ],
+        ]))
+    }
+
+    pub fn quat_mul(a: &Quat, b: &Quat) -> Quat {
+        Quat::of(
+            (a.w * b.x) + (a.x * b.w) + (a.y * b.z) - (a.z * b.y),
+            (a.w * b.y) - (a.x * b.z) + (a.y * b.w) + (a.z * b.x),
+            (a.w * b.z) + (a.x * b.y) - (a.y * b.x) + (a.z * b.w),
+            (a.w * b.w) - (a.x * b.x) - (a.y * b.y) - (a.z * b.z),
+        )
+    }
+
+    pub fn quat_normalize(quat: &Quat) -> Option<Quat> {
+        let len = quat.dot(quat).sqrt();
+        if len < f32::EPSILON {
+            return None;
+        }
+
+        Some(Quat::of(
+            quat.x / len,
+            quat.y / len,
+            quat.z / len,
+            quat.w / len,
+        ))
+    }
+}
+
+#[cfg(target_arch = "x86_64")]
+mod sse2 {
+    use std::arch::x86_64::*;
+
+    use super::*;
+
+    pub fn mat4_mul_vec4(mat: &Mat4, vec: Vec4) -> Vec4 {
+        let mut out = Vec4::splat(0.0);
+        // SAFETY: SSE2 is always available on x86_64 and every `Vec4` is 16-byte aligned
+        unsafe {
+            let x = _mm_mul_ps(load(&mat.x_axis), _mm_set1_ps(vec.x));
+            let y = _mm_mul_ps(load(&mat.y_axis), _mm_set1_ps(vec.y));
+            let z = _mm_mul_ps(load(&mat.z_axis), _mm_set1_ps(vec.z));
+            let w = _mm_mul_ps(load(&mat.w_axis), _mm_set1_ps(vec.w));
+            store(&mut out, _mm_add_ps(_mm_add_ps(x, y), _mm_add_ps(z, w)));
+        }
+        out
+    }
+
+    pub fn mat4_mul_mat4(a: &Mat4, b: &Mat4) -> Mat4 {
+        Mat4 {
+            x_axis: mat4_mul_vec4(a, b.x_axis),
+            y_axis: mat4_mul_vec4(a, b.y_axis),
+            z_axis: mat4_mul_vec4(a, b.z_axis),
+            w_axis: mat4_mul_vec4(a, b.w_axis),
+        }
+    }
+
+    pub fn mat4_transform(mat: &Mat4, vecs: &[Vec3], w: f32, out: &mut [Vec3]) {
+        let mut result = Vec4::splat(0.0);
+        // SAFETY: SSE2 is always available on x86_64 and every `Vec4` is 16-byte aligned
+        unsafe {
+            let (c0, c1, c2) = (load(&mat.x_axis), load(&mat.y_axis), load(&mat.z_axis));
+            let c3 = _mm_mul_ps(load(&mat.w_axis), _mm_set1_ps(w));
+            for (vec, out) in vecs.iter().zip(out) {
+                let x = _mm_mul_ps(c0, _mm_set1_ps(vec.x));
+                let y = _mm_mul_ps(c1, _mm_set1_ps(vec.y));
+                let z = _mm_mul_ps(c2, _mm_set1_ps(vec.z));
+                store(&mut result, _mm_add_ps(_mm_add_ps(x, y), _mm_add_ps(z, c3)));
+                *out = Vec3::new(result.x, result.y, result.z);
+            }
+        }
+    }
+
+    /// Inverts through the cofactors of the lower 2 columns (the same expansion as glm)
+    pub fn mat4_inverse(mat: &Mat4) -> Option<Mat4> {
+        let mut out = Mat4::new();
+        // SAFETY: SSE2 is always available on x86_64 and every `Vec4` is 16-byte aligned
+        unsafe {
+            let (c0, c1, c2, c3) = (
+                load(&mat.x_axis),
+                load(&mat.y_axis),
+                load(&mat.z_axis),
+                load(&mat.w_axis),
+            );
+            macro_rules! factor {
+                ($a:literal, $b:literal) => {{
+                    let swp0a = _mm_shuffle_ps::<$a>(c3, c2);
+                    let swp0b = _mm_shuffle_ps::<$b>(c3, c2);
+                    let swp00 = _mm_shuffle_ps::<$b>(c2, c1);
+                    let swp01 = _mm_shuffle_ps::<0b10_00_00_00>(swp0a, swp0a);
+                    let swp02 = _mm_shuffle_ps::<0b10_00_00_00>(swp0b, swp0b);
+                    let swp03 = _mm_shuffle_ps::<$a>(c2, c1);
+                    _mm_sub_ps(_mm_mul_ps(swp00, swp01), _mm_mul_ps(swp02, swp03))
+                }};
+            }
+            let fac0 = factor!(0b11_11_11_11, 0b10_10_10_10);
+            let fac1 = factor!(0b11_11_11_11, 0b01_01_01_01);
+            let fac2 = factor!(0b10_10_10_10, 0b01_01_01_01);
+            let fac3 = factor!(0b11_11_11_11, 0b00_00_00_00);
+            let fac4 = factor!(0b10_10_10_10, 0b00_00_00_00);
+            let fac5 = factor!(0b01_01_01_01, 0b00_00_00_00);
+
+            let sign_a = _mm_setr_ps(-1.0, 1.0, -1.0, 1.0);
+            let sign_b = _mm_setr_ps(1.0, -1.0, 1.0, -1.0);
+
+            macro_rules! column {
+                ($lane:literal) => {{
+                    let temp = _mm_shuffle_ps::<$lane>(c1, c0);
+                    _mm_shuffle_ps::<0b10_10_10_00>(temp, temp)
+                }};
+            }
+            let vec0 = column!(0b00_00_00_00);
+            let vec1 = column!(0b01_01_01_01);
+            let vec2 = column!(0b10_10_10_10);
+            let vec3 = column!(0b11_11_11_11);
+
+            macro_rules! inverse_column {
+                ($sign:expr, $v0:expr, $f0:expr, $v1:expr, $f1:expr, $v2:expr, $f2:expr) => {
+                    _mm_mul_ps(
+                        $sign,
+                        _mm_add_ps(
+                            _mm_sub_ps(_mm_mul_ps($v0, $f0), _mm_mul_ps($v1, $f1)),
+                            _mm_mul_ps($v2, $f2),
+                        ),
+                    )
+                };
+            }
+            let inv0 = inverse_column!(sign_b, vec1, fac0, vec2, fac1, vec3, fac2);
+            let inv1 = inverse_column!(sign_a, vec0, fac0, vec2, fac3, vec3, fac4);
+            let inv2 = inverse_column!(sign_b, vec0, fac1, vec1, fac3, vec3, fac5);
+            let inv3 = inverse_column!(sign_a, vec0, fac2, vec1, fac4, vec2, fac5);
+
+            // The first row of the adjugate, dotted with the first column, is the determinant
+            let row0 = _mm_shuffle_ps::<0b00_00_00_00>(inv0, inv1);
+            let row1 = _mm_shuffle_ps::<0b00_00_00_00>(inv2, inv3);
+            let row = _mm_shuffle_ps::<0b10_00_10_00>(row0, row1);
+            let products = _mm_mul_ps(c0, row);
+            let pairs = _mm_add_ps(
+                products,
+                _mm_shuffle_ps::<0b10_11_00_01>(products, products),
+            );
+            let det = _mm_add_ss(pairs, _mm_shuffle_ps::<0b01_00_11_10>(pairs, pairs));
+            let det = _mm_cvtss_f32(det);
+            if det == 0.0 {
+                return None;
+            }
+
+            let inv = _mm_set1_ps(1.0 / det);
+            store(&mut out.x_axis, _mm_mul_ps(inv0, inv));
+            store(&mut out.y_axis, _mm_mul_ps(inv1, inv));
+            store(&mut out.z_axis, _mm_mul_ps(inv2, inv));
+            store(&mut out.w_axis, _mm_mul_ps(inv3, inv));
+        }
+        Some(out)
+    }
+
+    pub fn quat_mul(a: &Quat, b: &Quat) -> Quat {
+        let mut out = Quat::new();
+        // SAFETY: SSE2 is always available on x86_64 and every `Quat` is 16-byte aligned
+        unsafe {
+            let q = _mm_load_ps(&b.x);
+            let wzyx = _mm_shuffle_ps::<0b00_01_10_11>(q, q);
+            let zwxy = _mm_shuffle_ps::<0b01_00_11_10>(q, q);
+            let yxwz = _mm_shuffle_ps::<0b10_11_00_01>(q, q);
+            let w = _mm_mul_ps(_mm_set1_ps(a.w), q);
+            let x = _mm_mul_ps(
+                _mm_set1_ps(a.x),
+                _mm_mul_ps(wzyx, _mm_setr_ps(1.0, -1.0, 1.0, -1.0)),
+            );
+            let y = _mm_mul_ps(
+                _mm_set1_ps(a.y),
+                _mm_mul_ps(zwxy, _mm_setr_ps(1.0, 1.0, -1.0, -1.0)),
+            );
+            let z = _mm_mul_ps(
+                _mm_set1_ps(a.z),
+                _mm_mul_ps(yxwz, _mm_setr_ps(-1.0, 1.0, 1.0, -1.0)),
+            );
+            _mm_store_ps(&mut out.x, _mm_add_ps(_mm_add_ps(w, x), _mm_add_ps(y, z)));
+        }
+        out
+    }
+
+    pub fn quat_normalize(quat: &Quat) -> Option<Quat> {
+        let mut out = Quat::new();
+        // SAFETY: SSE2 is always available on x86_64 and every `Quat` is 16-byte aligned
+        unsafe {
+            let q = _mm_load_ps(&quat.x);
+            let squares = _mm_mul_ps(q, q);
+            let pairs = _mm_add_ps(squares, _mm_shuffle_ps::<0b10_11_00_01>(squares, squares));
+            let sum = _mm_add_ps(pairs, _mm_shuffle_ps::<0b01_00_11_10>(pairs, pairs));
+            let len = _mm_sqrt_ps(sum);
+            if _mm_cvtss_f32(len) < f32::EPSILON {
+                return None;
+            }
+            _mm_store_ps(&mut out.x, _mm_div_ps(q, len));
+        }
+        Some(out)
+    }
+
+    /// Loads an aligned vector
+    ///
+    /// # Safety:
+    /// - SSE2 must be available, which it always is on x86_64.
+    #[inline(always)]
+    unsafe fn load(vec: &Vec4) -> __m128 {
+        // SAFETY: `Vec4` is 16-byte aligned and made of 4 adjacent f32 values
+        unsafe { _mm_load_ps(&vec.x) }
+    }
+
+    /// Stores into an aligned vector
+    ///
+    /// # Safety:
+    /// - SSE2 must be available, which it always is on x86_64.
+    #[inline(always)]
+    unsafe fn store(vec: &mut Vec4, value: __m128) {
+        // SAFETY: `Vec4` is 16-byte aligned and made of 4 adjacent f32 values
+        unsafe { _mm_store_ps(&mut vec.x, value) }
+    }
+}
+
+#[cfg(target_arch = "aarch64")]
+mod neon {
+    use std::arch::aarch64::*;
+
+    use super::*;
+
+    pub fn mat4_mul_vec4(mat: &Mat4, vec: Vec4) -> Vec4 {
+        let mut out = Vec4::splat(0.0);
+        // SAFETY: NEON is always available on aarch64 and every `Vec4` is made of 4 adjacent f32 values
+        unsafe {
+            let x = vmulq_n_f32(vld1q_f32(&mat.x_axis.x), vec.x);
+            let y = vmulq_n_f32(vld1q_f32(&mat.y_axis.x), vec.y);
+            let z = vmulq_n_f32(vld1q_f32(&mat.z_axis.x), vec.z);
+            let w = vmulq_n_f32(vld1q_f32(&mat.w_axis.x), vec.w);
+            vst1q_f32(&mut out.x, vaddq_f32(vaddq_f32(x, y), vaddq_f32(z, w)));
+        }
+        out
+    }
+
+    pub fn mat4_mul_mat4(a: &Mat4, b: &Mat4) -> Mat4 {
+        Mat4 {
+            x_axis: mat4_mul_vec4(a, b.x_axis),
+            y_axis: mat4_mul_vec4(a, b.y_axis),
+            z_axis: mat4_mul_vec4(a, b.z_axis),
+            w_axis: mat4_mul_vec4(a, b.w_axis),
+        }
+    }
+
+    pub fn mat4_transform(mat: &Mat4, vecs: &[Vec3], w: f32, out: &mut [Vec3]) {
+        let mut result = Vec4::splat(0.0);
+        // SAFETY: NEON is always available on aarch64 and every `Vec4` is made of 4 adjacent f32 values
+        unsafe {
+            let c0 = vld1q_f32(&mat.x_axis.x);
+            let c1 = vld1q_f32(&mat.y_axis.x);
+            let c2 = vld1q_f32(&mat.z_axis.x);
+            let c3 = vmulq_n_f32(vld1q_f32(&mat.w_axis.x), w);
+            for (vec, out) in vecs.iter().zip(out) {
+                let x = vmulq_n_f32(c0, vec.x);
+                let y = vmulq_n_f32(c1, vec.y);
+                let z = vmulq_n_f32(c2, vec.z);
+                vst1q_f32(&mut result.x, vaddq_f32(vaddq_f32(x, y), vaddq_f32(z, c3)));
+                *out = Vec3::new(result.x, result.y, result.z);
+            }
+        }
+    }
+
+    pub fn quat_mul(a: &Quat, b: &Quat) -> Quat {
+        const SIGN_X: [f32; 4] = [1.0, -1.0, 1.0, -1.0];
+        const SIGN_Y: [f32; 4] = [1.0, 1.0, -1.0, -1.0];
+        const SIGN_Z: [f32; 4] = [-1.0, 1.0, 1.0, -1.0];
+        let mut out = Quat::new();
+        // SAFETY: NEON is always available on aarch64 and every `Quat` is made of 4 adjacent f32 values
+        unsafe {
+            let q = vld1q_f32(&b.x);
+            let yxwz = vrev64q_f32(q);
+            let zwxy = vextq_f32::<2>(q, q);
+            let wzyx = vrev64q_f32(zwxy);
+            let w = vmulq_n_f32(q, a.w);
+            let x = vmulq_n_f32(vmulq_f32(wzyx, vld1q_f32(SIGN_X.as_ptr())), a.x);
+            let y = vmulq_n_f32(vmulq_f32(zwxy, vld1q_f32(SIGN_Y.as_ptr())), a.y);
+            let z = vmulq_n_f32(vmulq_f32(yxwz, vld1q_f32(SIGN_Z.as_ptr())), a.z);
+            vst1q_f32(&mut out.x, vaddq_f32(vaddq_f32(w, x), vaddq_f32(y, z)));
+        }
+        out
+    }
+
+    pub fn quat_normalize(quat: &Quat) -> Option<Quat> {
+        let mut out = Quat::new();
+        // SAFETY: NEON is always available on aarch64 and every `Quat` is made of 4 adjacent f32 values
+        unsafe {
+            let q = vld1q_f32(&quat.x);
+            let len = vaddvq_f32(vmulq_f32(q, q)).sqrt();
+            if len < f32::EPSILON {
+                return None;
+            }
+            vst1q_f32(&mut out.x, vdivq_f32(q, vdupq_n_f32(len)));
+        }
+        Some(out)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::math::{EPSILON, vec3::Vec3};
+
+    fn sample_matrix() -> Mat4 {
+        Mat4::translate(Vec3::new(3.0, -2.0, 7.5))
+            * Mat4::rotate(Quat::from_euler(0.3, -1.2, 0.7))
+            * Mat4::scale(Vec3::new(2.0, 0.5, 1.5))
+    }
+
+    #[rustfmt::skip]
+    fn general_matrix() -> Mat4 {
+        Mat4::of([
+            [ 2.0, 1.0, 0.0,  3.0],
+            [ 1.0, 3.0, 2.0,  1.0],
+            [ 0.0, 1.0, 4.0, -1.0],
+            [-2.0, 0.5, 1.0,  5.0],
+        ])
+    }
+
+    #[test]
+    fn alignment() {
+        assert_eq!(align_of::<Vec4>(), 16);
+        assert_eq!(align_of::<Mat4>(), 16);
+        assert_eq!(align_of::<Quat>(), 16);
+        assert_eq!(size_of::<Mat4>(), 64);
+    }
+
+    #[test]
+    fn mul_matches_scalar() {
+        let a = sample_matrix();
+        let b = general_matrix();
+        let v = Vec4::new(1.5, -2.0, 0.25, 1.0);
+        assert!(mat4_mul_vec4(&a, v).cmp(scalar::mat4_mul_vec4(&a, v), EPSILON));
+        assert!(mat4_mul_mat4(&a, &b).cmp(&scalar::mat4_mul_mat4(&a, &b), EPSILON));
+    }
+
+    #[test]
+    fn inverse_matches_scalar() {
+        for m in [sample_matrix(), general_matrix()] {
+            let inverse = mat4_inverse(&m).unwrap();
+            assert!(inverse.cmp(&scalar::mat4_inverse(&m).unwrap(), EPSILON));
+            assert!((m * inverse).cmp(&Mat4::new(), EPSILON));
+            assert!((inverse * m).cmp(&Mat4::new(), EPSILON));
+        }
+    }
+
+    #[test]
+    fn transform_matches_scalar() {
+        let m = sample_matrix();
+        let vecs = [Vec3::new(1.0, 2.0, 3.0), Vec3::new(-4.0, 0.5, 0.0)];
+        for w in [0.0, 1.0] {
+            let mut out = [Vec3::ZERO; 2];
+            let mut expected = [Vec3::ZERO; 2];
+            mat4_transform(&m, &vecs, w, &mut out);
+            scalar::mat4_transform(&m, &vecs, w, &mut expected);
+            assert!(out[0].cmp(expected[0], EPSILON) && out[1].cmp(expected[1], EPSILON));
+        }
+    }
+
+    #[test]
+    fn singular_inverse() {
+        let m = Mat4::scale(Vec3::new(1.0, 0.0, 1.0));
+        assert!(mat4_inverse(&m).is_none());
+        assert!(scalar::mat4_inverse(&m).is_none());
+    }
+
+    #[test]
+    fn quat_matches_scalar() {
+        let a = Quat::from_euler(0.4, 1.1, -0.3);
+        let b = Quat::of(0.5, -1.0, 2.0, 0.25);
+        assert!(quat_mul(&a, &b).cmp(&scalar::quat_mul(&a, &b), EPSILON));
+        assert!(quat_mul(&b, &a).cmp(&scalar::quat_mul(&b, &a), EPSILON));
+        let normalized = quat_normalize(&b).unwrap();
+        assert!(normalized.cmp(&scalar::quat_normalize(&b).unwrap(), EPSILON));
+        assert!((normalized.length() - 1.0).abs() < EPSILON);
+        assert!(quat_normalize(&Quat::of(0.0, 0.0, 0.0, 0.0)).is_none());
+    }
+}
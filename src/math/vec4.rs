@@ -11,7 +11,9 @@ use crate::math::vec3::Vec3;
 /// - Multiplying a vector by a 4x4 matrix which is required if we want to encode translation information
 /// - Locking translation by setting `w` to `0.0` (now it represents a direction, not a point)
 /// - Perspective division (when the GPU performs the vertex shader, the vertex (as a `Vec4`) is divided by its `w` coordinate, hence the name perspective division)
-#[repr(C)]
+///
+/// The vector is 16-byte aligned so it can be loaded into a SIMD register directly.
+#[repr(C, align(16))]
 #[derive(Debug, Clone, Copy, Zeroable, Pod)]
 pub struct Vec4 {
     /// The X component of the vector